@@ -28,6 +28,11 @@
 #include <signal.h>
 #include <limits.h>
 #include <unistd.h>
+#if HAVE_FORK
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 #include "libavformat/avformat.h"
 #include "libavdevice/avdevice.h"
 #include "libswscale/swscale.h"
@@ -206,6 +211,9 @@ static int64_t input_ts_offset = 0;
 static int file_overwrite = 0;
 static AVDictionary *metadata;
 static int do_benchmark = 0;
+static int do_benchmark_stages = 0;
+static char *benchmark_filename;
+static int nb_segments = 0;
 static int do_hex_dump = 0;
 static int do_pkt_dump = 0;
 static int do_psnr = 0;
@@ -257,7 +265,9 @@ static int64_t timer_start;
 static uint8_t *input_tmp;
 static uint8_t *audio_buf;
 static uint8_t *audio_out;
+static uint8_t *audio_layout_buf;
 static unsigned int allocated_audio_out_size, allocated_audio_buf_size, input_tmp_size;
+static unsigned int allocated_audio_layout_buf_size;
 
 static short *samples;
 
@@ -267,6 +277,34 @@ static AVBitStreamFilterContext *subtitle_bitstream_filters=NULL;
 
 #define DEFAULT_PASS_LOGFILENAME_PREFIX "ffmpeg2pass"
 
+enum Stage {
+    STAGE_DEMUX,
+    STAGE_DECODE,
+    STAGE_FILTER,
+    STAGE_SCALE,
+    STAGE_ENCODE,
+    STAGE_MUX,
+    STAGE_NB
+};
+
+static const char *const stage_names[STAGE_NB] = {
+    "demux", "decode", "filter", "scale", "encode", "mux"
+};
+
+typedef struct StageClock {
+    int64_t wall;
+    int64_t cpu;
+} StageClock;
+
+typedef struct StageStats {
+    int64_t wall;            /* wall clock time spent in the stage, in microseconds */
+    int64_t cpu;             /* user CPU time of the process meanwhile, all threads */
+    int64_t in;              /* packets or frames fed to the stage */
+    int64_t out;             /* packets or frames produced by the stage */
+    int queue;               /* packets or frames held by the stage */
+    int max_queue;
+} StageStats;
+
 struct InputStream;
 
 typedef struct {
@@ -329,6 +367,7 @@ typedef struct OutputStream {
     int reformat_pair;
     AVAudioConvert *reformat_ctx;
     AVFifoBuffer *fifo;     /* for compression: one audio fifo per codec */
+    int pcm_interleave;     /* sample size of planar PCM stream copied as packed PCM */
     FILE *logfile;
 
 #if CONFIG_AVFILTER
@@ -342,6 +381,8 @@ typedef struct OutputStream {
 
    int sws_flags;
    AVDictionary *opts;
+
+   StageStats stage[STAGE_NB]; /* filter, scale, encode and mux */
 } OutputStream;
 
 static OutputStream **output_streams_for_file[MAX_FILES] = { NULL };
@@ -366,6 +407,8 @@ typedef struct InputStream {
     AVDictionary *opts;
     uint8_t *pkt_data_to_free;
     AVRational frame_rate;
+
+    StageStats stage[STAGE_NB]; /* demux and decode */
 } InputStream;
 
 typedef struct InputFile {
@@ -387,6 +430,44 @@ static int         nb_input_streams = 0;
 static InputFile   *input_files   = NULL;
 static int         nb_input_files   = 0;
 
+static int64_t getutime(void);
+static int64_t getmaxrss(void);
+
+static void stage_clock(StageClock *c)
+{
+    c->wall = do_benchmark_stages ? av_gettime() : 0;
+    c->cpu  = do_benchmark_stages ? getutime()   : 0;
+}
+
+static void stage_queue(StageStats *s, int depth)
+{
+    s->queue     = depth;
+    s->max_queue = FFMAX(s->max_queue, depth);
+}
+
+/* account the time since stage_clock() to a stage, the stage queue being
+   what went in and did not come out yet */
+static void stage_add(StageStats *s, const StageClock *c, int in, int out)
+{
+    if (!do_benchmark_stages)
+        return;
+    s->wall += av_gettime() - c->wall;
+    s->cpu  += getutime() - c->cpu;
+    s->in   += in;
+    s->out  += out;
+    stage_queue(s, FFMAX(s->in - s->out, 0));
+}
+
+/* number of packets of a stream waiting in a lavf packet list */
+static int packet_queue_depth(const AVPacketList *pktl, int stream_index)
+{
+    int n = 0;
+
+    for (; pktl; pktl = pktl->next)
+        n += pktl->pkt.stream_index == stream_index;
+    return n;
+}
+
 #if CONFIG_AVFILTER
 
 static int configure_video_filters(InputStream *ist, OutputStream *ost)
@@ -607,6 +688,7 @@ static int ffmpeg_exit(int ret)
     if (vstats_file)
         fclose(vstats_file);
     av_free(vstats_filename);
+    av_free(benchmark_filename);
 
     av_free(streamid_map);
     av_free(stream_maps);
@@ -624,7 +706,9 @@ static int ffmpeg_exit(int ret)
     av_free(audio_buf);
     av_free(audio_out);
     av_free(input_tmp);
+    av_free(audio_layout_buf);
     allocated_audio_buf_size= allocated_audio_out_size= 0;
+    allocated_audio_layout_buf_size= 0;
     av_free(samples);
 
 #if CONFIG_AVFILTER
@@ -688,15 +772,31 @@ static void *grow_array(void *array, int elem_size, int *size, int new_size)
     return array;
 }
 
+static int sample_fmt_supported(AVCodec *codec, enum AVSampleFormat sample_fmt)
+{
+    const enum AVSampleFormat *p;
+
+    if (!codec || !codec->sample_fmts)
+        return 0;
+    for (p = codec->sample_fmts; *p != -1; p++)
+        if (*p == sample_fmt)
+            return 1;
+    return 0;
+}
+
 static void choose_sample_fmt(AVStream *st, AVCodec *codec)
 {
     if(codec && codec->sample_fmts){
         const enum AVSampleFormat *p= codec->sample_fmts;
+        enum AVSampleFormat packed_fmt = av_get_packed_sample_fmt(st->codec->sample_fmt);
         for(; *p!=-1; p++){
             if(*p == st->codec->sample_fmt)
                 break;
         }
-        if (*p == -1) {
+        if (*p == -1 && sample_fmt_supported(codec, packed_fmt)) {
+            /* planar input is interleaved in do_audio_out() */
+            st->codec->sample_fmt = packed_fmt;
+        } else if (*p == -1) {
             if((codec->capabilities & CODEC_CAP_LOSSLESS) && av_get_sample_fmt_name(st->codec->sample_fmt) > av_get_sample_fmt_name(codec->sample_fmts[0]))
                 av_log(NULL, AV_LOG_ERROR, "Convertion will not be lossless'\n");
             av_log(NULL, AV_LOG_WARNING,
@@ -709,6 +809,96 @@ static void choose_sample_fmt(AVStream *st, AVCodec *codec)
     }
 }
 
+/**
+ * Have the decoder output planar samples if the encoder takes them,
+ * so that they are not interleaved just to be split up again.
+ */
+static void choose_planar_sample_fmt(OutputStream *ost, InputStream *ist)
+{
+    AVCodecContext *enc = ost->st->codec;
+    AVCodecContext *dec = ist->st->codec;
+    AVCodec *decoder = ist->dec ? ist->dec : avcodec_find_decoder(dec->codec_id);
+    enum AVSampleFormat planar_fmt = av_get_planar_sample_fmt(dec->sample_fmt);
+    int i;
+
+    /* mapped channels are taken from the planes of the decoded samples
+       as they are merged, planar sources need not be interleaved first */
+    if (ost->nb_audio_channel_maps > 0) {
+        for (i = 0; i < ost->nb_source_indexes; i++) {
+            InputStream *src = &input_streams[ost->source_index[i]];
+            AVCodecContext *d = src->st->codec;
+            enum AVSampleFormat fmt = av_get_planar_sample_fmt(d->sample_fmt);
+            decoder = src->dec ? src->dec : avcodec_find_decoder(d->codec_id);
+            if (fmt != AV_SAMPLE_FMT_NONE && d->channels > 1 &&
+                d->request_sample_fmt == AV_SAMPLE_FMT_NONE &&
+                sample_fmt_supported(decoder, fmt)) {
+                d->request_sample_fmt = fmt;
+                d->sample_fmt = fmt;
+            }
+        }
+        return;
+    }
+
+    if (planar_fmt == AV_SAMPLE_FMT_NONE ||
+        ost->nb_source_indexes > 1 || audio_sync_method > 1 ||
+        (dec->request_sample_fmt != AV_SAMPLE_FMT_NONE &&
+         dec->request_sample_fmt != planar_fmt) ||
+        (enc->channels && enc->channels != dec->channels) ||
+        enc->sample_rate != dec->sample_rate ||
+        !sample_fmt_supported(decoder, planar_fmt) ||
+        !sample_fmt_supported(ost->enc, planar_fmt))
+        return;
+
+    dec->request_sample_fmt = planar_fmt;
+    dec->sample_fmt = planar_fmt;
+    enc->sample_fmt = planar_fmt;
+}
+
+static enum CodecID pcm_packed_codec_id(enum CodecID id)
+{
+    switch (id) {
+    case CODEC_ID_PCM_S16LE_PLANAR: return CODEC_ID_PCM_S16LE;
+    case CODEC_ID_PCM_S24LE_PLANAR: return CODEC_ID_PCM_S24LE;
+    case CODEC_ID_PCM_S32LE_PLANAR: return CODEC_ID_PCM_S32LE;
+    default:                        return CODEC_ID_NONE;
+    }
+}
+
+static uint8_t *audio_layout_alloc(int size)
+{
+    av_fast_malloc(&audio_layout_buf, &allocated_audio_layout_buf_size, size);
+    if (!audio_layout_buf) {
+        av_log(NULL, AV_LOG_ERROR, "out of memory in do_audio_out\n");
+        ffmpeg_exit(1);
+    }
+    return audio_layout_buf;
+}
+
+/**
+ * Drop (delta < 0) or prepend silence (delta > 0) at the start of each
+ * plane of a planar buffer.
+ * @param delta number of bytes per plane
+ */
+static uint8_t *audio_shift_planes(const uint8_t *buf, int size, int delta, int channels)
+{
+    int c, plane_size = size / channels, out_size = plane_size + delta;
+
+    av_fast_malloc(&input_tmp, &input_tmp_size, out_size * channels);
+    if (!input_tmp) {
+        av_log(NULL, AV_LOG_ERROR, "out of memory in do_audio_out\n");
+        ffmpeg_exit(1);
+    }
+    for (c = 0; c < channels; c++) {
+        uint8_t *dst = input_tmp + c*out_size;
+        if (delta > 0) {
+            memset(dst, 0, delta);
+            memcpy(dst + delta, buf + c*plane_size, plane_size);
+        } else
+            memcpy(dst, buf + c*plane_size - delta, out_size);
+    }
+    return input_tmp;
+}
+
 static void choose_sample_rate(AVStream *st, AVCodec *codec)
 {
     if(codec && codec->supported_samplerates){
@@ -804,9 +994,14 @@ get_sync_ipts(const OutputStream *ost)
     return (double)(ist->pts - start_time)/AV_TIME_BASE;
 }
 
-static void write_frame(AVFormatContext *s, AVPacket *pkt, AVCodecContext *avctx, AVBitStreamFilterContext *bsfc){
+static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost){
+    AVCodecContext *avctx = ost->st->codec;
+    AVBitStreamFilterContext *bsfc = ost->bitstream_filters;
+    StageClock t0;
     int ret;
 
+    stage_clock(&t0);
+
     while(bsfc){
         AVPacket new_pkt= *pkt;
         int a= av_bitstream_filter_filter(bsfc, avctx, NULL,
@@ -834,6 +1029,9 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, AVCodecContext *avctx
         print_error("av_interleaved_write_frame()", ret);
         ffmpeg_exit(1);
     }
+    stage_add(&ost->stage[STAGE_MUX], &t0, 1, 1);
+    if (do_benchmark_stages)
+        stage_queue(&ost->stage[STAGE_MUX], packet_queue_depth(s->packet_buffer, ost->index));
 }
 
 static int audiomerge_init(AudioMergeContext *a, int out_channels, int sample_size)
@@ -857,17 +1055,24 @@ static int audiomerge_init(AudioMergeContext *a, int out_channels, int sample_si
     return 0;
 }
 
+/**
+ * @param in_planar whether the channels of input are in planes
+ */
 static int audiomerge_add_channel(AudioMergeContext *a, uint8_t *input,
                                   unsigned in_channel, unsigned out_channel,
-                                  unsigned in_channels, unsigned samples)
+                                  unsigned in_channels, unsigned samples,
+                                  int in_planar)
 {
+    unsigned in_stride  = in_planar ? a->sample_size : a->sample_size*in_channels;
+    unsigned out_stride = a->sample_size*a->out_channels;
+    uint8_t *out;
+
     if (out_channel >= a->out_channels)
         return -1;
 
     //fprintf(stderr, "in channel %d out channel %d samples %d\n", in_channel, out_channel, samples);
 
-    if (a->buf_index[out_channel] +
-        (int64_t)samples*a->sample_size*a->out_channels >= a->buf_size) {
+    if (a->buf_index[out_channel] + (int64_t)samples*out_stride >= a->buf_size) {
         uint8_t *buf;
         if (a->buf_size + (int64_t)samples*a->sample_size*a->out_channels >= UINT_MAX)
             goto error;
@@ -881,11 +1086,13 @@ static int audiomerge_add_channel(AudioMergeContext *a, uint8_t *input,
         a->buf = buf;
     }
 
-    input += a->sample_size*in_channel;
+    input += in_channel*(in_planar ? samples*a->sample_size : a->sample_size);
+    out = a->buf + a->buf_index[out_channel];
+    a->buf_index[out_channel] += samples*out_stride;
     while (samples--) {
-        memcpy(a->buf + a->buf_index[out_channel], input, a->sample_size);
-        a->buf_index[out_channel] += a->sample_size*a->out_channels;
-        input += a->sample_size*in_channels;
+        memcpy(out, input, a->sample_size);
+        out   += out_stride;
+        input += in_stride;
     }
 
     a->last_sample_pos = FFMAX(a->buf_index[out_channel], a->last_sample_pos);
@@ -946,12 +1153,15 @@ static void do_audio_out(AVFormatContext *s,
 {
     uint8_t *buftmp;
     int64_t audio_out_size, audio_buf_size;
-    int size_out, frame_bytes, ret, resample_changed, i, in_channels;
+    int size_out, frame_bytes, ret, resample_changed, i, in_channels, planar, in_planar;
     AVCodecContext *enc= ost->st->codec;
     AVCodecContext *dec= ist->st->codec;
     int osize = av_get_bytes_per_sample(enc->sample_fmt);
     int isize = av_get_bytes_per_sample(dec->sample_fmt);
     const int coded_bps = av_get_bits_per_sample(enc->codec->id);
+    enum AVSampleFormat dec_fmt = dec->sample_fmt;
+    enum AVSampleFormat enc_fmt = av_get_packed_sample_fmt(enc->sample_fmt);
+    StageClock t0;
 
     if (ost->nb_audio_channel_maps > 0)
         in_channels = enc->channels; // do not mix channels
@@ -961,7 +1171,9 @@ static void do_audio_out(AVFormatContext *s,
     if (enc->channels != in_channels)
         ost->audio_resample = 1;
 
-    resample_changed = ost->resample_sample_fmt != dec->sample_fmt ||
+    /* a planar/packed layout change alone is handled below */
+    resample_changed = av_get_packed_sample_fmt(ost->resample_sample_fmt) !=
+                       av_get_packed_sample_fmt(dec->sample_fmt) ||
         (!ost->nb_audio_channel_maps &&
          ost->resample_channels != dec->channels) ||
         ost->resample_sample_rate != dec->sample_rate;
@@ -984,18 +1196,18 @@ static void do_audio_out(AVFormatContext *s,
         }
         /* if audio_sync_method is >1 the resampler is needed for audio drift compensation */
         if (audio_sync_method <= 1 &&
-            ost->resample_sample_fmt  == enc->sample_fmt &&
+            av_get_packed_sample_fmt(ost->resample_sample_fmt) == enc_fmt &&
             ost->resample_channels    == enc->channels   &&
             ost->resample_sample_rate == enc->sample_rate) {
             ost->resample = NULL;
             ost->audio_resample = 0;
         } else {
             ost->audio_resample = 1;
-            if (dec->sample_fmt != AV_SAMPLE_FMT_S16 && enc->sample_fmt != AV_SAMPLE_FMT_S16)
+            if (av_get_packed_sample_fmt(dec->sample_fmt) != AV_SAMPLE_FMT_S16 && enc_fmt != AV_SAMPLE_FMT_S16)
                 av_log(NULL, AV_LOG_ERROR, "Warning, using s16 intermediate sample format for resampling\n");
             ost->resample = av_audio_resample_init(enc->channels,    in_channels,
                                                    enc->sample_rate, dec->sample_rate,
-                                                   enc->sample_fmt,  dec->sample_fmt,
+                                                   enc_fmt, av_get_packed_sample_fmt(dec->sample_fmt),
                                                    32, 10, 0, 0.97);
             if (!ost->resample) {
                 av_log(NULL, AV_LOG_ERROR, "Can not resample %d channels @ %d Hz to %d channels @ %d Hz\n",
@@ -1006,20 +1218,38 @@ static void do_audio_out(AVFormatContext *s,
         }
     }
 
+    /* planar samples only reach an encoder taking the very same format
+       untouched, everything else works on interleaved samples */
+    planar = av_sample_fmt_is_planar(dec_fmt) && dec_fmt == enc->sample_fmt &&
+             !ost->audio_resample && !ost->nb_audio_channel_maps && enc->frame_size <= 1;
+    in_planar = av_sample_fmt_is_planar(dec_fmt);
+    if (planar) {
+        enc_fmt = enc->sample_fmt;
+    } else if (in_planar && ost->nb_audio_channel_maps > 0) {
+        /* the channels are taken from the planes when merged */
+        dec_fmt = av_get_packed_sample_fmt(dec_fmt);
+    } else if (in_planar) {
+        int nb_samples = size / (isize * dec->channels);
+        av_samples_copy_layout(audio_layout_alloc(size), buf, dec->channels, nb_samples, isize, 0);
+        buf       = audio_layout_buf;
+        dec_fmt   = av_get_packed_sample_fmt(dec_fmt);
+        in_planar = 0;
+    }
+
 #define MAKE_SFMT_PAIR(a,b) ((a)+AV_SAMPLE_FMT_NB*(b))
-    if (!ost->audio_resample && dec->sample_fmt!=enc->sample_fmt &&
-        MAKE_SFMT_PAIR(enc->sample_fmt,dec->sample_fmt)!=ost->reformat_pair) {
+    if (!ost->audio_resample && dec_fmt!=enc_fmt &&
+        MAKE_SFMT_PAIR(enc_fmt,dec_fmt)!=ost->reformat_pair) {
         if (ost->reformat_ctx)
             av_audio_convert_free(ost->reformat_ctx);
-        ost->reformat_ctx = av_audio_convert_alloc(enc->sample_fmt, 1,
-                                                   dec->sample_fmt, 1, NULL, 0);
+        ost->reformat_ctx = av_audio_convert_alloc(enc_fmt, 1,
+                                                   dec_fmt, 1, NULL, 0);
         if (!ost->reformat_ctx) {
             av_log(NULL, AV_LOG_ERROR, "Cannot convert %s sample format to %s sample format\n",
-                av_get_sample_fmt_name(dec->sample_fmt),
-                av_get_sample_fmt_name(enc->sample_fmt));
+                av_get_sample_fmt_name(dec_fmt),
+                av_get_sample_fmt_name(enc_fmt));
             ffmpeg_exit(1);
         }
-        ost->reformat_pair=MAKE_SFMT_PAIR(enc->sample_fmt,dec->sample_fmt);
+        ost->reformat_pair=MAKE_SFMT_PAIR(enc_fmt,dec_fmt);
     }
 
     // sync_ist will be set to the first input stream with audiomerge
@@ -1043,8 +1273,11 @@ static void do_audio_out(AVFormatContext *s,
             if(ost->is_start || fabs(delta) > audio_drift_threshold*enc->sample_rate){
                 if(byte_delta < 0){
                     byte_delta= FFMAX(byte_delta, -size);
+                    if (in_planar)
+                        buf = audio_shift_planes(buf, size, byte_delta / dec->channels, dec->channels);
+                    else
+                        buf -= byte_delta;
                     size += byte_delta;
-                    buf  -= byte_delta;
                     if(verbose > 0)
                         av_log(NULL, AV_LOG_INFO, "discarding %d audio samples in stream #%d.%d\n",
                                 -byte_delta/(isize*ist->st->codec->channels),
@@ -1057,10 +1290,14 @@ static void do_audio_out(AVFormatContext *s,
                                "cannot compensate a/v sync\n");
                         return;
                     }
-                    av_fast_malloc(&input_tmp, &input_tmp_size, byte_delta + size);
-                    memset(input_tmp, 0, byte_delta);
-                    memcpy(input_tmp + byte_delta, buf, size);
-                    buf= input_tmp;
+                    if (in_planar) {
+                        buf = audio_shift_planes(buf, size, byte_delta / dec->channels, dec->channels);
+                    } else {
+                        av_fast_malloc(&input_tmp, &input_tmp_size, byte_delta + size);
+                        memset(input_tmp, 0, byte_delta);
+                        memcpy(input_tmp + byte_delta, buf, size);
+                        buf= input_tmp;
+                    }
                     size += byte_delta;
                     if(verbose > 0)
                         av_log(NULL, AV_LOG_INFO, "adding %d audio samples in stream #%d.%d\n",
@@ -1111,7 +1348,7 @@ static void do_audio_out(AVFormatContext *s,
                                            ost->audio_channel_maps[i]->channel_index,
                                            ost->audio_channel_maps[i]->out_channel_index,
                                            dec->channels,
-                                           size/(isize*dec->channels)) < 0) {
+                                           size/(isize*dec->channels), in_planar) < 0) {
                     av_log(NULL, AV_LOG_ERROR, "audiomerge failed\n");
                     ffmpeg_exit(1);
                 }
@@ -1126,7 +1363,7 @@ static void do_audio_out(AVFormatContext *s,
         size_out = size;
     }
 
-    if (!ost->audio_resample && dec->sample_fmt!=enc->sample_fmt) {
+    if (!ost->audio_resample && dec_fmt!=enc_fmt) {
         const void *ibuf[6]= {buftmp};
         void *obuf[6]= {audio_buf};
         int istride[6]= {isize};
@@ -1166,11 +1403,18 @@ static void do_audio_out(AVFormatContext *s,
             av_init_packet(&pkt);
 
             av_fifo_generic_read(ost->fifo, audio_buf, frame_bytes, NULL);
+            buftmp = audio_buf;
+            if (av_sample_fmt_is_planar(enc->sample_fmt)) {
+                buftmp = audio_layout_alloc(frame_bytes);
+                av_samples_copy_layout(buftmp, audio_buf, enc->channels, enc->frame_size, osize, 1);
+            }
 
             //FIXME pass ost->sync_opts as AVFrame.pts in avcodec_encode_audio()
 
+            stage_clock(&t0);
             ret = avcodec_encode_audio(enc, audio_out, audio_out_size,
-                                       (short *)audio_buf);
+                                       (short *)buftmp);
+            stage_add(&ost->stage[STAGE_ENCODE], &t0, 1, ret > 0);
             if (ret < 0) {
                 av_log(NULL, AV_LOG_ERROR, "Audio encoding failed\n");
                 ffmpeg_exit(1);
@@ -1182,7 +1426,7 @@ static void do_audio_out(AVFormatContext *s,
             if(enc->coded_frame && enc->coded_frame->pts != AV_NOPTS_VALUE)
                 pkt.pts= av_rescale_q(enc->coded_frame->pts, enc->time_base, ost->st->time_base);
             pkt.flags |= AV_PKT_FLAG_KEY;
-            write_frame(s, &pkt, enc, ost->bitstream_filters);
+            write_frame(s, &pkt, ost);
 
             ost->sync_opts += enc->frame_size;
         }
@@ -1192,6 +1436,13 @@ static void do_audio_out(AVFormatContext *s,
 
         ost->sync_opts += size_out / (osize * enc->channels);
 
+        if (!planar && av_sample_fmt_is_planar(enc->sample_fmt)) {
+            uint8_t *planes = audio_layout_alloc(size_out);
+            av_samples_copy_layout(planes, buftmp, enc->channels,
+                                   size_out / (osize * enc->channels), osize, 1);
+            buftmp = planes;
+        }
+
         /* output a pcm frame */
         /* determine the size of the coded buffer */
         size_out /= osize;
@@ -1204,8 +1455,10 @@ static void do_audio_out(AVFormatContext *s,
         }
 
         //FIXME pass ost->sync_opts as AVFrame.pts in avcodec_encode_audio()
+        stage_clock(&t0);
         ret = avcodec_encode_audio(enc, audio_out, size_out,
                                    (short *)buftmp);
+        stage_add(&ost->stage[STAGE_ENCODE], &t0, 1, ret > 0);
         if (ret < 0) {
             av_log(NULL, AV_LOG_ERROR, "Audio encoding failed\n");
             ffmpeg_exit(1);
@@ -1217,7 +1470,7 @@ static void do_audio_out(AVFormatContext *s,
         if(enc->coded_frame && enc->coded_frame->pts != AV_NOPTS_VALUE)
             pkt.pts= av_rescale_q(enc->coded_frame->pts, enc->time_base, ost->st->time_base);
         pkt.flags |= AV_PKT_FLAG_KEY;
-        write_frame(s, &pkt, enc, ost->bitstream_filters);
+        write_frame(s, &pkt, ost);
     }
 
     if (ost->nb_audio_channel_maps > 0)
@@ -1240,6 +1493,7 @@ static void do_subtitle_out(AVFormatContext *s,
     int subtitle_out_size, nb, i;
     AVCodecContext *enc;
     AVPacket pkt;
+    StageClock t0;
 
     if (pts == AV_NOPTS_VALUE) {
         av_log(NULL, AV_LOG_ERROR, "Subtitle packets must have a pts\n");
@@ -1268,8 +1522,10 @@ static void do_subtitle_out(AVFormatContext *s,
         sub->pts              += av_rescale_q(sub->start_display_time, (AVRational){1, 1000}, AV_TIME_BASE_Q);
         sub->end_display_time -= sub->start_display_time;
         sub->start_display_time = 0;
+        stage_clock(&t0);
         subtitle_out_size = avcodec_encode_subtitle(enc, subtitle_out,
                                                     subtitle_out_max_size, sub);
+        stage_add(&ost->stage[STAGE_ENCODE], &t0, 1, subtitle_out_size > 0);
         if (subtitle_out_size < 0) {
             av_log(NULL, AV_LOG_ERROR, "Subtitle encoding failed\n");
             ffmpeg_exit(1);
@@ -1288,7 +1544,7 @@ static void do_subtitle_out(AVFormatContext *s,
             else
                 pkt.pts += 90 * sub->end_display_time;
         }
-        write_frame(s, &pkt, ost->st->codec, ost->bitstream_filters);
+        write_frame(s, &pkt, ost);
     }
 }
 
@@ -1300,6 +1556,7 @@ static void encode_frame(AVFormatContext *s,
                          AVFrame *frame, int *frame_size, int quality)
 {
     AVCodecContext *enc = ost->st->codec;
+    StageClock t0;
     int i, ret;
 
     /* duplicates frame if needed */
@@ -1317,7 +1574,7 @@ static void encode_frame(AVFormatContext *s,
             pkt.pts = av_rescale_q(ost->sync_opts, enc->time_base, ost->st->time_base);
             pkt.flags |= AV_PKT_FLAG_KEY;
 
-            write_frame(s, &pkt, ost->st->codec, ost->bitstream_filters);
+            write_frame(s, &pkt, ost);
             video_size += avpicture_get_size(enc->pix_fmt, enc->width, enc->height);
         } else {
             /* handles sameq here. This is not correct because it may
@@ -1331,9 +1588,11 @@ static void encode_frame(AVFormatContext *s,
                 frame->pict_type = FF_I_TYPE;
                 ost->forced_kf_index++;
             }
+            stage_clock(&t0);
             ret = avcodec_encode_video(enc,
                                        bit_buffer, bit_buffer_size,
                                        frame);
+            stage_add(&ost->stage[STAGE_ENCODE], &t0, 1, ret > 0);
             if (ret < 0) {
                 av_log(NULL, AV_LOG_ERROR, "Video encoding failed\n");
                 ffmpeg_exit(1);
@@ -1344,14 +1603,17 @@ static void encode_frame(AVFormatContext *s,
                 pkt.size = ret;
                 if (enc->coded_frame->pts != AV_NOPTS_VALUE)
                     pkt.pts = av_rescale_q(enc->coded_frame->pts, enc->time_base, ost->st->time_base);
+                if (enc->codec->capabilities & CODEC_CAP_DTS &&
+                    enc->coded_frame->pkt_dts != AV_NOPTS_VALUE)
+                    pkt.dts = av_rescale_q(enc->coded_frame->pkt_dts, enc->time_base, ost->st->time_base);
 
                 if (enc->coded_frame->key_frame)
                     pkt.flags |= AV_PKT_FLAG_KEY;
-                write_frame(s, &pkt, ost->st->codec, ost->bitstream_filters);
+                write_frame(s, &pkt, ost);
                 *frame_size = ret;
                 video_size += ret;
                 if (ost->logfile && enc->stats_out) {
-                    fprintf(ost->logfile, "%s", enc->stats_out);
+                    fputs(enc->stats_out, ost->logfile);
                 }
             }
         }
@@ -1478,6 +1740,8 @@ static void do_video_out(AVFormatContext *s, OutputStream *ost, InputStream *ist
                           dec->pix_fmt != enc->pix_fmt;
 
     if (ost->video_resample) {
+        StageClock t0;
+
         final_picture = &ost->resample_frame;
         if (!ost->img_resample_ctx || resample_changed) {
             /* initialize the destination picture */
@@ -1499,8 +1763,10 @@ static void do_video_out(AVFormatContext *s, OutputStream *ost, InputStream *ist
                 ffmpeg_exit(1);
             }
         }
+        stage_clock(&t0);
         sws_scale(ost->img_resample_ctx, formatted_picture->data, formatted_picture->linesize,
               0, ost->resample_height, final_picture->data, final_picture->linesize);
+        stage_add(&ost->stage[STAGE_SCALE], &t0, 1, 1);
     }
 #endif
 
@@ -1530,6 +1796,98 @@ static void do_video_out(AVFormatContext *s, OutputStream *ost, InputStream *ist
     }
 }
 
+/* wall clock time spent in each stage by all streams */
+static void stage_totals(int64_t wall[STAGE_NB], OutputStream **ost_table, int nb_ostreams)
+{
+    int i, j;
+
+    memset(wall, 0, STAGE_NB * sizeof(*wall));
+    for (i = 0; i < nb_input_streams; i++)
+        for (j = 0; j < STAGE_NB; j++)
+            wall[j] += input_streams[i].stage[j].wall;
+    for (i = 0; i < nb_ostreams; i++)
+        for (j = 0; j < STAGE_NB; j++)
+            wall[j] += ost_table[i]->stage[j].wall;
+}
+
+static const char *media_type_name(enum AVMediaType type)
+{
+    switch (type) {
+    case AVMEDIA_TYPE_VIDEO:    return "video";
+    case AVMEDIA_TYPE_AUDIO:    return "audio";
+    case AVMEDIA_TYPE_SUBTITLE: return "subtitle";
+    case AVMEDIA_TYPE_DATA:     return "data";
+    default:                    return "unknown";
+    }
+}
+
+/* fprintf() is redirected to av_log() by libavutil/log.h */
+static void file_printf(FILE *f, const char *fmt, ...)
+{
+    va_list vl;
+
+    va_start(vl, fmt);
+    vfprintf(f, fmt, vl);
+    va_end(vl);
+}
+
+/* log the stage timings of every stream, and write them to the benchmark
+   file as CSV or JSON */
+static void print_stage_report(OutputStream **ost_table, int nb_ostreams)
+{
+    FILE *f = NULL;
+    int i, j, csv = 0, first = 1;
+
+    if (benchmark_filename) {
+        f = fopen(benchmark_filename, "w");
+        if (!f)
+            av_log(NULL, AV_LOG_ERROR, "Cannot open benchmark file %s\n", benchmark_filename);
+        csv = av_match_ext(benchmark_filename, "csv");
+    }
+    if (f && csv)
+        file_printf(f, "stage,direction,stream,type,frames,wall,cpu,max_queue\n");
+    else if (f)
+        file_printf(f, "{\n  \"wall\": %.6f,\n  \"cpu\": %.6f,\n  \"maxrss\": %"PRId64",\n  \"stages\": [",
+                (av_gettime() - timer_start) / 1000000.0, getutime() / 1000000.0, getmaxrss());
+
+    av_log(NULL, AV_LOG_INFO, "stage   dir stream type       frames    wall(s)     cpu(s)      fps queue\n");
+    for (i = 0; i < nb_input_streams + nb_ostreams; i++) {
+        int input = i < nb_input_streams;
+        OutputStream *ost = input ? NULL : ost_table[i - nb_input_streams];
+        InputStream *ist = input ? input_streams + i : NULL;
+        const StageStats *stage = input ? ist->stage : ost->stage;
+        AVStream *st = input ? ist->st : ost->st;
+        int file_index = input ? ist->file_index : ost->file_index;
+        const char *type = media_type_name(st->codec->codec_type);
+
+        for (j = 0; j < STAGE_NB; j++) {
+            const StageStats *s = stage + j;
+            double wall = s->wall / 1000000.0, cpu = s->cpu / 1000000.0;
+
+            if (!s->in && !s->out)
+                continue;
+            av_log(NULL, AV_LOG_INFO, "%-7s %-3s %3d.%-2d %-8s %8"PRId64" %10.3f %10.3f %8.1f %5d\n",
+                   stage_names[j], input ? "in" : "out", file_index, st->index, type,
+                   s->out, wall, cpu, wall > 0 ? s->out / wall : 0, s->max_queue);
+            if (f && csv)
+                file_printf(f, "%s,%s,%d.%d,%s,%"PRId64",%.6f,%.6f,%d\n",
+                        stage_names[j], input ? "input" : "output", file_index, st->index,
+                        type, s->out, wall, cpu, s->max_queue);
+            else if (f)
+                file_printf(f, "%s\n    { \"stage\": \"%s\", \"direction\": \"%s\", \"stream\": \"%d.%d\", "
+                        "\"type\": \"%s\", \"frames\": %"PRId64", \"wall\": %.6f, \"cpu\": %.6f, "
+                        "\"max_queue\": %d }", first ? "" : ",",
+                        stage_names[j], input ? "input" : "output", file_index, st->index,
+                        type, s->out, wall, cpu, s->max_queue);
+            first = 0;
+        }
+    }
+    if (f && !csv)
+        file_printf(f, "\n  ]\n}\n");
+    if (f)
+        fclose(f);
+}
+
 static void print_report(AVFormatContext **output_files,
                          OutputStream **ost_table, int nb_ostreams,
                          int is_last_report, int64_t duration)
@@ -1670,6 +2028,21 @@ static void print_report(AVFormatContext **output_files,
           snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " dup=%d drop=%d",
                   nb_frames_dup, nb_frames_drop);
 
+        /* share of the time since the last report spent in each stage */
+        if (do_benchmark_stages && elapsed_time > 0) {
+            static int64_t prev_stage_wall[STAGE_NB];
+            int64_t stage_wall[STAGE_NB];
+
+            stage_totals(stage_wall, ost_table, nb_ostreams);
+            for (i = 0; i < STAGE_NB; i++) {
+                int64_t wall = is_last_report ? stage_wall[i] : stage_wall[i] - prev_stage_wall[i];
+                prev_stage_wall[i] = stage_wall[i];
+                if (stage_wall[i])
+                    snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " %s=%.0f%%",
+                             stage_names[i], 100.0 * wall / elapsed_time);
+            }
+        }
+
         if (verbose >= 0) {
             int len = strlen(buf);
             max_status_len = FFMAX(max_status_len, len);
@@ -1708,6 +2081,7 @@ static int output_packet(InputStream *ist, int ist_index,
     int ret, i, j;
     int got_output;
     AVFrame picture;
+    StageClock t0;
     static unsigned int samples_size= 0;
     AVSubtitle subtitle, *subtitle_to_free = NULL;
     int64_t pkt_pts = AV_NOPTS_VALUE;
@@ -1770,8 +2144,10 @@ static int output_packet(InputStream *ist, int ist_index,
                 decoded_data_size= samples_size;
                     /* XXX: could avoid copy if PCM 16 bits with same
                        endianness as CPU */
+                stage_clock(&t0);
                 ret = avcodec_decode_audio3(ist->st->codec, samples, &decoded_data_size,
                                             &avpkt);
+                stage_add(&ist->stage[STAGE_DECODE], &t0, avpkt.size > 0, decoded_data_size > 0);
                 if (ret < 0)
                     return ret;
                 avpkt.data += ret;
@@ -1799,8 +2175,10 @@ static int output_packet(InputStream *ist, int ist_index,
                     avpkt.dts = ist->pts;
                     pkt_pts = AV_NOPTS_VALUE;
 
+                    stage_clock(&t0);
                     ret = avcodec_decode_video2(ist->st->codec,
                                                 &picture, &got_output, &avpkt);
+                    stage_add(&ist->stage[STAGE_DECODE], &t0, avpkt.size > 0, got_output != 0);
                     quality = same_quality ? picture.quality : 0;
                     if (ret < 0)
                         return ret;
@@ -1821,8 +2199,10 @@ static int output_packet(InputStream *ist, int ist_index,
                     avpkt.size = 0;
                     break;
             case AVMEDIA_TYPE_SUBTITLE:
+                stage_clock(&t0);
                 ret = avcodec_decode_subtitle2(ist->st->codec,
                                                &subtitle, &got_output, &avpkt);
+                stage_add(&ist->stage[STAGE_DECODE], &t0, avpkt.size > 0, got_output != 0);
                 if (ret < 0)
                     return ret;
                 if (!got_output) {
@@ -1898,10 +2278,12 @@ static int output_packet(InputStream *ist, int ist_index,
                 if (j == ost->nb_source_indexes)
                     continue;
 #if CONFIG_AVFILTER
+                stage_clock(&t0);
                 if (ist->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && ost->input_video_filter) {
                     // add it to be filtered
                     picture.pts = ist->pts;
                     av_vsrc_buffer_add_frame(ost->input_video_filter, &picture, ist->pts);
+                    stage_add(&ost->stage[STAGE_FILTER], &t0, 1, 0);
                 }
 
                 frame_available = ist->st->codec->codec_type != AVMEDIA_TYPE_VIDEO ||
@@ -1909,7 +2291,10 @@ static int output_packet(InputStream *ist, int ist_index,
                 while (frame_available) {
                     if (ist->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && ost->output_video_filter) {
                         AVRational ist_pts_tb = ost->output_video_filter->inputs[0]->time_base;
-                        if (av_vsink_buffer_get_video_buffer_ref(ost->output_video_filter, &ost->picref, 0) < 0)
+                        stage_clock(&t0);
+                        ret = av_vsink_buffer_get_video_buffer_ref(ost->output_video_filter, &ost->picref, 0);
+                        stage_add(&ost->stage[STAGE_FILTER], &t0, 0, ret >= 0 && ost->picref);
+                        if (ret < 0)
                             goto cont;
                         if (ost->picref) {
                             avcodec_get_frame_defaults(&oframe);
@@ -2003,6 +2388,14 @@ static int output_packet(InputStream *ist, int ist_index,
                                 opkt.dts -= ist->st->codec->has_b_frames*opkt.duration;
                         }
 
+                        if (ost->pcm_interleave) {
+                            int channels = ost->st->codec->channels;
+                            av_samples_copy_layout(audio_layout_alloc(data_size), data_buf, channels,
+                                                   data_size / (channels * ost->pcm_interleave),
+                                                   ost->pcm_interleave, 0);
+                            data_buf = audio_layout_buf;
+                        }
+
                         //FIXME remove the following 2 lines they shall be replaced by the bitstream filters
                         if(   ost->st->codec->codec_id != CODEC_ID_H264
                            && ost->st->codec->codec_id != CODEC_ID_MPEG1VIDEO
@@ -2022,7 +2415,7 @@ static int output_packet(InputStream *ist, int ist_index,
                             opkt.size = sizeof(AVPicture);
                             opkt.flags |= AV_PKT_FLAG_KEY;
                         }
-                        write_frame(os, &opkt, ost->st->codec, ost->bitstream_filters);
+                        write_frame(os, &opkt, ost);
                         ost->st->codec->frame_number++;
                         ost->frame_number++;
                         av_free_packet(&opkt);
@@ -2120,13 +2513,17 @@ static int output_packet(InputStream *ist, int ist_index,
                                     generate_silence(audio_buf+fifo_bytes, enc->sample_fmt, frame_bytes - fifo_bytes);
                                 }
 
+                                stage_clock(&t0);
                                 ret = avcodec_encode_audio(enc, bit_buffer, bit_buffer_size, (short *)audio_buf);
+                                stage_add(&ost->stage[STAGE_ENCODE], &t0, 1, ret > 0);
                                 pkt.duration = av_rescale((int64_t)enc->frame_size*ost->st->time_base.den,
                                                           ost->st->time_base.num, enc->sample_rate);
                                 enc->frame_size = fs_tmp;
                             }
                             if(ret <= 0) {
+                                stage_clock(&t0);
                                 ret = avcodec_encode_audio(enc, bit_buffer, bit_buffer_size, NULL);
+                                stage_add(&ost->stage[STAGE_ENCODE], &t0, 0, ret > 0);
                             }
                             if (ret < 0) {
                                 av_log(NULL, AV_LOG_ERROR, "Audio encoding failed\n");
@@ -2136,7 +2533,9 @@ static int output_packet(InputStream *ist, int ist_index,
                             pkt.flags |= AV_PKT_FLAG_KEY;
                             break;
                         case AVMEDIA_TYPE_VIDEO:
+                            stage_clock(&t0);
                             ret = avcodec_encode_video(enc, bit_buffer, bit_buffer_size, NULL);
+                            stage_add(&ost->stage[STAGE_ENCODE], &t0, 0, ret > 0);
                             if (ret < 0) {
                                 av_log(NULL, AV_LOG_ERROR, "Video encoding failed\n");
                                 ffmpeg_exit(1);
@@ -2147,7 +2546,7 @@ static int output_packet(InputStream *ist, int ist_index,
                             if(enc->coded_frame && enc->coded_frame->key_frame)
                                 pkt.flags |= AV_PKT_FLAG_KEY;
                             if (ost->logfile && enc->stats_out) {
-                                fprintf(ost->logfile, "%s", enc->stats_out);
+                                fputs(enc->stats_out, ost->logfile);
                             }
                             break;
                         default:
@@ -2160,7 +2559,11 @@ static int output_packet(InputStream *ist, int ist_index,
                         pkt.size= ret;
                         if(enc->coded_frame && enc->coded_frame->pts != AV_NOPTS_VALUE)
                             pkt.pts= av_rescale_q(enc->coded_frame->pts, enc->time_base, ost->st->time_base);
-                        write_frame(os, &pkt, ost->st->codec, ost->bitstream_filters);
+                        if (enc->codec_type == AVMEDIA_TYPE_VIDEO &&
+                            enc->codec->capabilities & CODEC_CAP_DTS &&
+                            enc->coded_frame->pkt_dts != AV_NOPTS_VALUE)
+                            pkt.dts = av_rescale_q(enc->coded_frame->pkt_dts, enc->time_base, ost->st->time_base);
+                        write_frame(os, &pkt, ost);
                     }
                 }
             }
@@ -2564,6 +2967,7 @@ static int transcode(AVFormatContext **output_files,
     OutputStream *ost, **ost_table = NULL;
     InputStream *ist = NULL;
     int key;
+    StageClock t0;
     int want_sdp = 1;
     uint8_t no_packet[MAX_FILES]={0};
     int no_packet_count=0;
@@ -2852,7 +3256,14 @@ static int transcode(AVFormatContext **output_files,
 
             codec->interlaced = icodec->interlaced;
 
-            if(!codec->codec_tag){
+            /* no muxer stores PCM in planes, it is interleaved while copied */
+            if (codec->codec_type == AVMEDIA_TYPE_AUDIO &&
+                pcm_packed_codec_id(icodec->codec_id) != CODEC_ID_NONE) {
+                codec->codec_id = pcm_packed_codec_id(icodec->codec_id);
+                ost->pcm_interleave = av_get_bits_per_sample(codec->codec_id) >> 3;
+            }
+
+            if(!codec->codec_tag && !ost->pcm_interleave){
                 if(   !os->oformat->codec_tag
                    || av_codec_get_id (os->oformat->codec_tag, icodec->codec_tag) == codec->codec_id
                    || av_codec_get_tag(os->oformat->codec_tag, icodec->codec_id) <= 0)
@@ -2940,8 +3351,10 @@ static int transcode(AVFormatContext **output_files,
                 }
                 choose_sample_rate(ost->st, ost->enc);
                 codec->time_base = (AVRational){1, codec->sample_rate};
-                if (codec->sample_fmt == AV_SAMPLE_FMT_NONE)
+                if (codec->sample_fmt == AV_SAMPLE_FMT_NONE) {
                     codec->sample_fmt = icodec->sample_fmt;
+                    choose_planar_sample_fmt(ost, ist);
+                }
                 choose_sample_fmt(ost->st, ost->enc);
                 if (!codec->channels) {
                     codec->channels = icodec->channels;
@@ -3430,6 +3843,7 @@ static int transcode(AVFormatContext **output_files,
 
         /* read a frame from it and output it in the fifo */
         is = input_files[file_index].ctx;
+        stage_clock(&t0);
         ret= av_read_frame(is, &pkt);
         if(ret == AVERROR(EAGAIN)){
             no_packet[file_index]=1;
@@ -3467,6 +3881,9 @@ static int transcode(AVFormatContext **output_files,
         if (ist_index >= nb_input_streams)
             goto discard_packet;
         ist = &input_streams[ist_index];
+        stage_add(&ist->stage[STAGE_DEMUX], &t0, 0, 1);
+        if (do_benchmark_stages)
+            stage_queue(&ist->stage[STAGE_DEMUX], packet_queue_depth(is->packet_buffer, pkt.stream_index));
         if (ist->discard)
             goto discard_packet;
 
@@ -3541,6 +3958,8 @@ static int transcode(AVFormatContext **output_files,
 
     /* dump report by using the first video and audio streams */
     print_report(output_files, ost_table, nb_ostreams, 1, 0);
+    if (do_benchmark_stages)
+        print_stage_report(ost_table, nb_ostreams);
 
     term_exit();
 
@@ -5254,6 +5673,14 @@ static int opt_vstats_file(const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_benchmark_file(const char *opt, const char *arg)
+{
+    av_free(benchmark_filename);
+    benchmark_filename = av_strdup(arg);
+    do_benchmark_stages = 1;
+    return 0;
+}
+
 static int opt_vstats(const char *opt, const char *arg)
 {
     char filename[40];
@@ -5320,6 +5747,624 @@ static int opt_deinterlace(const char *opt, const char *arg)
     return -1;
 }
 
+#define MAX_SEGMENTS 64
+
+typedef struct Segment {
+    char filename[1024];
+    int64_t start;      ///< pts of the first keyframe, in the input video stream time base
+    char ss[32];        ///< -ss of the job
+    char t[32];         ///< -t of the job, empty for the last segment
+    char timecode[32];  ///< -timecode of the job, shifted to the segment start
+#if HAVE_FORK
+    pid_t pid;
+#endif
+} Segment;
+
+/**
+ * Pick up to nb keyframes of the index of st, evenly spaced in time, as
+ * segment starts. The first segment starts at base.
+ * @return the number of segments
+ */
+static int segment_split(AVFormatContext *ic, AVStream *st, int64_t base,
+                         Segment *seg, int nb)
+{
+    int64_t first = st->index_entries[0].timestamp;
+    int64_t last  = st->index_entries[st->nb_index_entries - 1].timestamp;
+    int i, j, prev = 0, n = 1;
+
+    seg[0].start = base;
+    for (i = 1; i < nb; i++) {
+        AVPacket pkt;
+        int64_t pts = AV_NOPTS_VALUE;
+
+        j = av_index_search_timestamp(st, first + (last - first) * i / nb,
+                                      AVSEEK_FLAG_BACKWARD);
+        if (j <= prev)
+            continue;
+        prev = j;
+
+        /* the index has the dts, the cut is done on the pts */
+        if (av_seek_frame(ic, st->index, st->index_entries[j].timestamp,
+                          AVSEEK_FLAG_BACKWARD) < 0)
+            continue;
+        while (av_read_frame(ic, &pkt) >= 0) {
+            int found = pkt.stream_index == st->index &&
+                        pkt.flags & AV_PKT_FLAG_KEY;
+            if (found)
+                pts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : pkt.dts;
+            av_free_packet(&pkt);
+            if (found)
+                break;
+        }
+        if (pts == AV_NOPTS_VALUE || pts <= seg[n - 1].start)
+            continue;
+        seg[n++].start = pts;
+    }
+    return n;
+}
+
+static void segment_time(char *buf, int size, int64_t ts, AVRational tb)
+{
+    /* rounded down, the seek then lands on the keyframe itself */
+    ts = av_rescale_rnd(ts, (int64_t)tb.num * AV_TIME_BASE, tb.den, AV_ROUND_DOWN);
+    snprintf(buf, size, "%"PRId64".%06d", ts / AV_TIME_BASE, (int)(ts % AV_TIME_BASE));
+}
+
+/**
+ * Shift a HH:MM:SS[:;]FF timecode by frames at the nominal rate fps.
+ */
+static int segment_timecode(char *buf, int size, const char *tc,
+                            int64_t frames, int fps)
+{
+    int hh, mm, ss, ff, d = 0;
+    char sep;
+    int64_t n;
+
+    if (sscanf(tc, "%d:%d:%d%c%d", &hh, &mm, &ss, &sep, &ff) != 5 || fps <= 0)
+        return AVERROR(EINVAL);
+    if (sep == ';' && (fps == 30 || fps == 60))
+        d = fps / 15;
+
+    mm += hh * 60;
+    n = ((int64_t)mm * 60 + ss) * fps + ff - d * (mm - mm / 10) + frames;
+    if (d) {
+        /* drop frame, numbered like libavcodec/timecode.c does since the
+           encoders of the jobs parse the result with it */
+        int fpm = fps * 60 - d, f10 = fps * 600 - 9 * d;
+        n += 9 * d * (n / f10) + d * ((n % f10 - 2) / fpm);
+    }
+    if (snprintf(buf, size, "%02d:%02d:%02d%c%02d", (int)(n / (3600 * fps)),
+                 (int)(n / (60 * fps) % 60), (int)(n / fps % 60), sep,
+                 (int)(n % fps)) >= size)
+        return AVERROR(EINVAL);
+    return 0;
+}
+
+/**
+ * Options of the output muxer and of none of the encoders of a job, they
+ * are for the final output alone. The job encodes the video stream when
+ * video is set, the others otherwise.
+ */
+static int segment_muxer_opt(AVFormatContext *os, const char *opt, int video)
+{
+    const AVClass *class = os->oformat->priv_class;
+    int i;
+
+    if (opt[0] != '-' || !class || !av_opt_find(&class, opt + 1, NULL, 0, 0))
+        return 0;
+    for (i = 0; i < nb_output_streams_for_file[0]; i++) {
+        OutputStream *ost = output_streams_for_file[0][i];
+        AVCodec *enc = ost->enc;
+        if ((ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO) != video)
+            continue;
+        if (enc && enc->priv_class &&
+            av_opt_find(&enc->priv_class, opt + 1, NULL, 0, 0))
+            return 0;
+    }
+    return 1;
+}
+
+static void segment_free_argv(char **args)
+{
+    int i;
+
+    for (i = 0; args && args[i]; i++)
+        av_free(args[i]);
+    av_free(args);
+}
+
+/**
+ * Build the command line of a job from the one of this process: without
+ * -segments and the muxer options, writing to filename in format with the
+ * streams of type disable ("-an" or "-vn") left out, and limited to the
+ * range of seg.
+ * @return the arguments, to be freed with segment_free_argv()
+ */
+static char **segment_argv(int argc, char **argv, int out_index,
+                           AVFormatContext *os, const char *filename,
+                           const char *format, const char *disable,
+                           const Segment *seg)
+{
+    const char **list = av_mallocz((argc + 16) * sizeof(*list));
+    char **args;
+    int i, n = 0;
+
+    if (!list)
+        return NULL;
+    list[n++] = argv[0];
+    list[n++] = "-loglevel";
+    list[n++] = "error";
+    list[n++] = "-y";
+    for (i = 1; i < argc; i++) {
+        if (i + 1 < out_index && (!strcmp(argv[i], "-segments") ||
+                                  segment_muxer_opt(os, argv[i], !!seg))) {
+            i++;
+            continue;
+        }
+        if (seg && seg->timecode[0] && i + 1 < out_index &&
+            !strcmp(argv[i], "-timecode")) {
+            list[n++] = argv[i++];
+            list[n++] = seg->timecode;
+            continue;
+        }
+        if (seg && !strcmp(argv[i], "-i")) {
+            list[n++] = "-ss";
+            list[n++] = seg->ss;
+            if (seg->t[0]) {
+                list[n++] = "-t";
+                list[n++] = seg->t;
+            }
+        }
+        if (i == out_index) {
+            list[n++] = disable;
+            list[n++] = "-f";
+            list[n++] = format;
+            list[n++] = filename;
+            continue;
+        }
+        list[n++] = argv[i];
+    }
+
+    /* execvp() takes non-const strings */
+    if ((args = av_mallocz((n + 1) * sizeof(*args)))) {
+        for (i = 0; i < n; i++) {
+            if (!(args[i] = av_strdup(list[i]))) {
+                segment_free_argv(args);
+                args = NULL;
+                break;
+            }
+        }
+    }
+    av_free(list);
+    return args;
+}
+
+static int segment_open(AVFormatContext **ic, const char *filename)
+{
+    int ret;
+
+    *ic = NULL;
+    if ((ret = avformat_open_input(ic, filename, NULL, NULL)) < 0 ||
+        (ret = avformat_find_stream_info(*ic, NULL)) < 0) {
+        print_error(filename, ret);
+        if (*ic)
+            av_close_input_file(*ic);
+        *ic = NULL;
+        return ret;
+    }
+    return 0;
+}
+
+/* same parameters as the stream copy setup of transcode() */
+/**
+ * @param rate frame rate the video was encoded at, 0/0 if unknown; the one
+ *             guessed from the segment files may differ (e.g. the field rate)
+ */
+static int segment_copy_stream(AVFormatContext *os, AVStream *ost, AVStream *ist,
+                               AVRational rate)
+{
+    AVCodecContext *codec = ost->codec, *icodec = ist->codec;
+
+    av_freep(&codec->extradata);
+    codec->extradata_size = 0;
+    if (icodec->extradata_size > 0) {
+        codec->extradata = av_mallocz(icodec->extradata_size + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!codec->extradata)
+            return AVERROR(ENOMEM);
+        memcpy(codec->extradata, icodec->extradata, icodec->extradata_size);
+        codec->extradata_size = icodec->extradata_size;
+    }
+    codec->codec_id   = icodec->codec_id;
+    codec->codec_type = icodec->codec_type;
+    codec->codec_tag  = 0;
+    if (!os->oformat->codec_tag ||
+        av_codec_get_id (os->oformat->codec_tag, icodec->codec_tag) == codec->codec_id ||
+        av_codec_get_tag(os->oformat->codec_tag, icodec->codec_id) <= 0)
+        codec->codec_tag = icodec->codec_tag;
+    codec->bit_rate            = icodec->bit_rate;
+    codec->rc_max_rate         = icodec->rc_max_rate;
+    codec->rc_buffer_size      = icodec->rc_buffer_size;
+    codec->bits_per_raw_sample = icodec->bits_per_raw_sample;
+    codec->time_base           = icodec->time_base;
+    if (codec->codec_type == AVMEDIA_TYPE_VIDEO && rate.num) {
+        /* the time base of the encoder of the jobs */
+        codec->time_base = (AVRational){ rate.den, rate.num };
+    } else if (codec->codec_type == AVMEDIA_TYPE_VIDEO &&
+               !(os->oformat->flags & AVFMT_VARIABLE_FPS) &&
+               ist->r_frame_rate.num && av_q2d(ist->r_frame_rate) <= 60)
+        codec->time_base = (AVRational){ ist->r_frame_rate.den, ist->r_frame_rate.num };
+    if (!codec->time_base.num)
+        codec->time_base = ist->time_base;
+
+    switch (codec->codec_type) {
+    case AVMEDIA_TYPE_AUDIO:
+        codec->channel_layout = icodec->channel_layout;
+        codec->sample_rate    = icodec->sample_rate;
+        codec->channels       = icodec->channels;
+        codec->sample_fmt     = icodec->sample_fmt;
+        codec->frame_size     = icodec->frame_size;
+        codec->block_align    = icodec->block_align;
+        break;
+    case AVMEDIA_TYPE_VIDEO:
+        codec->pix_fmt         = icodec->pix_fmt;
+        codec->color_primaries = icodec->color_primaries;
+        codec->color_transfer  = icodec->color_transfer;
+        codec->color_matrix    = icodec->color_matrix;
+        codec->width           = icodec->width;
+        codec->height          = icodec->height;
+        codec->has_b_frames    = icodec->has_b_frames;
+        codec->interlaced      = icodec->interlaced;
+        codec->bits_per_coded_sample = icodec->bits_per_coded_sample;
+        codec->sample_aspect_ratio = ost->sample_aspect_ratio =
+            ist->sample_aspect_ratio.num ? ist->sample_aspect_ratio :
+                                           icodec->sample_aspect_ratio;
+        break;
+    case AVMEDIA_TYPE_SUBTITLE:
+        codec->width  = icodec->width;
+        codec->height = icodec->height;
+        break;
+    default:
+        break;
+    }
+    av_dict_copy(&ost->metadata, ist->metadata, AV_DICT_DONT_OVERWRITE);
+    return 0;
+}
+
+static int64_t segment_pkt_time(AVPacket *pkt, AVRational tb)
+{
+    int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    return ts == AV_NOPTS_VALUE ? INT64_MIN : av_rescale_q(ts, tb, AV_TIME_BASE_Q);
+}
+
+static void segment_rescale(AVPacket *pkt, AVRational from, AVRational to)
+{
+    if (pkt->pts != AV_NOPTS_VALUE)
+        pkt->pts = av_rescale_q(pkt->pts, from, to);
+    if (pkt->dts != AV_NOPTS_VALUE)
+        pkt->dts = av_rescale_q(pkt->dts, from, to);
+    pkt->duration = av_rescale_q(pkt->duration, from, to);
+}
+
+/**
+ * Write the video of the segment files one after the other, shifted to
+ * the start of their segment, interleaved with the other streams taken
+ * from the aux file, to os.
+ */
+static int segment_concat(AVFormatContext *os, int vidx, const Segment *seg,
+                          int nb_seg, AVRational seg_tb, AVRational rate,
+                          const char *aux_name)
+{
+    AVFormatContext *vf = NULL, *af = NULL;
+    AVRational vtb, atb[MAX_STREAMS];
+    int amap[MAX_STREAMS];
+    AVPacket vpkt, apkt;
+    int have_v = 0, have_a = 0, cur = 0, vs, i, j, ret;
+    int64_t off = 0, last_dts = INT64_MIN;
+
+    if ((ret = segment_open(&vf, seg[0].filename)) < 0)
+        return ret;
+    if (os->nb_streams > 1 && (ret = segment_open(&af, aux_name)) < 0)
+        goto fail;
+    /* the segments may carry a timecode track besides the video */
+    vs = av_find_default_stream_index(vf);
+    if (vs < 0 || vf->streams[vs]->codec->codec_type != AVMEDIA_TYPE_VIDEO ||
+        os->nb_streams - 1 != (af ? af->nb_streams : 0)) {
+        av_log(NULL, AV_LOG_ERROR, "Segment files do not match the output streams\n");
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+
+    for (i = j = 0; i < os->nb_streams; i++) {
+        AVStream *ist = i == vidx ? vf->streams[vs] : af->streams[j];
+        if ((ret = segment_copy_stream(os, os->streams[i], ist,
+                                       i == vidx ? rate : (AVRational){ 0, 0 })) < 0)
+            goto fail;
+        if (i != vidx) {
+            amap[j] = i;
+            atb[j++] = ist->time_base;
+        }
+    }
+    av_dict_copy(&os->metadata, vf->metadata, AV_DICT_DONT_OVERWRITE);
+    if (af)
+        av_dict_copy(&os->metadata, af->metadata, AV_DICT_DONT_OVERWRITE);
+    vtb = vf->streams[vs]->time_base;
+
+    if ((ret = avformat_write_header(os, &output_opts[0])) < 0) {
+        print_error(os->filename, ret);
+        goto fail;
+    }
+
+    for (;;) {
+        AVPacket *pkt;
+
+        while (!have_v && vf) {
+            if (av_read_frame(vf, &vpkt) < 0) {
+                av_close_input_file(vf);
+                vf = NULL;
+                if (++cur < nb_seg) {
+                    if ((ret = segment_open(&vf, seg[cur].filename)) < 0)
+                        goto fail;
+                    vs  = FFMAX(av_find_default_stream_index(vf), 0);
+                    vtb = vf->streams[vs]->time_base;
+                    off = av_rescale_q(seg[cur].start - seg[0].start, seg_tb, vtb);
+                }
+                continue;
+            }
+            if (vpkt.stream_index != vs) {
+                av_free_packet(&vpkt);
+                continue;
+            }
+            if (vpkt.pts != AV_NOPTS_VALUE)
+                vpkt.pts += off;
+            if (vpkt.dts != AV_NOPTS_VALUE)
+                vpkt.dts += off;
+            have_v = 1;
+        }
+        while (!have_a && af) {
+            if (av_read_frame(af, &apkt) < 0) {
+                av_close_input_file(af);
+                af = NULL;
+                break;
+            }
+            have_a = 1;
+        }
+        if (!have_v && !have_a)
+            break;
+
+        if (have_v && (!have_a || segment_pkt_time(&vpkt, vtb) <=
+                                  segment_pkt_time(&apkt, atb[apkt.stream_index]))) {
+            pkt = &vpkt;
+            pkt->stream_index = vidx;
+            segment_rescale(pkt, vtb, os->streams[vidx]->time_base);
+            have_v = 0;
+            /* only a broken segment overlaps the next one */
+            if (pkt->dts != AV_NOPTS_VALUE && pkt->dts <= last_dts) {
+                av_log(NULL, AV_LOG_WARNING, "Dropping overlapping video packet at segment %d\n", cur);
+                av_free_packet(pkt);
+                continue;
+            }
+            if (pkt->dts != AV_NOPTS_VALUE)
+                last_dts = pkt->dts;
+        } else {
+            j   = apkt.stream_index;
+            pkt = &apkt;
+            pkt->stream_index = amap[j];
+            segment_rescale(pkt, atb[j], os->streams[amap[j]]->time_base);
+            have_a = 0;
+        }
+        if ((ret = av_interleaved_write_frame(os, pkt)) < 0) {
+            print_error("av_interleaved_write_frame()", ret);
+            goto fail;
+        }
+    }
+    ret = av_write_trailer(os);
+
+fail:
+    if (have_v)
+        av_free_packet(&vpkt);
+    if (have_a)
+        av_free_packet(&apkt);
+    if (vf)
+        av_close_input_file(vf);
+    if (af)
+        av_close_input_file(af);
+    return ret;
+}
+
+#if HAVE_FORK
+static pid_t segment_spawn(char **args)
+{
+    pid_t pid = fork();
+
+    if (!pid) {
+        /* keep the jobs away from the terminal */
+        int fd = open("/dev/null", O_RDONLY);
+        if (fd >= 0) {
+            dup2(fd, 0);
+            close(fd);
+        }
+        execvp(args[0], args);
+        _exit(127);
+    }
+    return pid;
+}
+#endif
+
+/**
+ * Transcode the video of the input in keyframe aligned segments, each in
+ * its own ffmbc process, and the other streams in one more process, then
+ * put them together in the output file. Only valid for intra-only or
+ * closed GOP input, a segment must not reference the previous one.
+ */
+static int transcode_segments(int argc, char **argv)
+{
+#if HAVE_FORK
+    AVFormatContext *ic, *os;
+    AVStream *st;
+    Segment seg[MAX_SEGMENTS];
+    char aux_name[1024], **args;
+    const char *tmp_format, *timecode = NULL;
+    AVRational rate;
+    int64_t base;
+    int i, n, vidx = -1, out_index, status, ret = 0;
+    pid_t aux_pid = -1;
+
+    /* the input start time is reset once the input is opened */
+    for (i = 1; i < argc; i++)
+        if (!strcmp(argv[i], "-ss"))
+            break;
+    if (nb_input_files != 1 || nb_output_files != 1 || using_stdin ||
+        nb_stream_maps || recording_time != INT64_MAX || i < argc) {
+        av_log(NULL, AV_LOG_ERROR, "-segments needs one input and one output file, "
+               "and cannot be used with -map, -ss or -t\n");
+        return AVERROR(EINVAL);
+    }
+    /* options each job would apply to its own part or share with the others */
+    for (i = 1; i < argc; i++) {
+        static const char * const per_job_opts[] = {
+            "-pass", "-passlogfile", "-vframes", "-aframes", "-dframes", "-fs",
+            "-vstats", "-vstats_file", "-benchmark_file", NULL
+        };
+        const char * const *opt;
+        for (opt = per_job_opts; *opt; opt++) {
+            if (!strcmp(argv[i], *opt)) {
+                av_log(NULL, AV_LOG_ERROR, "-segments cannot be used with %s\n", *opt);
+                return AVERROR(EINVAL);
+            }
+        }
+    }
+    ic = input_files[0].ctx;
+    os = output_files[0];
+
+    for (i = 0; i < os->nb_streams; i++) {
+        if (os->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
+            if (vidx >= 0)
+                vidx = INT_MAX;
+            else
+                vidx = i;
+        }
+    }
+    for (out_index = argc - 1; out_index > 0; out_index--)
+        if (!strcmp(argv[out_index], os->filename))
+            break;
+    for (i = 1; i + 1 < out_index; i++)
+        if (!strcmp(argv[i], "-timecode"))
+            timecode = argv[i + 1];
+    if (vidx < 0 || vidx == INT_MAX || out_index <= 0 ||
+        os->oformat->flags & AVFMT_NOFILE) {
+        av_log(NULL, AV_LOG_ERROR, "-segments needs an output file with one video stream\n");
+        return AVERROR(EINVAL);
+    }
+
+    i = av_find_default_stream_index(ic);
+    st = i >= 0 ? ic->streams[i] : NULL;
+    if (!st || st->codec->codec_type != AVMEDIA_TYPE_VIDEO || st->nb_index_entries < 2) {
+        av_log(NULL, AV_LOG_ERROR, "-segments needs an input with a keyframe index\n");
+        return AVERROR(EINVAL);
+    }
+    /* a segment starting on an open GOP misses the frames its leading
+       pictures reference */
+    if (st->codec->has_b_frames)
+        av_log(NULL, AV_LOG_WARNING, "The input video has delayed frames, "
+               "-segments needs intra-only or closed GOP input\n");
+
+    /* -ss is relative to the start of the default stream */
+    base = st->start_time != AV_NOPTS_VALUE && st->start_time > 0 ? st->start_time : 0;
+    n = segment_split(ic, st, base, seg, FFMIN(nb_segments, MAX_SEGMENTS));
+    rate = output_streams_for_file[0][vidx]->frame_rate;
+    if (!rate.num)
+        rate = st->r_frame_rate;
+    for (i = 0; i < n; i++) {
+        if (snprintf(seg[i].filename, sizeof(seg[i].filename), "%s.seg%d",
+                     os->filename, i) >= sizeof(seg[i].filename)) {
+            av_log(NULL, AV_LOG_ERROR, "Output file name too long for -segments\n");
+            return AVERROR(EINVAL);
+        }
+        segment_time(seg[i].ss, sizeof(seg[i].ss), seg[i].start - base, st->time_base);
+        seg[i].t[0] = 0;
+        seg[i].timecode[0] = 0;
+        if (timecode) {
+            int64_t frames = av_rescale_q(seg[i].start - base, st->time_base,
+                                          (AVRational){ rate.den, rate.num });
+            if (segment_timecode(seg[i].timecode, sizeof(seg[i].timecode), timecode,
+                                 frames, lrint(av_q2d(rate))) < 0) {
+                av_log(NULL, AV_LOG_ERROR, "Invalid timecode %s\n", timecode);
+                return AVERROR(EINVAL);
+            }
+        }
+        if (i + 1 < n)
+            segment_time(seg[i].t, sizeof(seg[i].t), seg[i + 1].start - seg[i].start,
+                         st->time_base);
+        seg[i].pid = -1;
+    }
+    if (snprintf(aux_name, sizeof(aux_name), "%s.aux", os->filename) >= sizeof(aux_name)) {
+        av_log(NULL, AV_LOG_ERROR, "Output file name too long for -segments\n");
+        return AVERROR(EINVAL);
+    }
+    /* the jobs overwrite them and they are removed at the end */
+    for (i = -1; i < n; i++) {
+        const char *name = i < 0 ? aux_name : seg[i].filename;
+        if ((i >= 0 || os->nb_streams > 1) && avio_check(name, 0) == 0) {
+            av_log(NULL, AV_LOG_ERROR, "Temporary file '%s' of -segments already exists\n",
+                   name);
+            return AVERROR(EEXIST);
+        }
+    }
+    /* the DV and MXF muxers cannot take the video or the audio alone, and
+       the timestamps are needed to put the files back together */
+    tmp_format = strcmp(os->oformat->name, "dv") &&
+                 !(os->oformat->flags & AVFMT_NOTIMESTAMPS) ? os->oformat->name : "mov";
+
+    if (os->nb_streams > 1) {
+        if (!(args = segment_argv(argc, argv, out_index, os, aux_name, tmp_format,
+                                  "-vn", NULL)))
+            return AVERROR(ENOMEM);
+        aux_pid = segment_spawn(args);
+        segment_free_argv(args);
+        if (aux_pid < 0)
+            ret = AVERROR(errno);
+    }
+    for (i = 0; i < n && !ret; i++) {
+        av_log(NULL, AV_LOG_INFO, "Segment %d from %ss%s%s%s\n", i, seg[i].ss,
+               seg[i].t[0] ? " for " : "", seg[i].t, seg[i].t[0] ? "s" : "");
+        if (!(args = segment_argv(argc, argv, out_index, os, seg[i].filename,
+                                  tmp_format, "-an", &seg[i]))) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        seg[i].pid = segment_spawn(args);
+        segment_free_argv(args);
+        if (seg[i].pid < 0)
+            ret = AVERROR(errno);
+    }
+
+    for (i = -1; i < n; i++) {
+        pid_t pid = i < 0 ? aux_pid : seg[i].pid;
+        if (pid < 0)
+            continue;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            if (i < 0)
+                av_log(NULL, AV_LOG_ERROR, "Transcoding of the non-video streams failed\n");
+            else
+                av_log(NULL, AV_LOG_ERROR, "Transcoding of segment %d failed\n", i);
+            ret = AVERROR(EINVAL);
+        }
+    }
+
+    if (!ret)
+        ret = segment_concat(os, vidx, seg, n, st->time_base, rate, aux_name);
+
+    for (i = 0; i < n; i++)
+        unlink(seg[i].filename);
+    if (os->nb_streams > 1)
+        unlink(aux_name);
+    return ret;
+#else
+    av_log(NULL, AV_LOG_ERROR, "-segments is not supported on this platform\n");
+    return AVERROR(ENOSYS);
+#endif
+}
+
 static const OptionDef options[] = {
     /* main options */
 #include "cmdutils_common_opts.h"
@@ -5346,6 +6391,12 @@ static const OptionDef options[] = {
     { "coverfile", HAS_ARG, {(void*)opt_cover_file}, "add cover artwork", "coverfilepath" },
     { "benchmark", OPT_BOOL | OPT_EXPERT, {(void*)&do_benchmark},
       "add timings for benchmarking" },
+    { "benchmark_stages", OPT_BOOL | OPT_EXPERT, {(void*)&do_benchmark_stages},
+      "time the demuxing, decoding, filtering, scaling, encoding and muxing of each stream" },
+    { "benchmark_file", HAS_ARG | OPT_EXPERT, {(void*)opt_benchmark_file},
+      "write the stage timings to file, as CSV if its extension is csv and JSON otherwise", "file" },
+    { "segments", HAS_ARG | OPT_INT | OPT_EXPERT, {(void*)&nb_segments},
+      "transcode the video in this many keyframe aligned segments in parallel processes", "count" },
     { "timelimit", HAS_ARG, {(void*)opt_timelimit}, "set max runtime in seconds", "limit" },
     { "dump", OPT_BOOL | OPT_EXPERT, {(void*)&do_pkt_dump},
       "dump each input packet" },
@@ -5513,8 +6564,11 @@ int main(int argc, char **argv)
     }
 
     ti = getutime();
-    if (transcode(output_files, nb_output_files, input_files, nb_input_files,
-                  stream_maps, nb_stream_maps) < 0)
+    if (nb_segments > 1) {
+        if (transcode_segments(argc, argv) < 0)
+            ffmpeg_exit(1);
+    } else if (transcode(output_files, nb_output_files, input_files, nb_input_files,
+                         stream_maps, nb_stream_maps) < 0)
         ffmpeg_exit(1);
     ti = getutime() - ti;
     if (do_benchmark) {
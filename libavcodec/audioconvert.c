@@ -96,6 +96,10 @@ AVAudioConvert *av_audio_convert_alloc(enum AVSampleFormat out_fmt, int out_chan
         return NULL;
     ctx->in_channels = in_channels;
     ctx->out_channels = out_channels;
+    /* the layout is entirely described by the per channel pointers and
+       strides, so planar formats convert like their packed forms */
+    out_fmt = av_get_packed_sample_fmt(out_fmt);
+    in_fmt  = av_get_packed_sample_fmt(in_fmt);
     ctx->fmt_pair = out_fmt + AV_SAMPLE_FMT_NB*in_fmt;
     return ctx;
 }
@@ -110,6 +110,8 @@ void av_audio_convert_free(AVAudioConvert *ctx);
  * @param[in] out_stride distance between consecutive output samples (measured in bytes)
  * @param[in] in array of input buffers for each channel
  * @param[in] in_stride distance between consecutive input samples (measured in bytes)
+ * For planar sample formats, in and out point to the start of each plane
+ * and the stride is the sample size.
  * @param len length of audio frame size (measured in samples)
  */
 int av_audio_convert(AVAudioConvert *ctx,
@@ -239,6 +239,8 @@ enum CodecID {
     CODEC_ID_PCM_BLURAY,
     CODEC_ID_PCM_LXF,
     CODEC_ID_S302M,
+    CODEC_ID_PCM_S24LE_PLANAR,
+    CODEC_ID_PCM_S32LE_PLANAR,
 
     /* various ADPCM codecs */
     CODEC_ID_ADPCM_IMA_QT= 0x11000,
@@ -691,6 +693,11 @@ typedef struct RcOverride{
  * Codec supports slice-based (or partition-based) multithreading.
  */
 #define CODEC_CAP_SLICE_THREADS    0x2000
+/**
+ * Encoder sets coded_frame->pkt_dts to the decoding timestamp of the
+ * frame it returns, in AVCodecContext.time_base.
+ */
+#define CODEC_CAP_DTS              0x4000
 /**
  * Codec is lossless.
  */
@@ -1089,7 +1096,8 @@ typedef struct AVFrame {
 
     /**
      * dts from the last AVPacket that has been input into the decoder
-     * - encoding: unused
+     * - encoding: Set by libavcodec in coded_frame for encoders with
+     *             CODEC_CAP_DTS.
      * - decoding: Read by user.
      */
     int64_t pkt_dts;
@@ -3853,6 +3861,8 @@ int avcodec_open2(AVCodecContext *avctx, AVCodec *codec, AVDictionary **options)
  *
  * @param avctx the codec context
  * @param[out] samples the output buffer, sample type in avctx->sample_fmt
+ *            For planar sample formats the channels are stored one after
+ *            the other, each taking *frame_size_ptr / channels bytes.
  * @param[in,out] frame_size_ptr the output buffer size in bytes
  * @param[in] avpkt The input AVPacket containing the input buffer.
  *            You can create such packet with av_init_packet() and by then setting
@@ -3956,6 +3966,8 @@ int avcodec_parse_frame(AVCodecContext *avctx, uint8_t **pdata,
  * both of which are defined in avctx.
  * For PCM audio the number of samples read from samples is equal to
  * buf_size * input_sample_size / output_sample_size.
+ * For planar sample formats the channels are stored one after the other,
+ * each holding the same number of samples.
  * @return On error a negative value is returned, on success zero or the number
  * of bytes used to encode the data read from the input buffer.
  */
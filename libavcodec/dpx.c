@@ -19,13 +19,23 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/cpu.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/imgutils.h"
 #include "bytestream.h"
 #include "avcodec.h"
+#include "dpxdsp.h"
 
 typedef struct DPXContext {
     AVFrame picture;
+    DPXDSPContext dsp;
+    const uint8_t *buf;     ///< image data of the packet being decoded
+    int line_size;          ///< size of a line of image data in bytes
+    int endian;
+    int method_b;           ///< 10/12-bit samples use filling method B
+    int descriptor;
+    int bits_per_color;
+    int elements;
 } DPXContext;
 
 
@@ -41,12 +51,65 @@ static unsigned int read32(const uint8_t **ptr, int is_big)
     return temp;
 }
 
-static inline unsigned make_16bit(unsigned value)
+static int decode_line(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
 {
-    // mask away invalid bits
-    value &= 0xFFC0;
-    // correctly expand to 16 bits
-    return value + (value >> 10);
+    DPXContext *s = avctx->priv_data;
+    AVFrame *p = &s->picture;
+    const uint8_t *src = s->buf + jobnr * s->line_size;
+    uint8_t *ptr = p->data[0] + jobnr * p->linesize[0];
+    int x, w = avctx->width;
+
+    switch (s->descriptor) {
+    case 100: // CbYCrY
+        if (s->bits_per_color == 8) {
+            memcpy(ptr, src, 2 * w);
+        } else {
+            s->dsp.unpack10_422[s->method_b][s->endian]((uint16_t *)ptr,
+                (uint16_t *)(p->data[1] + jobnr * p->linesize[1]),
+                (uint16_t *)(p->data[2] + jobnr * p->linesize[2]), src, w);
+        }
+        return 0;
+    case 102: // CbYCr
+        s->dsp.unpack10_planar[s->method_b][s->endian](
+            (uint16_t *)(p->data[1] + jobnr * p->linesize[1]), (uint16_t *)ptr,
+            (uint16_t *)(p->data[2] + jobnr * p->linesize[2]), src, w);
+        return 0;
+    }
+
+    switch (s->bits_per_color) {
+    case 10:
+        s->dsp.unpack10[s->method_b][s->endian]((uint16_t *)ptr, src, w);
+        break;
+    case 12:
+        if (s->method_b) {
+            uint16_t *dst = (uint16_t *)ptr;
+            if (s->elements == 3) {
+                s->dsp.unpack12b[s->endian](dst, src, 3 * w);
+                break;
+            }
+            for (x = 0; x < w; x++) {
+                s->dsp.unpack12b[s->endian](dst, src, 3);
+                dst += 3;
+                src += 8;
+            }
+            break;
+        }
+        // Treat 12-bit as 16-bit
+    case 8:
+    case 16:
+        if (s->bits_per_color == 8 || s->elements == 3) {
+            memcpy(ptr, src, s->line_size);
+        } else {
+            // Drop alpha
+            for (x = 0; x < w; x++) {
+                memcpy(ptr, src, 6);
+                ptr += 6;
+                src += 8;
+            }
+        }
+        break;
+    }
+    return 0;
 }
 
 static int decode_frame(AVCodecContext *avctx,
@@ -60,13 +123,9 @@ static int decode_frame(AVCodecContext *avctx,
     DPXContext *const s = avctx->priv_data;
     AVFrame *picture  = data;
     AVFrame *const p = &s->picture;
-    uint8_t *ptr;
 
     int magic_num, offset, endian;
-    int x, y;
-    int w, h, stride, bits_per_color, descriptor, elements, target_packet_size, source_packet_size;
-
-    unsigned int rgbBuffer;
+    int w, h, bits_per_color, descriptor, elements, packing;
 
     if (avpkt->size <= 1634) {
         av_log(avctx, AV_LOG_ERROR, "Packet too small for DPX header\n");
@@ -106,7 +165,11 @@ static int decode_frame(AVCodecContext *avctx,
     avctx->bits_per_raw_sample =
     bits_per_color = buf[0];
 
-    buf += 825;
+    // Need to end in 0x324 to read the packing method
+    buf++;
+    packing = endian ? AV_RB16(buf) : AV_RL16(buf);
+
+    buf += 824;
     avctx->sample_aspect_ratio.num = read32(&buf, endian);
     avctx->sample_aspect_ratio.den = read32(&buf, endian);
 
@@ -115,8 +178,12 @@ static int decode_frame(AVCodecContext *avctx,
             elements = 4;
             break;
         case 50: // RGB
+        case 102: // CbYCr
             elements = 3;
             break;
+        case 100: // CbYCrY
+            elements = 2;
+            break;
         default:
             av_log(avctx, AV_LOG_ERROR, "Unsupported descriptor %d\n", descriptor);
             return -1;
@@ -126,31 +193,53 @@ static int decode_frame(AVCodecContext *avctx,
         case 8:
             if (elements == 4) {
                 avctx->pix_fmt = PIX_FMT_RGBA;
-            } else {
+            } else if (elements == 3) {
                 avctx->pix_fmt = PIX_FMT_RGB24;
+            } else {
+                avctx->pix_fmt = PIX_FMT_UYVY422;
             }
-            source_packet_size = elements;
-            target_packet_size = elements;
+            s->line_size = elements * w;
             break;
         case 10:
-            avctx->pix_fmt = PIX_FMT_RGB48;
-            target_packet_size = 6;
-            source_packet_size = 4;
+            if (elements == 4) {
+                av_log(avctx, AV_LOG_ERROR, "Unsupported 10-bit RGBA\n");
+                return -1;
+            } else if (descriptor == 102) {
+                avctx->pix_fmt = PIX_FMT_YUV444P10;
+            } else if (descriptor == 100) {
+                avctx->pix_fmt = PIX_FMT_YUV422P10;
+            } else {
+                avctx->pix_fmt = PIX_FMT_RGB48;
+            }
+            s->line_size = 4 * ((elements * w + 2) / 3);
             break;
         case 12:
         case 16:
-            if (endian) {
+            if (elements < 3) {
+                av_log(avctx, AV_LOG_ERROR, "Unsupported %d-bit CbYCrY\n", bits_per_color);
+                return -1;
+            }
+            if (bits_per_color == 12 && packing == 2) {
+                avctx->pix_fmt = PIX_FMT_RGB48;
+            } else if (endian) {
                 avctx->pix_fmt = PIX_FMT_RGB48BE;
             } else {
                 avctx->pix_fmt = PIX_FMT_RGB48LE;
             }
-            target_packet_size = 6;
-            source_packet_size = elements * 2;
+            s->line_size = elements * 2 * w;
             break;
         default:
             av_log(avctx, AV_LOG_ERROR, "Unsupported color depth : %d\n", bits_per_color);
             return -1;
     }
+    if (descriptor == 102 && bits_per_color != 10) {
+        av_log(avctx, AV_LOG_ERROR, "Unsupported %d-bit CbYCr\n", bits_per_color);
+        return -1;
+    }
+    if (descriptor == 100 && (w & 1)) {
+        av_log(avctx, AV_LOG_ERROR, "Odd width with CbYCrY\n");
+        return -1;
+    }
 
     if (s->picture.data[0])
         avctx->release_buffer(avctx, &s->picture);
@@ -166,49 +255,18 @@ static int decode_frame(AVCodecContext *avctx,
     // Move pointer to offset from start of file
     buf =  avpkt->data + offset;
 
-    ptr    = p->data[0];
-    stride = p->linesize[0];
-
-    if (source_packet_size*avctx->width*avctx->height > buf_end - buf) {
+    if ((int64_t)s->line_size * h > buf_end - buf) {
         av_log(avctx, AV_LOG_ERROR, "Overread buffer. Invalid header?\n");
         return -1;
     }
-    switch (bits_per_color) {
-        case 10:
-            for (x = 0; x < avctx->height; x++) {
-               uint16_t *dst = (uint16_t*)ptr;
-               for (y = 0; y < avctx->width; y++) {
-                   rgbBuffer = read32(&buf, endian);
-                   // Read out the 10-bit colors and convert to 16-bit
-                   *dst++ = make_16bit(rgbBuffer >> 16);
-                   *dst++ = make_16bit(rgbBuffer >>  6);
-                   *dst++ = make_16bit(rgbBuffer <<  4);
-               }
-               ptr += stride;
-            }
-            break;
-        case 8:
-        case 12: // Treat 12-bit as 16-bit
-        case 16:
-            if (source_packet_size == target_packet_size) {
-                for (x = 0; x < avctx->height; x++) {
-                    memcpy(ptr, buf, target_packet_size*avctx->width);
-                    ptr += stride;
-                    buf += source_packet_size*avctx->width;
-                }
-            } else {
-                for (x = 0; x < avctx->height; x++) {
-                    uint8_t *dst = ptr;
-                    for (y = 0; y < avctx->width; y++) {
-                        memcpy(dst, buf, target_packet_size);
-                        dst += target_packet_size;
-                        buf += source_packet_size;
-                    }
-                    ptr += stride;
-                }
-            }
-            break;
-    }
+
+    s->buf            = buf;
+    s->endian         = endian;
+    s->method_b       = packing == 2;
+    s->descriptor     = descriptor;
+    s->bits_per_color = bits_per_color;
+    s->elements       = elements;
+    avctx->execute2(avctx, decode_line, NULL, NULL, h);
 
     *picture   = s->picture;
     *data_size = sizeof(AVPicture);
@@ -221,6 +279,7 @@ static av_cold int decode_init(AVCodecContext *avctx)
     DPXContext *s = avctx->priv_data;
     avcodec_get_frame_defaults(&s->picture);
     avctx->coded_frame = &s->picture;
+    ff_dpxdsp_init(&s->dsp, av_get_cpu_flags());
     return 0;
 }
 
@@ -242,7 +301,7 @@ AVCodec ff_dpx_decoder = {
     NULL,
     decode_end,
     decode_frame,
-    0,
+    CODEC_CAP_SLICE_THREADS,
     NULL,
     .long_name = NULL_IF_CONFIG_SMALL("DPX image"),
 };
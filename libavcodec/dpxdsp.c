@@ -0,0 +1,203 @@
+/*
+ * DPX line packing and unpacking functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/intreadwrite.h"
+#include "dpxdsp.h"
+
+#define EXPAND10(v) ((v) << 6 | (v) >> 4)
+
+#define UNPACK10(name, RD, s0, s1, s2)                                  \
+static void unpack10_ ## name(uint16_t *dst, const uint8_t *src, int words) \
+{                                                                       \
+    int i;                                                              \
+    for (i = 0; i < words; i++) {                                       \
+        unsigned w = RD(src + 4 * i);                                   \
+        *dst++ = EXPAND10(w >> s0 & 0x3ff);                             \
+        *dst++ = EXPAND10(w >> s1 & 0x3ff);                             \
+        *dst++ = EXPAND10(w >> s2 & 0x3ff);                             \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+static void unpack10_planar_ ## name(uint16_t *dst0, uint16_t *dst1,    \
+                                     uint16_t *dst2, const uint8_t *src, \
+                                     int words)                         \
+{                                                                       \
+    int i;                                                              \
+    for (i = 0; i < words; i++) {                                       \
+        unsigned w = RD(src + 4 * i);                                   \
+        dst0[i] = w >> s0 & 0x3ff;                                      \
+        dst1[i] = w >> s1 & 0x3ff;                                      \
+        dst2[i] = w >> s2 & 0x3ff;                                      \
+    }                                                                   \
+}
+
+UNPACK10(a_le, AV_RL32, 22, 12, 2)
+UNPACK10(a_be, AV_RB32, 22, 12, 2)
+UNPACK10(b_le, AV_RL32, 20, 10, 0)
+UNPACK10(b_be, AV_RB32, 20, 10, 0)
+
+#define UNPACK12B(name, RD)                                             \
+static void unpack12b_ ## name(uint16_t *dst, const uint8_t *src, int samples) \
+{                                                                       \
+    int i;                                                              \
+    for (i = 0; i < samples; i++) {                                     \
+        unsigned v = RD(src + 2 * i) & 0xfff;                           \
+        dst[i] = v << 4 | v >> 8;                                       \
+    }                                                                   \
+}
+
+UNPACK12B(le, AV_RL16)
+UNPACK12B(be, AV_RB16)
+
+#define PACK10(name, RD, WR)                                            \
+static void pack10_ ## name(uint8_t *dst, const uint8_t *src, int words) \
+{                                                                       \
+    int i;                                                              \
+    for (i = 0; i < words; i++) {                                       \
+        WR(dst + 4 * i, (RD(src + 6 * i + 0) & 0xFFC0U) << 16 |        \
+                        (RD(src + 6 * i + 2) & 0xFFC0U) <<  6 |        \
+                        (RD(src + 6 * i + 4) & 0xFFC0U) >>  4);        \
+    }                                                                   \
+}
+
+PACK10(le_le, AV_RL16, AV_WL32)
+PACK10(le_be, AV_RL16, AV_WB32)
+PACK10(be_le, AV_RB16, AV_WL32)
+PACK10(be_be, AV_RB16, AV_WB32)
+
+#define PACK10_PLANAR(name, WR)                                         \
+static void pack10_planar_ ## name(uint8_t *dst, const uint16_t *src0,  \
+                                   const uint16_t *src1,                \
+                                   const uint16_t *src2, int words)     \
+{                                                                       \
+    int i;                                                              \
+    for (i = 0; i < words; i++)                                         \
+        WR(dst + 4 * i, (src0[i] & 0x3ffU) << 22 |                      \
+                        (src1[i] & 0x3ffU) << 12 |                      \
+                        (src2[i] & 0x3ffU) <<  2);                      \
+}
+
+PACK10_PLANAR(le, AV_WL32)
+PACK10_PLANAR(be, AV_WB32)
+
+/* 4:2:2 samples are stored Cb Y Cr Y, 6 pixels fill 4 words exactly */
+#define UNPACK10_422(name, RD, s0, s1, s2)                              \
+static void unpack10_422_ ## name(uint16_t *y, uint16_t *u, uint16_t *v, \
+                                  const uint8_t *src, int width)        \
+{                                                                       \
+    int i, n = 0;                                                       \
+    for (i = 0; i + 6 <= width; i += 6) {                               \
+        unsigned w0 = RD(src), w1 = RD(src + 4);                        \
+        unsigned w2 = RD(src + 8), w3 = RD(src + 12);                   \
+        *u++ = w0 >> s0 & 0x3ff;                                        \
+        *y++ = w0 >> s1 & 0x3ff;                                        \
+        *v++ = w0 >> s2 & 0x3ff;                                        \
+        *y++ = w1 >> s0 & 0x3ff;                                        \
+        *u++ = w1 >> s1 & 0x3ff;                                        \
+        *y++ = w1 >> s2 & 0x3ff;                                        \
+        *v++ = w2 >> s0 & 0x3ff;                                        \
+        *y++ = w2 >> s1 & 0x3ff;                                        \
+        *u++ = w2 >> s2 & 0x3ff;                                        \
+        *y++ = w3 >> s0 & 0x3ff;                                        \
+        *v++ = w3 >> s1 & 0x3ff;                                        \
+        *y++ = w3 >> s2 & 0x3ff;                                        \
+        src += 16;                                                      \
+    }                                                                   \
+    for (i = 0; i < 2 * (width % 6); i++) {                             \
+        unsigned c = RD(src + 4 * (i / 3)) >> (s0 - 10 * (i % 3)) & 0x3ff; \
+        switch (i & 3) {                                                \
+        case 0:  u[n >> 1] = c; break;                                  \
+        case 2:  v[n >> 1] = c; break;                                  \
+        default: y[n++]    = c; break;                                  \
+        }                                                               \
+    }                                                                   \
+}
+
+UNPACK10_422(a_le, AV_RL32, 22, 12, 2)
+UNPACK10_422(a_be, AV_RB32, 22, 12, 2)
+UNPACK10_422(b_le, AV_RL32, 20, 10, 0)
+UNPACK10_422(b_be, AV_RB32, 20, 10, 0)
+
+#define WORD10(a, b, c) (((a) & 0x3ffU) << 22 | ((b) & 0x3ffU) << 12 | ((c) & 0x3ffU) << 2)
+
+#define PACK10_422(name, WR)                                            \
+static void pack10_422_ ## name(uint8_t *dst, const uint16_t *y,        \
+                                const uint16_t *u, const uint16_t *v,   \
+                                int width)                              \
+{                                                                       \
+    unsigned value = 0;                                                 \
+    int i, n = 0;                                                       \
+    for (i = 0; i + 6 <= width; i += 6) {                               \
+        WR(dst,      WORD10(u[0], y[0], v[0]));                         \
+        WR(dst +  4, WORD10(y[1], u[1], y[2]));                         \
+        WR(dst +  8, WORD10(v[1], y[3], u[2]));                         \
+        WR(dst + 12, WORD10(y[4], v[2], y[5]));                         \
+        y += 6;                                                         \
+        u += 3;                                                         \
+        v += 3;                                                         \
+        dst += 16;                                                      \
+    }                                                                   \
+    for (i = 0; i < 2 * (width % 6); i++) {                             \
+        unsigned c;                                                     \
+        switch (i & 3) {                                                \
+        case 0:  c = u[n >> 1]; break;                                  \
+        case 2:  c = v[n >> 1]; break;                                  \
+        default: c = y[n++];    break;                                  \
+        }                                                               \
+        value |= (c & 0x3ff) << (22 - 10 * (i % 3));                    \
+        if (i % 3 == 2 || i == 2 * (width % 6) - 1) {                   \
+            WR(dst, value);                                             \
+            dst  += 4;                                                  \
+            value = 0;                                                  \
+        }                                                               \
+    }                                                                   \
+}
+
+PACK10_422(le, AV_WL32)
+PACK10_422(be, AV_WB32)
+
+void ff_dpxdsp_init(DPXDSPContext *c, int cpu_flags)
+{
+    c->unpack10[0][0] = unpack10_a_le;
+    c->unpack10[0][1] = unpack10_a_be;
+    c->unpack10[1][0] = unpack10_b_le;
+    c->unpack10[1][1] = unpack10_b_be;
+    c->unpack10_planar[0][0] = unpack10_planar_a_le;
+    c->unpack10_planar[0][1] = unpack10_planar_a_be;
+    c->unpack10_planar[1][0] = unpack10_planar_b_le;
+    c->unpack10_planar[1][1] = unpack10_planar_b_be;
+    c->unpack12b[0] = unpack12b_le;
+    c->unpack12b[1] = unpack12b_be;
+    c->pack10[0][0] = pack10_le_le;
+    c->pack10[0][1] = pack10_le_be;
+    c->pack10[1][0] = pack10_be_le;
+    c->pack10[1][1] = pack10_be_be;
+    c->pack10_planar[0] = pack10_planar_le;
+    c->pack10_planar[1] = pack10_planar_be;
+    c->unpack10_422[0][0] = unpack10_422_a_le;
+    c->unpack10_422[0][1] = unpack10_422_a_be;
+    c->unpack10_422[1][0] = unpack10_422_b_le;
+    c->unpack10_422[1][1] = unpack10_422_b_be;
+    c->pack10_422[0] = pack10_422_le;
+    c->pack10_422[1] = pack10_422_be;
+
+    if (HAVE_MMX)
+        ff_dpxdsp_init_x86(c, cpu_flags);
+}
@@ -0,0 +1,61 @@
+/*
+ * DPX line packing and unpacking functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_DPXDSP_H
+#define AVCODEC_DPXDSP_H
+
+#include <stdint.h>
+
+/**
+ * 10-bit samples are filled 3 per 32-bit word, the first sample in the
+ * most significant bits. With method A the 2 padding bits are the least
+ * significant ones, with method B the most significant ones.
+ * The functions are indexed by [method B][big-endian words] and work on
+ * any number of words, 16-bit samples are in native endianness.
+ */
+typedef struct DPXDSPContext {
+    /** words to 16-bit samples, the 10 bits replicated in the low bits */
+    void (*unpack10[2][2])(uint16_t *dst, const uint8_t *src, int words);
+    /** words to 10-bit samples, one plane per position in the word */
+    void (*unpack10_planar[2][2])(uint16_t *dst0, uint16_t *dst1, uint16_t *dst2,
+                                  const uint8_t *src, int words);
+    /** 12-bit samples in the low bits of 16-bit words to 16-bit samples,
+        indexed by [big-endian words] */
+    void (*unpack12b[2])(uint16_t *dst, const uint8_t *src, int samples);
+    /** 16-bit samples to method A words, indexed by
+        [big-endian samples][big-endian words] */
+    void (*pack10[2][2])(uint8_t *dst, const uint8_t *src, int words);
+    /** 10-bit planes to method A words, indexed by [big-endian words] */
+    void (*pack10_planar[2])(uint8_t *dst, const uint16_t *src0, const uint16_t *src1,
+                             const uint16_t *src2, int words);
+    /** Cb Y Cr Y words to 10-bit 4:2:2 planes of width luma samples,
+        indexed by [method B][big-endian words] */
+    void (*unpack10_422[2][2])(uint16_t *y, uint16_t *u, uint16_t *v,
+                               const uint8_t *src, int width);
+    /** 10-bit 4:2:2 planes of width luma samples to method A Cb Y Cr Y words,
+        indexed by [big-endian words] */
+    void (*pack10_422[2])(uint8_t *dst, const uint16_t *y, const uint16_t *u,
+                          const uint16_t *v, int width);
+} DPXDSPContext;
+
+void ff_dpxdsp_init(DPXDSPContext *c, int cpu_flags);
+void ff_dpxdsp_init_x86(DPXDSPContext *c, int cpu_flags);
+
+#endif /* AVCODEC_DPXDSP_H */
@@ -19,15 +19,21 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/cpu.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/imgutils.h"
 #include "avcodec.h"
+#include "dpxdsp.h"
 
 typedef struct DPXContext {
     AVFrame picture;
+    DPXDSPContext dsp;
     int big_endian;
     int bits_per_component;
     int descriptor;
+    const AVPicture *pic;   ///< picture being encoded
+    uint8_t *dst;           ///< image data of the packet being encoded
+    int line_size;          ///< size of a line of image data in bytes
 } DPXContext;
 
 static av_cold int encode_init(AVCodecContext *avctx)
@@ -53,11 +59,25 @@ static av_cold int encode_init(AVCodecContext *avctx)
     case PIX_FMT_RGB48BE:
         s->bits_per_component = avctx->bits_per_raw_sample ? avctx->bits_per_raw_sample : 16;
         break;
+    case PIX_FMT_YUV422P10:
+        if (avctx->width & 1) {
+            av_log(avctx, AV_LOG_ERROR, "width must be even for 4:2:2\n");
+            return -1;
+        }
+        s->descriptor = 100; /* CbYCrY */
+        s->bits_per_component = 10;
+        break;
+    case PIX_FMT_YUV444P10:
+        s->descriptor = 102; /* CbYCr */
+        s->bits_per_component = 10;
+        break;
     default:
         av_log(avctx, AV_LOG_INFO, "unsupported pixel format\n");
         return -1;
     }
 
+    ff_dpxdsp_init(&s->dsp, av_get_cpu_flags());
+
     return 0;
 }
 
@@ -73,29 +93,29 @@ do { \
     else               AV_WL32(p, value); \
 } while(0)
 
-static void encode_rgb48_10bit(AVCodecContext *avctx, const AVPicture *pic, uint8_t *dst)
+static int encode_line(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
 {
     DPXContext *s = avctx->priv_data;
-    const uint8_t *src = pic->data[0];
-    int x, y;
-
-    for (y = 0; y < avctx->height; y++) {
-        for (x = 0; x < avctx->width; x++) {
-            int value;
-            if ((avctx->pix_fmt & 1)) {
-                value = ((AV_RB16(src + 6*x + 4) & 0xFFC0) >> 4)
-                      | ((AV_RB16(src + 6*x + 2) & 0xFFC0) << 6)
-                      | ((AV_RB16(src + 6*x + 0) & 0xFFC0) << 16);
-            } else {
-                value = ((AV_RL16(src + 6*x + 4) & 0xFFC0) >> 4)
-                      | ((AV_RL16(src + 6*x + 2) & 0xFFC0) << 6)
-                      | ((AV_RL16(src + 6*x + 0) & 0xFFC0) << 16);
-            }
-            write32(dst, value);
-            dst += 4;
-        }
-        src += pic->linesize[0];
+    const AVPicture *pic = s->pic;
+    const uint8_t *src = pic->data[0] + jobnr * pic->linesize[0];
+    uint8_t *dst = s->dst + jobnr * s->line_size;
+
+    switch (avctx->pix_fmt) {
+    case PIX_FMT_YUV422P10:
+        s->dsp.pack10_422[s->big_endian](dst, (const uint16_t *)src,
+            (const uint16_t *)(pic->data[1] + jobnr * pic->linesize[1]),
+            (const uint16_t *)(pic->data[2] + jobnr * pic->linesize[2]), avctx->width);
+        break;
+    case PIX_FMT_YUV444P10:
+        s->dsp.pack10_planar[s->big_endian](dst,
+            (const uint16_t *)(pic->data[1] + jobnr * pic->linesize[1]), (const uint16_t *)src,
+            (const uint16_t *)(pic->data[2] + jobnr * pic->linesize[2]), avctx->width);
+        break;
+    default:
+        s->dsp.pack10[avctx->pix_fmt == PIX_FMT_RGB48BE][s->big_endian](dst, src, avctx->width);
+        break;
     }
+    return 0;
 }
 
 static int encode_frame(AVCodecContext *avctx, unsigned char *buf, int buf_size, void *data)
@@ -124,8 +144,13 @@ static int encode_frame(AVCodecContext *avctx, unsigned char *buf, int buf_size,
     write32(buf + 772, avctx->width);
     write32(buf + 776, avctx->height);
     buf[800] = s->descriptor;
-    buf[801] = 2; /* linear transfer */
-    buf[802] = 2; /* linear colorimetric */
+    if (s->descriptor >= 100) {
+        buf[801] = 6; /* ITU-R 709-4 transfer */
+        buf[802] = 6; /* ITU-R 709-4 colorimetric */
+    } else {
+        buf[801] = 2; /* linear transfer */
+        buf[802] = 2; /* linear colorimetric */
+    }
     buf[803] = s->bits_per_component;
     write16(buf + 804, s->bits_per_component == 10 ? 1 : 0); /* packing method */
     write32(buf + 808, HEADER_SIZE); /* offset to data */
@@ -144,10 +169,16 @@ static int encode_frame(AVCodecContext *avctx, unsigned char *buf, int buf_size,
             return size;
         break;
     case 10:
-        size = avctx->height * avctx->width * 4;
+        if (s->descriptor == 100)
+            s->line_size = 4 * ((2 * avctx->width + 2) / 3);
+        else
+            s->line_size = 4 * avctx->width;
+        size = avctx->height * s->line_size;
         if (buf_size < HEADER_SIZE + size)
             return -1;
-        encode_rgb48_10bit(avctx, data, buf + HEADER_SIZE);
+        s->pic = data;
+        s->dst = buf + HEADER_SIZE;
+        avctx->execute2(avctx, encode_line, NULL, NULL, avctx->height);
         break;
     default:
         av_log(avctx, AV_LOG_ERROR, "Unsupported bit depth: %d\n", s->bits_per_component);
@@ -167,12 +198,14 @@ AVCodec ff_dpx_encoder = {
     .priv_data_size = sizeof(DPXContext),
     .init   = encode_init,
     .encode = encode_frame,
-    .capabilities = CODEC_CAP_LOSSLESS,
+    .capabilities = CODEC_CAP_LOSSLESS | CODEC_CAP_SLICE_THREADS,
     .pix_fmts = (const enum PixelFormat[]){
         PIX_FMT_RGB24,
         PIX_FMT_RGBA,
         PIX_FMT_RGB48LE,
         PIX_FMT_RGB48BE,
+        PIX_FMT_YUV422P10,
+        PIX_FMT_YUV444P10,
         PIX_FMT_NONE},
     .long_name = NULL_IF_CONFIG_SMALL("DPX image"),
 };
@@ -34,6 +34,7 @@
  * DV codec.
  */
 #define ALT_BITSTREAM_READER
+#include "libavutil/cpu.h"
 #include "libavutil/pixdesc.h"
 #include "avcodec.h"
 #include "dsputil.h"
@@ -86,6 +87,7 @@ static av_cold int dvvideo_init_encoder(AVCodecContext *avctx)
     }
 
     ff_dv_init_dynamic_tables(s->sys);
+    ff_dvencdsp_init(&s->dvdsp, av_get_cpu_flags());
 
     avctx->bit_rate = s->sys->frame_size * 8LL *
         avctx->time_base.den / avctx->time_base.num;
@@ -97,6 +99,10 @@ static av_cold int dvvideo_init_encoder(AVCodecContext *avctx)
 static const int vs_total_ac_bits_hd = (68 * 6 + 52*2) * 5;
 static const int vs_total_ac_bits = (100 * 4 + 68*2) * 5;
 static const int mb_area_start[5] = { 1, 6, 21, 43, 64 };
+static const uint64_t mb_area_mask[4] = {
+    0x000000000000003eULL, 0x00000000001fffc0ULL,
+    0x000007ffffe00000ULL, 0xfffff80000000000ULL,
+};
 
 typedef struct EncBlockInfo {
     int      area_q[4];
@@ -165,6 +171,16 @@ static av_always_inline PutBitContext *dv_encode_ac(EncBlockInfo *bi,
     return pb;
 }
 
+/* index of the lowest set bit of a nonzero coefficient mask */
+static av_always_inline int dv_mask_first(uint64_t mask)
+{
+    uint32_t lo = mask;
+    if (lo)
+        return av_log2(lo & -lo);
+    lo = mask >> 32;
+    return 32 + av_log2(lo & -lo);
+}
+
 static av_always_inline int dv_guess_dct_mode(DVVideoContext *s, uint8_t *data, int linesize) {
     if (s->avctx->flags & CODEC_FLAG_INTERLACED_DCT) {
         int ps = s->dsp.ildct_cmp[5](NULL, data, NULL, linesize, 8) - 400;
@@ -178,10 +194,13 @@ static av_always_inline int dv_guess_dct_mode(DVVideoContext *s, uint8_t *data,
     return 0;
 }
 
-static inline void dv_set_class_number_sd(DCTELEM *blk, EncBlockInfo *bi,
+static inline void dv_set_class_number_sd(DVVideoContext *s,
+                                          DCTELEM *blk, EncBlockInfo *bi,
                                           const uint8_t *zigzag_scan,
                                           const int *weight, int bias)
 {
+    LOCAL_ALIGNED_16(DCTELEM, zz, [64]);
+    uint64_t mask;
     int i, area;
     /* We offer two different methods for class number assignment: the
        method suggested in SMPTE 314M Table 22, and an improved
@@ -201,30 +220,35 @@ static inline void dv_set_class_number_sd(DCTELEM *blk, EncBlockInfo *bi,
     int max  = classes[0];
     int prev = 0;
 
+    for (i = 0; i < 64; i++)
+        zz[i] = blk[zigzag_scan[i]];
+
+    /* weight the levels and shift them down into range, adding for rounding */
+    /* the extra division by a factor of 2^4 reverses the 8x expansion of the DCT
+       AND the 2x doubling of the weights */
+    mask = s->dvdsp.weigh(bi->mb, bi->sign, zz, weight,
+                          1 << (dv_weight_bits+3), dv_weight_bits+4);
     bi->mb[0] = blk[0];
 
+    /* only levels outside of [-15, 15] are coded */
     for (area = 0; area < 4; area++) {
+        uint64_t m = mask & mb_area_mask[area];
+
         bi->prev[area]     = prev;
         bi->bit_size[area] = 1; // 4 areas 4 bits for EOB :)
-        for (i = mb_area_start[area]; i < mb_area_start[area+1]; i++) {
-            int level = blk[zigzag_scan[i]];
-
-            if (level + 15 > 30U) {
-                bi->sign[i] = (level >> 31) & 1;
-                /* weight it and and shift down into range, adding for rounding */
-                /* the extra division by a factor of 2^4 reverses the 8x expansion of the DCT
-                   AND the 2x doubling of the weights */
-                level = (FFABS(level) * weight[i] + (1 << (dv_weight_bits+3))) >> (dv_weight_bits+4);
-                bi->mb[i] = level;
-                if (level > max)
-                    max = level;
-                bi->bit_size[area] += dv_rl2vlc_size(i - prev  - 1, level);
-                bi->next[prev] = i;
-                prev = i;
-            }
+        for (; m; m &= m - 1) {
+            int level;
+
+            i     = dv_mask_first(m);
+            level = bi->mb[i];
+            if (level > max)
+                max = level;
+            bi->bit_size[area] += dv_rl2vlc_size(i - prev  - 1, level);
+            bi->next[prev] = i;
+            prev = i;
         }
     }
-    bi->next[prev]= i;
+    bi->next[prev]= 64;
     for (bi->cno = 0; max > classes[bi->cno]; bi->cno++)
         ;
     bi->cno += bias;
@@ -251,41 +275,22 @@ static inline void dv_set_class_number_sd(DCTELEM *blk, EncBlockInfo *bi,
 
 /* this function just copies the DCT coefficients and performs
    the initial (non-)quantization. */
-static inline void dv_set_class_number_hd(DCTELEM *blk, EncBlockInfo *bi,
+static inline void dv_set_class_number_hd(DVVideoContext *s,
+                                          DCTELEM *blk, EncBlockInfo *bi,
                                           const uint8_t *zigzag_scan,
                                           const int *weight, int bias)
 {
+    LOCAL_ALIGNED_16(DCTELEM, zz, [64]);
     int i, max = 0;
 
     /* the first quantization (none at all) */
     bi->area_q[0] = 1;
 
-    /* LOOP1: weigh AC components and store to save[] */
-    /* (i=0 is the DC component; we only include it to make the
-       number of loop iterations even, for future possible SIMD optimization) */
-    for (i = 0; i < 64; i += 2) {
-        int level0, level1;
-
-        /* get the AC component (in zig-zag order) */
-        level0 = blk[zigzag_scan[i+0]];
-        level1 = blk[zigzag_scan[i+1]];
-
-        /* extract sign and make it the lowest bit */
-        bi->sign[i+0] = (level0>>31)&1;
-        bi->sign[i+1] = (level1>>31)&1;
-
-        /* take absolute value of the level */
-        level0 = FFABS(level0);
-        level1 = FFABS(level1);
-
-        /* weigh it */
-        level0 = (level0*weight[i+0] + 4096 + (1<<17)) >> 18;
-        level1 = (level1*weight[i+1] + 4096 + (1<<17)) >> 18;
-
-        /* save unquantized value */
-        bi->save[i+0] = level0;
-        bi->save[i+1] = level1;
-    }
+    /* weigh AC components and store to save[], the sign as the lowest bit
+       in sign[] (i=0 is the DC component, it is simply overwritten below) */
+    for (i = 0; i < 64; i++)
+        zz[i] = blk[zigzag_scan[i]];
+    s->dvdsp.weigh(bi->save, bi->sign, zz, weight, 4096 + (1 << 17), 18);
 
     /* find max component */
     for (i = 0; i < 64; i++) {
@@ -341,12 +346,12 @@ static av_always_inline int dv_init_enc_block(EncBlockInfo* bi, uint8_t *data, i
         } else { /* 720p */
             weights = dv_weight_720[chroma];
         }
-        dv_set_class_number_hd(blk, bi,
+        dv_set_class_number_hd(s, blk, bi,
                                ff_zigzag_direct,
                                weights,
                                dv100_min_bias+chroma*dv100_chroma_bias);
     } else {
-        dv_set_class_number_sd(blk, bi,
+        dv_set_class_number_sd(s, blk, bi,
                                bi->dct_mode ? ff_zigzag248_direct : ff_zigzag_direct,
                                bi->dct_mode ? dv_weight_248 : dv_weight_88,
                                chroma);
@@ -355,26 +360,12 @@ static av_always_inline int dv_init_enc_block(EncBlockInfo* bi, uint8_t *data, i
     return bi->bit_size[0] + bi->bit_size[1] + bi->bit_size[2] + bi->bit_size[3];
 }
 
-/* DV100 quantize
-   Perform quantization by divinding the AC component by the qstep.
-   As an optimization we use a fixed-point integer multiply instead
-   of a divide. */
-static av_always_inline int dv100_quantize(int level, int qsinv)
-{
-    /* this code is equivalent to */
-    /* return (level + qs/2) / qs; */
-
-    return (level * qsinv + 1024 + (1<<(dv100_qstep_bits-1))) >> dv100_qstep_bits;
-
-    /* the extra +1024 is needed to make the rounding come out right. */
-
-    /* I (DJM) have verified that the results are exactly the same as
-       division for level 0-2048 at all QNOs. */
-}
-
-static int dv100_actual_quantize(EncBlockInfo *b, int qlevel)
+static int dv100_actual_quantize(const DVEncDSPContext *dsp, EncBlockInfo *b,
+                                 int qlevel)
 {
-    int prev, k, qsinv;
+    LOCAL_ALIGNED_16(DCTELEM, ac, [64]);
+    uint64_t mask;
+    int prev, k;
 
     int qno = DV100_QLEVEL_QNO(dv100_qlevels[qlevel]);
     int cno = DV100_QLEVEL_CNO(dv100_qlevels[qlevel]);
@@ -382,8 +373,6 @@ static int dv100_actual_quantize(EncBlockInfo *b, int qlevel)
     if (b->area_q[0] == qno && b->cno == cno)
         return b->bit_size[0];
 
-    qsinv = dv100_qstep_inv[qno];
-
     /* record the new qstep */
     b->area_q[0] = qno;
     b->cno = cno;
@@ -391,27 +380,23 @@ static int dv100_actual_quantize(EncBlockInfo *b, int qlevel)
     /* reset encoded size (EOB = 4 bits) */
     b->bit_size[0] = 4;
 
-    /* visit nonzero components and quantize */
+    /* quantize, then visit the nonzero AC components */
+    mask = dsp->quantize_hd(ac, b->save, dv100_qstep_inv[qno], cno) & ~1ULL;
     prev = 0;
-    for (k = 1; k < 64; k++) {
-        /* quantize */
-        int ac = dv100_quantize(b->save[k], qsinv) >> cno;
-        if (ac) {
-            if (ac > 255)
-                ac = 255;
-            b->mb[k] = ac;
-            b->bit_size[0] += dv_rl2vlc_size(k - prev - 1, ac);
-            b->next[prev] = k;
-            prev = k;
-        }
+    for (; mask; mask &= mask - 1) {
+        k = dv_mask_first(mask);
+        b->mb[k] = ac[k];
+        b->bit_size[0] += dv_rl2vlc_size(k - prev - 1, ac[k]);
+        b->next[prev] = k;
+        prev = k;
     }
-    b->next[prev] = k;
+    b->next[prev] = 64;
 
     return b->bit_size[0];
 }
 
 
-static inline void dv_guess_qnos_hd(EncBlockInfo *blks, int *qnos)
+static inline void dv_guess_qnos_hd(const DVEncDSPContext *dsp, EncBlockInfo *blks, int *qnos)
 {
     EncBlockInfo *b;
     int min_qlevel[5];
@@ -444,7 +429,7 @@ static inline void dv_guess_qnos_hd(EncBlockInfo *blks, int *qnos)
         qnos[i] = DV100_QLEVEL_QNO(dv100_qlevels[qlevels[i]]);
         size[i] = 0;
         for (j = 0; j < 8; j++) {
-            size_cache[8*i+j][qlevels[i]] = dv100_actual_quantize(&blks[8*i+j], qlevels[i]);
+            size_cache[8*i+j][qlevels[i]] = dv100_actual_quantize(dsp, &blks[8*i+j], qlevels[i]);
             size[i] += size_cache[8*i+j][qlevels[i]];
         }
     }
@@ -486,7 +471,7 @@ static inline void dv_guess_qnos_hd(EncBlockInfo *blks, int *qnos)
                 if(size_cache[8*i+j][qlevels[i]] == 0) {
                     /* it is safe to use actual_quantize() here because we only go from finer to coarser,
                        and it saves the final actual_quantize() down below */
-                    size_cache[8*i+j][qlevels[i]] = dv100_actual_quantize(b, qlevels[i]);
+                    size_cache[8*i+j][qlevels[i]] = dv100_actual_quantize(dsp, b, qlevels[i]);
                 }
                 size[i] += size_cache[8*i+j][qlevels[i]];
             } /* for each block */
@@ -541,7 +526,7 @@ static inline void dv_guess_qnos_hd(EncBlockInfo *blks, int *qnos)
             for (j = 0; j < 8; j++, b++) {
                 /* accumulate block size into macroblock */
                 if(size_cache[8*i+j][qlevels[i]] == 0) {
-                    size_cache[8*i+j][qlevels[i]] = dv100_actual_quantize(b, qlevels[i]);
+                    size_cache[8*i+j][qlevels[i]] = dv100_actual_quantize(dsp, b, qlevels[i]);
                 }
                 size[i] += size_cache[8*i+j][qlevels[i]];
             } /* for each block */
@@ -563,7 +548,7 @@ static inline void dv_guess_qnos_hd(EncBlockInfo *blks, int *qnos)
         size[i] = 0;
         for (j = 0; j < 8; j++, b++) {
             /* accumulate block size into macroblock */
-            size[i] += dv100_actual_quantize(b, qlevels[i]);
+            size[i] += dv100_actual_quantize(dsp, b, qlevels[i]);
         } /* for each block */
     }
 }
@@ -746,7 +731,7 @@ static int dv_encode_video_segment(AVCodecContext *avctx, void *arg)
 
     if (DV_PROFILE_IS_HD(s->sys)) {
         /* unconditional */
-        dv_guess_qnos_hd(&enc_blks[0], qnosp);
+        dv_guess_qnos_hd(&s->dvdsp, &enc_blks[0], qnosp);
     } else if (vs_total_ac_bits < vs_bit_size) {
         dv_guess_qnos(&enc_blks[0], qnosp);
     }
@@ -0,0 +1,62 @@
+/*
+ * DV encoder coefficient weighting and quantization
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/common.h"
+#include "dvencdsp.h"
+
+static uint64_t weigh_c(DCTELEM *dst, uint8_t *sign, const DCTELEM *src,
+                        const int *weight, int bias, int shift)
+{
+    uint64_t mask = 0;
+    int i;
+
+    for (i = 0; i < 64; i++) {
+        int level = src[i];
+        sign[i] = level < 0;
+        level   = FFABS(level);
+        dst[i]  = (unsigned)(level * weight[i] + bias) >> shift;
+        if (level > 15)
+            mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+static uint64_t quantize_hd_c(DCTELEM *dst, const DCTELEM *src, int qsinv, int cno)
+{
+    uint64_t mask = 0;
+    int i;
+
+    for (i = 0; i < 64; i++) {
+        int ac = ((src[i] * qsinv + 1024 + (1 << 15)) >> 16) >> cno;
+        dst[i] = FFMIN(ac, 255);
+        if (ac)
+            mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+void ff_dvencdsp_init(DVEncDSPContext *c, int cpu_flags)
+{
+    c->weigh       = weigh_c;
+    c->quantize_hd = quantize_hd_c;
+
+    if (HAVE_MMX)
+        ff_dvencdsp_init_x86(c, cpu_flags);
+}
@@ -0,0 +1,54 @@
+/*
+ * DV encoder coefficient weighting and quantization
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_DVENCDSP_H
+#define AVCODEC_DVENCDSP_H
+
+#include <stdint.h>
+#include "dsputil.h"
+
+/**
+ * The functions work on the 64 coefficients of a block in zigzag order
+ * and return a mask of the coefficients of interest, bit i for
+ * coefficient i, which the bit estimation walks instead of the whole
+ * block. The buffers need not be aligned.
+ */
+typedef struct DVEncDSPContext {
+    /**
+     * dst[i] = (FFABS(src[i]) * weight[i] + bias) >> shift,
+     * sign[i] = src[i] < 0.
+     * FFABS(src[i]) * weight[i] + bias must fit in 32 bits.
+     * @return mask of the coefficients with FFABS(src[i]) > 15
+     */
+    uint64_t (*weigh)(DCTELEM *dst, uint8_t *sign, const DCTELEM *src,
+                      const int *weight, int bias, int shift);
+    /**
+     * DV100 quantization of weighted coefficients,
+     * dst[i] = FFMIN(((src[i] * qsinv + 1024 + (1 << 15)) >> 16) >> cno, 255).
+     * src[i] must be positive, qsinv at most 65536.
+     * @return mask of the nonzero dst[i]
+     */
+    uint64_t (*quantize_hd)(DCTELEM *dst, const DCTELEM *src, int qsinv, int cno);
+} DVEncDSPContext;
+
+void ff_dvencdsp_init(DVEncDSPContext *c, int cpu_flags);
+void ff_dvencdsp_init_x86(DVEncDSPContext *c, int cpu_flags);
+
+#endif /* AVCODEC_DVENCDSP_H */
@@ -212,6 +212,11 @@ int ff_j2k_init_component(J2kComponent *comp, J2kCodingStyle *codsty, J2kQuantSt
     comp->data = av_malloc(csize * sizeof(int));
     if (!comp->data)
         return AVERROR(ENOMEM);
+    if (codsty->transform == FF_DWT97){
+        comp->f_data = av_malloc(csize * sizeof(float));
+        if (!comp->f_data)
+            return AVERROR(ENOMEM);
+    }
     comp->reslevel = av_malloc(codsty->nreslevels * sizeof(J2kResLevel));
 
     if (!comp->reslevel)
@@ -258,8 +263,11 @@ int ff_j2k_init_component(J2kComponent *comp, J2kCodingStyle *codsty, J2kQuantSt
 
                 numbps = cbps + lut_gain[codsty->transform][bandno + reslevelno>0];
                 band->stepsize = SHL(2048 + qntsty->mant[gbandno], 2 + numbps - qntsty->expn[gbandno]);
-            } else
+                band->f_stepsize = ldexp(1 + qntsty->mant[gbandno] / 2048.0, numbps - qntsty->expn[gbandno]);
+            } else{
                 band->stepsize = 1 << 13;
+                band->f_stepsize = 1;
+            }
 
             if (reslevelno == 0){  // the same everywhere
                 band->codeblock_width = 1 << FFMIN(codsty->log2_cblk_width, codsty->log2_prec_width-1);
@@ -389,4 +397,5 @@ void ff_j2k_cleanup(J2kComponent *comp, J2kCodingStyle *codsty)
     ff_j2k_dwt_destroy(&comp->dwt);
     av_freep(&comp->reslevel);
     av_freep(&comp->data);
+    av_freep(&comp->f_data);
 }
@@ -160,6 +160,7 @@ typedef struct {
     uint16_t codeblock_width, codeblock_height;
     uint16_t cblknx, cblkny;
     uint32_t stepsize; ///< quantization stepsize (* 2^13)
+    float f_stepsize;  ///< quantization stepsize of irreversible transforms
     J2kPrec *prec;
     J2kCblk *cblk;
 } J2kBand; ///< subband
@@ -176,6 +177,7 @@ typedef struct {
    J2kResLevel *reslevel;
    DWTContext dwt;
    int *data;
+   float *f_data; ///< coefficients of the irreversible transform
    uint16_t coord[2][2]; ///< border coordinates {{x0, x1}, {y0, y1}}
 } J2kComponent;
 
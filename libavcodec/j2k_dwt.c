@@ -25,6 +25,7 @@
  * @author Kamil Nowosad
  */
 
+#include "libavutil/cpu.h"
 #include "j2k_dwt.h"
 
 const static float scale97[] = {1.625786, 1.230174};
@@ -184,136 +185,150 @@ static void dwt_encode97(DWTContext *s, int *t)
     }
 }
 
-static void sr_1d53(int *p, int i0, int i1)
-{
-    int i;
+#define STRIP FF_DWT_STRIP
 
-    if (i1 == i0 + 1)
-        return;
+/* lifting coefficients and scaling of the 9/7 reconstruction */
+#define F_LFTG_ALPHA  1.586134342f
+#define F_LFTG_BETA   0.052980118f
+#define F_LFTG_GAMMA  0.882911075f
+#define F_LFTG_DELTA  0.443506852f
+#define F_LFTG_K      1.230174105f
+#define F_LFTG_X      (2 / F_LFTG_K)
 
-    extend53(p, i0, i1);
+static void sr53_even_c(int *p, int n)
+{
+    int i, k;
 
-    for (i = i0/2; i < i1/2 + 1; i++)
-        p[2*i] -= (p[2*i-1] + p[2*i+1] + 2) >> 2;
-    for (i = i0/2; i < i1/2; i++)
-        p[2*i+1] += (p[2*i] + p[2*i+2]) >> 1;
+    for (i = 0; i < n; i++, p += 2 * STRIP)
+        for (k = 0; k < STRIP; k++)
+            p[k] -= (p[k - STRIP] + p[k + STRIP] + 2) >> 2;
 }
 
-static void dwt_decode53(DWTContext *s, int *t)
+static void sr53_odd_c(int *p, int n)
 {
-    int lev,
-        w = s->linelen[s->ndeclevels-1][0];
-    int *line = s->linebuf;
-    line += 3;
+    int i, k;
 
-    for (lev = 0; lev < s->ndeclevels; lev++){
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        int *l;
-
-        // HOR_SD
-        l = line + mh;
-        for (lp = 0; lp < lv; lp++){
-            int i, j = 0;
-            // copy with interleaving
-            for (i =   mh; i < lh; i+=2, j++)
-                l[i] = t[w*lp + j];
-            for (i = 1-mh; i < lh; i+=2, j++)
-                l[i] = t[w*lp + j];
+    for (i = 0; i < n; i++, p += 2 * STRIP)
+        for (k = 0; k < STRIP; k++)
+            p[k] += (p[k - STRIP] + p[k + STRIP]) >> 1;
+}
 
-            sr_1d53(line, mh, mh + lh);
+static void lift97_c(float *p, int n, float c)
+{
+    int i, k;
 
-            for (i = 0; i < lh; i++)
-                t[w*lp + i] = l[i];
-        }
+    for (i = 0; i < n; i++, p += 2 * STRIP)
+        for (k = 0; k < STRIP; k++)
+            p[k] += c * (p[k - STRIP] + p[k + STRIP]);
+}
 
-        // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++){
-            int i, j = 0;
-            // copy with interleaving
-            for (i =   mv; i < lv; i+=2, j++)
-                l[i] = t[w*j + lp];
-            for (i = 1-mv; i < lv; i+=2, j++)
-                l[i] = t[w*j + lp];
+static void sr_strip53(DWTContext *s, int *p, int i0, int i1)
+{
+    if (i1 == i0 + 1){
+        int k;
+        if (i0 & 1)
+            for (k = 0; k < STRIP; k++)
+                p[STRIP * i0 + k] >>= 1;
+        return;
+    }
 
-            sr_1d53(line, mv, mv + lv);
+    memcpy(p + STRIP * (i0 - 1), p + STRIP * (i0 + 1), STRIP * sizeof(*p));
+    memcpy(p + STRIP *  i1,      p + STRIP * (i1 - 2), STRIP * sizeof(*p));
+    memcpy(p + STRIP * (i0 - 2), p + STRIP * (i0 + 2), STRIP * sizeof(*p));
+    memcpy(p + STRIP * (i1 + 1), p + STRIP * (i1 - 3), STRIP * sizeof(*p));
 
-            for (i = 0; i < lv; i++)
-                t[w*i + lp] = l[i];
-        }
-    }
+    s->sr53_even(p + STRIP * (i0/2*2),     i1/2 + 1 - i0/2);
+    s->sr53_odd (p + STRIP * (i0/2*2 + 1), i1/2     - i0/2);
 }
 
-static void sr_1d97(float *p, int i0, int i1)
+static void sr_strip97(DWTContext *s, float *p, int i0, int i1)
 {
     int i;
 
     if (i1 == i0 + 1)
         return;
 
-    extend97(p, i0, i1);
+    for (i = 1; i <= 4; i++){
+        memcpy(p + STRIP * (i0 - i),     p + STRIP * (i0 + i),     STRIP * sizeof(*p));
+        memcpy(p + STRIP * (i1 + i - 1), p + STRIP * (i1 - i - 1), STRIP * sizeof(*p));
+    }
 
-    for (i = i0/2 - 1; i < i1/2 + 2; i++)
-        p[2*i] -= 0.443506 * (p[2*i-1] + p[2*i+1]);
-    for (i = i0/2 - 1; i < i1/2 + 1; i++)
-        p[2*i+1] -= 0.882911 * (p[2*i] + p[2*i+2]);
-    for (i = i0/2; i < i1/2 + 1; i++)
-        p[2*i] += 0.052980 * (p[2*i-1] + p[2*i+1]);
-    for (i = i0/2; i < i1/2; i++)
-        p[2*i+1] += 1.586134 * (p[2*i] + p[2*i+2]);
+    s->lift97(p + STRIP * (i0/2*2 - 2), i1/2 - i0/2 + 3, -F_LFTG_DELTA);
+    s->lift97(p + STRIP * (i0/2*2 - 1), i1/2 - i0/2 + 2, -F_LFTG_GAMMA);
+    s->lift97(p + STRIP * (i0/2*2),     i1/2 - i0/2 + 1,  F_LFTG_BETA);
+    s->lift97(p + STRIP * (i0/2*2 + 1), i1/2 - i0/2,      F_LFTG_ALPHA);
 }
 
-static void dwt_decode97(DWTContext *s, int *t)
-{
-    int lev,
-        w = s->linelen[s->ndeclevels-1][0];
-    float *line = s->linebuf;
-    line += 5;
-
-    for (lev = 0; lev < s->ndeclevels; lev++){
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        float *l;
-
-        // HOR_SD
-        l = line + mh;
-        for (lp = 0; lp < lv; lp++){
-            int i, j = 0;
-            // copy with interleaving
-            for (i =   mh; i < lh; i+=2, j++)
-                l[i] = scale97[1-mh] * t[w*lp + j];
-            for (i = 1-mh; i < lh; i+=2, j++)
-                l[i] = scale97[1-mh] * t[w*lp + j];
-
-            sr_1d97(line, mh, mh + lh);
+/**
+ * Reconstruct n <= STRIP lines of len samples, sample i of line k is at
+ * t[k * lstride + i * sstride].
+ */
+#define SR_LINES(type, strip_fn, scale_lo, scale_hi)                    \
+static void sr_lines_ ## type(DWTContext *s, type *line, type *t, int len, int mod, \
+                              int n, int lstride, int sstride)          \
+{                                                                       \
+    type *l = line + STRIP * mod;                                       \
+    int i, j, k;                                                        \
+                                                                        \
+    /* copy with interleaving */                                        \
+    for (k = 0; k < n; k++){                                            \
+        type *src = t + k * lstride;                                    \
+        for (i = mod, j = 0; i < len; i += 2, j++)                      \
+            l[STRIP * i + k] = src[j * sstride] * scale_lo;             \
+        for (i = 1 - mod; i < len; i += 2, j++)                         \
+            l[STRIP * i + k] = src[j * sstride] * scale_hi;             \
+    }                                                                   \
+                                                                        \
+    strip_fn(s, line, mod, mod + len);                                  \
+                                                                        \
+    for (k = 0; k < n; k++){                                            \
+        type *dst = t + k * lstride;                                    \
+        for (i = 0; i < len; i++)                                       \
+            dst[i * sstride] = l[STRIP * i + k];                        \
+    }                                                                   \
+}
 
-            for (i = 0; i < lh; i++)
-                t[w*lp + i] = l[i];
-        }
+SR_LINES(int,   sr_strip53, 1, 1)
+SR_LINES(float, sr_strip97, (len > 1 ? F_LFTG_K : 1), (len > 1 ? F_LFTG_X : 1))
+
+#define DWT_DECODE(type, offset)                                        \
+static void dwt_decode_ ## type(DWTContext *s, type *t)                 \
+{                                                                       \
+    int lev,                                                            \
+        w = s->linelen[s->ndeclevels-1][0];                             \
+    type *line = s->linebuf;                                            \
+    line += offset * STRIP;                                             \
+                                                                        \
+    for (lev = 0; lev < s->ndeclevels; lev++){                          \
+        int lh = s->linelen[lev][0],                                    \
+            lv = s->linelen[lev][1],                                    \
+            mh = s->mod[lev][0],                                        \
+            mv = s->mod[lev][1],                                        \
+            lp;                                                         \
+                                                                        \
+        /* HOR_SD */                                                    \
+        for (lp = 0; lp < lv; lp += STRIP)                              \
+            sr_lines_ ## type(s, line, t + w*lp, lh, mh,                \
+                              FFMIN(STRIP, lv - lp), w, 1);             \
+                                                                        \
+        /* VER_SD */                                                    \
+        for (lp = 0; lp < lh; lp += STRIP)                              \
+            sr_lines_ ## type(s, line, t + lp, lv, mv,                  \
+                              FFMIN(STRIP, lh - lp), 1, w);             \
+    }                                                                   \
+}
 
-        // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++){
-            int i, j = 0;
-            // copy with interleaving
-            for (i =   mv; i < lv; i+=2, j++)
-                l[i] = scale97[1-mv] * t[w*j + lp];
-            for (i = 1-mv; i < lv; i+=2, j++)
-                l[i] = scale97[1-mv] * t[w*j + lp];
+DWT_DECODE(int,   3)
+DWT_DECODE(float, 5)
 
-            sr_1d97(line, mv, mv + lv);
+void ff_j2k_dwt_init_lifting(DWTContext *s, int cpu_flags)
+{
+    s->sr53_even = sr53_even_c;
+    s->sr53_odd  = sr53_odd_c;
+    s->lift97    = lift97_c;
 
-            for (i = 0; i < lv; i++)
-                t[w*i + lp] = l[i];
-        }
-    }
+    if (HAVE_MMX)
+        ff_j2k_dwt_init_lifting_x86(s, cpu_flags);
 }
 
 int ff_j2k_dwt_init(DWTContext *s, uint16_t border[2][2], int decomp_levels, int type)
@@ -340,15 +355,17 @@ int ff_j2k_dwt_init(DWTContext *s, uint16_t border[2][2], int decomp_levels, int
         }
     }
     if (type == FF_DWT97)
-        s->linebuf = av_malloc((maxlen + 12) * sizeof(float));
+        s->linebuf = av_mallocz((maxlen + 12) * STRIP * sizeof(float));
     else if (type == FF_DWT53)
-        s->linebuf = av_malloc((maxlen + 6) * sizeof(int));
+        s->linebuf = av_mallocz((maxlen + 6) * STRIP * sizeof(int));
     else
         return -1;
 
     if (!s->linebuf)
         return AVERROR(ENOMEM);
 
+    ff_j2k_dwt_init_lifting(s, av_get_cpu_flags());
+
     return 0;
 }
 
@@ -365,13 +382,13 @@ int ff_j2k_dwt_encode(DWTContext *s, int *t)
     return 0;
 }
 
-int ff_j2k_dwt_decode(DWTContext *s, int *t)
+int ff_j2k_dwt_decode(DWTContext *s, void *t)
 {
     switch(s->type){
         case FF_DWT97:
-            dwt_decode97(s, t); break;
+            dwt_decode_float(s, t); break;
         case FF_DWT53:
-            dwt_decode53(s, t); break;
+            dwt_decode_int(s, t); break;
         default:
             return -1;
     }
@@ -31,6 +31,7 @@
 #include "avcodec.h"
 
 #define FF_DWT_MAX_DECLVLS 32 ///< max number of decomposition levels
+#define FF_DWT_STRIP        8 ///< number of lines reconstructed together
 
 enum DWTType{
     FF_DWT97,
@@ -44,6 +45,15 @@ typedef struct {
     uint8_t  ndeclevels;                 ///< number of decomposition levels
     uint8_t  type;                       ///< 0 for 9/7; 1 for 5/3
     void     *linebuf;                   ///< buffer used by transform (int or float)
+
+    /**
+     * Lifting steps of the inverse transforms, on FF_DWT_STRIP lines at a
+     * time: p[x] is a group of FF_DWT_STRIP samples, p points to the first
+     * group to update and n groups 2 apart are updated.
+     */
+    void (*sr53_even)(int *p, int n);        ///< p[x] -= (p[x-1] + p[x+1] + 2) >> 2
+    void (*sr53_odd)(int *p, int n);         ///< p[x] += (p[x-1] + p[x+1]) >> 1
+    void (*lift97)(float *p, int n, float c); ///< p[x] += c * (p[x-1] + p[x+1])
 } DWTContext;
 
 /**
@@ -56,7 +66,15 @@ typedef struct {
 int ff_j2k_dwt_init(DWTContext *s, uint16_t border[2][2], int decomp_levels, int type);
 
 int ff_j2k_dwt_encode(DWTContext *s, int *t);
-int ff_j2k_dwt_decode(DWTContext *s, int *t);
+
+/**
+ * inverse DWT
+ * @param t coefficients, int for DWT 5/3, float for DWT 9/7
+ */
+int ff_j2k_dwt_decode(DWTContext *s, void *t);
+
+void ff_j2k_dwt_init_lifting(DWTContext *s, int cpu_flags);
+void ff_j2k_dwt_init_lifting_x86(DWTContext *s, int cpu_flags);
 
 void ff_j2k_dwt_destroy(DWTContext *s);
 
@@ -27,6 +27,7 @@
 
 #include "avcodec.h"
 #include "bytestream.h"
+#include "thread.h"
 #include "j2k.h"
 #include "libavutil/common.h"
 
@@ -44,9 +45,21 @@ typedef struct {
    J2kQuantStyle  qntsty[4];
 } J2kTile;
 
+/** codeblock to decode, and its position in the component */
+typedef struct {
+    J2kTile *tile;
+    int compno;
+    J2kBand *band;
+    J2kCblk *cblk;
+    int bandpos;
+    int x0, x1, y0, y1;
+} J2kCblkJob;
+
 typedef struct {
     AVCodecContext *avctx;
     AVFrame picture;
+    int planar; ///< output is planar YUV
+    int depth;  ///< bits per sample of the output format
 
     int width, height; ///< image width and height
     int image_offset_x, image_offset_y;
@@ -72,6 +85,12 @@ typedef struct {
     int16_t curtileno;
 
     J2kTile *tile;
+
+    J2kCblkJob *jobs;
+    unsigned int jobs_size;
+    int nb_jobs;
+    J2kT1Context *t1; ///< one per slice thread
+    int nb_t1;
 } J2kDecoderContext;
 
 static int get_bits(J2kDecoderContext *s, int n)
@@ -203,7 +222,7 @@ static int tag_tree_decode(J2kDecoderContext *s, J2kTgtNode *node, int threshold
 /** get sizes and offsets of image, tiles; number of components */
 static int get_siz(J2kDecoderContext *s)
 {
-    int i, ret;
+    int i, ret, subsampled = 0;
 
     if (s->buf_end - s->buf < 36)
         return AVERROR(EINVAL);
@@ -250,23 +269,61 @@ static int get_siz(J2kDecoderContext *s)
     s->avctx->width = s->width - s->image_offset_x;
     s->avctx->height = s->height - s->image_offset_y;
 
+    for (i = 0; i < s->ncomponents; i++){
+        if (s->cbps[i] > 16 || !s->cdx[i] || !s->cdy[i]){
+            av_log(s->avctx, AV_LOG_ERROR, "unsupported component %d: %d bits, %dx%d subsampling\n",
+                   i, s->cbps[i], s->cdx[i], s->cdy[i]);
+            return AVERROR_PATCHWELCOME;
+        }
+        if (s->cdx[i] != 1 || s->cdy[i] != 1)
+            subsampled = 1;
+    }
+    s->planar = s->ncomponents == 3 && s->cdx[0] == 1 && s->cdy[0] == 1 &&
+                s->cdx[1] == 2 && s->cdx[2] == 2 && s->cdy[1] == s->cdy[2] && s->cdy[1] <= 2;
+    if (subsampled && !s->planar){
+        av_log(s->avctx, AV_LOG_ERROR, "unsupported subsampling\n");
+        return AVERROR_PATCHWELCOME;
+    }
+
+    s->depth = s->precision > 8 ? 16 : 8;
     switch(s->ncomponents){
         case 1: if (s->precision > 8) {
                     s->avctx->pix_fmt    = PIX_FMT_GRAY16;
                 } else s->avctx->pix_fmt = PIX_FMT_GRAY8;
                 break;
-        case 3: if (s->precision > 8) {
+        case 3: if (s->planar && s->cdy[1] == 2) {
+                    if (s->precision > 10) {
+                        s->avctx->pix_fmt = PIX_FMT_YUV420P16;
+                    } else if (s->precision > 8) {
+                        s->avctx->pix_fmt = PIX_FMT_YUV420P10;
+                        s->depth = 10;
+                    } else s->avctx->pix_fmt = PIX_FMT_YUV420P;
+                } else if (s->planar) {
+                    if (s->precision > 10) {
+                        s->avctx->pix_fmt = PIX_FMT_YUV422P16;
+                    } else if (s->precision > 8) {
+                        s->avctx->pix_fmt = PIX_FMT_YUV422P10;
+                        s->depth = 10;
+                    } else s->avctx->pix_fmt = PIX_FMT_YUV422P;
+                } else if (s->precision > 8) {
                     s->avctx->pix_fmt    = PIX_FMT_RGB48;
                 } else s->avctx->pix_fmt = PIX_FMT_RGB24;
                 break;
-        case 4: s->avctx->pix_fmt = PIX_FMT_BGRA; break;
+        case 4: s->avctx->pix_fmt = PIX_FMT_BGRA;
+                s->depth = 8;
+                break;
+        default:
+            av_log(s->avctx, AV_LOG_ERROR, "unsupported number of components %d\n", s->ncomponents);
+            return AVERROR_PATCHWELCOME;
     }
+    s->avctx->bits_per_raw_sample = s->precision;
 
     if (s->picture.data[0])
-        s->avctx->release_buffer(s->avctx, &s->picture);
+        ff_thread_release_buffer(s->avctx, &s->picture);
 
-    if ((ret = s->avctx->get_buffer(s->avctx, &s->picture)) < 0)
+    if ((ret = ff_thread_get_buffer(s->avctx, &s->picture)) < 0)
         return ret;
+    ff_thread_finish_setup(s->avctx);
 
     s->picture.pict_type = FF_I_TYPE;
     s->picture.key_frame = 1;
@@ -318,6 +375,11 @@ static int get_cod(J2kDecoderContext *s, J2kCodingStyle *c, uint8_t *properties)
     tmp.nlayers = bytestream_get_be16(&s->buf);
         tmp.mct = bytestream_get_byte(&s->buf); // multiple component transformation
 
+    if (tmp.mct && (s->ncomponents < 3 || s->planar)){
+        av_log(s->avctx, AV_LOG_ERROR, "MCT needs three equally sized components\n");
+        return AVERROR_INVALIDDATA;
+    }
+
     get_cox(s, &tmp);
     for (compno = 0; compno < s->ncomponents; compno++){
         if (!(properties[compno] & HAD_COC))
@@ -451,12 +513,16 @@ static int init_tile(J2kDecoderContext *s, int tileno)
         J2kQuantStyle  *qntsty = tile->qntsty + compno;
         int ret; // global bandno
 
-        comp->coord[0][0] = FFMAX(tilex * s->tile_width + s->tile_offset_x, s->image_offset_x);
-        comp->coord[0][1] = FFMIN((tilex+1)*s->tile_width + s->tile_offset_x, s->width);
-        comp->coord[1][0] = FFMAX(tiley * s->tile_height + s->tile_offset_y, s->image_offset_y);
-        comp->coord[1][1] = FFMIN((tiley+1)*s->tile_height + s->tile_offset_y, s->height);
+        comp->coord[0][0] = ff_j2k_ceildiv(FFMAX(tilex * s->tile_width + s->tile_offset_x, s->image_offset_x),
+                                           s->cdx[compno]);
+        comp->coord[0][1] = ff_j2k_ceildiv(FFMIN((tilex+1)*s->tile_width + s->tile_offset_x, s->width),
+                                           s->cdx[compno]);
+        comp->coord[1][0] = ff_j2k_ceildiv(FFMAX(tiley * s->tile_height + s->tile_offset_y, s->image_offset_y),
+                                           s->cdy[compno]);
+        comp->coord[1][1] = ff_j2k_ceildiv(FFMIN((tiley+1)*s->tile_height + s->tile_offset_y, s->height),
+                                           s->cdy[compno]);
 
-        if (ret = ff_j2k_init_component(comp, codsty, qntsty, s->cbps[compno], s->cdx[compno], s->cdy[compno]))
+        if (ret = ff_j2k_init_component(comp, codsty, qntsty, s->cbps[compno], 1, 1))
             return ret;
     }
     return 0;
@@ -731,26 +797,49 @@ static int decode_cblk(J2kDecoderContext *s, J2kCodingStyle *codsty, J2kT1Contex
     return 0;
 }
 
-static void mct_decode(J2kDecoderContext *s, J2kTile *tile)
+/** check that the first three components can go through the inverse MCT */
+static int mct_possible(J2kDecoderContext *s, J2kTile *tile)
 {
-    int i, *src[3], i0, i1, i2, csize = 1;
+    int compno, i;
+
+    if (s->ncomponents < 3)
+        return 0;
+    for (compno = 1; compno < 3; compno++){
+        if (tile->codsty[compno].transform != tile->codsty[0].transform)
+            return 0;
+        for (i = 0; i < 2; i++)
+            if (tile->comp[compno].coord[i][1] - tile->comp[compno].coord[i][0] !=
+                tile->comp[0].coord[i][1]      - tile->comp[0].coord[i][0])
+                return 0;
+    }
+    return 1;
+}
 
-    for (i = 0; i < 3; i++)
-        src[i] = tile->comp[i].data;
+static void mct_decode(J2kDecoderContext *s, J2kTile *tile)
+{
+    int i, i0, i1, i2, csize = 1;
 
     for (i = 0; i < 2; i++)
         csize *= tile->comp[0].coord[i][1] - tile->comp[0].coord[i][0];
 
     if (tile->codsty[0].transform == FF_DWT97){
+        float *src[3];
+
+        for (i = 0; i < 3; i++)
+            src[i] = tile->comp[i].f_data;
+
         for (i = 0; i < csize; i++){
-            i0 = *src[0] + (*src[2] * 46802 >> 16);
-            i1 = *src[0] - (*src[1] * 22553 + *src[2] * 46802 >> 16);
-            i2 = *src[0] + (116130 * *src[1] >> 16);
-            *src[0]++ = i0;
-            *src[1]++ = i1;
-            *src[2]++ = i2;
+            float y = src[0][i], cb = src[1][i], cr = src[2][i];
+            src[0][i] = y + 1.402f * cr;
+            src[1][i] = y - 0.34413f * cb - 0.71414f * cr;
+            src[2][i] = y + 1.772f * cb;
         }
     } else{
+        int *src[3];
+
+        for (i = 0; i < 3; i++)
+            src[i] = tile->comp[i].data;
+
         for (i = 0; i < csize; i++){
             i1 = *src[0] - (*src[2] + *src[1] >> 2);
             i0 = i1 + *src[2];
@@ -762,12 +851,10 @@ static void mct_decode(J2kDecoderContext *s, J2kTile *tile)
     }
 }
 
-static int decode_tile(J2kDecoderContext *s, J2kTile *tile)
+/** queue the codeblocks of a tile for decode_cblk_job() */
+static int add_cblk_jobs(J2kDecoderContext *s, J2kTile *tile)
 {
     int compno, reslevelno, bandno;
-    int x, y, *src[4];
-    uint8_t *line;
-    J2kT1Context t1;
 
     for (compno = 0; compno < s->ncomponents; compno++){
         J2kComponent *comp = tile->comp + compno;
@@ -799,25 +886,23 @@ static int decode_tile(J2kDecoderContext *s, J2kTile *tile)
                                 band->coord[0][1]) - band->coord[0][0] + xx0;
 
                     for (cblkx = 0; cblkx < band->cblknx; cblkx++, cblkno++){
-                        int y, x;
-                        decode_cblk(s, codsty, &t1, band->cblk + cblkno, xx1 - xx0, yy1 - yy0, bandpos);
-                        if (codsty->transform == FF_DWT53){
-                            for (y = yy0; y < yy1; y+=s->cdy[compno]){
-                                int *ptr = t1.data[y-yy0];
-                                for (x = xx0; x < xx1; x+=s->cdx[compno]){
-                                    comp->data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] = *ptr++ >> 1;
-                                }
-                            }
-                        } else{
-                            for (y = yy0; y < yy1; y+=s->cdy[compno]){
-                                int *ptr = t1.data[y-yy0];
-                                for (x = xx0; x < xx1; x+=s->cdx[compno]){
-                                    int tmp = ((int64_t)*ptr++) * ((int64_t)band->stepsize) >> 13, tmp2;
-                                    tmp2 = FFABS(tmp>>1) + FFABS(tmp&1);
-                                    comp->data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] = tmp < 0 ? -tmp2 : tmp2;
-                                }
-                            }
-                        }
+                        J2kCblkJob *job = av_fast_realloc(s->jobs, &s->jobs_size,
+                                                          (s->nb_jobs + 1) * sizeof(*s->jobs));
+                        if (!job)
+                            return AVERROR(ENOMEM);
+                        s->jobs = job;
+                        job += s->nb_jobs++;
+
+                        job->tile    = tile;
+                        job->compno  = compno;
+                        job->band    = band;
+                        job->cblk    = band->cblk + cblkno;
+                        job->bandpos = bandpos;
+                        job->x0 = xx0;
+                        job->x1 = xx1;
+                        job->y0 = yy0;
+                        job->y1 = yy1;
+
                         xx0 = xx1;
                         xx1 = FFMIN(xx1 + band->codeblock_width, band->coord[0][1] - band->coord[0][0] + x0);
                     }
@@ -826,55 +911,124 @@ static int decode_tile(J2kDecoderContext *s, J2kTile *tile)
                 }
             }
         }
+    }
+    return 0;
+}
+
+/** decode a codeblock and dequantize it into the component */
+static int decode_cblk_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    J2kDecoderContext *s = avctx->priv_data;
+    J2kCblkJob *job = s->jobs + jobnr;
+    J2kComponent *comp = job->tile->comp + job->compno;
+    J2kCodingStyle *codsty = job->tile->codsty + job->compno;
+    J2kT1Context *t1 = s->t1 + threadnr;
+    int w = comp->coord[0][1] - comp->coord[0][0];
+    int x, y;
+
+    decode_cblk(s, codsty, t1, job->cblk, job->x1 - job->x0, job->y1 - job->y0, job->bandpos);
+
+    if (codsty->transform == FF_DWT97){
+        float scale = job->band->f_stepsize * 0.5f;
+        for (y = job->y0; y < job->y1; y++){
+            int *src = t1->data[y - job->y0];
+            float *dst = comp->f_data + w * y;
+            for (x = job->x0; x < job->x1; x++)
+                dst[x] = *src++ * scale;
+        }
+    } else{
+        for (y = job->y0; y < job->y1; y++){
+            int *src = t1->data[y - job->y0];
+            int *dst = comp->data + w * y;
+            for (x = job->x0; x < job->x1; x++)
+                dst[x] = *src++ / 2;
+        }
+    }
+    return 0;
+}
+
+static int dwt_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    J2kDecoderContext *s = avctx->priv_data;
+    J2kTile *tile = s->tile + jobnr / s->ncomponents;
+    J2kComponent *comp = tile->comp + jobnr % s->ncomponents;
+
+    if (!comp->data)
+        return 0;
+    if (tile->codsty[jobnr % s->ncomponents].transform == FF_DWT97)
+        ff_j2k_dwt_decode(&comp->dwt, comp->f_data);
+    else
         ff_j2k_dwt_decode(&comp->dwt, comp->data);
+    return 0;
+}
+
+/** inverse component transform and level shift, then store in the picture */
+static int output_tile_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    J2kDecoderContext *s = avctx->priv_data;
+    J2kTile *tile = s->tile + jobnr;
+    int compno, i, x, y, *src[4];
+    uint8_t *line;
+
+    if (!tile->comp[0].data)
+        return 0;
+
+    if (tile->codsty[0].mct){
+        if (!mct_possible(s, tile)){
+            av_log(avctx, AV_LOG_ERROR, "MCT on mismatched components\n");
+            return AVERROR_INVALIDDATA;
+        }
+        mct_decode(s, tile);
+    }
+
+    for (compno = 0; compno < s->ncomponents; compno++){
+        J2kComponent *comp = tile->comp + compno;
+        if (tile->codsty[compno].transform == FF_DWT97){
+            int csize = (comp->coord[0][1] - comp->coord[0][0]) *
+                        (comp->coord[1][1] - comp->coord[1][0]);
+            for (i = 0; i < csize; i++)
+                comp->data[i] = lrintf(comp->f_data[i]);
+        }
         src[compno] = comp->data;
     }
-    if (tile->codsty[0].mct)
-        mct_decode(s, tile);
 
     if (s->avctx->pix_fmt == PIX_FMT_BGRA) // RGBA -> BGRA
         FFSWAP(int *, src[0], src[2]);
 
-    if (s->precision <= 8) {
-        for (compno = 0; compno < s->ncomponents; compno++){
-            y = tile->comp[compno].coord[1][0] - s->image_offset_y;
-            line = s->picture.data[0] + y * s->picture.linesize[0];
-            for (; y < tile->comp[compno].coord[1][1] - s->image_offset_y; y += s->cdy[compno]){
-                uint8_t *dst;
-
-                x = tile->comp[compno].coord[0][0] - s->image_offset_x;
-                dst = line + x * s->ncomponents + compno;
-
-                for (; x < tile->comp[compno].coord[0][1] - s->image_offset_x; x += s->cdx[compno]) {
+    for (compno = 0; compno < s->ncomponents; compno++){
+        J2kComponent *comp = tile->comp + compno;
+        int plane = s->planar ? compno : 0;
+        int step  = s->planar ? 1 : s->ncomponents;
+        int xoff  = ff_j2k_ceildiv(s->image_offset_x, s->cdx[compno]);
+        int yoff  = ff_j2k_ceildiv(s->image_offset_y, s->cdy[compno]);
+
+        y = comp->coord[1][0] - yoff;
+        line = s->picture.data[plane] + y * s->picture.linesize[plane];
+        for (; y < comp->coord[1][1] - yoff; y++){
+            x = comp->coord[0][0] - xoff;
+            if (s->depth == 8){
+                uint8_t *dst = line + x * step + (s->planar ? 0 : compno);
+                for (; x < comp->coord[0][1] - xoff; x++){
                     *src[compno] += 1 << (s->cbps[compno]-1);
                     if (*src[compno] < 0)
                         *src[compno] = 0;
                     else if (*src[compno] >= (1 << s->cbps[compno]))
                         *src[compno] = (1 << s->cbps[compno]) - 1;
                     *dst = *src[compno]++;
-                    dst += s->ncomponents;
+                    dst += step;
                 }
-                line += s->picture.linesize[0];
-            }
-        }
-    } else {
-        for (compno = 0; compno < s->ncomponents; compno++) {
-            y = tile->comp[compno].coord[1][0] - s->image_offset_y;
-            line = s->picture.data[0] + y * s->picture.linesize[0];
-            for (; y < tile->comp[compno].coord[1][1] - s->image_offset_y; y += s->cdy[compno]) {
-                uint16_t *dst;
-                x = tile->comp[compno].coord[0][0] - s->image_offset_x;
-                dst = line + (x * s->ncomponents + compno) * 2;
-                for (; x < tile->comp[compno].coord[0][1] - s->image_offset_x; x += s-> cdx[compno]) {
+            } else{
+                uint16_t *dst = (uint16_t *)line + x * step + (s->planar ? 0 : compno);
+                for (; x < comp->coord[0][1] - xoff; x++){
                     int32_t val;
-                    val = *src[compno]++ << (16 - s->cbps[compno]);
-                    val += 1 << 15;
-                    val = av_clip(val, 0, (1 << 16) - 1);
+                    val = *src[compno]++ << (s->depth - s->cbps[compno]);
+                    val += 1 << (s->depth - 1);
+                    val = av_clip(val, 0, (1 << s->depth) - 1);
                     *dst = val;
-                    dst += s->ncomponents;
+                    dst += step;
                 }
-                line += s->picture.linesize[0];
             }
+            line += s->picture.linesize[plane];
         }
     }
     return 0;
@@ -989,7 +1143,7 @@ static int decode_frame(AVCodecContext *avctx,
 {
     J2kDecoderContext *s = avctx->priv_data;
     AVFrame *picture = data;
-    int tileno, ret;
+    int tileno, ret, nb_t1;
 
     s->avctx = avctx;
     av_log(s->avctx, AV_LOG_DEBUG, "start\n");
@@ -999,8 +1153,6 @@ static int decode_frame(AVCodecContext *avctx,
     s->buf_end = s->buf_start + avpkt->size;
     s->curtileno = -1;
 
-    ff_j2k_init_tier1_luts();
-
     if (s->buf_end - s->buf < 2)
         return AVERROR(EINVAL);
 
@@ -1020,10 +1172,24 @@ static int decode_frame(AVCodecContext *avctx,
     if (ret = decode_codestream(s))
         return ret;
 
+    nb_t1 = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+    if (s->nb_t1 < nb_t1){
+        av_free(s->t1);
+        s->nb_t1 = 0;
+        if (!(s->t1 = av_malloc(nb_t1 * sizeof(*s->t1))))
+            return AVERROR(ENOMEM);
+        s->nb_t1 = nb_t1;
+    }
+
+    s->nb_jobs = 0;
     for (tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++)
-        if (ret = decode_tile(s, s->tile + tileno))
+        if (s->tile[tileno].comp[0].data && (ret = add_cblk_jobs(s, s->tile + tileno)) < 0)
             return ret;
 
+    avctx->execute2(avctx, decode_cblk_job, NULL, NULL, s->nb_jobs);
+    avctx->execute2(avctx, dwt_job, NULL, NULL, s->numXtiles * s->numYtiles * s->ncomponents);
+    avctx->execute2(avctx, output_tile_job, NULL, NULL, s->numXtiles * s->numYtiles);
+
     cleanup(s);
     av_log(s->avctx, AV_LOG_DEBUG, "end\n");
 
@@ -1039,6 +1205,8 @@ static av_cold int j2kdec_init(AVCodecContext *avctx)
 
     avcodec_get_frame_defaults((AVFrame*)&s->picture);
     avctx->coded_frame = (AVFrame*)&s->picture;
+
+    ff_j2k_init_tier1_luts();
     return 0;
 }
 
@@ -1047,7 +1215,9 @@ static av_cold int decode_end(AVCodecContext *avctx)
     J2kDecoderContext *s = avctx->priv_data;
 
     if (s->picture.data[0])
-        avctx->release_buffer(avctx, &s->picture);
+        ff_thread_release_buffer(avctx, &s->picture);
+    av_freep(&s->jobs);
+    av_freep(&s->t1);
 
     return 0;
 }
@@ -1061,7 +1231,9 @@ AVCodec ff_jpeg2000_decoder = {
     NULL,
     decode_end,
     decode_frame,
-    .capabilities = CODEC_CAP_EXPERIMENTAL,
+    .capabilities = CODEC_CAP_EXPERIMENTAL | CODEC_CAP_SLICE_THREADS | CODEC_CAP_FRAME_THREADS,
     .pix_fmts =
-        (enum PixelFormat[]) {PIX_FMT_GRAY8, PIX_FMT_RGB24, -1}
+        (enum PixelFormat[]) {PIX_FMT_GRAY8, PIX_FMT_GRAY16, PIX_FMT_RGB24, PIX_FMT_RGB48,
+                              PIX_FMT_BGRA, PIX_FMT_YUV420P, PIX_FMT_YUV420P10, PIX_FMT_YUV420P16,
+                              PIX_FMT_YUV422P, PIX_FMT_YUV422P10, PIX_FMT_YUV422P16, -1}
 };
@@ -73,6 +73,10 @@ typedef struct X264Context {
     char *aq_strength;
     char *rc_lookahead;
     char *threads;
+    char *sliced_threads;
+    char *lookahead_threads;
+    char *sync_lookahead;
+    int latency;
     int psy;
     char *psy_rd;
     char *me_range;
@@ -90,6 +94,12 @@ typedef struct X264Context {
     char *avcintra_class;
 } X264Context;
 
+enum {
+    LATENCY_NORMAL,
+    LATENCY_LOW,     ///< sliced threads, no lookahead buffering
+    LATENCY_ZERO,    ///< same as low, without B-frames and frame lookahead
+};
+
 static void X264_log(void *p, int level, const char *fmt, va_list args)
 {
     static const int level_map[] = {
@@ -128,6 +138,7 @@ static int X264_frame(AVCodecContext *ctx, uint8_t *buf,
     x264_nal_t *nal;
     int nnal, i;
     x264_picture_t pic_out;
+    int reconfig = 0;
 
     x264_picture_init(&x4->pic);
 
@@ -148,14 +159,19 @@ static int X264_frame(AVCodecContext *ctx, uint8_t *buf,
                                             X264_TYPE_AUTO;
         if (x4->params.b_interlaced && x4->params.b_tff != frame->top_field_first) {
             x4->params.b_tff = frame->top_field_first;
-            x264_encoder_reconfig(x4->enc, &x4->params);
+            reconfig = 1;
         }
-        if (x4->params.vui.i_sar_height != ctx->sample_aspect_ratio.den
-         || x4->params.vui.i_sar_width != ctx->sample_aspect_ratio.num) {
+        /* 32:18 is the same aspect as 16:9, only a different value is
+           worth flushing the encoder state for */
+        if (av_cmp_q((AVRational){ x4->params.vui.i_sar_width,
+                                   x4->params.vui.i_sar_height },
+                     ctx->sample_aspect_ratio)) {
             x4->params.vui.i_sar_height = ctx->sample_aspect_ratio.den;
-            x4->params.vui.i_sar_width = ctx->sample_aspect_ratio.num;
-            x264_encoder_reconfig(x4->enc, &x4->params);
+            x4->params.vui.i_sar_width  = ctx->sample_aspect_ratio.num;
+            reconfig = 1;
         }
+        if (reconfig && x264_encoder_reconfig(x4->enc, &x4->params) < 0)
+            av_log(ctx, AV_LOG_WARNING, "encoder reconfiguration failed\n");
     }
 
     do {
@@ -167,8 +183,8 @@ static int X264_frame(AVCodecContext *ctx, uint8_t *buf,
         return -1;
     } while (!bufsize && !frame && x264_encoder_delayed_frames(x4->enc));
 
-    /* FIXME: libx264 now provides DTS, but AVFrame doesn't have a field for it. */
-    x4->out_pic.pts = pic_out.i_pts;
+    x4->out_pic.pts     = pic_out.i_pts;
+    x4->out_pic.pkt_dts = pic_out.i_dts;
 
     switch (pic_out.i_type) {
     case X264_TYPE_IDR:
@@ -230,6 +246,19 @@ static av_cold int X264_init(AVCodecContext *avctx)
             return -1;
     }
 
+    switch (x4->latency) {
+    case LATENCY_ZERO:
+        x4->params.i_bframe       = 0;
+        x4->params.i_rc_lookahead = 0;
+        x4->params.rc.b_mb_tree   = 0;
+        x4->params.b_vfr_input    = 0;
+        /* fall through */
+    case LATENCY_LOW:
+        x4->params.b_sliced_threads = 1;
+        x4->params.i_sync_lookahead = 0;
+        break;
+    }
+
     x4->params.pf_log = X264_log;
     x4->params.p_log_private = avctx;
 
@@ -357,6 +386,9 @@ static av_cold int X264_init(AVCodecContext *avctx)
     x4->params.i_log_level    = X264_LOG_DEBUG;
 
     OPT_STR("threads", x4->threads);
+    OPT_STR("sliced-threads", x4->sliced_threads);
+    OPT_STR("lookahead-threads", x4->lookahead_threads);
+    OPT_STR("sync-lookahead", x4->sync_lookahead);
 
     x4->params.analyse.b_psnr = avctx->flags & CODEC_FLAG_PSNR;
     x4->params.analyse.b_ssim = avctx->flags2 & CODEC_FLAG2_SSIM;
@@ -482,6 +514,13 @@ static const AVOption options[] = {
     {"aq_strength", "Reduces blocking and blurring in flat and textured areas", OFFSET(aq_strength), FF_OPT_TYPE_STRING, {.dbl = 0}, 0, 0, VE},
     {"rc_lookahead", "Number of frames for frametype lookahead", OFFSET(rc_lookahead), FF_OPT_TYPE_STRING, {.dbl = 0}, 0, 0, VE},
     {"threads", "Force a specific number of threads", OFFSET(threads), FF_OPT_TYPE_STRING, {.dbl = 0}, 0, 0, VE},
+    {"sliced_threads", "Split each frame between the threads instead of encoding several frames at once, lower latency", OFFSET(sliced_threads), FF_OPT_TYPE_STRING, {.dbl = 0}, 0, 0, VE},
+    {"lookahead_threads", "Number of threads for the frametype lookahead", OFFSET(lookahead_threads), FF_OPT_TYPE_STRING, {.dbl = 0}, 0, 0, VE},
+    {"sync_lookahead", "Number of buffer frames for the threaded lookahead, 0: Disabled", OFFSET(sync_lookahead), FF_OPT_TYPE_STRING, {.dbl = 0}, 0, 0, VE},
+    {"latency", "Latency preset, applied after preset and tune", OFFSET(latency), FF_OPT_TYPE_INT, {.dbl = LATENCY_NORMAL}, LATENCY_NORMAL, LATENCY_ZERO, VE, "latency"},
+    {"normal", "Frame threads and lookahead as set by the preset", 0, FF_OPT_TYPE_CONST, {.dbl = LATENCY_NORMAL}, 0, 0, VE, "latency"},
+    {"low", "Sliced threads, no lookahead buffering", 0, FF_OPT_TYPE_CONST, {.dbl = LATENCY_LOW}, 0, 0, VE, "latency"},
+    {"zero", "Sliced threads, no B-frames, no lookahead", 0, FF_OPT_TYPE_CONST, {.dbl = LATENCY_ZERO}, 0, 0, VE, "latency"},
     {"psy", "Psychovisual Optimization: 0: Disabled", OFFSET(psy), FF_OPT_TYPE_INT, {.dbl = 1}, 0, 1, VE},
     {"psy_rd", "Strength of psychovisual optimization <rd:trellis>: RD (requires subme>=6), Trellis (requires trellis)", OFFSET(psy_rd), FF_OPT_TYPE_STRING, {.dbl = 0}, 0, 0, VE},
     {"me_range", "Maximum motion vector search range", OFFSET(me_range), FF_OPT_TYPE_STRING, {.dbl = 0}, 0, 0, VE},
@@ -511,7 +550,7 @@ AVCodec ff_libx264_encoder = {
     .init           = X264_init,
     .encode         = X264_frame,
     .close          = X264_close,
-    .capabilities   = CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DELAY | CODEC_CAP_DTS,
 #if X264_BIT_DEPTH == 10
     .pix_fmts       = (const enum PixelFormat[]) { PIX_FMT_YUV422P10, PIX_FMT_YUV420P10, PIX_FMT_NONE },
 #elif X264_BIT_DEPTH == 8
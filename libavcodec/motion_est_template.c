@@ -211,7 +211,7 @@ static int qpel_motion_search(MpegEncContext * s,
     const int my = *my_ptr;
     const int penalty_factor= c->sub_penalty_factor;
     const int map_generation= c->map_generation;
-    const int subpel_quality= c->avctx->me_subpel_quality;
+    const int subpel_quality= s->me_subpel_quality;
     uint32_t *map= c->map;
     me_cmp_func cmpf, chroma_cmpf;
     me_cmp_func cmp_sub, chroma_cmp_sub;
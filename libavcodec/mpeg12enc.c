@@ -991,6 +991,8 @@ static const AVOption options[] = {
       offsetof(MpegEncContext, timecode), FF_OPT_TYPE_STRING, {.str = 0}, 0, 0, AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_ENCODING_PARAM},
     { "pulldown", "Encode with pulldown: 3:2",
       offsetof(MpegEncContext, pulldown), FF_OPT_TYPE_STRING, {.str = 0}, 0, 0, AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_ENCODING_PARAM},
+    { "fastfirstpass", "Use fast settings when encoding first pass, only gather rate control statistics",
+      offsetof(MpegEncContext, fast_first_pass), FF_OPT_TYPE_INT, {.dbl = 0}, 0, 1, AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
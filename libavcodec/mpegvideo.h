@@ -220,7 +220,12 @@ typedef struct MpegEncContext {
     int encoding;     ///< true if we are encoding (vs decoding)
     int flags;        ///< AVCodecContext.flags (HQ, MV4, ...)
     int flags2;       ///< AVCodecContext.flags2
+    int mb_decision;  ///< AVCodecContext.mb_decision
+    int trellis;      ///< AVCodecContext.trellis
+    int quantizer_noise_shaping; ///< AVCodecContext.quantizer_noise_shaping
+    int me_subpel_quality;       ///< AVCodecContext.me_subpel_quality
     int max_b_frames; ///< max number of b-frames for encoding
+    int lookahead_scene_cut;   ///< place scene change I-frames from the b_frame_strategy 2 lookahead
     int luma_elim_threshold;
     int chroma_elim_threshold;
     int strict_std_compliance; ///< strictly follow the std (MPEG4, ...)
@@ -248,6 +253,8 @@ typedef struct MpegEncContext {
     Picture *picture;          ///< main picture buffer
     Picture **input_picture;   ///< next pictures on display order for encoding
     Picture **reordered_input_picture; ///< pointer to the next pictures in codedorder for encoding
+    struct BFrameCandidate *b_cand;    ///< b_frame_strategy 2 sub-encoders, one per B-frame count
+    uint8_t *b_cand_buf;               ///< downscaled pictures shared by the b_frame_strategy 2 sub-encoders
 
     int y_dc_scale, c_dc_scale;
     int ac_pred;
@@ -652,6 +659,7 @@ typedef struct MpegEncContext {
     int first_field;         ///< is 1 for the first field of a field picture 0 otherwise
 
     const char *pulldown;
+    int fast_first_pass;     ///< skip RD decisions in pass 1, only rate control statistics are needed
 
     /* RTP specific */
     int rtp_mode;
@@ -29,6 +29,7 @@
 
 #include "libavutil/intmath.h"
 #include "libavutil/mathematics.h"
+#include "libavutil/opt.h"
 #include "avcodec.h"
 #include "dsputil.h"
 #include "mpegvideo.h"
@@ -54,6 +55,8 @@ static int sse_mb(MpegEncContext *s);
 static void denoise_dct_c(MpegEncContext *s, DCTELEM *block);
 static int dct_quantize_trellis_c(MpegEncContext *s, DCTELEM *block, int n, int qscale, int *overflow);
 static int dct_quantize_c(MpegEncContext *s, DCTELEM *block, int n, int qscale, int *overflow);
+static int init_b_candidates(MpegEncContext *s);
+static void free_b_candidates(MpegEncContext *s);
 
 /* enable all paranoid tests for rounding, overflows, etc... */
 //#define PARANOID
@@ -304,6 +307,10 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
     s->avctx = avctx;
     s->flags= avctx->flags;
     s->flags2= avctx->flags2;
+    s->mb_decision= avctx->mb_decision;
+    s->trellis= avctx->trellis;
+    s->quantizer_noise_shaping= avctx->quantizer_noise_shaping;
+    s->me_subpel_quality= avctx->me_subpel_quality;
     s->max_b_frames= avctx->max_b_frames;
     s->codec_id= avctx->codec->id;
     s->luma_elim_threshold  = avctx->luma_elim_threshold;
@@ -323,6 +330,16 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
         s->intra_only = 0;
     }
 
+    if (s->fast_first_pass && (s->flags & CODEC_FLAG_PASS1)) {
+        /* the first pass output is discarded, only the complexity statistics
+           are used by init_pass2(), which do not depend much on RD decisions */
+        s->mb_decision = FF_MB_DECISION_SIMPLE;
+        s->trellis = 0;
+        s->quantizer_noise_shaping = 0;
+        s->me_subpel_quality = FFMIN(s->me_subpel_quality, 2);
+        s->flags &= ~(CODEC_FLAG_QP_RD | CODEC_FLAG_CBP_RD | CODEC_FLAG_MV0);
+    }
+
     s->me_method = avctx->me_method;
 
     /* Fixed QSCALE */
@@ -389,7 +406,7 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
         return -1;
     }
 
-    if(s->obmc && s->avctx->mb_decision != FF_MB_DECISION_SIMPLE){
+    if(s->obmc && s->mb_decision != FF_MB_DECISION_SIMPLE){
         av_log(avctx, AV_LOG_ERROR, "OBMC is only supported with simple mb decision\n");
         return -1;
     }
@@ -435,19 +452,22 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
         return -1;
     }
 
-    if((s->flags & CODEC_FLAG_CBP_RD) && !avctx->trellis){
+    if((s->flags & CODEC_FLAG_CBP_RD) && !s->trellis){
         av_log(avctx, AV_LOG_ERROR, "CBP RD needs trellis quant\n");
         return -1;
     }
 
-    if((s->flags & CODEC_FLAG_QP_RD) && s->avctx->mb_decision != FF_MB_DECISION_RD){
+    if((s->flags & CODEC_FLAG_QP_RD) && s->mb_decision != FF_MB_DECISION_RD){
         av_log(avctx, AV_LOG_ERROR, "QP RD needs mbd=2\n");
         return -1;
     }
 
     if(s->avctx->scenechange_threshold < 1000000000 && (s->flags & CODEC_FLAG_CLOSED_GOP)){
-        av_log(avctx, AV_LOG_ERROR, "closed gop with scene change detection are not supported yet, set threshold to 1000000000\n");
-        return -1;
+        if(s->avctx->b_frame_strategy != 2 || (s->flags & CODEC_FLAG_PASS2)){
+            av_log(avctx, AV_LOG_ERROR, "closed gop with scene change detection needs b_strategy 2, or set threshold to 1000000000\n");
+            return -1;
+        }
+        s->lookahead_scene_cut = 1;
     }
 
     if((s->flags2 & CODEC_FLAG2_INTRA_VLC) && s->codec_id != CODEC_ID_MPEG2VIDEO){
@@ -703,7 +723,7 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
     if(!s->denoise_dct)
         s->denoise_dct = denoise_dct_c;
     s->fast_dct_quantize = s->dct_quantize;
-    if(avctx->trellis)
+    if(s->trellis)
         s->dct_quantize = dct_quantize_trellis_c;
 
     if((CONFIG_H263P_ENCODER || CONFIG_RV20_ENCODER) && s->modified_quant)
@@ -760,6 +780,9 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
     if(ff_rate_control_init(s) < 0)
         return -1;
 
+    if(s->avctx->b_frame_strategy == 2 && init_b_candidates(s) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -768,6 +791,7 @@ av_cold int MPV_encode_end(AVCodecContext *avctx)
     MpegEncContext *s = avctx->priv_data;
 
     ff_rate_control_uninit(s);
+    free_b_candidates(s);
 
     MPV_common_end(s);
     if ((CONFIG_MJPEG_ENCODER || CONFIG_LJPEG_ENCODER) && s->out_format == FMT_MJPEG)
@@ -966,110 +990,275 @@ static int skip_check(MpegEncContext *s, Picture *p, Picture *ref){
     return 0;
 }
 
-static int estimate_best_b_count(MpegEncContext *s){
-    AVCodec *codec= avcodec_find_encoder(s->avctx->codec_id);
-    AVCodecContext *c = avcodec_alloc_context3(NULL);
+typedef struct BFrameCandidate {
+    AVCodecContext *c;
     AVFrame input[FF_MAX_B_FRAMES+2];
-    const int scale= s->avctx->brd_scale;
-    int i, j, out_size, p_lambda, b_lambda, lambda2;
-    int outbuf_size= s->width * s->height; //FIXME
-    uint8_t *outbuf= av_malloc(outbuf_size);
-    int64_t best_rd= INT64_MAX;
-    int best_b_count= -1;
-
-    assert(scale>=0 && scale <=3);
+    uint8_t *outbuf;
+    int outbuf_size;
+    int b_count;            ///< number of consecutive B-frames tried by this candidate
+    int nb_frames;          ///< number of lookahead pictures after the reference
+    int picture_base;       ///< pictures given to the sub-encoder before this window
+    int p_lambda, b_lambda, lambda2;
+    int64_t rd;
+    uint8_t scene_cut[FF_MAX_B_FRAMES+2]; ///< P-frames the sub-encoder turned into I-frames
+} BFrameCandidate;
 
-//    emms_c();
-    p_lambda= s->last_lambda_for[AV_PICTURE_TYPE_P]; //s->next_picture_ptr->quality;
-    b_lambda= s->last_lambda_for[AV_PICTURE_TYPE_B]; //p_lambda *FFABS(s->avctx->b_quant_factor) + s->avctx->b_quant_offset;
-    if(!b_lambda) b_lambda= p_lambda; //FIXME we should do this somewhere else
-    lambda2= (b_lambda*b_lambda + (1<<FF_LAMBDA_SHIFT)/2 ) >> FF_LAMBDA_SHIFT;
+/**
+ * Open the downscaled sub-encoder of a b_frame_strategy 2 candidate.
+ * The codec is initialized directly, avcodec_open2() and avcodec_close()
+ * cannot be nested in the open and close of the parent encoder.
+ */
+static int open_b_candidate(MpegEncContext *s, AVCodecContext *c){
+    AVCodec *codec= s->avctx->codec;
+    const int scale= s->avctx->brd_scale;
 
     c->width = s->width >> scale;
     c->height= s->height>> scale;
     c->flags= CODEC_FLAG_QSCALE | CODEC_FLAG_PSNR | CODEC_FLAG_INPUT_PRESERVED /*| CODEC_FLAG_EMU_EDGE*/;
     c->flags|= s->avctx->flags & CODEC_FLAG_QPEL;
-    c->mb_decision= s->avctx->mb_decision;
+    c->mb_decision= s->mb_decision;
     c->me_cmp= s->avctx->me_cmp;
     c->mb_cmp= s->avctx->mb_cmp;
     c->me_sub_cmp= s->avctx->me_sub_cmp;
+    /* the score sums over macroblocks, of which there are 4^scale times fewer */
+    c->scenechange_threshold= s->avctx->scenechange_threshold / (1 << 2*scale);
+    c->scenechange_factor= s->avctx->scenechange_factor;
     c->pix_fmt = PIX_FMT_YUV420P;
     c->time_base= s->avctx->time_base;
     c->max_b_frames= s->max_b_frames;
 
-    if (avcodec_open2(c, codec, NULL) < 0)
+    c->codec_type= codec->type;
+    c->codec_id= codec->id;
+    c->priv_data= av_mallocz(codec->priv_data_size);
+    if(!c->priv_data)
+        return AVERROR(ENOMEM);
+    if(codec->priv_class){
+        *(AVClass**)c->priv_data= codec->priv_class;
+        av_opt_set_defaults(c->priv_data);
+    }
+    c->codec= codec;
+    if(codec->init(c) < 0){
+        c->codec= NULL;
         return -1;
+    }
+    return 0;
+}
 
-    for(i=0; i<s->max_b_frames+2; i++){
-        int ysize= c->width*c->height;
-        int csize= (c->width/2)*(c->height/2);
-        Picture pre_input, *pre_input_ptr= i ? s->input_picture[i-1] : s->next_picture_ptr;
-
-        avcodec_get_frame_defaults(&input[i]);
-        input[i].data[0]= av_malloc(ysize + 2*csize);
-        input[i].data[1]= input[i].data[0] + ysize;
-        input[i].data[2]= input[i].data[1] + csize;
-        input[i].linesize[0]= c->width;
-        input[i].linesize[1]=
-        input[i].linesize[2]= c->width/2;
+static void close_b_candidate(AVCodecContext *c){
+    if(c->codec){
+        c->codec->close(c);
+        avcodec_default_free_buffers(c);
+        if(c->codec->priv_class)
+            av_opt_free(c->priv_data);
+    }
+    av_freep(&c->priv_data);
+    av_freep(&c->extradata);
+    av_opt_free(c);
+}
 
-        if(pre_input_ptr && (!i || s->input_picture[i-1])) {
-            pre_input= *pre_input_ptr;
+static void free_b_candidates(MpegEncContext *s){
+    int j;
 
-            if (pre_input.f.type != FF_BUFFER_TYPE_SHARED && i) {
-                pre_input.f.data[0] += INPLACE_OFFSET;
-                pre_input.f.data[1] += INPLACE_OFFSET;
-                pre_input.f.data[2] += INPLACE_OFFSET;
+    if(s->b_cand){
+        for(j=0; j<s->max_b_frames+1; j++){
+            if(s->b_cand[j].c){
+                close_b_candidate(s->b_cand[j].c);
+                av_freep(&s->b_cand[j].c);
             }
-
-            s->dsp.shrink[scale](input[i].data[0], input[i].linesize[0], pre_input.f.data[0], pre_input.f.linesize[0], c->width,      c->height);
-            s->dsp.shrink[scale](input[i].data[1], input[i].linesize[1], pre_input.f.data[1], pre_input.f.linesize[1], c->width >> 1, c->height >> 1);
-            s->dsp.shrink[scale](input[i].data[2], input[i].linesize[2], pre_input.f.data[2], pre_input.f.linesize[2], c->width >> 1, c->height >> 1);
+            av_freep(&s->b_cand[j].outbuf);
         }
     }
+    av_freep(&s->b_cand);
+    av_freep(&s->b_cand_buf);
+}
+
+/**
+ * Open one sub-encoder per candidate B-frame count. They are kept across
+ * decisions, each window starts from a flushed sub-encoder.
+ */
+static int init_b_candidates(MpegEncContext *s){
+    const int scale= s->avctx->brd_scale;
+    int width = s->width >> scale;
+    int height= s->height>> scale;
+    int j;
+
+    if(scale > 3){
+        av_log(s->avctx, AV_LOG_ERROR, "brd_scale %d is not supported, the maximum is 3\n", scale);
+        return -1;
+    }
+
+    s->b_cand= av_mallocz((s->max_b_frames+1) * sizeof(*s->b_cand));
+    s->b_cand_buf= av_malloc((s->max_b_frames+2) * (width*height + 2*(width/2)*(height/2)));
+    if(!s->b_cand || !s->b_cand_buf)
+        goto fail;
 
     for(j=0; j<s->max_b_frames+1; j++){
-        int64_t rd=0;
+        BFrameCandidate *cand= &s->b_cand[j];
+
+        cand->c= avcodec_alloc_context3(NULL);
+        if(!cand->c || open_b_candidate(s, cand->c) < 0)
+            goto fail;
+        cand->outbuf_size= s->width * s->height; //FIXME
+        cand->outbuf= av_malloc(cand->outbuf_size);
+        if(!cand->outbuf)
+            goto fail;
+        cand->b_count= j;
+    }
+    return 0;
+
+fail:
+    free_b_candidates(s);
+    return -1;
+}
 
-        if(!s->input_picture[j])
+static void check_lookahead_scene_cut(BFrameCandidate *cand, int out_size){
+    AVFrame *coded = cand->c->coded_frame;
+    int num = coded->display_picture_number - cand->picture_base;
+
+    if(out_size > 0 && coded->pict_type == AV_PICTURE_TYPE_I &&
+       num > 0 && num < FF_MAX_B_FRAMES+2)
+        cand->scene_cut[num]= 1;
+}
+
+/**
+ * Encode the downscaled lookahead window with one B-frame pattern.
+ * Candidates are independent and run concurrently through avctx->execute().
+ */
+static int estimate_b_count_thread(AVCodecContext *avctx, void *arg){
+    BFrameCandidate *cand= arg;
+    AVCodecContext *c= cand->c;
+    MpegEncContext *sub= c->priv_data;
+    int i, out_size;
+
+    c->error[0]= c->error[1]= c->error[2]= 0;
+    cand->rd= 0;
+    memset(cand->scene_cut, 0, sizeof(cand->scene_cut));
+
+    cand->input[0].pict_type= AV_PICTURE_TYPE_I;
+    cand->input[0].quality= 1 * FF_QP2LAMBDA;
+    out_size = avcodec_encode_video(c, cand->outbuf, cand->outbuf_size, &cand->input[0]);
+//    rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
+
+    for(i=0; i<cand->nb_frames; i++){
+        int is_p= i % (cand->b_count+1) == cand->b_count || i==cand->nb_frames-1;
+
+        cand->input[i+1].pict_type= is_p ? AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
+        cand->input[i+1].quality= is_p ? cand->p_lambda : cand->b_lambda;
+        out_size = avcodec_encode_video(c, cand->outbuf, cand->outbuf_size, &cand->input[i+1]);
+        cand->rd += (out_size * cand->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+        check_lookahead_scene_cut(cand, out_size);
+    }
+
+    /* get the delayed frames */
+    while(out_size){
+        out_size = avcodec_encode_video(c, cand->outbuf, cand->outbuf_size, NULL);
+        cand->rd += (out_size * cand->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+        check_lookahead_scene_cut(cand, out_size);
+    }
+
+    cand->rd += c->error[0] + c->error[1] + c->error[2];
+
+    /* pictures still queued are not part of the estimate, but the sub-encoder
+       is reused and must not keep them past the flush below */
+    while(avcodec_encode_video(c, cand->outbuf, cand->outbuf_size, NULL) > 0);
+    emms_c();
+
+    /* drop the references, the next window starts with an I-frame again,
+       motion estimation also starts over from the initial vector ranges */
+    ff_mpeg_flush(c);
+    sub->f_code= sub->b_code= 1;
+    cand->picture_base += cand->nb_frames + 1;
+
+    return 0;
+}
+
+/**
+ * Choose the number of B-frames before the next P-frame, b_frame_strategy 2.
+ * Every candidate B-frame count is encoded on downscaled pictures and the
+ * one with the lowest rate-distortion cost wins. This is parallel candidate
+ * evaluation, the decision is still made when the picture is selected.
+ */
+static int estimate_best_b_count(MpegEncContext *s){
+    BFrameCandidate *cand= s->b_cand;
+    const int scale= s->avctx->brd_scale;
+    int i, j, p_lambda, b_lambda, lambda2, cand_count;
+    int width = s->width >> scale;
+    int height= s->height>> scale;
+    int ysize= width*height;
+    int csize= (width/2)*(height/2);
+    int64_t best_rd= INT64_MAX;
+    int best_b_count= -1;
+
+//    emms_c();
+    p_lambda= s->last_lambda_for[AV_PICTURE_TYPE_P]; //s->next_picture_ptr->quality;
+    b_lambda= s->last_lambda_for[AV_PICTURE_TYPE_B]; //p_lambda *FFABS(s->avctx->b_quant_factor) + s->avctx->b_quant_offset;
+    if(!b_lambda) b_lambda= p_lambda; //FIXME we should do this somewhere else
+    lambda2= (b_lambda*b_lambda + (1<<FF_LAMBDA_SHIFT)/2 ) >> FF_LAMBDA_SHIFT;
+
+    for(cand_count=0; cand_count<s->max_b_frames+1; cand_count++)
+        if(!s->input_picture[cand_count])
             break;
 
-        c->error[0]= c->error[1]= c->error[2]= 0;
+    /* only the pictures already queued are downscaled, near the end of the
+       stream the candidates get a shorter window */
+    for(i=0; i<cand_count+1; i++){
+        Picture pre_input, *pre_input_ptr= i ? s->input_picture[i-1] : s->next_picture_ptr;
+        uint8_t *data[3];
 
-        input[0].pict_type= AV_PICTURE_TYPE_I;
-        input[0].quality= 1 * FF_QP2LAMBDA;
-        out_size = avcodec_encode_video(c, outbuf, outbuf_size, &input[0]);
-//        rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
+        data[0]= s->b_cand_buf + i*(ysize + 2*csize);
+        data[1]= data[0] + ysize;
+        data[2]= data[1] + csize;
 
-        for(i=0; i<s->max_b_frames+1; i++){
-            int is_p= i % (j+1) == j || i==s->max_b_frames;
+        if(pre_input_ptr) {
+            pre_input= *pre_input_ptr;
 
-            input[i+1].pict_type= is_p ? AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
-            input[i+1].quality= is_p ? p_lambda : b_lambda;
-            out_size = avcodec_encode_video(c, outbuf, outbuf_size, &input[i+1]);
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
+            if (pre_input.f.type != FF_BUFFER_TYPE_SHARED && i) {
+                pre_input.f.data[0] += INPLACE_OFFSET;
+                pre_input.f.data[1] += INPLACE_OFFSET;
+                pre_input.f.data[2] += INPLACE_OFFSET;
+            }
+
+            s->dsp.shrink[scale](data[0], width,    pre_input.f.data[0], pre_input.f.linesize[0], width,      height);
+            s->dsp.shrink[scale](data[1], width/2,  pre_input.f.data[1], pre_input.f.linesize[1], width >> 1, height >> 1);
+            s->dsp.shrink[scale](data[2], width/2,  pre_input.f.data[2], pre_input.f.linesize[2], width >> 1, height >> 1);
         }
 
-        /* get the delayed frames */
-        while(out_size){
-            out_size = avcodec_encode_video(c, outbuf, outbuf_size, NULL);
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
+        for(j=0; j<cand_count; j++){
+            AVFrame *input= &cand[j].input[i];
+
+            avcodec_get_frame_defaults(input);
+            input->data[0]= data[0];
+            input->data[1]= data[1];
+            input->data[2]= data[2];
+            input->linesize[0]= width;
+            input->linesize[1]=
+            input->linesize[2]= width/2;
         }
+    }
+
+    for(j=0; j<cand_count; j++){
+        cand[j].nb_frames= cand_count;
+        cand[j].p_lambda= p_lambda;
+        cand[j].b_lambda= b_lambda;
+        cand[j].lambda2= lambda2;
+    }
 
-        rd += c->error[0] + c->error[1] + c->error[2];
+    s->avctx->execute(s->avctx, estimate_b_count_thread, cand, NULL, cand_count, sizeof(*cand));
 
-        if(rd < best_rd){
-            best_rd= rd;
+    for(j=0; j<cand_count; j++){
+        if(cand[j].rd < best_rd){
+            best_rd= cand[j].rd;
             best_b_count= j;
         }
     }
 
-    av_freep(&outbuf);
-    avcodec_close(c);
-    av_freep(&c);
-
-    for(i=0; i<s->max_b_frames+2; i++){
-        av_freep(&input[i].data[0]);
+    /* the all-P candidate ran the sub-encoder scene change detection on every
+       lookahead picture, use it to place I-frames before B-frames are chosen */
+    if(cand_count && s->lookahead_scene_cut){
+        for(i=1; i<=cand_count; i++){
+            if(cand[0].scene_cut[i])
+                s->input_picture[i-1]->f.pict_type = AV_PICTURE_TYPE_I;
+        }
     }
 
     return best_b_count;
@@ -1160,6 +1349,8 @@ static int select_input_picture(MpegEncContext *s, AVFrame *pic_arg){
                 }
             }else if(s->avctx->b_frame_strategy==2){
                 b_frames= estimate_best_b_count(s);
+                if(b_frames < 0)
+                    b_frames= 0;
             }else{
                 av_log(s->avctx, AV_LOG_ERROR, "illegal b frame strategy\n");
                 b_frames=0;
@@ -1483,7 +1674,7 @@ static inline void clip_coeffs(MpegEncContext *s, DCTELEM *block, int last_index
         block[j]= level;
     }
 
-    if(overflow && s->avctx->mb_decision == FF_MB_DECISION_SIMPLE)
+    if(overflow && s->mb_decision == FF_MB_DECISION_SIMPLE)
         av_log(s->avctx, AV_LOG_INFO, "warning, clipping %d dct coefficients to %d..%d\n", overflow, minlevel, maxlevel);
 }
 
@@ -1690,7 +1881,7 @@ static av_always_inline void encode_mb_internal(MpegEncContext *s, int motion_x,
         }
     }
 
-    if(s->avctx->quantizer_noise_shaping){
+    if(s->quantizer_noise_shaping){
         if(!skip_dct[0]) get_visual_weight(weight[0], ptr_y                 , wrap_y);
         if(!skip_dct[1]) get_visual_weight(weight[1], ptr_y              + 8, wrap_y);
         if(!skip_dct[2]) get_visual_weight(weight[2], ptr_y + dct_offset    , wrap_y);
@@ -1718,7 +1909,7 @@ static av_always_inline void encode_mb_internal(MpegEncContext *s, int motion_x,
             }else
                 s->block_last_index[i]= -1;
         }
-        if(s->avctx->quantizer_noise_shaping){
+        if(s->quantizer_noise_shaping){
             for(i=0;i<mb_block_count;i++) {
                 if(!skip_dct[i]){
                     s->block_last_index[i] = dct_quantize_refine(s, s->block[i], weight[i], orig[i], i, s->qscale);
@@ -1908,7 +2099,7 @@ static inline void encode_mb_hq(MpegEncContext *s, MpegEncContext *backup, MpegE
         score+= put_bits_count(&s->tex_pb);
     }
 
-    if(s->avctx->mb_decision == FF_MB_DECISION_RD){
+    if(s->mb_decision == FF_MB_DECISION_RD){
         MPV_decode_mb(s, s->block);
 
         score *= s->lambda2;
@@ -2514,7 +2705,7 @@ static int encode_thread(AVCodecContext *c, void *arg){
                     s->dsp.put_pixels_tab[1][0](s->dest[2], s->rd_scratchpad + 16*s->linesize + 8, s->uvlinesize, 8);
                 }
 
-                if(s->avctx->mb_decision == FF_MB_DECISION_BITS)
+                if(s->mb_decision == FF_MB_DECISION_BITS)
                     MPV_decode_mb(s, s->block);
             } else {
                 int motion_x = 0, motion_y = 0;
@@ -2857,7 +3048,8 @@ static int encode_picture(MpegEncContext *s, int picture_number)
     s->current_picture.   mb_var_sum= s->current_picture_ptr->   mb_var_sum= s->me.   mb_var_sum_temp;
     emms_c();
 
-    if(s->me.scene_change_score > s->avctx->scenechange_threshold && s->pict_type == AV_PICTURE_TYPE_P){
+    if(s->me.scene_change_score > s->avctx->scenechange_threshold && s->pict_type == AV_PICTURE_TYPE_P &&
+       !s->lookahead_scene_cut){
         s->pict_type= AV_PICTURE_TYPE_I;
         for(i=0; i<s->mb_stride*s->mb_height; i++)
             s->mb_type[i]= CANDIDATE_MB_TYPE_INTRA;
@@ -3463,7 +3655,7 @@ STOP_TIMER("init rem[]")
 #ifdef REFINE_STATS
 {START_TIMER
 #endif
-        analyze_gradient = last_non_zero > 2 || s->avctx->quantizer_noise_shaping >= 3;
+        analyze_gradient = last_non_zero > 2 || s->quantizer_noise_shaping >= 3;
 
         if(analyze_gradient){
 #ifdef REFINE_STATS
@@ -3521,7 +3713,7 @@ STOP_TIMER("dct")}
             const int level= block[j];
             int change, old_coeff;
 
-            if(s->avctx->quantizer_noise_shaping < 3 && i > last_non_zero + 1)
+            if(s->quantizer_noise_shaping < 3 && i > last_non_zero + 1)
                 break;
 
             if(level){
@@ -3539,7 +3731,7 @@ STOP_TIMER("dct")}
                 int score, new_coeff, unquant_change;
 
                 score=0;
-                if(s->avctx->quantizer_noise_shaping < 2 && FFABS(new_level) > FFABS(level))
+                if(s->quantizer_noise_shaping < 2 && FFABS(new_level) > FFABS(level))
                    continue;
 
                 if(new_level){
@@ -62,6 +62,8 @@ static av_cold int pcm_encode_close(AVCodecContext *avctx)
 
 /**
  * Write PCM samples macro
+ * Planar input (one plane of n/channels samples per channel) is
+ * interleaved while writing.
  * @param type Datatype of native machine format
  * @param endian bytestream_put_xxx() suffix
  * @param src Source pointer (variable name)
@@ -72,6 +74,14 @@ static av_cold int pcm_encode_close(AVCodecContext *avctx)
  */
 #define ENCODE(type, endian, src, dst, n, shift, offset) \
     samples_##type = (const type*) src; \
+    if (planar) { \
+        int i, c, plane_size = n / avctx->channels; \
+        for (i = 0; i < plane_size; i++) \
+            for (c = 0; c < avctx->channels; c++) { \
+                register type v = (samples_##type[c*plane_size + i] >> shift) + offset; \
+                bytestream_put_##endian(&dst, v); \
+            } \
+    } else \
     for(;n>0;n--) { \
         register type v = (*samples_##type++ >> shift) + offset; \
         bytestream_put_##endian(&dst, v); \
@@ -80,7 +90,7 @@ static av_cold int pcm_encode_close(AVCodecContext *avctx)
 static int pcm_encode_frame(AVCodecContext *avctx,
                             unsigned char *frame, int buf_size, void *data)
 {
-    int n, sample_size, v;
+    int n, sample_size, v, planar;
     const short *samples;
     unsigned char *dst;
     const uint8_t *srcu8;
@@ -95,7 +105,8 @@ static int pcm_encode_frame(AVCodecContext *avctx,
     samples = data;
     dst = frame;
 
-    if (avctx->sample_fmt!=avctx->codec->sample_fmts[0]) {
+    planar = av_sample_fmt_is_planar(avctx->sample_fmt);
+    if (av_get_packed_sample_fmt(avctx->sample_fmt) != avctx->codec->sample_fmts[0]) {
         av_log(avctx, AV_LOG_ERROR, "invalid sample_fmt\n");
         return -1;
     }
@@ -173,7 +184,11 @@ static int pcm_encode_frame(AVCodecContext *avctx,
     case CODEC_ID_PCM_S16LE:
 #endif /* HAVE_BIGENDIAN */
     case CODEC_ID_PCM_U8:
-        memcpy(dst, samples, n*sample_size);
+        if (planar)
+            av_samples_copy_layout(dst, (const uint8_t*)samples, avctx->channels,
+                                   n / avctx->channels, sample_size, 0);
+        else
+            memcpy(dst, samples, n*sample_size);
         dst += n*sample_size;
         break;
     case CODEC_ID_PCM_ZORK:
@@ -227,8 +242,11 @@ static av_cold int pcm_decode_init(AVCodecContext * avctx)
     }
 
     avctx->sample_fmt = avctx->codec->sample_fmts[0];
+    if (avctx->request_sample_fmt != AV_SAMPLE_FMT_NONE &&
+        avctx->request_sample_fmt == avctx->codec->sample_fmts[1])
+        avctx->sample_fmt = avctx->request_sample_fmt;
 
-    if (avctx->sample_fmt == AV_SAMPLE_FMT_S32)
+    if (av_get_packed_sample_fmt(avctx->sample_fmt) == AV_SAMPLE_FMT_S32)
         avctx->bits_per_raw_sample = av_get_bits_per_sample(avctx->codec->id);
 
     return 0;
@@ -259,7 +277,7 @@ static int pcm_decode_frame(AVCodecContext *avctx,
     const uint8_t *buf = avpkt->data;
     int buf_size = avpkt->size;
     PCMDecode *s = avctx->priv_data;
-    int sample_size, c, n, i;
+    int sample_size, c, n, i, planar;
     short *samples;
     const uint8_t *src, *src8, *src2[MAX_CHANNELS];
     uint8_t *dstu8;
@@ -272,7 +290,9 @@ static int pcm_decode_frame(AVCodecContext *avctx,
     samples = data;
     src = buf;
 
-    if (avctx->sample_fmt!=avctx->codec->sample_fmts[0]) {
+    planar = av_sample_fmt_is_planar(avctx->sample_fmt);
+    if (avctx->sample_fmt != avctx->codec->sample_fmts[0] &&
+        (!planar || avctx->sample_fmt != avctx->codec->sample_fmts[1])) {
         av_log(avctx, AV_LOG_ERROR, "invalid sample_fmt\n");
         return -1;
     }
@@ -308,6 +328,8 @@ static int pcm_decode_frame(AVCodecContext *avctx,
     }
 
     buf_size= FFMIN(buf_size, *data_size/2);
+    if (planar)
+        buf_size -= buf_size % (avctx->channels * sample_size);
     *data_size=0;
 
     n = buf_size/sample_size;
@@ -340,6 +362,16 @@ static int pcm_decode_frame(AVCodecContext *avctx,
         }
         break;
     case CODEC_ID_PCM_S16LE_PLANAR:
+        if (planar) {
+#if HAVE_BIGENDIAN
+            DECODE(int16_t, le16, src, samples, n, 0, 0)
+#else
+            memcpy(samples, src, n*2);
+            src     += n*2;
+            samples += n;
+#endif
+            break;
+        }
         n /= avctx->channels;
         for(c=0;c<avctx->channels;c++)
             src2[c] = &src[c*n*2];
@@ -348,6 +380,47 @@ static int pcm_decode_frame(AVCodecContext *avctx,
                 *samples++ = bytestream_get_le16(&src2[c]);
         src = src2[avctx->channels-1];
         break;
+    case CODEC_ID_PCM_S24LE_PLANAR:
+        if (planar) {
+            DECODE(int32_t, le24, src, samples, n, 8, 0)
+            break;
+        }
+        n /= avctx->channels;
+        for(c=0;c<avctx->channels;c++)
+            src2[c] = &src[c*n*3];
+        dst_int32_t = data;
+        for(;n>0;n--)
+            for(c=0;c<avctx->channels;c++)
+                *dst_int32_t++ = bytestream_get_le24(&src2[c]) << 8;
+        src = src2[avctx->channels-1];
+        samples = (short *)dst_int32_t;
+        break;
+    case CODEC_ID_PCM_S32LE_PLANAR:
+        if (planar) {
+#if HAVE_BIGENDIAN
+            DECODE(int32_t, le32, src, samples, n, 0, 0)
+#else
+            memcpy(samples, src, n*4);
+            src     += n*4;
+            samples += n*2;
+#endif
+            break;
+        }
+#if HAVE_BIGENDIAN
+        n /= avctx->channels;
+        for(c=0;c<avctx->channels;c++)
+            src2[c] = &src[c*n*4];
+        dst_int32_t = data;
+        for(;n>0;n--)
+            for(c=0;c<avctx->channels;c++)
+                *dst_int32_t++ = bytestream_get_le32(&src2[c]);
+        samples = (short *)dst_int32_t;
+#else
+        av_samples_copy_layout(data, src, avctx->channels, n / avctx->channels, 4, 0);
+        samples = (short *)((uint8_t *)data + n*4);
+#endif
+        src += n*4;
+        break;
     case CODEC_ID_PCM_U16LE:
         DECODE(uint16_t, le16, src, samples, n, 0, 0x8000)
         break;
@@ -446,6 +519,20 @@ static int pcm_decode_frame(AVCodecContext *avctx,
     case CODEC_ID_PCM_LXF:
         dst_int32_t = data;
         n /= avctx->channels;
+        if (planar) {
+            //unpack each plane, every 40-bit block holds two samples
+            for (c = 0, src8 = src; c < avctx->channels; c++) {
+                for (i = 0; i < n; i++, src8 += 5) {
+                    *dst_int32_t++ = (src8[2] << 28) | (src8[1] << 20) | (src8[0] << 12) |
+                                     ((src8[2] & 0xF) << 8) | src8[1];
+                    *dst_int32_t++ = (src8[4] << 24) | (src8[3] << 16) |
+                                     ((src8[2] & 0xF0) << 8) | (src8[4] << 4) | (src8[3] >> 4);
+                }
+            }
+            src = src8;
+            samples = (short *) dst_int32_t;
+            break;
+        }
         //unpack and de-planerize
         for (i = 0; i < n; i++) {
             for (c = 0, src8 = src + i*5; c < avctx->channels; c++, src8 += n*5) {
@@ -471,7 +558,7 @@ static int pcm_decode_frame(AVCodecContext *avctx,
 }
 
 #if CONFIG_ENCODERS
-#define PCM_ENCODER(id_,sample_fmt_,name_,long_name_) \
+#define PCM_ENCODER(id_,sample_fmt_,planar_fmt_,name_,long_name_) \
 AVCodec ff_ ## name_ ## _encoder = {            \
     .name        = #name_,                      \
     .type        = AVMEDIA_TYPE_AUDIO,          \
@@ -479,15 +566,15 @@ AVCodec ff_ ## name_ ## _encoder = {            \
     .init        = pcm_encode_init,             \
     .encode      = pcm_encode_frame,            \
     .close       = pcm_encode_close,            \
-    .sample_fmts = (const enum AVSampleFormat[]){sample_fmt_,AV_SAMPLE_FMT_NONE}, \
+    .sample_fmts = (const enum AVSampleFormat[]){sample_fmt_,planar_fmt_,AV_SAMPLE_FMT_NONE}, \
     .long_name = NULL_IF_CONFIG_SMALL(long_name_), \
 }
 #else
-#define PCM_ENCODER(id,sample_fmt_,name,long_name_)
+#define PCM_ENCODER(id,sample_fmt_,planar_fmt_,name,long_name_)
 #endif
 
 #if CONFIG_DECODERS
-#define PCM_DECODER(id_,sample_fmt_,name_,long_name_)         \
+#define PCM_DECODER(id_,sample_fmt_,planar_fmt_,name_,long_name_) \
 AVCodec ff_ ## name_ ## _decoder = {            \
     .name           = #name_,                   \
     .type           = AVMEDIA_TYPE_AUDIO,       \
@@ -495,39 +582,43 @@ AVCodec ff_ ## name_ ## _decoder = {            \
     .priv_data_size = sizeof(PCMDecode),        \
     .init           = pcm_decode_init,          \
     .decode         = pcm_decode_frame,         \
-    .sample_fmts = (const enum AVSampleFormat[]){sample_fmt_,AV_SAMPLE_FMT_NONE}, \
+    .sample_fmts = (const enum AVSampleFormat[]){sample_fmt_,planar_fmt_,AV_SAMPLE_FMT_NONE}, \
     .long_name = NULL_IF_CONFIG_SMALL(long_name_), \
 }
 #else
-#define PCM_DECODER(id,sample_fmt_,name,long_name_)
+#define PCM_DECODER(id,sample_fmt_,planar_fmt_,name,long_name_)
 #endif
 
-#define PCM_CODEC(id, sample_fmt_, name, long_name_)         \
-    PCM_ENCODER(id,sample_fmt_,name,long_name_); PCM_DECODER(id,sample_fmt_,name,long_name_)
+/* planar_fmt_ is the planar input also accepted by the encoder, decoders
+   of packed data only output sample_fmt_ */
+#define PCM_CODEC(id, sample_fmt_, planar_fmt_, name, long_name_)         \
+    PCM_ENCODER(id,sample_fmt_,planar_fmt_,name,long_name_); PCM_DECODER(id,sample_fmt_,AV_SAMPLE_FMT_NONE,name,long_name_)
 
 /* Note: Do not forget to add new entries to the Makefile as well. */
-PCM_CODEC  (CODEC_ID_PCM_ALAW,  AV_SAMPLE_FMT_S16, pcm_alaw, "PCM A-law");
-PCM_DECODER(CODEC_ID_PCM_DVD,   AV_SAMPLE_FMT_S32, pcm_dvd, "PCM signed 20|24-bit big-endian");
-PCM_CODEC  (CODEC_ID_PCM_F32BE, AV_SAMPLE_FMT_FLT, pcm_f32be, "PCM 32-bit floating point big-endian");
-PCM_CODEC  (CODEC_ID_PCM_F32LE, AV_SAMPLE_FMT_FLT, pcm_f32le, "PCM 32-bit floating point little-endian");
-PCM_CODEC  (CODEC_ID_PCM_F64BE, AV_SAMPLE_FMT_DBL, pcm_f64be, "PCM 64-bit floating point big-endian");
-PCM_CODEC  (CODEC_ID_PCM_F64LE, AV_SAMPLE_FMT_DBL, pcm_f64le, "PCM 64-bit floating point little-endian");
-PCM_DECODER(CODEC_ID_PCM_LXF,   AV_SAMPLE_FMT_S32, pcm_lxf, "PCM signed 20-bit little-endian planar");
-PCM_CODEC  (CODEC_ID_PCM_MULAW, AV_SAMPLE_FMT_S16, pcm_mulaw, "PCM mu-law");
-PCM_CODEC  (CODEC_ID_PCM_S8,    AV_SAMPLE_FMT_U8,  pcm_s8, "PCM signed 8-bit");
-PCM_CODEC  (CODEC_ID_PCM_S16BE, AV_SAMPLE_FMT_S16, pcm_s16be, "PCM signed 16-bit big-endian");
-PCM_CODEC  (CODEC_ID_PCM_S16LE, AV_SAMPLE_FMT_S16, pcm_s16le, "PCM signed 16-bit little-endian");
-PCM_DECODER(CODEC_ID_PCM_S16LE_PLANAR, AV_SAMPLE_FMT_S16, pcm_s16le_planar, "PCM 16-bit little-endian planar");
-PCM_CODEC  (CODEC_ID_PCM_S24BE, AV_SAMPLE_FMT_S32, pcm_s24be, "PCM signed 24-bit big-endian");
-PCM_CODEC  (CODEC_ID_PCM_S24DAUD, AV_SAMPLE_FMT_S16,  pcm_s24daud, "PCM D-Cinema audio signed 24-bit");
-PCM_CODEC  (CODEC_ID_PCM_S24LE, AV_SAMPLE_FMT_S32, pcm_s24le, "PCM signed 24-bit little-endian");
-PCM_CODEC  (CODEC_ID_PCM_S32BE, AV_SAMPLE_FMT_S32, pcm_s32be, "PCM signed 32-bit big-endian");
-PCM_CODEC  (CODEC_ID_PCM_S32LE, AV_SAMPLE_FMT_S32, pcm_s32le, "PCM signed 32-bit little-endian");
-PCM_CODEC  (CODEC_ID_PCM_U8,    AV_SAMPLE_FMT_U8,  pcm_u8, "PCM unsigned 8-bit");
-PCM_CODEC  (CODEC_ID_PCM_U16BE, AV_SAMPLE_FMT_S16, pcm_u16be, "PCM unsigned 16-bit big-endian");
-PCM_CODEC  (CODEC_ID_PCM_U16LE, AV_SAMPLE_FMT_S16, pcm_u16le, "PCM unsigned 16-bit little-endian");
-PCM_CODEC  (CODEC_ID_PCM_U24BE, AV_SAMPLE_FMT_S32, pcm_u24be, "PCM unsigned 24-bit big-endian");
-PCM_CODEC  (CODEC_ID_PCM_U24LE, AV_SAMPLE_FMT_S32, pcm_u24le, "PCM unsigned 24-bit little-endian");
-PCM_CODEC  (CODEC_ID_PCM_U32BE, AV_SAMPLE_FMT_S32, pcm_u32be, "PCM unsigned 32-bit big-endian");
-PCM_CODEC  (CODEC_ID_PCM_U32LE, AV_SAMPLE_FMT_S32, pcm_u32le, "PCM unsigned 32-bit little-endian");
-PCM_CODEC  (CODEC_ID_PCM_ZORK,  AV_SAMPLE_FMT_S16, pcm_zork, "PCM Zork");
+PCM_CODEC  (CODEC_ID_PCM_ALAW,  AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE, pcm_alaw, "PCM A-law");
+PCM_DECODER(CODEC_ID_PCM_DVD,   AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_NONE, pcm_dvd, "PCM signed 20|24-bit big-endian");
+PCM_CODEC  (CODEC_ID_PCM_F32BE, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP, pcm_f32be, "PCM 32-bit floating point big-endian");
+PCM_CODEC  (CODEC_ID_PCM_F32LE, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP, pcm_f32le, "PCM 32-bit floating point little-endian");
+PCM_CODEC  (CODEC_ID_PCM_F64BE, AV_SAMPLE_FMT_DBL, AV_SAMPLE_FMT_NONE, pcm_f64be, "PCM 64-bit floating point big-endian");
+PCM_CODEC  (CODEC_ID_PCM_F64LE, AV_SAMPLE_FMT_DBL, AV_SAMPLE_FMT_NONE, pcm_f64le, "PCM 64-bit floating point little-endian");
+PCM_DECODER(CODEC_ID_PCM_LXF,   AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_lxf, "PCM signed 20-bit little-endian planar");
+PCM_CODEC  (CODEC_ID_PCM_MULAW, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE, pcm_mulaw, "PCM mu-law");
+PCM_CODEC  (CODEC_ID_PCM_S8,    AV_SAMPLE_FMT_U8,  AV_SAMPLE_FMT_NONE, pcm_s8, "PCM signed 8-bit");
+PCM_CODEC  (CODEC_ID_PCM_S16BE, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P, pcm_s16be, "PCM signed 16-bit big-endian");
+PCM_CODEC  (CODEC_ID_PCM_S16LE, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P, pcm_s16le, "PCM signed 16-bit little-endian");
+PCM_DECODER(CODEC_ID_PCM_S16LE_PLANAR, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P, pcm_s16le_planar, "PCM 16-bit little-endian planar");
+PCM_CODEC  (CODEC_ID_PCM_S24BE, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_s24be, "PCM signed 24-bit big-endian");
+PCM_CODEC  (CODEC_ID_PCM_S24DAUD, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE, pcm_s24daud, "PCM D-Cinema audio signed 24-bit");
+PCM_DECODER(CODEC_ID_PCM_S24LE_PLANAR, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_s24le_planar, "PCM signed 24-bit little-endian planar");
+PCM_CODEC  (CODEC_ID_PCM_S24LE, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_s24le, "PCM signed 24-bit little-endian");
+PCM_CODEC  (CODEC_ID_PCM_S32BE, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_s32be, "PCM signed 32-bit big-endian");
+PCM_DECODER(CODEC_ID_PCM_S32LE_PLANAR, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_s32le_planar, "PCM signed 32-bit little-endian planar");
+PCM_CODEC  (CODEC_ID_PCM_S32LE, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_s32le, "PCM signed 32-bit little-endian");
+PCM_CODEC  (CODEC_ID_PCM_U8,    AV_SAMPLE_FMT_U8,  AV_SAMPLE_FMT_NONE, pcm_u8, "PCM unsigned 8-bit");
+PCM_CODEC  (CODEC_ID_PCM_U16BE, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P, pcm_u16be, "PCM unsigned 16-bit big-endian");
+PCM_CODEC  (CODEC_ID_PCM_U16LE, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P, pcm_u16le, "PCM unsigned 16-bit little-endian");
+PCM_CODEC  (CODEC_ID_PCM_U24BE, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_u24be, "PCM unsigned 24-bit big-endian");
+PCM_CODEC  (CODEC_ID_PCM_U24LE, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_u24le, "PCM unsigned 24-bit little-endian");
+PCM_CODEC  (CODEC_ID_PCM_U32BE, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_u32be, "PCM unsigned 32-bit big-endian");
+PCM_CODEC  (CODEC_ID_PCM_U32LE, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_u32le, "PCM unsigned 32-bit little-endian");
+PCM_CODEC  (CODEC_ID_PCM_ZORK,  AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE, pcm_zork, "PCM Zork");
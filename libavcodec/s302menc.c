@@ -0,0 +1,170 @@
+/*
+ * SMPTE 302M encoder
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * SMPTE 302M encoder, AES3 audio in pairs of channels as carried in MPEG-TS
+ */
+
+#include "libavutil/intreadwrite.h"
+#include "avcodec.h"
+
+#define AES3_HEADER_LEN   4
+#define AES3_BLOCK_SIZE 192 ///< samples between two framing (F) bits
+#define S302M_FRAME_SIZE 1920 ///< 40ms at 48kHz, one 25fps video frame
+
+typedef struct S302MEncContext {
+    int framing_index; ///< position in the current AES3 block
+} S302MEncContext;
+
+static av_cold int s302m_encode_init(AVCodecContext *avctx)
+{
+    S302MEncContext *s = avctx->priv_data;
+
+    if (avctx->channels < 2 || avctx->channels > 8 || avctx->channels & 1) {
+        av_log(avctx, AV_LOG_ERROR, "encoding %d channels is not allowed, "
+               "only 2, 4, 6 and 8 channels are supported\n", avctx->channels);
+        return AVERROR(EINVAL);
+    }
+    if (avctx->sample_rate != 48000) {
+        av_log(avctx, AV_LOG_ERROR, "only 48kHz sample rate is supported\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (avctx->sample_fmt == AV_SAMPLE_FMT_S16) {
+        avctx->bits_per_coded_sample = 16;
+    } else if (avctx->bits_per_raw_sample && avctx->bits_per_raw_sample <= 20) {
+        avctx->bits_per_coded_sample = 20;
+    } else {
+        if (avctx->bits_per_raw_sample > 24)
+            av_log(avctx, AV_LOG_WARNING, "encoding as 24 bits per sample\n");
+        avctx->bits_per_coded_sample = 24;
+    }
+
+    avctx->frame_size = S302M_FRAME_SIZE;
+    avctx->bit_rate   = 48000 * avctx->channels * (avctx->bits_per_coded_sample + 4);
+    avctx->coded_frame = avcodec_alloc_frame();
+    if (!avctx->coded_frame)
+        return AVERROR(ENOMEM);
+    avctx->coded_frame->key_frame = 1;
+    s->framing_index = 0;
+
+    return 0;
+}
+
+/**
+ * Pack one pair of samples into 2*(bits+4) bits.
+ *
+ * Each AES3 subframe is the sample followed by the V, U, C and F bits,
+ * sent LSB first. Both subframes are assembled in transmission order in
+ * a 64-bit word, then the bits of all bytes are reversed at once, which
+ * is what a per-byte table lookup would do.
+ */
+static av_always_inline void s302m_pack_pair(uint8_t *o, uint32_t s0, uint32_t s1,
+                                             int bits, uint64_t f)
+{
+    uint64_t w = s0 | f << (bits + 3) | (uint64_t)s1 << (bits + 4);
+
+    w = ((w >> 1) & 0x5555555555555555ULL) | ((w & 0x5555555555555555ULL) << 1);
+    w = ((w >> 2) & 0x3333333333333333ULL) | ((w & 0x3333333333333333ULL) << 2);
+    w = ((w >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((w & 0x0F0F0F0F0F0F0F0FULL) << 4);
+
+    AV_WL32(o, w);
+    if (bits == 16) {
+        o[4] = w >> 32;
+    } else {
+        AV_WL16(o + 4, w >> 32);
+        if (bits == 24)
+            o[6] = w >> 48;
+    }
+}
+
+static av_always_inline uint8_t *s302m_pack(S302MEncContext *s, uint8_t *o,
+                                            const void *data, int nb_samples,
+                                            int channels, int bits)
+{
+    const uint16_t *s16 = data;
+    const uint32_t *s32 = data;
+    int i, c;
+
+    for (i = 0; i < nb_samples; i++) {
+        uint64_t f = !s->framing_index;
+        for (c = 0; c < channels; c += 2) {
+            if (bits == 16) {
+                s302m_pack_pair(o, s16[0], s16[1], bits, f);
+                s16 += 2;
+            } else {
+                s302m_pack_pair(o, s32[0] >> (32 - bits), s32[1] >> (32 - bits), bits, f);
+                s32 += 2;
+            }
+            o += (bits + 4) >> 2;
+        }
+        if (++s->framing_index == AES3_BLOCK_SIZE)
+            s->framing_index = 0;
+    }
+    return o;
+}
+
+static int s302m_encode_frame(AVCodecContext *avctx, uint8_t *buf,
+                              int buf_size, void *data)
+{
+    S302MEncContext *s = avctx->priv_data;
+    int bits = avctx->bits_per_coded_sample;
+    int frame_size = avctx->frame_size * avctx->channels * (bits + 4) >> 3;
+    uint8_t *o = buf + AES3_HEADER_LEN;
+
+    if (buf_size < AES3_HEADER_LEN + frame_size) {
+        av_log(avctx, AV_LOG_ERROR, "output buffer too small\n");
+        return AVERROR(EINVAL);
+    }
+
+    /* size, number of channels, channel id, bits per sample, alignment */
+    AV_WB32(buf, frame_size << 16 | (avctx->channels - 2) >> 1 << 14 |
+                 (bits - 16) >> 2 << 4);
+
+    switch (bits) {
+    case 16: o = s302m_pack(s, o, data, avctx->frame_size, avctx->channels, 16); break;
+    case 20: o = s302m_pack(s, o, data, avctx->frame_size, avctx->channels, 20); break;
+    case 24: o = s302m_pack(s, o, data, avctx->frame_size, avctx->channels, 24); break;
+    }
+
+    return o - buf;
+}
+
+static av_cold int s302m_encode_close(AVCodecContext *avctx)
+{
+    av_freep(&avctx->coded_frame);
+    return 0;
+}
+
+AVCodec ff_s302m_encoder = {
+    .name           = "s302m",
+    .type           = AVMEDIA_TYPE_AUDIO,
+    .id             = CODEC_ID_S302M,
+    .priv_data_size = sizeof(S302MEncContext),
+    .init           = s302m_encode_init,
+    .encode         = s302m_encode_frame,
+    .close          = s302m_encode_close,
+    .sample_fmts    = (const enum AVSampleFormat[]){AV_SAMPLE_FMT_S32,
+                                                    AV_SAMPLE_FMT_S16,
+                                                    AV_SAMPLE_FMT_NONE},
+    .supported_samplerates = (const int[]){48000, 0},
+    .long_name      = NULL_IF_CONFIG_SMALL("SMPTE 302M"),
+};
@@ -300,6 +300,8 @@ static int svq1_encode_plane(SVQ1Context *s, int plane, unsigned char *src_plane
         s->m.me_method= s->avctx->me_method;
         s->m.me.scene_change_score=0;
         s->m.flags= s->avctx->flags;
+        s->m.mb_decision= s->avctx->mb_decision;
+        s->m.me_subpel_quality= s->avctx->me_subpel_quality;
 //        s->m.out_format = FMT_H263;
 //        s->m.unrestricted_mv= 1;
 
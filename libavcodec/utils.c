@@ -1289,6 +1289,7 @@ int av_get_bits_per_sample(enum CodecID codec_id){
     case CODEC_ID_PCM_S24LE:
     case CODEC_ID_PCM_U24BE:
     case CODEC_ID_PCM_U24LE:
+    case CODEC_ID_PCM_S24LE_PLANAR:
         return 24;
     case CODEC_ID_PCM_S32BE:
     case CODEC_ID_PCM_S32LE:
@@ -1296,6 +1297,7 @@ int av_get_bits_per_sample(enum CodecID codec_id){
     case CODEC_ID_PCM_U32LE:
     case CODEC_ID_PCM_F32BE:
     case CODEC_ID_PCM_F32LE:
+    case CODEC_ID_PCM_S32LE_PLANAR:
         return 32;
     case CODEC_ID_PCM_F64BE:
     case CODEC_ID_PCM_F64LE:
@@ -47,6 +47,14 @@ static void v210_planar_unpack_c(const uint32_t *src, uint16_t *y, uint16_t *u,
     }
 }
 
+av_cold void ff_v210dec_init(V210DecContext *s)
+{
+    s->unpack_frame = v210_planar_unpack_c;
+
+    if (HAVE_MMX)
+        v210_x86_init(s);
+}
+
 static av_cold int decode_init(AVCodecContext *avctx)
 {
     V210DecContext *s = avctx->priv_data;
@@ -60,10 +68,7 @@ static av_cold int decode_init(AVCodecContext *avctx)
 
     avctx->coded_frame         = avcodec_alloc_frame();
 
-    s->unpack_frame            = v210_planar_unpack_c;
-
-    if (HAVE_MMX)
-        v210_x86_init(s);
+    ff_v210dec_init(s);
 
     return 0;
 }
@@ -88,8 +93,7 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *data_size,
     aligned_input = !((uintptr_t)psrc & 0xf) && !(stride & 0xf);
     if (aligned_input != s->aligned_input) {
         s->aligned_input = aligned_input;
-        if (HAVE_MMX)
-            v210_x86_init(s);
+        ff_v210dec_init(s);
     }
 
     if (pic->data[0])
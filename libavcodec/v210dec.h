@@ -29,6 +29,10 @@ typedef struct {
     void (*unpack_frame)(const uint32_t *src, uint16_t *y, uint16_t *u, uint16_t *v, int width);
 } V210DecContext;
 
+/**
+ * Set unpack_frame() for the CPU and s->aligned_input.
+ */
+void ff_v210dec_init(V210DecContext *s);
 void v210_x86_init(V210DecContext *s);
 
 #endif /* AVCODEC_V210DEC_H */
@@ -0,0 +1,429 @@
+/*
+ * DPX line packing and unpacking functions, SSE2 and SSSE3
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/dpxdsp.h"
+
+/*
+ * 10-bit unpacking to 16-bit samples: 8 words give 24 samples. pshufb
+ * puts in each word lane the 16 bits of the 32-bit word that hold the
+ * sample, pmullw shifts the sample to the top bits, then the top bits
+ * are replicated in the low bits.
+ */
+DECLARE_ALIGNED(16, static const uint8_t, unpack10_shuf)[2][3][16] = {
+    { {  2,  3,  1,  2,  0,  1,  6,  7,  5,  6,  4,  5, 10, 11,  9, 10 },
+      {  0,  1,  6,  7,  5,  6,  4,  5, 10, 11,  9, 10,  8,  9, 14, 15 },
+      {  5,  6,  4,  5, 10, 11,  9, 10,  8,  9, 14, 15, 13, 14, 12, 13 } },
+    { {  1,  0,  2,  1,  3,  2,  5,  4,  6,  5,  7,  6,  9,  8, 10,  9 },
+      {  3,  2,  5,  4,  6,  5,  7,  6,  9,  8, 10,  9, 11, 10, 13, 12 },
+      {  6,  5,  7,  6,  9,  8, 10,  9, 11, 10, 13, 12, 14, 13, 15, 14 } },
+};
+
+/* shift of each sample position to the top bits, method A and B */
+#define MUL3(a, b, c) \
+    { { a, b, c, a, b, c, a, b }, { c, a, b, c, a, b, c, a }, { b, c, a, b, c, a, b, c } }
+DECLARE_ALIGNED(16, static const uint16_t, unpack10_mul)[2][3][8] = {
+    MUL3(1, 4, 16),
+    MUL3(4, 16, 64),
+};
+
+/*
+ * 10-bit packing of 4 pixels: pshufb gathers the r samples of 24 bytes in
+ * the high words of the dword lanes, and the g and b samples in the low
+ * words. The 24 bytes are read as 16 + 8 bytes, hence 2 masks each.
+ */
+#define Z 0x80
+DECLARE_ALIGNED(16, static const uint8_t, pack10_shuf)[2][6][16] = {
+    { { Z, Z,  0,  1, Z, Z,  6,  7, Z, Z, 12, 13, Z, Z, Z, Z },
+      { Z, Z,  Z,  Z, Z, Z,  Z,  Z, Z, Z,  Z,  Z, Z, Z, 2, 3 },
+      { 2, 3,  Z,  Z, 8, 9,  Z,  Z, 14, 15, Z, Z, Z, Z, Z, Z },
+      { Z, Z,  Z,  Z, Z, Z,  Z,  Z, Z, Z,  Z,  Z, 4, 5, Z, Z },
+      { 4, 5,  Z,  Z, 10, 11, Z, Z, Z, Z,  Z,  Z, Z, Z, Z, Z },
+      { Z, Z,  Z,  Z, Z, Z,  Z,  Z, 0, 1,  Z,  Z, 6, 7, Z, Z } },
+    { { Z, Z,  1,  0, Z, Z,  7,  6, Z, Z, 13, 12, Z, Z, Z, Z },
+      { Z, Z,  Z,  Z, Z, Z,  Z,  Z, Z, Z,  Z,  Z, Z, Z, 3, 2 },
+      { 3, 2,  Z,  Z, 9, 8,  Z,  Z, 15, 14, Z, Z, Z, Z, Z, Z },
+      { Z, Z,  Z,  Z, Z, Z,  Z,  Z, Z, Z,  Z,  Z, 5, 4, Z, Z },
+      { 5, 4,  Z,  Z, 11, 10, Z, Z, Z, Z,  Z,  Z, Z, Z, Z, Z },
+      { Z, Z,  Z,  Z, Z, Z,  Z,  Z, 1, 0,  Z,  Z, 7, 6, Z, Z } },
+};
+#undef Z
+
+DECLARE_ALIGNED(16, static const uint8_t, bswap32_shuf)[16] = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+DECLARE_ALIGNED(16, static const uint16_t, pw_ffc0)[8] = {
+    0xffc0, 0xffc0, 0xffc0, 0xffc0, 0xffc0, 0xffc0, 0xffc0, 0xffc0
+};
+DECLARE_ALIGNED(16, static const uint16_t, pw_3ff)[8] = {
+    0x3ff, 0x3ff, 0x3ff, 0x3ff, 0x3ff, 0x3ff, 0x3ff, 0x3ff
+};
+DECLARE_ALIGNED(16, static const uint16_t, pw_fff)[8] = {
+    0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff
+};
+DECLARE_ALIGNED(16, static const uint32_t, pd_3ff)[4] = {
+    0x3ff, 0x3ff, 0x3ff, 0x3ff
+};
+DECLARE_ALIGNED(16, static const uint32_t, pd_ffc0)[4] = {
+    0xffc0, 0xffc0, 0xffc0, 0xffc0
+};
+DECLARE_ALIGNED(16, static const uint32_t, pd_ffc00000)[4] = {
+    0xffc00000, 0xffc00000, 0xffc00000, 0xffc00000
+};
+
+/* swap the bytes of the dwords of r, uses t */
+#define BSWAP32(r, t)                   \
+    "pshuflw $0xb1, "r", "r"        \n" \
+    "pshufhw $0xb1, "r", "r"        \n" \
+    "movdqa     "r", "t"            \n" \
+    "psrlw       $8, "r"            \n" \
+    "psllw       $8, "t"            \n" \
+    "por        "t", "r"            \n"
+
+/* swap the bytes of the words of r, uses t */
+#define BSWAP16(r, t)                   \
+    "movdqa     "r", "t"            \n" \
+    "psrlw       $8, "r"            \n" \
+    "psllw       $8, "t"            \n" \
+    "por        "t", "r"            \n"
+
+#define EXPAND10(v) ((v) << 6 | (v) >> 4)
+
+static av_always_inline void unpack10_ssse3(uint16_t *dst, const uint8_t *src, int words,
+                                            int method_b, int big)
+{
+#if HAVE_SSSE3
+    x86_reg n = words & ~7;
+
+    if (n > 0) {
+        __asm__ volatile(
+            "movdqa         %5, %%xmm5      \n"
+            "1:                             \n"
+            "movdqu       (%1), %%xmm0      \n"
+            "movdqu      8(%1), %%xmm1      \n"
+            "movdqu     16(%1), %%xmm2      \n"
+            "pshufb       (%3), %%xmm0      \n"
+            "pshufb     16(%3), %%xmm1      \n"
+            "pshufb     32(%3), %%xmm2      \n"
+            "pmullw       (%4), %%xmm0      \n"
+            "pmullw     16(%4), %%xmm1      \n"
+            "pmullw     32(%4), %%xmm2      \n"
+            "pand       %%xmm5, %%xmm0      \n"
+            "pand       %%xmm5, %%xmm1      \n"
+            "pand       %%xmm5, %%xmm2      \n"
+            "movdqa     %%xmm0, %%xmm3      \n"
+            "psrlw         $10, %%xmm3      \n"
+            "por        %%xmm3, %%xmm0      \n"
+            "movdqa     %%xmm1, %%xmm3      \n"
+            "psrlw         $10, %%xmm3      \n"
+            "por        %%xmm3, %%xmm1      \n"
+            "movdqa     %%xmm2, %%xmm3      \n"
+            "psrlw         $10, %%xmm3      \n"
+            "por        %%xmm3, %%xmm2      \n"
+            "movdqu     %%xmm0,   (%2)      \n"
+            "movdqu     %%xmm1, 16(%2)      \n"
+            "movdqu     %%xmm2, 32(%2)      \n"
+            "add           $32, %1          \n"
+            "add           $48, %2          \n"
+            "sub            $8, %0          \n"
+            "jg 1b                          \n"
+            :"+r"(n), "+r"(src), "+r"(dst)
+            :"r"(unpack10_shuf[big]), "r"(unpack10_mul[method_b]),
+             "m"(*pw_ffc0)
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm5",)
+             "memory"
+        );
+        words &= 7;
+    }
+#endif
+    for (; words > 0; words--) {
+        unsigned w = big ? AV_RB32(src) : AV_RL32(src);
+        if (method_b) {
+            *dst++ = EXPAND10(w >> 20 & 0x3ff);
+            *dst++ = EXPAND10(w >> 10 & 0x3ff);
+            *dst++ = EXPAND10(w       & 0x3ff);
+        } else {
+            *dst++ = EXPAND10(w >> 22 & 0x3ff);
+            *dst++ = EXPAND10(w >> 12 & 0x3ff);
+            *dst++ = EXPAND10(w >>  2 & 0x3ff);
+        }
+        src += 4;
+    }
+}
+
+#define UNPACK10_PLANAR(name, method_b, big, bswap, s0, s1, s2)         \
+static void unpack10_ ## name ## _ssse3(uint16_t *dst, const uint8_t *src, int words) \
+{                                                                       \
+    unpack10_ssse3(dst, src, words, method_b, big);                     \
+}                                                                       \
+                                                                        \
+static void unpack10_planar_ ## name ## _sse2(uint16_t *dst0, uint16_t *dst1, \
+                                              uint16_t *dst2,           \
+                                              const uint8_t *src, int words) \
+{                                                                       \
+    x86_reg i = 0, n = words & ~7;                                      \
+                                                                        \
+    if (n > 0) {                                                        \
+        __asm__ volatile(                                               \
+            "movdqa         %6, %%xmm4      \n"                         \
+            "1:                             \n"                         \
+            "movdqu   (%5,%0,4), %%xmm0     \n"                         \
+            "movdqu 16(%5,%0,4), %%xmm1     \n"                         \
+            bswap                                                       \
+            "movdqa     %%xmm0, %%xmm2      \n"                         \
+            "movdqa     %%xmm1, %%xmm3      \n"                         \
+            "psrld   $"#s0", %%xmm2         \n"                         \
+            "psrld   $"#s0", %%xmm3         \n"                         \
+            "pand       %%xmm4, %%xmm2      \n"                         \
+            "pand       %%xmm4, %%xmm3      \n"                         \
+            "packssdw   %%xmm3, %%xmm2      \n"                         \
+            "movdqu     %%xmm2, (%2,%0,2)   \n"                         \
+            "movdqa     %%xmm0, %%xmm2      \n"                         \
+            "movdqa     %%xmm1, %%xmm3      \n"                         \
+            "psrld   $"#s1", %%xmm2         \n"                         \
+            "psrld   $"#s1", %%xmm3         \n"                         \
+            "pand       %%xmm4, %%xmm2      \n"                         \
+            "pand       %%xmm4, %%xmm3      \n"                         \
+            "packssdw   %%xmm3, %%xmm2      \n"                         \
+            "movdqu     %%xmm2, (%3,%0,2)   \n"                         \
+            "psrld   $"#s2", %%xmm0         \n"                         \
+            "psrld   $"#s2", %%xmm1         \n"                         \
+            "pand       %%xmm4, %%xmm0      \n"                         \
+            "pand       %%xmm4, %%xmm1      \n"                         \
+            "packssdw   %%xmm1, %%xmm0      \n"                         \
+            "movdqu     %%xmm0, (%4,%0,2)   \n"                         \
+            "add            $8, %0          \n"                         \
+            "cmp            %1, %0          \n"                         \
+            "jl 1b                          \n"                         \
+            :"+&r"(i)                                                   \
+            :"r"(n), "r"(dst0), "r"(dst1), "r"(dst2), "r"(src),         \
+             "m"(*pd_3ff)                                               \
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",) \
+             "memory"                                                   \
+        );                                                              \
+    }                                                                   \
+    for (i = n; i < words; i++) {                                       \
+        unsigned w = big ? AV_RB32(src + 4 * i) : AV_RL32(src + 4 * i); \
+        dst0[i] = w >> s0 & 0x3ff;                                      \
+        dst1[i] = w >> s1 & 0x3ff;                                      \
+        dst2[i] = w >> s2 & 0x3ff;                                      \
+    }                                                                   \
+}
+
+#if HAVE_SSSE3
+UNPACK10_PLANAR(a_le, 0, 0, "", 22, 12, 2)
+UNPACK10_PLANAR(a_be, 0, 1, BSWAP32("%%xmm0", "%%xmm5") BSWAP32("%%xmm1", "%%xmm5"), 22, 12, 2)
+UNPACK10_PLANAR(b_le, 1, 0, "", 20, 10, 0)
+UNPACK10_PLANAR(b_be, 1, 1, BSWAP32("%%xmm0", "%%xmm5") BSWAP32("%%xmm1", "%%xmm5"), 20, 10, 0)
+
+#define UNPACK12B(name, big, bswap)                                     \
+static void unpack12b_ ## name ## _sse2(uint16_t *dst, const uint8_t *src, int samples) \
+{                                                                       \
+    x86_reg i = 0, n = samples & ~7;                                    \
+                                                                        \
+    if (n > 0) {                                                        \
+        __asm__ volatile(                                               \
+            "movdqa         %4, %%xmm2      \n"                         \
+            "1:                             \n"                         \
+            "movdqu (%3,%0,2), %%xmm0       \n"                         \
+            bswap                                                       \
+            "pand       %%xmm2, %%xmm0      \n"                         \
+            "movdqa     %%xmm0, %%xmm1      \n"                         \
+            "psllw          $4, %%xmm0      \n"                         \
+            "psrlw          $8, %%xmm1      \n"                         \
+            "por        %%xmm1, %%xmm0      \n"                         \
+            "movdqu     %%xmm0, (%2,%0,2)   \n"                         \
+            "add            $8, %0          \n"                         \
+            "cmp            %1, %0          \n"                         \
+            "jl 1b                          \n"                         \
+            :"+&r"(i)                                                   \
+            :"r"(n), "r"(dst), "r"(src), "m"(*pw_fff)                   \
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)          \
+             "memory"                                                   \
+        );                                                              \
+    }                                                                   \
+    for (i = n; i < samples; i++) {                                     \
+        unsigned v = (big ? AV_RB16(src + 2 * i) : AV_RL16(src + 2 * i)) & 0xfff; \
+        dst[i] = v << 4 | v >> 8;                                       \
+    }                                                                   \
+}
+
+UNPACK12B(le, 0, "")
+UNPACK12B(be, 1, BSWAP16("%%xmm0", "%%xmm3"))
+
+static av_always_inline void pack10_ssse3(uint8_t *dst, const uint8_t *src, int words,
+                                          int src_big, int big)
+{
+    x86_reg n = words & ~3;
+    int i;
+
+    if (n > 0) {
+        __asm__ volatile(
+            "1:                             \n"
+            "movdqu       (%1), %%xmm0      \n"
+            "movq       16(%1), %%xmm1      \n"
+            "movdqa     %%xmm0, %%xmm2      \n"
+            "movdqa     %%xmm1, %%xmm3      \n"
+            "pshufb       (%3), %%xmm2      \n"
+            "pshufb     16(%3), %%xmm3      \n"
+            "por        %%xmm3, %%xmm2      \n"
+            "pand           %5, %%xmm2      \n"
+            "movdqa     %%xmm0, %%xmm3      \n"
+            "movdqa     %%xmm1, %%xmm4      \n"
+            "pshufb     32(%3), %%xmm3      \n"
+            "pshufb     48(%3), %%xmm4      \n"
+            "por        %%xmm4, %%xmm3      \n"
+            "pand           %6, %%xmm3      \n"
+            "pslld          $6, %%xmm3      \n"
+            "por        %%xmm3, %%xmm2      \n"
+            "pshufb     64(%3), %%xmm0      \n"
+            "pshufb     80(%3), %%xmm1      \n"
+            "por        %%xmm1, %%xmm0      \n"
+            "pand           %6, %%xmm0      \n"
+            "psrld          $4, %%xmm0      \n"
+            "por        %%xmm0, %%xmm2      \n"
+            "test           %4, %4          \n"
+            "jz 2f                          \n"
+            "pshufb         %7, %%xmm2      \n"
+            "2:                             \n"
+            "movdqu     %%xmm2, (%2)        \n"
+            "add           $24, %1          \n"
+            "add           $16, %2          \n"
+            "sub            $4, %0          \n"
+            "jg 1b                          \n"
+            :"+r"(n), "+r"(src), "+r"(dst)
+            :"r"(pack10_shuf[src_big]), "r"((x86_reg)big),
+             "m"(*pd_ffc00000), "m"(*pd_ffc0), "m"(*bswap32_shuf)
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",)
+             "memory"
+        );
+    }
+    for (i = 0; i < (words & 3); i++) {
+        unsigned r = src_big ? AV_RB16(src + 6 * i + 0) : AV_RL16(src + 6 * i + 0);
+        unsigned g = src_big ? AV_RB16(src + 6 * i + 2) : AV_RL16(src + 6 * i + 2);
+        unsigned b = src_big ? AV_RB16(src + 6 * i + 4) : AV_RL16(src + 6 * i + 4);
+        unsigned w = (r & 0xFFC0U) << 16 | (g & 0xFFC0U) << 6 | (b & 0xFFC0U) >> 4;
+        if (big) AV_WB32(dst + 4 * i, w);
+        else     AV_WL32(dst + 4 * i, w);
+    }
+}
+
+#define PACK10(name, src_big, big)                                      \
+static void pack10_ ## name ## _ssse3(uint8_t *dst, const uint8_t *src, int words) \
+{                                                                       \
+    pack10_ssse3(dst, src, words, src_big, big);                        \
+}
+
+PACK10(le_le, 0, 0)
+PACK10(le_be, 0, 1)
+PACK10(be_le, 1, 0)
+PACK10(be_be, 1, 1)
+
+#define PACK10_PLANAR(name, big, bswap)                                 \
+static void pack10_planar_ ## name ## _sse2(uint8_t *dst, const uint16_t *src0, \
+                                            const uint16_t *src1,       \
+                                            const uint16_t *src2, int words) \
+{                                                                       \
+    x86_reg i = 0, n = words & ~7;                                      \
+                                                                        \
+    if (n > 0) {                                                        \
+        __asm__ volatile(                                               \
+            "pxor       %%xmm7, %%xmm7      \n"                         \
+            "movdqa         %6, %%xmm6      \n"                         \
+            "1:                             \n"                         \
+            "movdqu (%3,%0,2), %%xmm0       \n"                         \
+            "movdqu (%4,%0,2), %%xmm1       \n"                         \
+            "movdqu (%5,%0,2), %%xmm2       \n"                         \
+            "pand       %%xmm6, %%xmm0      \n"                         \
+            "pand       %%xmm6, %%xmm1      \n"                         \
+            "pand       %%xmm6, %%xmm2      \n"                         \
+            "movdqa     %%xmm0, %%xmm3      \n"                         \
+            "punpcklwd  %%xmm7, %%xmm0      \n"                         \
+            "punpckhwd  %%xmm7, %%xmm3      \n"                         \
+            "pslld         $22, %%xmm0      \n"                         \
+            "pslld         $22, %%xmm3      \n"                         \
+            "movdqa     %%xmm1, %%xmm4      \n"                         \
+            "punpcklwd  %%xmm7, %%xmm1      \n"                         \
+            "punpckhwd  %%xmm7, %%xmm4      \n"                         \
+            "pslld         $12, %%xmm1      \n"                         \
+            "pslld         $12, %%xmm4      \n"                         \
+            "por        %%xmm1, %%xmm0      \n"                         \
+            "por        %%xmm4, %%xmm3      \n"                         \
+            "movdqa     %%xmm2, %%xmm4      \n"                         \
+            "punpcklwd  %%xmm7, %%xmm2      \n"                         \
+            "punpckhwd  %%xmm7, %%xmm4      \n"                         \
+            "pslld          $2, %%xmm2      \n"                         \
+            "pslld          $2, %%xmm4      \n"                         \
+            "por        %%xmm2, %%xmm0      \n"                         \
+            "por        %%xmm4, %%xmm3      \n"                         \
+            bswap                                                       \
+            "movdqu     %%xmm0,   (%2,%0,4) \n"                         \
+            "movdqu     %%xmm3, 16(%2,%0,4) \n"                         \
+            "add            $8, %0          \n"                         \
+            "cmp            %1, %0          \n"                         \
+            "jl 1b                          \n"                         \
+            :"+&r"(i)                                                   \
+            :"r"(n), "r"(dst), "r"(src0), "r"(src1), "r"(src2),         \
+             "m"(*pw_3ff)                                               \
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",  \
+                          "%xmm5", "%xmm6", "%xmm7",)                   \
+             "memory"                                                   \
+        );                                                              \
+    }                                                                   \
+    for (i = n; i < words; i++) {                                       \
+        unsigned w = (src0[i] & 0x3ffU) << 22 | (src1[i] & 0x3ffU) << 12 | \
+                     (src2[i] & 0x3ffU) << 2;                           \
+        if (big) AV_WB32(dst + 4 * i, w);                               \
+        else     AV_WL32(dst + 4 * i, w);                               \
+    }                                                                   \
+}
+
+PACK10_PLANAR(le, 0, "")
+PACK10_PLANAR(be, 1, BSWAP32("%%xmm0", "%%xmm5") BSWAP32("%%xmm3", "%%xmm5"))
+#endif /* HAVE_SSSE3 */
+
+void ff_dpxdsp_init_x86(DPXDSPContext *c, int cpu_flags)
+{
+#if HAVE_SSSE3
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        c->unpack10_planar[0][0] = unpack10_planar_a_le_sse2;
+        c->unpack10_planar[0][1] = unpack10_planar_a_be_sse2;
+        c->unpack10_planar[1][0] = unpack10_planar_b_le_sse2;
+        c->unpack10_planar[1][1] = unpack10_planar_b_be_sse2;
+        c->unpack12b[0] = unpack12b_le_sse2;
+        c->unpack12b[1] = unpack12b_be_sse2;
+        c->pack10_planar[0] = pack10_planar_le_sse2;
+        c->pack10_planar[1] = pack10_planar_be_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_SSSE3) {
+        c->unpack10[0][0] = unpack10_a_le_ssse3;
+        c->unpack10[0][1] = unpack10_a_be_ssse3;
+        c->unpack10[1][0] = unpack10_b_le_ssse3;
+        c->unpack10[1][1] = unpack10_b_be_ssse3;
+        c->pack10[0][0] = pack10_le_le_ssse3;
+        c->pack10[0][1] = pack10_le_be_ssse3;
+        c->pack10[1][0] = pack10_be_le_ssse3;
+        c->pack10[1][1] = pack10_be_be_ssse3;
+    }
+#endif
+}
@@ -711,6 +711,90 @@ static int vsad_intra16_mmx2(void *v, uint8_t * pix, uint8_t * dummy, int line_s
 }
 #undef SUM
 
+static int vsad_intra8_mmx(void *v, uint8_t * pix, uint8_t * dummy, int line_size, int h) {
+    int tmp;
+
+    assert( (((int)pix) & 7) == 0);
+    assert((line_size &7) ==0);
+
+#define SUM(in0, out0) \
+      "movq (%0), %%mm2\n"\
+      "add %2,%0\n"\
+      "movq %%mm2, " #out0 "\n"\
+      "psubusb " #in0 ", %%mm2\n"\
+      "psubusb " #out0 ", " #in0 "\n"\
+      "por %%mm2, " #in0 "\n"\
+      "movq " #in0 ", %%mm2\n"\
+      "punpcklbw %%mm7, " #in0 "\n"\
+      "punpckhbw %%mm7, %%mm2\n"\
+      "paddw %%mm2, " #in0 "\n"\
+      "paddw " #in0 ", %%mm6\n"
+
+  __asm__ volatile (
+      "movl %3,%%ecx\n"
+      "pxor %%mm6,%%mm6\n"
+      "pxor %%mm7,%%mm7\n"
+      "movq (%0),%%mm0\n"
+      "add %2,%0\n"
+      "jmp 2f\n"
+      "1:\n"
+
+      SUM(%%mm4, %%mm0)
+      "2:\n"
+      SUM(%%mm0, %%mm4)
+
+      "subl $2, %%ecx\n"
+      "jnz 1b\n"
+
+      "movq %%mm6,%%mm0\n"
+      "psrlq $32, %%mm6\n"
+      "paddw %%mm6,%%mm0\n"
+      "movq %%mm0,%%mm6\n"
+      "psrlq $16, %%mm0\n"
+      "paddw %%mm6,%%mm0\n"
+      "movd %%mm0,%1\n"
+      : "+r" (pix), "=r"(tmp)
+      : "r" ((x86_reg)line_size) , "m" (h)
+      : "%ecx");
+    return tmp & 0xFFFF;
+}
+#undef SUM
+
+static int vsad_intra8_mmx2(void *v, uint8_t * pix, uint8_t * dummy, int line_size, int h) {
+    int tmp;
+
+    assert( (((int)pix) & 7) == 0);
+    assert((line_size &7) ==0);
+
+#define SUM(in0, out0) \
+      "movq (%0), " #out0 "\n"\
+      "add %2,%0\n"\
+      "psadbw " #out0 ", " #in0 "\n"\
+      "paddw " #in0 ", %%mm6\n"
+
+  __asm__ volatile (
+      "movl %3,%%ecx\n"
+      "pxor %%mm6,%%mm6\n"
+      "movq (%0),%%mm0\n"
+      "add %2,%0\n"
+      "jmp 2f\n"
+      "1:\n"
+
+      SUM(%%mm4, %%mm0)
+      "2:\n"
+      SUM(%%mm0, %%mm4)
+
+      "subl $2, %%ecx\n"
+      "jnz 1b\n"
+
+      "movd %%mm6,%1\n"
+      : "+r" (pix), "=r"(tmp)
+      : "r" ((x86_reg)line_size) , "m" (h)
+      : "%ecx");
+    return tmp;
+}
+#undef SUM
+
 static int vsad16_mmx(void *v, uint8_t * pix1, uint8_t * pix2, int line_size, int h) {
     int tmp;
 
@@ -1160,6 +1244,7 @@ void dsputilenc_init_mmx(DSPContext* c, AVCodecContext *avctx)
         c->sse[0] = (HAVE_YASM && mm_flags & AV_CPU_FLAG_SSE2) ? ff_sse16_sse2 : sse16_mmx;
           c->sse[1] = sse8_mmx;
         c->vsad[4]= vsad_intra16_mmx;
+        c->vsad[5]= vsad_intra8_mmx;
 
         c->nsse[0] = nsse16_mmx;
         c->nsse[1] = nsse8_mmx;
@@ -1182,6 +1267,7 @@ void dsputilenc_init_mmx(DSPContext* c, AVCodecContext *avctx)
             c->hadamard8_diff[1]= ff_hadamard8_diff_mmx2;
 #endif
             c->vsad[4]= vsad_intra16_mmx2;
+            c->vsad[5]= vsad_intra8_mmx2;
 
             if(!(avctx->flags & CODEC_FLAG_BITEXACT)){
                 c->vsad[0] = vsad16_mmx2;
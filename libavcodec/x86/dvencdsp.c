@@ -0,0 +1,168 @@
+/*
+ * DV encoder coefficient weighting and quantization, SSE2
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/dvencdsp.h"
+
+#if HAVE_SSE
+DECLARE_ALIGNED(16, static const uint16_t, pw_15)[8] = {
+    15, 15, 15, 15, 15, 15, 15, 15
+};
+DECLARE_ALIGNED(16, static const uint16_t, pw_255)[8] = {
+    255, 255, 255, 255, 255, 255, 255, 255
+};
+DECLARE_ALIGNED(16, static const uint16_t, pw_16896)[8] = {
+    16896, 16896, 16896, 16896, 16896, 16896, 16896, 16896
+};
+
+/*
+ * 4 levels as dwords in a times the weights at w: pmuludq multiplies the
+ * even dwords, so the odd ones are shifted down and multiplied apart,
+ * then both are rounded and shifted in the qwords and put back together.
+ */
+#define MUL_WEIGHT(a, w)                        \
+    "movdqu      " w ", %%xmm3          \n"     \
+    "movdqa      " a ", %%xmm4          \n"     \
+    "psrlq         $32, %%xmm4          \n"     \
+    "pmuludq    %%xmm3, " a "           \n"     \
+    "psrlq         $32, %%xmm3          \n"     \
+    "pmuludq    %%xmm3, %%xmm4          \n"     \
+    "paddq      %%xmm6, " a "           \n"     \
+    "paddq      %%xmm6, %%xmm4          \n"     \
+    "psrlq      %%xmm5, " a "           \n"     \
+    "psrlq      %%xmm5, %%xmm4          \n"     \
+    "psllq         $32, %%xmm4          \n"     \
+    "por        %%xmm4, " a "           \n"
+
+static uint64_t weigh_sse2(DCTELEM *dst, uint8_t *sign, const DCTELEM *src,
+                           const int *weight, int bias, int shift)
+{
+    uint64_t mask = 0, bias64 = bias;
+    int i, small;
+
+    for (i = 0; i < 64; i += 8) {
+        __asm__ volatile(
+            "movq           %5, %%xmm6          \n"
+            "punpcklqdq %%xmm6, %%xmm6          \n"
+            "movd           %6, %%xmm5          \n"
+            "pxor       %%xmm7, %%xmm7          \n"
+            "movdqu       (%2), %%xmm0          \n"
+            "movdqa     %%xmm0, %%xmm1          \n"
+            "psraw         $15, %%xmm1          \n"
+            "pxor       %%xmm1, %%xmm0          \n"
+            "psubw      %%xmm1, %%xmm0          \n"
+            "packsswb   %%xmm1, %%xmm1          \n"
+            "pxor       %%xmm2, %%xmm2          \n"
+            "psubb      %%xmm1, %%xmm2          \n"
+            "movq       %%xmm2, (%4)            \n"
+            /* unsigned compare of the levels with 15 */
+            "movdqa     %%xmm0, %%xmm1          \n"
+            "psubusw        %7, %%xmm1          \n"
+            "pcmpeqw    %%xmm7, %%xmm1          \n"
+            "packsswb   %%xmm1, %%xmm1          \n"
+            "pmovmskb   %%xmm1, %0              \n"
+            "movdqa     %%xmm0, %%xmm2          \n"
+            "punpcklwd  %%xmm7, %%xmm0          \n"
+            "punpckhwd  %%xmm7, %%xmm2          \n"
+            MUL_WEIGHT("%%xmm0", "(%3)")
+            MUL_WEIGHT("%%xmm2", "16(%3)")
+            "packssdw   %%xmm2, %%xmm0          \n"
+            "movdqu     %%xmm0, (%1)            \n"
+            :"=r"(small)
+            :"r"(dst + i), "r"(src + i), "r"(weight + i), "r"(sign + i),
+             "m"(bias64), "r"(shift), "m"(*pw_15)
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                          "%xmm5", "%xmm6", "%xmm7",)
+             "memory"
+        );
+        mask |= (uint64_t)(~small & 0xff) << i;
+    }
+    return mask;
+}
+
+/*
+ * (level * qsinv + 1024 + (1 << 15)) >> 16 is the high word of the
+ * product plus the carry of adding 33792 to the low word, which is
+ * ((low >> 1) + 16896) >> 15. A qsinv of 65536 is replaced by 65535,
+ * which gives the same result for levels up to 33792.
+ */
+static uint64_t quantize_hd_sse2(DCTELEM *dst, const DCTELEM *src, int qsinv, int cno)
+{
+    uint64_t mask = 0;
+    int i, zero, q = FFMIN(qsinv, 65535);
+
+    for (i = 0; i < 64; i += 16) {
+        __asm__ volatile(
+            "movd           %3, %%xmm5          \n"
+            "pshuflw $0, %%xmm5, %%xmm5         \n"
+            "punpcklqdq %%xmm5, %%xmm5          \n"
+            "movd           %4, %%xmm6          \n"
+            "movdqa         %5, %%xmm4          \n"
+            "pxor       %%xmm7, %%xmm7          \n"
+            "movdqu       (%2), %%xmm0          \n"
+            "movdqu     16(%2), %%xmm2          \n"
+            "movdqa     %%xmm0, %%xmm1          \n"
+            "movdqa     %%xmm2, %%xmm3          \n"
+            "pmullw     %%xmm5, %%xmm0          \n"
+            "pmullw     %%xmm5, %%xmm2          \n"
+            "pmulhuw    %%xmm5, %%xmm1          \n"
+            "pmulhuw    %%xmm5, %%xmm3          \n"
+            "psrlw          $1, %%xmm0          \n"
+            "psrlw          $1, %%xmm2          \n"
+            "paddw      %%xmm4, %%xmm0          \n"
+            "paddw      %%xmm4, %%xmm2          \n"
+            "psrlw         $15, %%xmm0          \n"
+            "psrlw         $15, %%xmm2          \n"
+            "paddw      %%xmm1, %%xmm0          \n"
+            "paddw      %%xmm3, %%xmm2          \n"
+            "psrlw      %%xmm6, %%xmm0          \n"
+            "psrlw      %%xmm6, %%xmm2          \n"
+            "pminsw         %6, %%xmm0          \n"
+            "pminsw         %6, %%xmm2          \n"
+            "movdqu     %%xmm0,   (%1)          \n"
+            "movdqu     %%xmm2, 16(%1)          \n"
+            "pcmpeqw    %%xmm7, %%xmm0          \n"
+            "pcmpeqw    %%xmm7, %%xmm2          \n"
+            "packsswb   %%xmm2, %%xmm0          \n"
+            "pmovmskb   %%xmm0, %0              \n"
+            :"=r"(zero)
+            :"r"(dst + i), "r"(src + i), "r"(q), "r"(cno),
+             "m"(*pw_16896), "m"(*pw_255)
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                          "%xmm5", "%xmm6", "%xmm7",)
+             "memory"
+        );
+        mask |= (uint64_t)(~zero & 0xffff) << i;
+    }
+    return mask;
+}
+#endif /* HAVE_SSE */
+
+void ff_dvencdsp_init_x86(DVEncDSPContext *c, int cpu_flags)
+{
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        c->weigh       = weigh_sse2;
+        c->quantize_hd = quantize_hd_sse2;
+    }
+#endif
+}
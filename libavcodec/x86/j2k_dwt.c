@@ -0,0 +1,132 @@
+/*
+ * Discrete wavelet transform, SSE and SSE2 lifting steps
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/j2k_dwt.h"
+
+/*
+ * A group of FF_DWT_STRIP = 8 samples is 32 bytes, 2 registers. The
+ * neighbours of the group at (%0) are at -32(%0) and 32(%0), and the next
+ * group to update is at 64(%0).
+ */
+
+#if HAVE_SSE
+DECLARE_ALIGNED(16, static const uint32_t, pd_2)[4] = { 2, 2, 2, 2 };
+
+static void sr53_even_sse2(int *p, int n)
+{
+    if (n <= 0)
+        return;
+    __asm__ volatile(
+        "movdqa         %2, %%xmm6      \n"
+        "1:                             \n"
+        "movdqa    -32(%0), %%xmm0      \n"
+        "movdqa    -16(%0), %%xmm1      \n"
+        "paddd      32(%0), %%xmm0      \n"
+        "paddd      48(%0), %%xmm1      \n"
+        "paddd      %%xmm6, %%xmm0      \n"
+        "paddd      %%xmm6, %%xmm1      \n"
+        "psrad          $2, %%xmm0      \n"
+        "psrad          $2, %%xmm1      \n"
+        "movdqa       (%0), %%xmm2      \n"
+        "movdqa     16(%0), %%xmm3      \n"
+        "psubd      %%xmm0, %%xmm2      \n"
+        "psubd      %%xmm1, %%xmm3      \n"
+        "movdqa     %%xmm2,   (%0)      \n"
+        "movdqa     %%xmm3, 16(%0)      \n"
+        "add           $64, %0          \n"
+        "dec            %1              \n"
+        "jnz 1b                         \n"
+        :"+r"(p), "+r"(n)
+        :"m"(*pd_2)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm6",)
+         "memory"
+    );
+}
+
+static void sr53_odd_sse2(int *p, int n)
+{
+    if (n <= 0)
+        return;
+    __asm__ volatile(
+        "1:                             \n"
+        "movdqa    -32(%0), %%xmm0      \n"
+        "movdqa    -16(%0), %%xmm1      \n"
+        "paddd      32(%0), %%xmm0      \n"
+        "paddd      48(%0), %%xmm1      \n"
+        "psrad          $1, %%xmm0      \n"
+        "psrad          $1, %%xmm1      \n"
+        "paddd        (%0), %%xmm0      \n"
+        "paddd      16(%0), %%xmm1      \n"
+        "movdqa     %%xmm0,   (%0)      \n"
+        "movdqa     %%xmm1, 16(%0)      \n"
+        "add           $64, %0          \n"
+        "dec            %1              \n"
+        "jnz 1b                         \n"
+        :"+r"(p), "+r"(n)
+        :
+        :XMM_CLOBBERS("%xmm0", "%xmm1",)
+         "memory"
+    );
+}
+
+/* same operation order as the C version, c * (a + b) + p */
+static void lift97_sse(float *p, int n, float c)
+{
+    if (n <= 0)
+        return;
+    __asm__ volatile(
+        "movss          %2, %%xmm7      \n"
+        "shufps   $0, %%xmm7, %%xmm7    \n"
+        "1:                             \n"
+        "movaps    -32(%0), %%xmm0      \n"
+        "movaps    -16(%0), %%xmm1      \n"
+        "addps      32(%0), %%xmm0      \n"
+        "addps      48(%0), %%xmm1      \n"
+        "mulps      %%xmm7, %%xmm0      \n"
+        "mulps      %%xmm7, %%xmm1      \n"
+        "addps        (%0), %%xmm0      \n"
+        "addps      16(%0), %%xmm1      \n"
+        "movaps     %%xmm0,   (%0)      \n"
+        "movaps     %%xmm1, 16(%0)      \n"
+        "add           $64, %0          \n"
+        "dec            %1              \n"
+        "jnz 1b                         \n"
+        :"+r"(p), "+r"(n)
+        :"m"(c)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm7",)
+         "memory"
+    );
+}
+#endif /* HAVE_SSE */
+
+void ff_j2k_dwt_init_lifting_x86(DWTContext *s, int cpu_flags)
+{
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        s->sr53_even = sr53_even_sse2;
+        s->sr53_odd  = sr53_odd_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_SSE)
+        s->lift97 = lift97_sse;
+#endif
+}
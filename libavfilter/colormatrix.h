@@ -0,0 +1,84 @@
+/*
+ * Color matrix conversion DSP functions
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_COLORMATRIX_H
+#define AVFILTER_COLORMATRIX_H
+
+#include <stdint.h>
+#include "libavutil/mem.h"
+
+/**
+ * Coefficients of one conversion, scaled by 65536:
+ * Y' = Y + c[0] * u + c[1] * v
+ * U' =     c[2] * u + c[3] * v
+ * V' =     c[4] * u + c[5] * v
+ * with u and v the chroma samples minus their zero level.
+ */
+typedef struct ColorMatrixCoeffs {
+    int c[6];
+    /** c[] split in c = hi * 65536 + lo, lo in [-32768;32767], as
+     *  interleaved (u, v) pairs of words for pmaddwd */
+    DECLARE_ALIGNED(16, int16_t, lo)[3][8];
+    DECLARE_ALIGNED(16, int16_t, hi)[3][8];
+} ColorMatrixCoeffs;
+
+/**
+ * Line functions, chroma_w is the number of chroma samples and each
+ * chroma sample covers 2 luma samples. Conversions may be done in place,
+ * the luma of a line must then be converted before its chroma.
+ * The 10 bits functions work on 16-bit words.
+ */
+typedef struct ColorMatrixDSPContext {
+    void (*luma_line)(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                      const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+    void (*chroma_line)(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                        const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+    void (*uyvy_line)(uint8_t *dst, const uint8_t *src, int chroma_w,
+                      const ColorMatrixCoeffs *cm);
+    void (*luma10_line)(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                        const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+    void (*chroma10_line)(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                          const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+} ColorMatrixDSPContext;
+
+void ff_colormatrix_init_coeffs(ColorMatrixCoeffs *cm, const int c[6]);
+void ff_colormatrix_init_dsp(ColorMatrixDSPContext *dsp, int cpu_flags);
+
+void ff_colormatrix_luma_line_c(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                                const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+void ff_colormatrix_chroma_line_c(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                                  const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+void ff_colormatrix_uyvy_line_c(uint8_t *dst, const uint8_t *src, int chroma_w,
+                                const ColorMatrixCoeffs *cm);
+void ff_colormatrix_luma10_line_c(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                                  const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+void ff_colormatrix_chroma10_line_c(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                                    const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+
+void ff_colormatrix_luma_line_sse2(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                                   const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+void ff_colormatrix_chroma_line_sse2(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                                     const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+void ff_colormatrix_uyvy_line_sse2(uint8_t *dst, const uint8_t *src, int chroma_w,
+                                   const ColorMatrixCoeffs *cm);
+void ff_colormatrix_luma10_line_sse2(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                                     const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+void ff_colormatrix_chroma10_line_sse2(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                                       const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm);
+
+#endif /* AVFILTER_COLORMATRIX_H */
@@ -16,8 +16,11 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
 #include "libavutil/avutil.h"
 #include "libavutil/colorspace.h"
+#include "libavutil/cpu.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/pixdesc.h"
 #include "drawutils.h"
 
@@ -71,6 +74,7 @@ int ff_fill_line_with_color(uint8_t *line[4], int pixel_step[4], int w, uint8_t
             memcpy(rgba_map_ptr, rgba_map, sizeof(rgba_map[0]) * 4);
     } else {
         int plane;
+        int depth = pix_desc->comp[0].depth_minus1 + 1;
 
         dst_color[0] = RGB_TO_Y_CCIR(rgba_color[0], rgba_color[1], rgba_color[2]);
         dst_color[1] = RGB_TO_U_CCIR(rgba_color[0], rgba_color[1], rgba_color[2], 0);
@@ -81,10 +85,16 @@ int ff_fill_line_with_color(uint8_t *line[4], int pixel_step[4], int w, uint8_t
             int line_size;
             int hsub1 = (plane == 1 || plane == 2) ? hsub : 0;
 
-            pixel_step[plane] = 1;
+            pixel_step[plane] = depth > 8 ? 2 : 1;
             line_size = (w >> hsub1) * pixel_step[plane];
             line[plane] = av_malloc(line_size);
-            memset(line[plane], dst_color[plane], line_size);
+            if (depth > 8) {
+                /* native endian samples in 16-bit containers */
+                uint16_t *p = (uint16_t *)line[plane];
+                for (i = 0; i < w >> hsub1; i++)
+                    p[i] = dst_color[plane] << (depth - 8);
+            } else
+                memset(line[plane], dst_color[plane], line_size);
         }
     }
 
@@ -137,15 +147,27 @@ int ff_draw_init(FFDrawContext *draw, enum PixelFormat format, unsigned flags)
     const AVComponentDescriptor *c;
     unsigned i, nb_planes = 0;
     int pixelstep[MAX_PLANES] = { 0 };
+    int depth;
 
     if (!desc->name)
         return AVERROR(EINVAL);
-    if (desc->flags & ~(PIX_FMT_PLANAR | PIX_FMT_RGB))
+    if (desc->flags & ~(PIX_FMT_PLANAR | PIX_FMT_RGB | PIX_FMT_BE))
+        return AVERROR(ENOSYS);
+    depth = desc->comp[0].depth_minus1 + 1;
+    if (depth > 8) {
+        /* deeper formats only as planar YUV with native endian
+           samples, each in its own 16-bit container */
+        if (!(desc->flags & PIX_FMT_PLANAR) || (desc->flags & PIX_FMT_RGB) ||
+            !(desc->flags & PIX_FMT_BE) != !AV_HAVE_BIGENDIAN || depth > 16)
+            return AVERROR(ENOSYS);
+    } else if (depth != 8 || (desc->flags & PIX_FMT_BE))
         return AVERROR(ENOSYS);
     for (i = 0; i < desc->nb_components; i++) {
         c = &desc->comp[i];
-        /* for now, only 8-bits formats */
-        if (c->depth_minus1 != 8 - 1)
+        /* 8 bits formats, or all components in 16 bits words */
+        if (c->depth_minus1 + 1 != depth)
+            return AVERROR(ENOSYS);
+        if (depth > 8 && (c->step_minus1 != 1 || c->shift || c->offset_plus1 != 1))
             return AVERROR(ENOSYS);
         if (c->plane >= MAX_PLANES)
             return AVERROR(ENOSYS);
@@ -161,6 +183,7 @@ int ff_draw_init(FFDrawContext *draw, enum PixelFormat format, unsigned flags)
     if ((desc->log2_chroma_w || desc->log2_chroma_h) && nb_planes < 3)
         return AVERROR(ENOSYS); /* exclude NV12 and NV21 */
     memset(draw, 0, sizeof(*draw));
+    ff_blend_init_dsp(&draw->blend, av_get_cpu_flags());
     draw->desc      = desc;
     draw->format    = format;
     draw->nb_planes = nb_planes;
@@ -186,6 +209,14 @@ void ff_draw_color(FFDrawContext *draw, FFDrawColor *color, uint8_t rgba[4])
         ff_fill_rgba_map(rgba_map, draw->format) >= 0) {
         for (i = 0; i < 4; i++)
             color->comp[0].u8[rgba_map[i]] = rgba[i];
+    } else if ((draw->nb_planes == 3 || draw->nb_planes == 4) &&
+               draw->pixelstep[0] == 2) {
+        /* YUV, scaled to the depth of the format */
+        int shift = draw->desc->comp[0].depth_minus1 + 1 - 8;
+        color->comp[0].u16 = RGB_TO_Y_CCIR(rgba[0], rgba[1], rgba[2])    << shift;
+        color->comp[1].u16 = RGB_TO_U_CCIR(rgba[0], rgba[1], rgba[2], 0) << shift;
+        color->comp[2].u16 = RGB_TO_V_CCIR(rgba[0], rgba[1], rgba[2], 0) << shift;
+        color->comp[3].u16 = rgba[3] << shift;
     } else if (draw->nb_planes == 3 || draw->nb_planes == 4) {
         /* assume YUV */
         color->comp[0].u8[0] = RGB_TO_Y_CCIR(rgba[0], rgba[1], rgba[2]);
@@ -318,6 +349,44 @@ static void blend_line(uint8_t *dst, unsigned src, unsigned alpha,
     }
 }
 
+/* Same for 16-bit samples, with alpha in the [ 0 ; 0x10000 ] range;
+   the products stay below 2^32 for any sample value. */
+static void blend_line16(uint8_t *dst, unsigned src, unsigned alpha,
+                         int dx, int w, unsigned hsub, int left, int right)
+{
+    unsigned asrc = alpha * src + 0x8000;
+    unsigned tau = 0x10000 - alpha;
+    int x;
+
+    if (left) {
+        unsigned suba = (left * alpha) >> hsub;
+        AV_WN16(dst, (AV_RN16(dst) * (0x10000 - suba) + src * suba + 0x8000) >> 16);
+        dst += dx;
+    }
+    for (x = 0; x < w; x++) {
+        AV_WN16(dst, (AV_RN16(dst) * tau + asrc) >> 16);
+        dst += dx;
+    }
+    if (right) {
+        unsigned suba = (right * alpha) >> hsub;
+        AV_WN16(dst, (AV_RN16(dst) * (0x10000 - suba) + src * suba + 0x8000) >> 16);
+    }
+}
+
+static void blend_line_depth(FFDrawContext *draw, FFDrawColor *color,
+                             uint8_t *dst, int plane, int comp, unsigned alpha,
+                             int w, int left, int right)
+{
+    if (draw->pixelstep[0] == 2)
+        blend_line16(dst, color->comp[plane].u16, alpha,
+                     draw->pixelstep[plane], w,
+                     draw->hsub[plane], left, right);
+    else
+        blend_line(dst, color->comp[plane].u8[comp], alpha,
+                   draw->pixelstep[plane], w,
+                   draw->hsub[plane], left, right);
+}
+
 void ff_blend_rectangle(FFDrawContext *draw, FFDrawColor *color,
                         uint8_t *dst[], int dst_linesize[],
                         int dst_w, int dst_h,
@@ -332,8 +401,11 @@ void ff_blend_rectangle(FFDrawContext *draw, FFDrawColor *color,
     clip_interval(dst_h, &y0, &h, NULL);
     if (w <= 0 || h <= 0 || !color->rgba[3])
         return;
-    /* 0x10203 * alpha + 2 is in the [ 2 ; 0x1010101 - 2 ] range */
-    alpha = 0x10203 * color->rgba[3] + 0x2;
+    if (draw->pixelstep[0] == 2)
+        alpha = (color->rgba[3] * 0x10000 + 127) / 255;
+    else
+        /* 0x10203 * alpha + 2 is in the [ 2 ; 0x1010101 - 2 ] range */
+        alpha = 0x10203 * color->rgba[3] + 0x2;
     nb_planes = (draw->nb_planes - 1) | 1; /* eliminate alpha */
     for (plane = 0; plane < nb_planes; plane++) {
         nb_comp = draw->pixelstep[plane];
@@ -349,28 +421,26 @@ void ff_blend_rectangle(FFDrawContext *draw, FFDrawColor *color,
                 continue;
             p = p0 + comp;
             if (top) {
-                blend_line(p, color->comp[plane].u8[comp], alpha >> 1,
-                           draw->pixelstep[plane], w_sub,
-                           draw->hsub[plane], left, right);
+                blend_line_depth(draw, color, p, plane, comp, alpha >> 1,
+                                 w_sub, left, right);
                 p += dst_linesize[plane];
             }
             for (y = 0; y < h_sub; y++) {
-                blend_line(p, color->comp[plane].u8[comp], alpha,
-                           draw->pixelstep[plane], w_sub,
-                           draw->hsub[plane], left, right);
+                blend_line_depth(draw, color, p, plane, comp, alpha,
+                                 w_sub, left, right);
                 p += dst_linesize[plane];
             }
             if (bottom)
-                blend_line(p, color->comp[plane].u8[comp], alpha >> 1,
-                           draw->pixelstep[plane], w_sub,
-                           draw->hsub[plane], left, right);
+                blend_line_depth(draw, color, p, plane, comp, alpha >> 1,
+                                 w_sub, left, right);
         }
     }
 }
 
-static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
-                        uint8_t *mask, int mask_linesize, int l2depth,
-                        unsigned w, unsigned h, unsigned shift, unsigned xm0)
+static av_always_inline void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
+                                        uint8_t *mask, int mask_linesize, int l2depth,
+                                        unsigned w, unsigned h, unsigned shift, unsigned xm0,
+                                        int depth16)
 {
     unsigned xm, x, y, t = 0;
     unsigned xmshf = 3 - l2depth;
@@ -388,32 +458,237 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
         mask += mask_linesize;
     }
     alpha = (t >> shift) * alpha;
-    *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
+    if (depth16)
+        AV_WN16(dst, ((0x10000 - alpha) * AV_RN16(dst) + alpha * src + 0x8000) >> 16);
+    else
+        *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
 
-static void blend_line_hv(uint8_t *dst, int dst_delta,
-                          unsigned src, unsigned alpha,
-                          uint8_t *mask, int mask_linesize, int l2depth, int w,
-                          unsigned hsub, unsigned vsub,
-                          int xm, int left, int right, int hband)
+static av_always_inline void blend_line_hv_depth(uint8_t *dst, int dst_delta,
+                                                 unsigned src, unsigned alpha,
+                                                 uint8_t *mask, int mask_linesize,
+                                                 int l2depth, int w,
+                                                 unsigned hsub, unsigned vsub,
+                                                 int xm, int left, int right,
+                                                 int hband, int depth16)
 {
     int x;
 
     if (left) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
-                    left, hband, hsub + vsub, xm);
+                    left, hband, hsub + vsub, xm, depth16);
         dst += dst_delta;
         xm += left;
     }
     for (x = 0; x < w; x++) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
-                    1 << hsub, hband, hsub + vsub, xm);
+                    1 << hsub, hband, hsub + vsub, xm, depth16);
         dst += dst_delta;
         xm += 1 << hsub;
     }
     if (right)
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
-                    right, hband, hsub + vsub, xm);
+                    right, hband, hsub + vsub, xm, depth16);
+}
+
+static void blend_line_hv(uint8_t *dst, int dst_delta,
+                          unsigned src, unsigned alpha,
+                          uint8_t *mask, int mask_linesize, int l2depth, int w,
+                          unsigned hsub, unsigned vsub,
+                          int xm, int left, int right, int hband)
+{
+    blend_line_hv_depth(dst, dst_delta, src, alpha, mask, mask_linesize,
+                        l2depth, w, hsub, vsub, xm, left, right, hband, 0);
+}
+
+static void blend_line_hv16(uint8_t *dst, int dst_delta,
+                            unsigned src, unsigned alpha,
+                            uint8_t *mask, int mask_linesize, int l2depth, int w,
+                            unsigned hsub, unsigned vsub,
+                            int xm, int left, int right, int hband)
+{
+    blend_line_hv_depth(dst, dst_delta, src, alpha, mask, mask_linesize,
+                        l2depth, w, hsub, vsub, xm, left, right, hband, 1);
+}
+
+void ff_blend_line_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w)
+{
+    int x;
+
+    for (x = 0; x < w; x++) {
+        unsigned a = alpha[x];
+        if (a)
+            dst[x] = FAST_DIV255(dst[x] * (255 - a) + src[x] * a);
+    }
+}
+
+void ff_blend_line16_c(uint16_t *dst, const uint8_t *src, const uint8_t *alpha,
+                       int w, int shift)
+{
+    int x;
+
+    for (x = 0; x < w; x++) {
+        unsigned a = alpha[x];
+        if (a)
+            dst[x] = FAST_DIV255(dst[x] * (255 - a) + (src[x] << shift) * a);
+    }
+}
+
+void ff_blend_line_premul_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                            int w, int bias)
+{
+    int x;
+
+    for (x = 0; x < w; x++) {
+        int a = alpha[x];
+        if (a)
+            dst[x] = av_clip_uint8(src[x] + FAST_DIV255((dst[x] - bias) * (255 - a)));
+    }
+}
+
+void ff_blend_line16_premul_c(uint16_t *dst, const uint8_t *src, const uint8_t *alpha,
+                              int w, int shift, int bias)
+{
+    int x;
+
+    for (x = 0; x < w; x++) {
+        int a = alpha[x];
+        if (a)
+            dst[x] = av_clip_uintp2((src[x] << shift) +
+                                    FAST_DIV255((int64_t)(dst[x] - bias) * (255 - a)),
+                                    8 + shift);
+    }
+}
+
+void ff_blend_alpha_line_c(uint8_t *dst, const uint8_t *src, int src_linesize,
+                           int w, int hsub, int vsub, int scale)
+{
+    int x, i, j;
+
+    for (x = 0; x < w; x++) {
+        unsigned t = 0;
+        for (j = 0; j < 1 << vsub; j++)
+            for (i = 0; i < 1 << hsub; i++)
+                t += src[j * src_linesize + i];
+        dst[x] = FAST_DIV255((t >> (hsub + vsub)) * scale);
+        src += 1 << hsub;
+    }
+}
+
+void ff_blend_init_dsp(FFBlendDSPContext *dsp, int cpu_flags)
+{
+    dsp->blend_line          = ff_blend_line_c;
+    dsp->blend_line16        = ff_blend_line16_c;
+    dsp->blend_line_premul   = ff_blend_line_premul_c;
+    dsp->blend_line16_premul = ff_blend_line16_premul_c;
+    dsp->alpha_line          = ff_blend_alpha_line_c;
+
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        dsp->blend_line          = ff_blend_line_sse2;
+        dsp->blend_line16        = ff_blend_line16_sse2;
+        dsp->blend_line_premul   = ff_blend_line_premul_sse2;
+        dsp->blend_line16_premul = ff_blend_line16_premul_sse2;
+        dsp->alpha_line          = ff_blend_alpha_line_sse2;
+    }
+#endif
+}
+
+#define BLEND_CHUNK 512
+
+/* alpha of a block of the mask, of which only cols x rows samples may be
+   inside the mask, out of 1 << sub */
+static unsigned mask_alpha(const uint8_t *mask, int mask_linesize,
+                           int cols, int rows, unsigned sub, unsigned scale)
+{
+    unsigned t = 0;
+    int x, y;
+
+    for (y = 0; y < rows; y++)
+        for (x = 0; x < cols; x++)
+            t += mask[y * mask_linesize + x];
+    return FAST_DIV255((t >> sub) * scale);
+}
+
+static void blend_samples(FFDrawContext *draw, uint8_t *dst,
+                          const uint8_t *src, const uint8_t *alpha, int w)
+{
+    int depth = draw->desc->comp[0].depth_minus1 + 1;
+
+    if (depth > 8)
+        draw->blend.blend_line16((uint16_t *)dst, src, alpha, w, depth - 8);
+    else
+        draw->blend.blend_line(dst, src, alpha, w);
+}
+
+/* 8-bit mask on a plane with one sample per pixel, with the line functions */
+static void blend_line_hv_dsp(FFDrawContext *draw, int plane, uint8_t *dst,
+                              const uint8_t *color, unsigned scale,
+                              const uint8_t *mask, int mask_linesize, int w,
+                              int left, int right, int hband)
+{
+    unsigned hsub = draw->hsub[plane], vsub = draw->vsub[plane];
+    int step = draw->pixelstep[plane];
+    uint8_t alpha[BLEND_CHUNK];
+    int x, i, n;
+
+    if (left) {
+        alpha[0] = mask_alpha(mask, mask_linesize, left, hband,
+                              hsub + vsub, scale);
+        blend_samples(draw, dst, color, alpha, 1);
+        dst  += step;
+        mask += left;
+    }
+    for (x = 0; x < w; x += n) {
+        n = FFMIN(w - x, BLEND_CHUNK);
+        if (hband == 1 << vsub) {
+            draw->blend.alpha_line(alpha, mask, mask_linesize, n,
+                                   hsub, vsub, scale);
+        } else {
+            for (i = 0; i < n; i++)
+                alpha[i] = mask_alpha(mask + (i << hsub), mask_linesize,
+                                      1 << hsub, hband, hsub + vsub, scale);
+        }
+        blend_samples(draw, dst, color, alpha, n);
+        dst  += n * step;
+        mask += n << hsub;
+    }
+    if (right) {
+        alpha[0] = mask_alpha(mask, mask_linesize, right, hband,
+                              hsub + vsub, scale);
+        blend_samples(draw, dst, color, alpha, 1);
+    }
+}
+
+static void blend_mask_dsp(FFDrawContext *draw, FFDrawColor *color,
+                           int plane, uint8_t *p, int dst_linesize,
+                           const uint8_t *m, int mask_linesize,
+                           int w_sub, int h_sub, int left, int right,
+                           int top, int bottom)
+{
+    int depth = draw->desc->comp[0].depth_minus1 + 1;
+    unsigned vsub = draw->vsub[plane];
+    uint8_t color_line[BLEND_CHUNK];
+    int y;
+
+    memset(color_line, depth > 8 ? color->comp[plane].u16 >> (depth - 8) :
+                                   color->comp[plane].u8[0],
+           FFMIN(w_sub + 1, BLEND_CHUNK));
+    if (top) {
+        blend_line_hv_dsp(draw, plane, p, color_line, color->rgba[3],
+                          m, mask_linesize, w_sub, left, right, top);
+        p += dst_linesize;
+        m += top * mask_linesize;
+    }
+    for (y = 0; y < h_sub; y++) {
+        blend_line_hv_dsp(draw, plane, p, color_line, color->rgba[3],
+                          m, mask_linesize, w_sub, left, right, 1 << vsub);
+        p += dst_linesize;
+        m += mask_linesize << vsub;
+    }
+    if (bottom)
+        blend_line_hv_dsp(draw, plane, p, color_line, color->rgba[3],
+                          m, mask_linesize, w_sub, left, right, bottom);
 }
 
 void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
@@ -423,7 +698,13 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
 {
     unsigned alpha, nb_planes, nb_comp, plane, comp;
     int xm0, ym0, w_sub, h_sub, x_sub, y_sub, left, right, top, bottom, y;
+    int depth;
     uint8_t *p0, *p, *m;
+    unsigned src;
+    void (*blend)(uint8_t *dst, int dst_delta, unsigned src, unsigned alpha,
+                  uint8_t *mask, int mask_linesize, int l2depth, int w,
+                  unsigned hsub, unsigned vsub, int xm, int left, int right,
+                  int hband) = blend_line_hv;
 
     clip_interval(dst_w, &x0, &mask_w, &xm0);
     clip_interval(dst_h, &y0, &mask_h, &ym0);
@@ -433,6 +714,13 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
     /* alpha is in the [ 0 ; 0x10203 ] range,
        alpha * mask is in the [ 0 ; 0x1010101 - 4 ] range */
     alpha = (0x10307 * color->rgba[3] + 0x3) >> 8;
+    if (draw->pixelstep[0] == 2) {
+        /* alpha is in the [ 0 ; 0x101 ] range,
+           alpha * mask is in the [ 0 ; 0xFFFF ] range */
+        alpha = (0x101 * color->rgba[3] + 0x7F) / 0xFF;
+        blend = blend_line_hv16;
+    }
+    depth = draw->desc->comp[0].depth_minus1 + 1;
     nb_planes = (draw->nb_planes - 1) | 1; /* eliminate alpha */
     for (plane = 0; plane < nb_planes; plane++) {
         nb_comp = draw->pixelstep[plane];
@@ -443,35 +731,41 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
         y_sub = y0;
         subsampling_bounds(draw->hsub[plane], &x_sub, &w_sub, &left, &right);
         subsampling_bounds(draw->vsub[plane], &y_sub, &h_sub, &top, &bottom);
+        if (l2depth == 3 && nb_comp == (depth > 8 ? 2 : 1)) {
+            /* planar, blend whole lines */
+            blend_mask_dsp(draw, color, plane, p0, dst_linesize[plane],
+                           mask + xm0, mask_linesize, w_sub, h_sub,
+                           left, right, top, bottom);
+            continue;
+        }
         for (comp = 0; comp < nb_comp; comp++) {
             if (!component_used(draw, plane, comp))
                 continue;
             p = p0 + comp;
             m = mask;
+            src = draw->pixelstep[0] == 2 ? color->comp[plane].u16 :
+                                            color->comp[plane].u8[comp];
             if (top) {
-                blend_line_hv(p, draw->pixelstep[plane],
-                              color->comp[plane].u8[comp], alpha,
-                              m, mask_linesize, l2depth, w_sub,
-                              draw->hsub[plane], draw->vsub[plane],
-                              xm0, left, right, top);
+                blend(p, draw->pixelstep[plane], src, alpha,
+                      m, mask_linesize, l2depth, w_sub,
+                      draw->hsub[plane], draw->vsub[plane],
+                      xm0, left, right, top);
                 p += dst_linesize[plane];
                 m += top * mask_linesize;
             }
             for (y = 0; y < h_sub; y++) {
-                blend_line_hv(p, draw->pixelstep[plane],
-                              color->comp[plane].u8[comp], alpha,
-                              m, mask_linesize, l2depth, w_sub,
-                              draw->hsub[plane], draw->vsub[plane],
-                              xm0, left, right, 1 << draw->vsub[plane]);
+                blend(p, draw->pixelstep[plane], src, alpha,
+                      m, mask_linesize, l2depth, w_sub,
+                      draw->hsub[plane], draw->vsub[plane],
+                      xm0, left, right, 1 << draw->vsub[plane]);
                 p += dst_linesize[plane];
                 m += mask_linesize << draw->vsub[plane];
             }
             if (bottom)
-                blend_line_hv(p, draw->pixelstep[plane],
-                              color->comp[plane].u8[comp], alpha,
-                              m, mask_linesize, l2depth, w_sub,
-                              draw->hsub[plane], draw->vsub[plane],
-                              xm0, left, right, bottom);
+                blend(p, draw->pixelstep[plane], src, alpha,
+                      m, mask_linesize, l2depth, w_sub,
+                      draw->hsub[plane], draw->vsub[plane],
+                      xm0, left, right, bottom);
         }
     }
 }
@@ -45,6 +45,66 @@ void ff_copy_rectangle(uint8_t *dst[4], int dst_linesize[4],
 
 #define MAX_PLANES 4
 
+/**
+ * Divide by 255 and round to nearest, for x in [ 0 ; 65025 ]:
+ * (X+127)/255 = ((X+127)*257+257)>>16 = ((X+128)*257)>>16
+ */
+#define FAST_DIV255(x) ((((x) + 128) * 257) >> 16)
+
+/**
+ * Line blending functions. alpha has one 8-bit sample per destination
+ * sample, 0 keeping dst and 255 replacing it; dst samples under a zero
+ * alpha are never changed, and runs of them are skipped.
+ * The 16 functions work on samples of 8 + shift bits in native 16-bit
+ * words, the 8-bit src samples being scaled up by shift.
+ */
+typedef struct FFBlendDSPContext {
+    /**
+     * Straight alpha: dst = (dst * (255 - alpha) + src * alpha) / 255
+     */
+    void (*blend_line)(uint8_t *dst, const uint8_t *src,
+                       const uint8_t *alpha, int w);
+    void (*blend_line16)(uint16_t *dst, const uint8_t *src,
+                         const uint8_t *alpha, int w, int shift);
+    /**
+     * Premultiplied alpha: dst = src + (dst - bias) * (255 - alpha) / 255,
+     * clipped, with bias the zero level of the samples, that is 0 for luma
+     * and 128 << shift for chroma.
+     */
+    void (*blend_line_premul)(uint8_t *dst, const uint8_t *src,
+                              const uint8_t *alpha, int w, int bias);
+    void (*blend_line16_premul)(uint16_t *dst, const uint8_t *src,
+                                const uint8_t *alpha, int w, int shift, int bias);
+    /**
+     * Average the alpha of blocks of (1 << hsub) x (1 << vsub) samples,
+     * for subsampled planes, and scale it by scale / 255.
+     */
+    void (*alpha_line)(uint8_t *dst, const uint8_t *src, int src_linesize,
+                       int w, int hsub, int vsub, int scale);
+} FFBlendDSPContext;
+
+void ff_blend_init_dsp(FFBlendDSPContext *dsp, int cpu_flags);
+
+void ff_blend_line_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w);
+void ff_blend_line16_c(uint16_t *dst, const uint8_t *src, const uint8_t *alpha,
+                       int w, int shift);
+void ff_blend_line_premul_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                            int w, int bias);
+void ff_blend_line16_premul_c(uint16_t *dst, const uint8_t *src, const uint8_t *alpha,
+                              int w, int shift, int bias);
+void ff_blend_alpha_line_c(uint8_t *dst, const uint8_t *src, int src_linesize,
+                           int w, int hsub, int vsub, int scale);
+
+void ff_blend_line_sse2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w);
+void ff_blend_line16_sse2(uint16_t *dst, const uint8_t *src, const uint8_t *alpha,
+                          int w, int shift);
+void ff_blend_line_premul_sse2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                               int w, int bias);
+void ff_blend_line16_premul_sse2(uint16_t *dst, const uint8_t *src, const uint8_t *alpha,
+                                 int w, int shift, int bias);
+void ff_blend_alpha_line_sse2(uint8_t *dst, const uint8_t *src, int src_linesize,
+                              int w, int hsub, int vsub, int scale);
+
 typedef struct FFDrawContext {
     const struct AVPixFmtDescriptor *desc;
     enum PixelFormat format;
@@ -55,6 +115,7 @@ typedef struct FFDrawContext {
     uint8_t vsub[MAX_PLANES];  /*< vertical subsamling */
     uint8_t hsub_max;
     uint8_t vsub_max;
+    FFBlendDSPContext blend;
 } FFDrawContext;
 
 typedef struct FFDrawColor {
@@ -71,6 +132,8 @@ typedef struct FFDrawColor {
  *
  * Only a limited number of pixel formats are supported, if format is not
  * supported the function will return an error.
+ * Formats deeper than 8 bits are supported as planar YUV in native
+ * endianness, with one sample per 16-bit word.
  * No flags currently defined.
  * @return  0 for success, < 0 for error
  */
@@ -0,0 +1,178 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * worker threads shared by the filters computing a frame in bands
+ *
+ * The workers are started once by the filter init and wait for the jobs
+ * of each call, which they take in order along with the calling thread.
+ */
+
+#include "config.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "thread.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+
+struct FFFilterPool {
+    pthread_t *workers;
+    int nb_workers;
+
+    AVFilterContext *ctx;
+    ff_filter_job_func *func;
+    void *arg;
+    int nb_jobs;
+    int next_job;           ///< next job to take
+    int nb_done;            ///< jobs of the call finished
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    int quit;
+};
+
+/* take the jobs left, the lock is held on entry and on return */
+static void run_jobs(FFFilterPool *pool)
+{
+    while (pool->next_job < pool->nb_jobs) {
+        int jobnr = pool->next_job++;
+
+        pthread_mutex_unlock(&pool->lock);
+        pool->func(pool->ctx, pool->arg, jobnr, pool->nb_jobs);
+        pthread_mutex_lock(&pool->lock);
+        if (++pool->nb_done == pool->nb_jobs)
+            pthread_cond_signal(&pool->done_cond);
+    }
+}
+
+static void* attribute_align_arg worker(void *arg)
+{
+    FFFilterPool *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->quit && pool->next_job >= pool->nb_jobs)
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        if (pool->quit)
+            break;
+        run_jobs(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int ff_filter_pool_init(FFFilterPool **pool, int nb_threads)
+{
+    FFFilterPool *p;
+    int i;
+
+    *pool = NULL;
+    if (nb_threads <= 1)
+        return 0;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->workers = av_mallocz((nb_threads - 1) * sizeof(*p->workers));
+    if (!p->workers) {
+        av_free(p);
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work_cond, NULL);
+    pthread_cond_init(&p->done_cond, NULL);
+    /* with fewer workers the calling thread takes more jobs */
+    for (i = 0; i < nb_threads - 1; i++) {
+        if (pthread_create(&p->workers[i], NULL, worker, p))
+            break;
+        p->nb_workers++;
+    }
+    *pool = p;
+    return 0;
+}
+
+void ff_filter_pool_execute(FFFilterPool *pool, AVFilterContext *ctx,
+                            ff_filter_job_func *func, void *arg, int nb_jobs)
+{
+    int i;
+
+    if (!pool || !pool->nb_workers || nb_jobs <= 1) {
+        for (i = 0; i < nb_jobs; i++)
+            func(ctx, arg, i, nb_jobs);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->ctx      = ctx;
+    pool->func     = func;
+    pool->arg      = arg;
+    pool->nb_jobs  = nb_jobs;
+    pool->next_job = 0;
+    pool->nb_done  = 0;
+    pthread_cond_broadcast(&pool->work_cond);
+    run_jobs(pool);
+    while (pool->nb_done < pool->nb_jobs)
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void ff_filter_pool_free(FFFilterPool **pool)
+{
+    FFFilterPool *p = *pool;
+    int i;
+
+    if (!p)
+        return;
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->work_cond);
+    pthread_mutex_unlock(&p->lock);
+    for (i = 0; i < p->nb_workers; i++)
+        pthread_join(p->workers[i], NULL);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->work_cond);
+    pthread_cond_destroy(&p->done_cond);
+    av_free(p->workers);
+    av_freep(pool);
+}
+
+#else
+
+int ff_filter_pool_init(FFFilterPool **pool, int nb_threads)
+{
+    *pool = NULL;
+    return 0;
+}
+
+void ff_filter_pool_execute(FFFilterPool *pool, AVFilterContext *ctx,
+                            ff_filter_job_func *func, void *arg, int nb_jobs)
+{
+    int i;
+
+    for (i = 0; i < nb_jobs; i++)
+        func(ctx, arg, i, nb_jobs);
+}
+
+void ff_filter_pool_free(FFFilterPool **pool)
+{
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_THREAD_H
+#define AVFILTER_THREAD_H
+
+/**
+ * @file
+ * worker threads shared by the filters computing a frame in bands
+ */
+
+#include "avfilter.h"
+
+typedef struct FFFilterPool FFFilterPool;
+
+/**
+ * Compute band jobnr out of nb_jobs, the bands of a call must not
+ * depend on each other.
+ */
+typedef void (ff_filter_job_func)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
+
+/**
+ * Start the workers of a filter, the calling thread is the first one.
+ *
+ * @param nb_threads number of threads running the jobs, with 1 or without
+ *                   thread support no pool is created and *pool is NULL
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int ff_filter_pool_init(FFFilterPool **pool, int nb_threads);
+
+/**
+ * Run func for jobs 0 to nb_jobs - 1 and wait until all of them are done.
+ * The jobs are run in the calling thread if pool is NULL.
+ */
+void ff_filter_pool_execute(FFFilterPool *pool, AVFilterContext *ctx,
+                            ff_filter_job_func *func, void *arg, int nb_jobs);
+
+/**
+ * Stop the workers and free the pool, *pool is set to NULL.
+ */
+void ff_filter_pool_free(FFFilterPool **pool);
+
+#endif /* AVFILTER_THREAD_H */
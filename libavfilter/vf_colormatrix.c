@@ -28,10 +28,13 @@
 #include <strings.h>
 #include <float.h>
 #include "avfilter.h"
+#include "colormatrix.h"
+#include "libavutil/cpu.h"
 #include "libavutil/pixdesc.h"
 
 #define NS(n) n < 0 ? (int)(n*65536.0-0.5+DBL_EPSILON) : (int)(n*65536.0+0.5)
 #define CB(n) av_clip_uint8(n)
+#define CB10(n) av_clip_uintp2(n, 10)
 
 static const double yuv_coeff[4][3][3] = {
     { { +0.7152, +0.0722, +0.2126 }, // Rec.709 (0)
@@ -55,6 +58,8 @@ typedef struct {
     char src[256];
     char dst[256];
     int hsub, vsub;
+    ColorMatrixCoeffs cm;
+    ColorMatrixDSPContext dsp;
 } ColorMatrixContext;
 
 #define ma m[0][0]
@@ -172,6 +177,7 @@ static void check_mode(ColorMatrixContext *color)
 static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
 {
     ColorMatrixContext *color = ctx->priv;
+    int c[6];
 
     if (!args)
         goto usage;
@@ -193,36 +199,144 @@ static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
 
     calc_coefficients(ctx);
 
+    c[0] = color->yuv_convert[color->mode][0][1];
+    c[1] = color->yuv_convert[color->mode][0][2];
+    c[2] = color->yuv_convert[color->mode][1][1];
+    c[3] = color->yuv_convert[color->mode][1][2];
+    c[4] = color->yuv_convert[color->mode][2][1];
+    c[5] = color->yuv_convert[color->mode][2][2];
+    ff_colormatrix_init_coeffs(&color->cm, c);
+    ff_colormatrix_init_dsp(&color->dsp, av_get_cpu_flags());
+
     return 0;
 }
 
+void ff_colormatrix_init_coeffs(ColorMatrixCoeffs *cm, const int c[6])
+{
+    int i, j;
+
+    for (i = 0; i < 6; i++)
+        cm->c[i] = c[i];
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 8; j++) {
+            int hi = (c[2 * i + (j & 1)] + 32768) >> 16;
+            cm->hi[i][j] = hi;
+            cm->lo[i][j] = c[2 * i + (j & 1)] - hi * 65536;
+        }
+    }
+}
+
+void ff_colormatrix_luma_line_c(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                                const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm)
+{
+    int x;
+
+    for (x = 0; x < chroma_w; x++) {
+        const int u = srcu[x] - 128;
+        const int v = srcv[x] - 128;
+        const int uvval = cm->c[0] * u + cm->c[1] * v + 1081344;
+        dsty[2 * x + 0] = CB((65536 * (srcy[2 * x + 0] - 16) + uvval) >> 16);
+        dsty[2 * x + 1] = CB((65536 * (srcy[2 * x + 1] - 16) + uvval) >> 16);
+    }
+}
+
+void ff_colormatrix_chroma_line_c(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                                  const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm)
+{
+    int x;
+
+    for (x = 0; x < chroma_w; x++) {
+        const int u = srcu[x] - 128;
+        const int v = srcv[x] - 128;
+        dstu[x] = CB((cm->c[2] * u + cm->c[3] * v + 8421376) >> 16);
+        dstv[x] = CB((cm->c[4] * u + cm->c[5] * v + 8421376) >> 16);
+    }
+}
+
+void ff_colormatrix_uyvy_line_c(uint8_t *dst, const uint8_t *src, int chroma_w,
+                                const ColorMatrixCoeffs *cm)
+{
+    int x;
+
+    for (x = 0; x < 4 * chroma_w; x += 4) {
+        const int u = src[x + 0] - 128;
+        const int v = src[x + 2] - 128;
+        const int uvval = cm->c[0] * u + cm->c[1] * v + 1081344;
+        dst[x + 0] = CB((cm->c[2] * u + cm->c[3] * v + 8421376) >> 16);
+        dst[x + 1] = CB((65536 * (src[x + 1] - 16) + uvval) >> 16);
+        dst[x + 2] = CB((cm->c[4] * u + cm->c[5] * v + 8421376) >> 16);
+        dst[x + 3] = CB((65536 * (src[x + 3] - 16) + uvval) >> 16);
+    }
+}
+
+/* same as 8 bits with black at 64, chroma zero at 512 */
+void ff_colormatrix_luma10_line_c(uint8_t *dsty8, const uint8_t *srcy8, const uint8_t *srcu8,
+                                  const uint8_t *srcv8, int chroma_w, const ColorMatrixCoeffs *cm)
+{
+    const uint16_t *srcy = (const uint16_t *)srcy8;
+    const uint16_t *srcu = (const uint16_t *)srcu8;
+    const uint16_t *srcv = (const uint16_t *)srcv8;
+    uint16_t *dsty = (uint16_t *)dsty8;
+    int x;
+
+    for (x = 0; x < chroma_w; x++) {
+        const int u = srcu[x] - 512;
+        const int v = srcv[x] - 512;
+        const int uvval = cm->c[0] * u + cm->c[1] * v + 4227072;
+        dsty[2 * x + 0] = CB10((65536 * (srcy[2 * x + 0] - 64) + uvval) >> 16);
+        dsty[2 * x + 1] = CB10((65536 * (srcy[2 * x + 1] - 64) + uvval) >> 16);
+    }
+}
+
+void ff_colormatrix_chroma10_line_c(uint8_t *dstu8, uint8_t *dstv8, const uint8_t *srcu8,
+                                    const uint8_t *srcv8, int chroma_w, const ColorMatrixCoeffs *cm)
+{
+    const uint16_t *srcu = (const uint16_t *)srcu8;
+    const uint16_t *srcv = (const uint16_t *)srcv8;
+    uint16_t *dstu = (uint16_t *)dstu8;
+    uint16_t *dstv = (uint16_t *)dstv8;
+    int x;
+
+    for (x = 0; x < chroma_w; x++) {
+        const int u = srcu[x] - 512;
+        const int v = srcv[x] - 512;
+        dstu[x] = CB10((cm->c[2] * u + cm->c[3] * v + 33587200) >> 16);
+        dstv[x] = CB10((cm->c[4] * u + cm->c[5] * v + 33587200) >> 16);
+    }
+}
+
+void ff_colormatrix_init_dsp(ColorMatrixDSPContext *dsp, int cpu_flags)
+{
+    dsp->luma_line     = ff_colormatrix_luma_line_c;
+    dsp->chroma_line   = ff_colormatrix_chroma_line_c;
+    dsp->uyvy_line     = ff_colormatrix_uyvy_line_c;
+    dsp->luma10_line   = ff_colormatrix_luma10_line_c;
+    dsp->chroma10_line = ff_colormatrix_chroma10_line_c;
+
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        dsp->luma_line     = ff_colormatrix_luma_line_sse2;
+        dsp->chroma_line   = ff_colormatrix_chroma_line_sse2;
+        dsp->uyvy_line     = ff_colormatrix_uyvy_line_sse2;
+        dsp->luma10_line   = ff_colormatrix_luma10_line_sse2;
+        dsp->chroma10_line = ff_colormatrix_chroma10_line_sse2;
+    }
+#endif
+}
+
 static void process_frame_uyvy422(ColorMatrixContext *color,
                                   AVFilterBufferRef *dst, AVFilterBufferRef *src)
 {
     const unsigned char *srcp = src->data[0];
     const int src_pitch = src->linesize[0];
     const int height = src->video->h;
-    const int width = src->video->w*2;
+    const int chroma_w = (src->video->w + 1) >> 1;
     unsigned char *dstp = dst->data[0];
     const int dst_pitch = dst->linesize[0];
-    const int c2 = color->yuv_convert[color->mode][0][1];
-    const int c3 = color->yuv_convert[color->mode][0][2];
-    const int c4 = color->yuv_convert[color->mode][1][1];
-    const int c5 = color->yuv_convert[color->mode][1][2];
-    const int c6 = color->yuv_convert[color->mode][2][1];
-    const int c7 = color->yuv_convert[color->mode][2][2];
-    int x, y;
+    int y;
 
     for (y = 0; y < height; ++y) {
-        for (x = 0; x < width; x += 4) {
-            const int u = srcp[x + 0] - 128;
-            const int v = srcp[x + 2] - 128;
-            const int uvval = c2 * u + c3 * v + 1081344;
-            dstp[x + 0] = CB((c4 * u + c5 * v + 8421376) >> 16);
-            dstp[x + 1] = CB((65536 * (srcp[x + 1] - 16) + uvval) >> 16);
-            dstp[x + 2] = CB((c6 * u + c7 * v + 8421376) >> 16);
-            dstp[x + 3] = CB((65536 * (srcp[x + 3] - 16) + uvval) >> 16);
-        }
+        color->dsp.uyvy_line(dstp, srcp, chroma_w, &color->cm);
         srcp += src_pitch;
         dstp += dst_pitch;
     }
@@ -237,30 +351,46 @@ static void process_frame_yuv422p(ColorMatrixContext *color,
     const int src_pitchY  = src->linesize[0];
     const int src_pitchUV = src->linesize[1];
     const int height = src->video->h;
-    const int width = src->video->w;
+    const int chroma_w = (src->video->w + 1) >> 1;
     unsigned char *dstpU = dst->data[1];
     unsigned char *dstpV = dst->data[2];
     unsigned char *dstpY = dst->data[0];
     const int dst_pitchY  = dst->linesize[0];
     const int dst_pitchUV = dst->linesize[1];
-    const int c2 = color->yuv_convert[color->mode][0][1];
-    const int c3 = color->yuv_convert[color->mode][0][2];
-    const int c4 = color->yuv_convert[color->mode][1][1];
-    const int c5 = color->yuv_convert[color->mode][1][2];
-    const int c6 = color->yuv_convert[color->mode][2][1];
-    const int c7 = color->yuv_convert[color->mode][2][2];
-    int x, y;
+    int y;
 
     for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x += 2) {
-            const int u = srcpU[x >> 1] - 128;
-            const int v = srcpV[x >> 1] - 128;
-            const int uvval = c2 * u + c3 * v + 1081344;
-            dstpY[x + 0] = CB((65536 * (srcpY[x + 0] - 16) + uvval) >> 16);
-            dstpY[x + 1] = CB((65536 * (srcpY[x + 1] - 16) + uvval) >> 16);
-            dstpU[x >> 1] = CB((c4 * u + c5 * v + 8421376) >> 16);
-            dstpV[x >> 1] = CB((c6 * u + c7 * v + 8421376) >> 16);
-        }
+        color->dsp.luma_line(dstpY, srcpY, srcpU, srcpV, chroma_w, &color->cm);
+        color->dsp.chroma_line(dstpU, dstpV, srcpU, srcpV, chroma_w, &color->cm);
+        srcpY += src_pitchY;
+        dstpY += dst_pitchY;
+        srcpU += src_pitchUV;
+        srcpV += src_pitchUV;
+        dstpU += dst_pitchUV;
+        dstpV += dst_pitchUV;
+    }
+}
+
+static void process_frame_yuv422p10(ColorMatrixContext *color,
+                                    AVFilterBufferRef *dst, AVFilterBufferRef *src)
+{
+    const unsigned char *srcpU = src->data[1];
+    const unsigned char *srcpV = src->data[2];
+    const unsigned char *srcpY = src->data[0];
+    const int src_pitchY  = src->linesize[0];
+    const int src_pitchUV = src->linesize[1];
+    const int height = src->video->h;
+    const int chroma_w = (src->video->w + 1) >> 1;
+    unsigned char *dstpU = dst->data[1];
+    unsigned char *dstpV = dst->data[2];
+    unsigned char *dstpY = dst->data[0];
+    const int dst_pitchY  = dst->linesize[0];
+    const int dst_pitchUV = dst->linesize[1];
+    int y;
+
+    for (y = 0; y < height; y++) {
+        color->dsp.luma10_line(dstpY, srcpY, srcpU, srcpV, chroma_w, &color->cm);
+        color->dsp.chroma10_line(dstpU, dstpV, srcpU, srcpV, chroma_w, &color->cm);
         srcpY += src_pitchY;
         dstpY += dst_pitchY;
         srcpU += src_pitchUV;
@@ -280,33 +410,20 @@ static void process_frame_yuv420p(ColorMatrixContext *color,
     const int src_pitchY  = src->linesize[0];
     const int src_pitchUV = src->linesize[1];
     const int height = src->video->h;
-    const int width = src->video->w;
+    const int chroma_w = (src->video->w + 1) >> 1;
     unsigned char *dstpU = dst->data[1];
     unsigned char *dstpV = dst->data[2];
     unsigned char *dstpY = dst->data[0];
     unsigned char *dstpN = dst->data[0] + dst->linesize[0];
     const int dst_pitchY  = dst->linesize[0];
     const int dst_pitchUV = dst->linesize[1];
-    const int c2 = color->yuv_convert[color->mode][0][1];
-    const int c3 = color->yuv_convert[color->mode][0][2];
-    const int c4 = color->yuv_convert[color->mode][1][1];
-    const int c5 = color->yuv_convert[color->mode][1][2];
-    const int c6 = color->yuv_convert[color->mode][2][1];
-    const int c7 = color->yuv_convert[color->mode][2][2];
-    int x, y;
+    int y;
 
     for (y = 0; y < height; y += 2) {
-        for (x = 0; x < width; x += 2) {
-            const int u = srcpU[x >> 1] - 128;
-            const int v = srcpV[x >> 1] - 128;
-            const int uvval = c2 * u + c3 * v + 1081344;
-            dstpY[x + 0] = CB((65536 * (srcpY[x + 0] - 16) + uvval) >> 16);
-            dstpY[x + 1] = CB((65536 * (srcpY[x + 1] - 16) + uvval) >> 16);
-            dstpN[x + 0] = CB((65536 * (srcpN[x + 0] - 16) + uvval) >> 16);
-            dstpN[x + 1] = CB((65536 * (srcpN[x + 1] - 16) + uvval) >> 16);
-            dstpU[x >> 1] = CB((c4 * u + c5 * v + 8421376) >> 16);
-            dstpV[x >> 1] = CB((c6 * u + c7 * v + 8421376) >> 16);
-        }
+        color->dsp.luma_line(dstpY, srcpY, srcpU, srcpV, chroma_w, &color->cm);
+        if (y + 1 < height)
+            color->dsp.luma_line(dstpN, srcpN, srcpU, srcpV, chroma_w, &color->cm);
+        color->dsp.chroma_line(dstpU, dstpV, srcpU, srcpV, chroma_w, &color->cm);
         srcpY += src_pitchY << 1;
         dstpY += dst_pitchY << 1;
         srcpN += src_pitchY << 1;
@@ -338,6 +455,7 @@ static int query_formats(AVFilterContext *ctx)
         PIX_FMT_YUV422P,
         PIX_FMT_YUV420P,
         PIX_FMT_UYVY422,
+        PIX_FMT_YUV422P10,
         PIX_FMT_NONE
     };
 
@@ -372,6 +490,8 @@ static void end_frame(AVFilterLink *link)
         process_frame_yuv422p(color, out, link->cur_buf);
     else if (link->cur_buf->format == PIX_FMT_YUV420P)
         process_frame_yuv420p(color, out, link->cur_buf);
+    else if (link->cur_buf->format == PIX_FMT_YUV422P10)
+        process_frame_yuv422p10(color, out, link->cur_buf);
     else
         process_frame_uyvy422(color, out, link->cur_buf);
 
@@ -35,6 +35,7 @@ typedef struct {
     int x, y, w, h;
     unsigned char yuv_color[4];
     int vsub, hsub;   //< chroma subsampling
+    int depth;        //< bits per sample, more than 8 in 16-bit words
 } DrawBoxContext;
 
 static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
@@ -67,6 +68,7 @@ static int query_formats(AVFilterContext *ctx)
         PIX_FMT_YUV411P,  PIX_FMT_YUV410P,
         PIX_FMT_YUVJ444P, PIX_FMT_YUVJ422P, PIX_FMT_YUVJ420P,
         PIX_FMT_YUV440P,  PIX_FMT_YUVJ440P,
+        PIX_FMT_YUV422P10,
         PIX_FMT_NONE
     };
 
@@ -80,6 +82,7 @@ static int config_input(AVFilterLink *inlink)
 
     drawbox->hsub = av_pix_fmt_descriptors[inlink->format].log2_chroma_w;
     drawbox->vsub = av_pix_fmt_descriptors[inlink->format].log2_chroma_h;
+    drawbox->depth = av_pix_fmt_descriptors[inlink->format].comp[0].depth_minus1 + 1;
 
     if (drawbox->w == 0) drawbox->w = inlink->w;
     if (drawbox->h == 0) drawbox->h = inlink->h;
@@ -91,6 +94,34 @@ static int config_input(AVFilterLink *inlink)
     return 0;
 }
 
+static void draw_slice16(AVFilterLink *inlink, int y0, int h)
+{
+    DrawBoxContext *drawbox = inlink->dst->priv;
+    int plane, x, y, xb = drawbox->x, yb = drawbox->y;
+    int shift = drawbox->depth - 8;
+    uint16_t *row[4];
+    AVFilterBufferRef *picref = inlink->cur_buf;
+
+    for (y = FFMAX(yb, y0); y < (y0 + h) && y < (yb + drawbox->h); y++) {
+        row[0] = (uint16_t *)(picref->data[0] + y * picref->linesize[0]);
+
+        for (plane = 1; plane < 3; plane++)
+            row[plane] = (uint16_t *)(picref->data[plane] +
+                picref->linesize[plane] * (y >> drawbox->vsub));
+
+        for (x = FFMAX(xb, 0); x < (xb + drawbox->w) && x < picref->video->w; x++) {
+            double alpha = (double)drawbox->yuv_color[A] / 255;
+
+            if ((y - yb < 3) || (yb + drawbox->h - y < 4) ||
+                (x - xb < 3) || (xb + drawbox->w - x < 4)) {
+                row[0][x                 ] = (1 - alpha) * row[0][x                 ] + alpha * (drawbox->yuv_color[Y] << shift);
+                row[1][x >> drawbox->hsub] = (1 - alpha) * row[1][x >> drawbox->hsub] + alpha * (drawbox->yuv_color[U] << shift);
+                row[2][x >> drawbox->hsub] = (1 - alpha) * row[2][x >> drawbox->hsub] + alpha * (drawbox->yuv_color[V] << shift);
+            }
+        }
+    }
+}
+
 static void draw_slice(AVFilterLink *inlink, int y0, int h, int slice_dir)
 {
     DrawBoxContext *drawbox = inlink->dst->priv;
@@ -98,6 +129,12 @@ static void draw_slice(AVFilterLink *inlink, int y0, int h, int slice_dir)
     unsigned char *row[4];
     AVFilterBufferRef *picref = inlink->cur_buf;
 
+    if (drawbox->depth > 8) {
+        draw_slice16(inlink, y0, h);
+        avfilter_draw_slice(inlink->dst->outputs[0], y0, h, 1);
+        return;
+    }
+
     for (y = FFMAX(yb, y0); y < (y0 + h) && y < (yb + drawbox->h); y++) {
         row[0] = picref->data[0] + y * picref->linesize[0];
 
@@ -62,9 +62,9 @@ typedef struct {
     char *fontcolor_string;         ///< font color as string
     char *boxcolor_string;          ///< box color as string
     char *shadowcolor_string;       ///< shadow color as string
-    uint8_t fontcolor[4];           ///< foreground color
+    FFDrawColor fontcolor;          ///< foreground color
     uint8_t boxcolor[4];            ///< background color
-    uint8_t shadowcolor[4];         ///< shadow color
+    FFDrawColor shadowcolor;        ///< shadow color
     uint8_t fontcolor_rgba[4];      ///< foreground color in RGBA
     uint8_t boxcolor_rgba[4];       ///< background color in RGBA
     uint8_t shadowcolor_rgba[4];    ///< shadow color in RGBA
@@ -81,6 +81,7 @@ typedef struct {
     int pixel_step[4];              ///< distance in bytes between the component of each pixel
     uint8_t rgba_map[4];            ///< map RGBA offsets to the positions in the packed RGBA format
     uint8_t *box_line[4];           ///< line used for filling the box background
+    FFDrawContext dc;               ///< used to blend the glyphs on planar YUV
 } DrawTextContext;
 
 #define OFFSET(x) offsetof(DrawTextContext, x)
@@ -386,16 +387,10 @@ static int config_input(AVFilterLink *inlink)
         return ret;
 
     if (!dtext->is_packed_rgb) {
-        uint8_t *rgba = dtext->fontcolor_rgba;
-        dtext->fontcolor[0] = RGB_TO_Y_CCIR(rgba[0], rgba[1], rgba[2]);
-        dtext->fontcolor[1] = RGB_TO_U_CCIR(rgba[0], rgba[1], rgba[2], 0);
-        dtext->fontcolor[2] = RGB_TO_V_CCIR(rgba[0], rgba[1], rgba[2], 0);
-        dtext->fontcolor[3] = rgba[3];
-        rgba = dtext->shadowcolor_rgba;
-        dtext->shadowcolor[0] = RGB_TO_Y_CCIR(rgba[0], rgba[1], rgba[2]);
-        dtext->shadowcolor[1] = RGB_TO_U_CCIR(rgba[0], rgba[1], rgba[2], 0);
-        dtext->shadowcolor[2] = RGB_TO_V_CCIR(rgba[0], rgba[1], rgba[2], 0);
-        dtext->shadowcolor[3] = rgba[3];
+        if ((ret = ff_draw_init(&dtext->dc, inlink->format, 0)) < 0)
+            return ret;
+        ff_draw_color(&dtext->dc, &dtext->fontcolor,   dtext->fontcolor_rgba);
+        ff_draw_color(&dtext->dc, &dtext->shadowcolor, dtext->shadowcolor_rgba);
     }
 
     return 0;
@@ -418,25 +413,15 @@ static int config_input(AVFilterLink *inlink)
     }\
 }
 
-static inline int draw_glyph_yuv(AVFilterBufferRef *picref, FT_Bitmap *bitmap, unsigned int x,
-                                 unsigned int y, unsigned int width, unsigned int height,
-                                 const uint8_t yuva_color[4], int hsub, int vsub)
+static inline int draw_glyph_yuv(FFDrawContext *dc, AVFilterBufferRef *picref,
+                                 FT_Bitmap *bitmap, unsigned int x, unsigned int y,
+                                 unsigned int width, unsigned int height,
+                                 FFDrawColor *yuva_color)
 {
-    int r, c, alpha;
-    unsigned int luma_pos, chroma_pos1, chroma_pos2;
-    uint8_t src_val;
-
-    for (r = 0; r < bitmap->rows && r+y < height; r++) {
-        for (c = 0; c < bitmap->width && c+x < width; c++) {
-            /* get intensity value in the glyph bitmap (source) */
-            src_val = GET_BITMAP_VAL(r, c);
-            if (!src_val)
-                continue;
-
-            SET_PIXEL_YUV(picref, yuva_color, src_val, c+x, y+r, hsub, vsub);
-        }
-    }
-
+    /* gray glyphs are blended a line at a time by the drawutils kernels */
+    ff_blend_mask(dc, yuva_color, picref->data, picref->linesize, width, height,
+                  bitmap->buffer, bitmap->pitch, bitmap->width, bitmap->rows,
+                  bitmap->pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3, 0, x, y);
     return 0;
 }
 
@@ -505,7 +490,7 @@ static inline int is_newline(uint32_t c)
 }
 
 static int draw_glyphs(DrawTextContext *dtext, AVFilterBufferRef *picref,
-                       int width, int height, const uint8_t rgbcolor[4], const uint8_t yuvcolor[4], int x, int y)
+                       int width, int height, const uint8_t rgbcolor[4], FFDrawColor *yuvcolor, int x, int y)
 {
     char *text = HAVE_LOCALTIME_R ? dtext->expanded_text : dtext->text;
     uint32_t code = 0;
@@ -533,9 +518,9 @@ static int draw_glyphs(DrawTextContext *dtext, AVFilterBufferRef *picref,
                            dtext->positions[i].x+x, dtext->positions[i].y+y, width, height,
                            dtext->pixel_step[0], rgbcolor, dtext->rgba_map);
         } else {
-            draw_glyph_yuv(picref, &glyph->bitmap,
+            draw_glyph_yuv(&dtext->dc, picref, &glyph->bitmap,
                            dtext->positions[i].x+x, dtext->positions[i].y+y, width, height,
-                           yuvcolor, dtext->hsub, dtext->vsub);
+                           yuvcolor);
         }
     }
 
@@ -661,12 +646,12 @@ static int draw_text(AVFilterContext *ctx, AVFilterBufferRef *picref,
 
     if (dtext->shadowx || dtext->shadowy) {
         if ((ret = draw_glyphs(dtext, picref, width, height, dtext->shadowcolor_rgba,
-                               dtext->shadowcolor, dtext->shadowx, dtext->shadowy)) < 0)
+                               &dtext->shadowcolor, dtext->shadowx, dtext->shadowy)) < 0)
             return ret;
     }
 
     if ((ret = draw_glyphs(dtext, picref, width, height, dtext->fontcolor_rgba,
-                           dtext->fontcolor, 0, 0)) < 0)
+                           &dtext->fontcolor, 0, 0)) < 0)
         return ret;
 
     return 0;
@@ -43,6 +43,15 @@
 #include "libavcodec/dsputil.h"
 #endif
 
+#include "thread.h"
+
+#if HAVE_PTHREADS
+#include <unistd.h>
+#endif
+
+#define MAX_THREADS 16
+#define MB_SIZE     16
+
 #define N_SRCE 3
 static const int frst = 0;
 static const int crnt = (N_SRCE)>>1;
@@ -79,8 +88,17 @@ typedef struct {
     AVCodecContext *avctx;              ///< codec context required for the DSPContext (scene detect only)
     DSPContext c;                       ///< context providing optimized SAD methods   (scene detect only)
     double prev_mafd;                   ///< previous MAFD                             (scene detect only)
+    me_cmp_func cmp;                    ///< block compare function for motion search
 #endif
 
+    int search_range;                   ///< maximum motion vector length, in pixels
+    int nb_threads;                     ///< number of bands of blocks searched in parallel
+    FFFilterPool *pool;                 ///< workers searching the bands
+    int hsub;
+    int mb_w, mb_h;                     ///< number of blocks in the motion fields
+    int16_t (*mv)[2];                   ///< motion field of the frame being interpolated
+    int16_t (*prev_mv)[2];              ///< motion field of the previous interpolated frame
+
     AVFilterBufferRef *srce[N_SRCE];    ///< buffered source frames
     int64_t srce_pts_dest[N_SRCE];      ///< pts for source frames scaled to output timebase
     AVFilterBufferRef *work;            ///< frame we are working on
@@ -89,7 +107,9 @@ typedef struct {
 } FRAMERATEContext;
 
 #define OFFSET(x) offsetof(FRAMERATEContext, x)
-#define FRAMERATE_FLAG_SCD 01
+#define FRAMERATE_FLAG_SCD  01
+#define FRAMERATE_FLAG_MC   02
+#define FRAMERATE_FLAG_SATD 04
 
 static const AVOption framerate_options[] = {
     {"fps",                 "required output frames per second rate", OFFSET(dest_frame_rate), FF_OPT_TYPE_RATIONAL, {.dbl=50},                 0,       INT_MAX, 0 },
@@ -101,6 +121,12 @@ static const AVOption framerate_options[] = {
     {"flags",               "set flags",                              OFFSET(flags),             FF_OPT_TYPE_FLAGS,    {.dbl=1},                  0,       INT_MAX, 0, "flags" },
     {"scene_change_detect", "enable scene change detection",          0,                         FF_OPT_TYPE_CONST,    {.dbl=FRAMERATE_FLAG_SCD}, INT_MIN, INT_MAX, 0, "flags" },
     {"scd",                 "enable scene change detection",          0,                         FF_OPT_TYPE_CONST,    {.dbl=FRAMERATE_FLAG_SCD}, INT_MIN, INT_MAX, 0, "flags" },
+    {"motion_compensation", "interpolate along motion vectors",       0,                         FF_OPT_TYPE_CONST,    {.dbl=FRAMERATE_FLAG_MC},  INT_MIN, INT_MAX, 0, "flags" },
+    {"mc",                  "interpolate along motion vectors",       0,                         FF_OPT_TYPE_CONST,    {.dbl=FRAMERATE_FLAG_MC},  INT_MIN, INT_MAX, 0, "flags" },
+    {"satd",                "compare blocks with SATD instead of SAD", 0,                        FF_OPT_TYPE_CONST,    {.dbl=FRAMERATE_FLAG_SATD}, INT_MIN, INT_MAX, 0, "flags" },
+
+    {"search_range",        "motion search range in pixels",          OFFSET(search_range),      FF_OPT_TYPE_INT,      {.dbl=16},                 0,       64,      0 },
+    {"threads",             "number of motion search threads",        OFFSET(nb_threads),        FF_OPT_TYPE_INT,      {.dbl=0},                  0,       MAX_THREADS, 0 },
 
     {NULL}
 };
@@ -187,6 +213,180 @@ static double get_scene_score(AVFilterContext *ctx, AVFilterBufferRef *crnt, AVF
 #endif
     return ret;
 }
+
+/** motion compensated interpolation */
+
+typedef struct {
+    AVFilterBufferRef *src1, *src2;
+    int factor;                         ///< weight of src2, out of 256
+} ThreadData;
+
+/**
+ * Offsets of the source blocks for a motion of mv pixels from src1 to
+ * src2, the interpolated block lying at factor/256 of the way.
+ */
+static inline void mv_offsets(int mv, int factor, int *o1, int *o2)
+{
+    *o1 = -ROUNDED_DIV(mv * factor, 256);
+    *o2 = *o1 + mv;
+}
+
+/**
+ * Compare the blocks of both sources that a vector maps to the block at
+ * x, y of the interpolated frame, with a small penalty on the vector length
+ * to keep flat areas still. Vectors reaching outside the frame cost INT_MAX.
+ */
+static int block_cost(FRAMERATEContext *priv_ctx, const ThreadData *td,
+                      int x, int y, int mx, int my)
+{
+    const int linesize = td->src1->linesize[0];
+    int x1, y1, x2, y2;
+
+    mv_offsets(mx, td->factor, &x1, &x2);
+    mv_offsets(my, td->factor, &y1, &y2);
+    x1 += x; x2 += x;
+    y1 += y; y2 += y;
+    if (FFMIN(x1, x2) < 0 || FFMAX(x1, x2) > priv_ctx->srce_w - MB_SIZE ||
+        FFMIN(y1, y2) < 0 || FFMAX(y1, y2) > priv_ctx->srce_h - MB_SIZE)
+        return INT_MAX;
+    return priv_ctx->cmp(priv_ctx,
+                         td->src1->data[0] + y1 * linesize + x1,
+                         td->src2->data[0] + y2 * linesize + x2,
+                         linesize, MB_SIZE) + 4 * (FFABS(mx) + FFABS(my));
+}
+
+/**
+ * Search the motion of one block, symmetrically around the interpolated
+ * frame. The zero vector, the left neighbour and the vectors of the
+ * previous interpolated frame are tried first, then the best of them is
+ * refined with a logarithmic search within the search range.
+ */
+static void search_block(FRAMERATEContext *priv_ctx, const ThreadData *td,
+                         int mb_x, int mb_y)
+{
+    int16_t *mv = priv_ctx->mv[mb_y * priv_ctx->mb_w + mb_x];
+    const int range = priv_ctx->search_range;
+    const int x = mb_x * MB_SIZE, y = mb_y * MB_SIZE;
+    int16_t cand[4][2];
+    int i, dx, dy, step, cost, n = 0, bx = 0, by = 0;
+    int best = block_cost(priv_ctx, td, x, y, 0, 0);
+
+    mv[0] = mv[1] = 0;
+    if (best == INT_MAX || !range)
+        return;
+
+    if (mb_x)
+        memcpy(cand[n++], mv - 2, sizeof(cand[0]));
+    memcpy(cand[n++], priv_ctx->prev_mv[mb_y * priv_ctx->mb_w + mb_x], sizeof(cand[0]));
+    if (mb_x + 1 < priv_ctx->mb_w)
+        memcpy(cand[n++], priv_ctx->prev_mv[mb_y * priv_ctx->mb_w + mb_x + 1], sizeof(cand[0]));
+    if (mb_y + 1 < priv_ctx->mb_h)
+        memcpy(cand[n++], priv_ctx->prev_mv[(mb_y + 1) * priv_ctx->mb_w + mb_x], sizeof(cand[0]));
+    for (i = 0; i < n; i++) {
+        int mx = av_clip(cand[i][0], -range, range);
+        int my = av_clip(cand[i][1], -range, range);
+        if ((mx || my) && (cost = block_cost(priv_ctx, td, x, y, mx, my)) < best) {
+            best = cost;
+            bx = mx;
+            by = my;
+        }
+    }
+
+    for (step = FFMAX((1 << av_log2(range)) >> 1, 1); step; step >>= 1) {
+        int cx = bx, cy = by;
+        for (dy = -step; dy <= step; dy += step)
+            for (dx = -step; dx <= step; dx += step) {
+                int mx = cx + dx, my = cy + dy;
+                if ((!dx && !dy) || FFABS(mx) > range || FFABS(my) > range)
+                    continue;
+                if ((cost = block_cost(priv_ctx, td, x, y, mx, my)) < best) {
+                    best = cost;
+                    bx = mx;
+                    by = my;
+                }
+            }
+    }
+    mv[0] = bx;
+    mv[1] = by;
+}
+
+/**
+ * Build one block of the work frame from both sources moved along its
+ * vector, chroma using the vector scaled down to its subsampling. Offsets
+ * are clipped to the planes at the frame borders.
+ */
+static void compensate_block(FRAMERATEContext *priv_ctx, const ThreadData *td,
+                             int mb_x, int mb_y)
+{
+    const int16_t *mv = priv_ctx->mv[mb_y * priv_ctx->mb_w + mb_x];
+    const int src2_factor = td->factor, src1_factor = 256 - td->factor;
+    int mvx1, mvx2, mvy1, mvy2;
+
+    mv_offsets(mv[0], td->factor, &mvx1, &mvx2);
+    mv_offsets(mv[1], td->factor, &mvy1, &mvy2);
+
+    for (int plane = 0; plane < 4 && td->src1->data[plane] && td->src2->data[plane]; plane++) {
+        const int hsub = (plane == 1 || plane == 2) ? priv_ctx->hsub : 0;
+        const int vsub = (plane == 1 || plane == 2) ? priv_ctx->vsub : 0;
+        const int plane_w = -((-priv_ctx->srce_w) >> hsub);
+        const int plane_h = -((-priv_ctx->srce_h) >> vsub);
+        const int x = (mb_x * MB_SIZE) >> hsub, y = (mb_y * MB_SIZE) >> vsub;
+        const int w = FFMIN(MB_SIZE >> hsub, plane_w - x);
+        const int h = FFMIN(MB_SIZE >> vsub, plane_h - y);
+        const int x1 = x + av_clip(mvx1 >> hsub, -x, plane_w - w - x);
+        const int x2 = x + av_clip(mvx2 >> hsub, -x, plane_w - w - x);
+        const int y1 = y + av_clip(mvy1 >> vsub, -y, plane_h - h - y);
+        const int y2 = y + av_clip(mvy2 >> vsub, -y, plane_h - h - y);
+        const uint8_t *src1 = td->src1->data[plane] + y1 * td->src1->linesize[plane] + x1;
+        const uint8_t *src2 = td->src2->data[plane] + y2 * td->src2->linesize[plane] + x2;
+        uint8_t *dst = priv_ctx->work->data[plane] + y * priv_ctx->work->linesize[plane] + x;
+
+        for (int line = 0; line < h; line++) {
+            // same rounding as the blend, which holds for chroma as well
+            // since the factors sum to 256
+            for (int pixel = 0; pixel < w; pixel++)
+                dst[pixel] = (src1[pixel] * src1_factor + src2[pixel] * src2_factor + 128) >> 8;
+            src1 += td->src1->linesize[plane];
+            src2 += td->src2->linesize[plane];
+            dst  += priv_ctx->work->linesize[plane];
+        }
+    }
+}
+
+static void motion_band(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    FRAMERATEContext *priv_ctx = ctx->priv;
+    const int start = priv_ctx->mb_h *  jobnr      / nb_jobs;
+    const int end   = priv_ctx->mb_h * (jobnr + 1) / nb_jobs;
+
+    for (int mb_y = start; mb_y < end; mb_y++)
+        for (int mb_x = 0; mb_x < priv_ctx->mb_w; mb_x++) {
+            search_block(priv_ctx, td, mb_x, mb_y);
+            compensate_block(priv_ctx, td, mb_x, mb_y);
+        }
+    emms_c();
+}
+
+/**
+ * Interpolate the work frame along the motion between both sources, in
+ * parallel bands of block rows. Blocks only predict from their left
+ * neighbour and from the previous motion field, so the result does not
+ * depend on the number of threads.
+ */
+static void motion_compensate(AVFilterContext *ctx, AVFilterBufferRef *src1,
+                              AVFilterBufferRef *src2, int factor)
+{
+    FRAMERATEContext *priv_ctx = ctx->priv;
+    ThreadData td = { src1, src2, factor };
+    int16_t (*tmp_mv)[2];
+
+    ff_filter_pool_execute(priv_ctx->pool, ctx, motion_band, &td,
+                           FFMIN(priv_ctx->nb_threads, priv_ctx->mb_h));
+    tmp_mv            = priv_ctx->prev_mv;
+    priv_ctx->prev_mv = priv_ctx->mv;
+    priv_ctx->mv      = tmp_mv;
+}
 #endif
 
 static int process_work_frame(AVFilterContext *ctx)
@@ -290,6 +490,13 @@ static int process_work_frame(AVFilterContext *ctx)
             uint16_t src1_factor = 256 - src2_factor;
 #ifdef DEBUG
             av_dlog(ctx, "process_work_frame() INTERPOLATE to create work frame\n");
+#endif
+#if CONFIG_AVCODEC
+            if ((priv_ctx->flags & FRAMERATE_FLAG_MC) &&
+                copy_src1->linesize[0] == copy_src2->linesize[0]) {
+                motion_compensate(ctx, copy_src1, copy_src2, src2_factor);
+                goto copy_done;
+            }
 #endif
             for (int plane = 0; plane < 4 && copy_src1->data[plane] && copy_src2->data[plane]; plane++) {
                 int cpy_line_width = priv_ctx->line_size[plane];
@@ -480,7 +687,7 @@ static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
 {
     FRAMERATEContext *priv_ctx = ctx->priv;
     char c;
-    int count, raw, err = 0;
+    int count, raw = 0, err = 0;
 
 #ifdef DEBUG
             av_dlog(ctx, "init()\n");
@@ -541,7 +748,16 @@ static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
         }
     }
 
-    return 0;
+#if HAVE_PTHREADS && defined(_SC_NPROCESSORS_ONLN)
+    if (!priv_ctx->nb_threads)
+        priv_ctx->nb_threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    priv_ctx->nb_threads = av_clip(priv_ctx->nb_threads, 1, MAX_THREADS);
+#if !HAVE_PTHREADS
+    priv_ctx->nb_threads = 1;
+#endif
+
+    return ff_filter_pool_init(&priv_ctx->pool, priv_ctx->nb_threads);
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
@@ -552,6 +768,12 @@ static av_cold void uninit(AVFilterContext *ctx)
         if (priv_ctx->srce[i] && (priv_ctx->srce[i] != priv_ctx->srce[i + 1])) avfilter_unref_buffer(priv_ctx->srce[i]);
     }
     if (priv_ctx->srce[last]) avfilter_unref_buffer(priv_ctx->srce[last]);
+    av_freep(&priv_ctx->mv);
+    av_freep(&priv_ctx->prev_mv);
+    ff_filter_pool_free(&priv_ctx->pool);
+#if CONFIG_AVCODEC
+    av_freep(&priv_ctx->avctx);
+#endif
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -586,14 +808,26 @@ static int config_input(AVFilterLink *inlink)
                 plane);
     }
 
+    priv_ctx->hsub = pix_desc->log2_chroma_w;
     priv_ctx->vsub = pix_desc->log2_chroma_h;
 
     if (CONFIG_AVCODEC) {
         priv_ctx->avctx = avcodec_alloc_context3(NULL);
         if (!priv_ctx->avctx) return AVERROR(ENOMEM);
         dsputil_init(&priv_ctx->c, priv_ctx->avctx);
+        priv_ctx->cmp = (priv_ctx->flags & FRAMERATE_FLAG_SATD) ?
+                        priv_ctx->c.hadamard8_diff[0] : priv_ctx->c.pix_abs[0][0];
     }
 
+    priv_ctx->mb_w = (inlink->w + MB_SIZE - 1) / MB_SIZE;
+    priv_ctx->mb_h = (inlink->h + MB_SIZE - 1) / MB_SIZE;
+    av_freep(&priv_ctx->mv);
+    av_freep(&priv_ctx->prev_mv);
+    priv_ctx->mv      = av_mallocz(priv_ctx->mb_w * priv_ctx->mb_h * sizeof(*priv_ctx->mv));
+    priv_ctx->prev_mv = av_mallocz(priv_ctx->mb_w * priv_ctx->mb_h * sizeof(*priv_ctx->prev_mv));
+    if (!priv_ctx->mv || !priv_ctx->prev_mv)
+        return AVERROR(ENOMEM);
+
     priv_ctx->srce_time_base = inlink->time_base;
     priv_ctx->srce_w = inlink->w;
     priv_ctx->srce_h = inlink->h;
@@ -735,6 +969,10 @@ static int config_output(AVFilterLink *outlink)
     av_log(ctx, AV_LOG_INFO, "fps -> fps:%u/%u scene score:%f interpolate start:%d end:%d\n",
             priv_ctx->dest_frame_rate.num, priv_ctx->dest_frame_rate.den,
             priv_ctx->scene_score, priv_ctx->interp_start, priv_ctx->interp_end);
+    if (priv_ctx->flags & FRAMERATE_FLAG_MC)
+        av_log(ctx, AV_LOG_INFO, "motion compensation, %s, search range:%d, %d thread(s)\n",
+               priv_ctx->flags & FRAMERATE_FLAG_SATD ? "satd" : "sad",
+               priv_ctx->search_range, priv_ctx->nb_threads);
 
     return 0;
 }
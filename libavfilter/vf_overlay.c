@@ -27,11 +27,13 @@
  */
 
 #include "avfilter.h"
+#include "libavutil/cpu.h"
 #include "libavutil/eval.h"
 #include "libavutil/avstring.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/mathematics.h"
+#include "libavutil/opt.h"
 #include "drawutils.h"
 #include "internal.h"
 
@@ -66,6 +68,7 @@ enum { R = 0, G, B, A };
 enum { Y = 0, U, V };
 
 typedef struct {
+    const AVClass *class;
     int x, y;                   ///< position of overlayed picture
 
     int allow_packed_rgb;
@@ -82,32 +85,60 @@ typedef struct {
     int main_pix_step[4];       ///< steps per pixel for each plane of the main output
     int overlay_pix_step[4];    ///< steps per pixel for each plane of the overlay
     int hsub, vsub;             ///< chroma subsampling values
+    int overlay_hsub, overlay_vsub; ///< chroma subsampling values of the overlay
+    int main_depth;             ///< bits per sample of main, more than 8 in 16-bit words
+    int premultiplied;          ///< the overlay color components are premultiplied by alpha
 
-    char x_expr[256], y_expr[256], rgb_expr[256];
+    FFBlendDSPContext blend;
+    uint8_t *alpha_line;        ///< alpha of a line of main subsampled samples
+    uint8_t *src_line;          ///< overlay samples at the positions of a line of main
+
+    char x_expr[256], y_expr[256];
 } OverlayContext;
 
+#define OFFSET(x) offsetof(OverlayContext, x)
+
+static const AVOption overlay_options[] = {
+    {"rgb",           "blend in packed RGB",                     OFFSET(allow_packed_rgb), FF_OPT_TYPE_INT, {.dbl=0}, 0, 1 },
+    {"premultiplied", "overlay colors premultiplied by its alpha", OFFSET(premultiplied),  FF_OPT_TYPE_INT, {.dbl=0}, 0, 1 },
+    {NULL},
+};
+
+static const char *overlay_get_name(void *ctx)
+{
+    return "overlay";
+}
+
+static const AVClass overlay_class = {
+    "OverlayContext",
+    overlay_get_name,
+    overlay_options
+};
+
 static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
 {
     OverlayContext *over = ctx->priv;
+    int len = 0, ret;
 
 #ifdef DEBUG
     av_log(ctx, AV_LOG_DEBUG, "init()\n");
 #endif
 
+    over->class = &overlay_class;
+    av_opt_set_defaults(over);
+
     av_strlcpy(over->x_expr,   "0", sizeof(over->x_expr));
     av_strlcpy(over->y_expr,   "0", sizeof(over->y_expr));
-    av_strlcpy(over->rgb_expr, "0", sizeof(over->rgb_expr));
-
-    if (args)
-        sscanf(args, "%255[^:]:%255[^:]:%255[^:]", over->x_expr, over->y_expr, over->rgb_expr);
 
-    if (over->rgb_expr && strstr(over->rgb_expr,"rgb=1")) {
-#ifdef DEBUG
-        av_log(ctx, AV_LOG_DEBUG, "config_input_overlay() RGB\n");
-#endif
-        over->allow_packed_rgb = 1;
+    if (args) {
+        sscanf(args, "%255[^:]:%255[^:]%n", over->x_expr, over->y_expr, &len);
+        if (len && args[len] == ':' &&
+            (ret = av_set_options_string(over, args+len+1, "=", ":")) < 0)
+            return ret;
     }
 
+    ff_blend_init_dsp(&over->blend, av_get_cpu_flags());
+
     return 0;
 }
 
@@ -117,6 +148,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     if (over->overpicref)
         avfilter_unref_buffer(over->overpicref);
+    av_freep(&over->alpha_line);
+    av_freep(&over->src_line);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -124,7 +157,9 @@ static int query_formats(AVFilterContext *ctx)
     OverlayContext *over = ctx->priv;
 
     /* overlay formats contains alpha, for avoiding conversion with alpha information loss */
-    const enum PixelFormat main_pix_fmts_yuv[] = { PIX_FMT_YUV420P, PIX_FMT_YUVA420P, PIX_FMT_NONE };
+    const enum PixelFormat main_pix_fmts_yuv[] = {
+        PIX_FMT_YUV420P, PIX_FMT_YUVA420P, PIX_FMT_YUV422P10, PIX_FMT_NONE
+    };
     const enum PixelFormat overlay_pix_fmts_yuv[] = { PIX_FMT_YUVA420P, PIX_FMT_NONE };
     const enum PixelFormat main_pix_fmts_rgb[] = {
         PIX_FMT_ARGB,  PIX_FMT_RGBA,
@@ -179,11 +214,25 @@ static int config_input_main(AVFilterLink *inlink)
 
     over->hsub = pix_desc->log2_chroma_w;
     over->vsub = pix_desc->log2_chroma_h;
+    over->main_depth = pix_desc->comp[0].depth_minus1 + 1;
 
     over->main_is_packed_rgb =
         ff_fill_rgba_map(over->main_rgba_map, inlink->format) >= 0;
     over->main_has_alpha = ff_fmt_is_in(inlink->format, alpha_pix_fmts);
 
+    if (over->premultiplied && (over->main_is_packed_rgb || over->main_has_alpha)) {
+        av_log(ctx, AV_LOG_ERROR,
+               "Premultiplied overlay is only supported on YUV without alpha\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_freep(&over->alpha_line);
+    av_freep(&over->src_line);
+    over->alpha_line = av_malloc(inlink->w);
+    over->src_line   = av_malloc(inlink->w);
+    if (!over->alpha_line || !over->src_line)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -201,6 +250,8 @@ static int config_input_overlay(AVFilterLink *inlink)
 #endif
 
     av_image_fill_max_pixsteps(over->overlay_pix_step, NULL, pix_desc);
+    over->overlay_hsub = pix_desc->log2_chroma_w;
+    over->overlay_vsub = pix_desc->log2_chroma_h;
 
     /* Finish the configuration by evaluating the expressions
        now when both inputs are configured. */
@@ -305,16 +356,108 @@ static void start_frame_overlay(AVFilterLink *inlink, AVFilterBufferRef *inpicre
     over->overpicref = inpicref;
 }
 
-// divide by 255 and round to nearest
-// apply a fast variant: (X+127)/255 = ((X+127)*257+257)>>16 = ((X+128)*257)>>16
-#define FAST_DIV255(x) ((((x) + 128) * 257) >> 16)
-
 // calculate the unpremultiplied alpha, applying the general equation:
 // alpha = alpha_overlay / ( (alpha_main + alpha_overlay) - (alpha_main * alpha_overlay) )
 // (((x) << 16) - ((x) << 9) + (x)) is a faster version of: 255 * 255 * x
 // ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)) is a faster version of: 255 * (x + y)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
 
+static void blend_samples(OverlayContext *over, uint8_t *dst, const uint8_t *src,
+                          const uint8_t *alpha, int w, int plane)
+{
+    const int shift = over->main_depth - 8;
+    const int bias  = plane ? 128 << shift : 0;
+
+    if (shift) {
+        if (over->premultiplied)
+            over->blend.blend_line16_premul((uint16_t *)dst, src, alpha, w, shift, bias);
+        else
+            over->blend.blend_line16((uint16_t *)dst, src, alpha, w, shift);
+    } else {
+        if (over->premultiplied)
+            over->blend.blend_line_premul(dst, src, alpha, w, bias);
+        else
+            over->blend.blend_line(dst, src, alpha, w);
+    }
+}
+
+/**
+ * Blend an 8 bits YUVA overlay on a planar YUV main picture without alpha,
+ * with 8 bits samples or deeper ones in 16-bit words. The overlay is scaled
+ * up to the depth of main and sampled at the chroma positions of main,
+ * which may be subsampled differently; the alpha of a chroma sample is the
+ * average of the overlay alpha samples it covers.
+ */
+static void blend_slice_yuv(AVFilterContext *ctx,
+                            AVFilterBufferRef *dst, AVFilterBufferRef *src,
+                            int x, int y, int width, int start_y, int height)
+{
+    OverlayContext *over = ctx->priv;
+    const int bps = over->main_depth > 8 ? 2 : 1;
+    int i, j, k;
+
+    for (i = 0; i < 3; i++) {
+        int hsub  = i ? over->hsub : 0;
+        int vsub  = i ? over->vsub : 0;
+        int ohsub = i ? over->overlay_hsub : 0;
+        int ovsub = i ? over->overlay_vsub : 0;
+        int x0 = x >> hsub;
+        int y0 = start_y >> vsub;
+        int wp = ((x + width - 1) >> hsub) - x0 + 1;
+        int hp = ((start_y + height - 1) >> vsub) - y0 + 1;
+        /* samples of main covering a whole block of the overlay */
+        int kf = x0 << hsub < x;
+        int kl = FFMAX(((x + width) >> hsub) - x0, kf);
+        uint8_t *dp = dst->data[i] + x0 * bps + y0 * dst->linesize[i];
+
+        for (j = 0; j < hp; j++) {
+            /* overlay rows covered by this row of main */
+            int oy0 = FFMAX((y0 + j) << vsub, start_y) - y;
+            int oy1 = FFMIN((y0 + j + 1) << vsub, start_y + height) - y;
+            int rows = oy1 - oy0;
+            const uint8_t *s = src->data[i] + (oy0 >> ovsub) * src->linesize[i];
+            const uint8_t *a = src->data[3] + oy0 * src->linesize[3];
+            const uint8_t *alpha = a, *sline;
+
+            if (hsub || vsub) {
+                uint8_t *abuf = over->alpha_line;
+                for (k = 0; k < wp; k++) {
+                    /* overlay columns covered by this sample of main */
+                    int ox0 = FFMAX((x0 + k) << hsub, x) - x;
+                    int ox1 = FFMIN((x0 + k + 1) << hsub, x + width) - x;
+                    int t = 0, ax, ay;
+
+                    if (k == kf && kl > kf && !(rows & (rows - 1))) {
+                        over->blend.alpha_line(abuf + k, a + ox0, src->linesize[3],
+                                               kl - kf, hsub, av_log2(rows), 255);
+                        k = kl - 1;
+                        continue;
+                    }
+                    for (ay = 0; ay < rows; ay++)
+                        for (ax = ox0; ax < ox1; ax++)
+                            t += a[ay * src->linesize[3] + ax];
+                    abuf[k] = t / (rows * (ox1 - ox0));
+                }
+                alpha = abuf;
+            }
+
+            if (hsub == ohsub) {
+                /* from the first whole block, the overlay samples follow
+                   those of main */
+                if (kf)
+                    blend_samples(over, dp, s, alpha, 1, i);
+                sline = s + ((((x0 + kf) << hsub) - x) >> ohsub);
+                blend_samples(over, dp + kf * bps, sline, alpha + kf, wp - kf, i);
+            } else {
+                for (k = 0; k < wp; k++)
+                    over->src_line[k] = s[(FFMAX((x0 + k) << hsub, x) - x) >> ohsub];
+                blend_samples(over, dp, over->src_line, alpha, wp, i);
+            }
+            dp += dst->linesize[i];
+        }
+    }
+}
+
 static void blend_slice(AVFilterContext *ctx,
                         AVFilterBufferRef *dst, AVFilterBufferRef *src,
                         int x, int y, int w, int h,
@@ -332,7 +475,9 @@ static void blend_slice(AVFilterContext *ctx,
     start_y = FFMAX(y, slice_y);
     height = end_y - start_y;
 
-    if (over->main_is_packed_rgb) {
+    if (!over->main_is_packed_rgb && !over->main_has_alpha) {
+        blend_slice_yuv(ctx, dst, src, x, y, width, start_y, height);
+    } else if (over->main_is_packed_rgb) {
         uint8_t *dp = dst->data[0] + x * over->main_pix_step[0] +
                       start_y * dst->linesize[0];
         uint8_t *sp = src->data[0];
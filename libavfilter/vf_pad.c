@@ -83,6 +83,8 @@ static int query_formats(AVFilterContext *ctx)
         PIX_FMT_YUVJ420P,     PIX_FMT_YUVJ440P,
         PIX_FMT_YUVA420P,
 
+        PIX_FMT_YUV422P10,
+
         PIX_FMT_NONE
     };
 
@@ -352,15 +354,18 @@ static int does_clip(PadContext *pad, AVFilterBufferRef *outpicref, int plane, i
              +  (x >> hsub) * pad      ->line_step[plane]
              +  (y >> vsub) * outpicref->linesize [plane];
 
-    if(x_in_buf < 0 || x_in_buf % pad->line_step[plane])
+    if(x_in_buf < 0)
         return 1;
-    x_in_buf /= pad->line_step[plane];
 
     av_assert0(outpicref->buf->linesize[plane]>0); //while reference can use negative linesize the main buffer should not
 
     y_in_buf = x_in_buf / outpicref->buf->linesize[plane];
     x_in_buf %= outpicref->buf->linesize[plane];
 
+    if(x_in_buf % pad->line_step[plane])
+        return 1;
+    x_in_buf /= pad->line_step[plane];
+
     if(   y_in_buf<<vsub >= outpicref->buf->h
        || x_in_buf<<hsub >= outpicref->buf->w)
         return 1;
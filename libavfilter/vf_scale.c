@@ -23,6 +23,7 @@
  * scale video filter
  */
 
+#include <strings.h>
 #include "avfilter.h"
 #include "libavutil/avstring.h"
 #include "libavutil/eval.h"
@@ -77,16 +78,46 @@ typedef struct {
     int slice_y;                ///< top of current output slice
     int input_is_pal;           ///< set to 1 if the input format is paletted
     int interlaced;
+    int in_color_matrix;        ///< SWS_CS_* of the input, -1 if not converted
+    int out_color_matrix;       ///< SWS_CS_* of the output, -1 if not converted
 
     char w_expr[256];           ///< width  expression string
     char h_expr[256];           ///< height expression string
 } ScaleContext;
 
+static int parse_color_matrix(AVFilterContext *ctx, const char *args, const char *key)
+{
+    static const struct {
+        const char *name;
+        int colorspace;
+    } matrices[] = {
+        { "bt709",     SWS_CS_ITU709    },
+        { "bt601",     SWS_CS_ITU601    },
+        { "fcc",       SWS_CS_FCC       },
+        { "smpte240m", SWS_CS_SMPTE240M },
+    };
+    const char *p = strstr(args, key);
+    int i;
+
+    if (!p)
+        return -1;
+    p += strlen(key);
+    for (i = 0; i < FF_ARRAY_ELEMS(matrices); i++) {
+        int len = strlen(matrices[i].name);
+        if (!strncasecmp(p, matrices[i].name, len) && (!p[len] || p[len] == ':'))
+            return matrices[i].colorspace;
+    }
+    av_log(ctx, AV_LOG_ERROR, "invalid %s, possible values: bt709,bt601,fcc,smpte240m\n", key);
+    return AVERROR(EINVAL);
+}
+
 static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
 {
     ScaleContext *scale = ctx->priv;
     const char *p;
 
+    scale->in_color_matrix  = -1;
+    scale->out_color_matrix = -1;
     av_strlcpy(scale->w_expr, "iw", sizeof(scale->w_expr));
     av_strlcpy(scale->h_expr, "ih", sizeof(scale->h_expr));
 
@@ -99,6 +130,14 @@ static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
             scale->interlaced=1;
         }else if(strstr(args,"interl=-1"))
             scale->interlaced=-1;
+        scale->in_color_matrix  = parse_color_matrix(ctx, args, "in_color_matrix=");
+        scale->out_color_matrix = parse_color_matrix(ctx, args, "out_color_matrix=");
+        if (scale->in_color_matrix < -1 || scale->out_color_matrix < -1)
+            return AVERROR(EINVAL);
+        if ((scale->in_color_matrix < 0) != (scale->out_color_matrix < 0)) {
+            av_log(ctx, AV_LOG_ERROR, "in_color_matrix and out_color_matrix must be set together\n");
+            return AVERROR(EINVAL);
+        }
     }
 
     return 0;
@@ -228,7 +267,8 @@ static int config_props(AVFilterLink *outlink)
     if (scale->sws)
         sws_freeContext(scale->sws);
     if (inlink->w == outlink->w && inlink->h == outlink->h &&
-        inlink->format == outlink->format) {
+        inlink->format == outlink->format &&
+        scale->in_color_matrix == scale->out_color_matrix) {
         scale->sws = NULL;
     } else {
         scale->sws = sws_getContext(inlink ->w, inlink ->h, inlink ->format,
@@ -246,6 +286,21 @@ static int config_props(AVFilterLink *outlink)
                                         scale->flags, NULL, NULL, NULL);
         if (!scale->sws)
             return AVERROR(EINVAL);
+        if (scale->in_color_matrix != scale->out_color_matrix) {
+            const int *in  = sws_getCoefficients(scale->in_color_matrix);
+            const int *out = sws_getCoefficients(scale->out_color_matrix);
+            /* the matrix is applied to each line as it is output */
+            if (sws_setColorspaceDetails(scale->sws, in, 0, out, 0, 0, 1<<16, 1<<16) < 0 ||
+                (scale->isws[0] &&
+                 sws_setColorspaceDetails(scale->isws[0], in, 0, out, 0, 0, 1<<16, 1<<16) < 0) ||
+                (scale->isws[1] &&
+                 sws_setColorspaceDetails(scale->isws[1], in, 0, out, 0, 0, 1<<16, 1<<16) < 0)) {
+                av_log(ctx, AV_LOG_ERROR, "color matrix conversion is not supported "
+                       "from %s to %s\n", av_pix_fmt_descriptors[inlink->format].name,
+                       av_pix_fmt_descriptors[outlink->format].name);
+                return AVERROR(EINVAL);
+            }
+        }
     }
 
     return 0;
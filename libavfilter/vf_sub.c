@@ -63,6 +63,15 @@ typedef struct {
     int hsub, vsub;
     int vmargin;
     int font_encoding;
+    FFDrawContext layer_dc;              ///< 8-bit layout of the output, for the cache
+    uint8_t *layer[MAX_PLANES];          ///< rendered subtitles, premultiplied
+    uint8_t *layer_alpha[MAX_PLANES];    ///< coverage of the rendered subtitles
+    int layer_linesize[MAX_PLANES];
+    int layer_valid;
+    int layer_x0, layer_y0, layer_x1, layer_y1; ///< area covered by the cache
+    uint8_t *box;                        ///< opaque box mask
+    unsigned box_size;
+    int64_t frames, cache_hits;
 } SubContext;
 
 static void message_callback(int level, const char *format, va_list va, void *ctx)
@@ -516,10 +525,27 @@ static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
     return 0;
 }
 
+static void free_layer(SubContext *sub)
+{
+    int i;
+
+    for (i = 0; i < MAX_PLANES; i++) {
+        av_freep(&sub->layer[i]);
+        av_freep(&sub->layer_alpha[i]);
+    }
+    sub->layer_valid = 0;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     SubContext *sub = ctx->priv;
 
+    if (sub->frames)
+        av_log(ctx, AV_LOG_INFO, "%"PRId64" frames, %"PRId64" from cache (%.1f%%)\n",
+               sub->frames, sub->cache_hits, 100.0 * sub->cache_hits / sub->frames);
+    free_layer(sub);
+    av_freep(&sub->box);
+
     if (sub->ass_track)
         ass_free_track(sub->ass_track);
     if (sub->ass_renderer)
@@ -538,16 +564,58 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
+/**
+ * Allocate the subtitle cache. It is kept at 8 bits in the layout of the
+ * output, deeper formats use the 8-bit planar format of same subsampling.
+ */
+static int config_layer(AVFilterLink *link)
+{
+    SubContext *sub = link->dst->priv;
+    enum PixelFormat format = link->format;
+    int i;
+
+    if (sub->dc.pixelstep[0] == 2) {
+        for (format = 0; format < PIX_FMT_NB; format++) {
+            if (ff_draw_init(&sub->layer_dc, format, 0) >= 0 &&
+                sub->layer_dc.pixelstep[0] == 1 &&
+                !(sub->layer_dc.desc->flags & PIX_FMT_RGB) &&
+                sub->layer_dc.nb_planes == sub->dc.nb_planes &&
+                !memcmp(sub->layer_dc.hsub, sub->dc.hsub, sizeof(sub->dc.hsub)) &&
+                !memcmp(sub->layer_dc.vsub, sub->dc.vsub, sizeof(sub->dc.vsub)))
+                break;
+        }
+        if (format == PIX_FMT_NB)
+            return AVERROR(ENOSYS);
+    } else
+        ff_draw_init(&sub->layer_dc, format, 0);
+
+    free_layer(sub);
+    for (i = 0; i < sub->layer_dc.nb_planes; i++) {
+        int w = -((-link->w) >> sub->layer_dc.hsub[i]);
+        int h = -((-link->h) >> sub->layer_dc.vsub[i]);
+        sub->layer_linesize[i] = FFALIGN(w * sub->layer_dc.pixelstep[i], 16);
+        sub->layer[i]       = av_malloc(sub->layer_linesize[i] * h);
+        sub->layer_alpha[i] = av_malloc(sub->layer_linesize[i] * h);
+        if (!sub->layer[i] || !sub->layer_alpha[i])
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
 static int config_input(AVFilterLink *link)
 {
     AVFilterContext *ctx = link->dst;
     SubContext *sub = ctx->priv;
     AVRational dar;
     AVRational sar;
+    int ret;
 
-    ff_draw_init(&sub->dc, link->format, 0);
+    if ((ret = ff_draw_init(&sub->dc, link->format, 0)) < 0)
+        return ret;
     ff_draw_color(&sub->dc, &sub->textcolor, sub->textcolor.rgba);
     ff_draw_color(&sub->dc, &sub->boxcolor, sub->boxcolor.rgba);
+    if ((ret = config_layer(link)) < 0)
+        return ret;
 
     dar.num = link->w*link->sample_aspect_ratio.num;
     dar.den = link->h*link->sample_aspect_ratio.den;
@@ -585,30 +653,85 @@ static void null_draw_slice(AVFilterLink *link, int y, int h, int slice_dir)
 #define B(c)  (((c)>>8)&0xFF)
 #define A(c)  ((c)&0xFF)
 
-static void blend_ass_image(AVFilterContext *ctx, AVFilterBufferRef *ref, ASS_Image *img)
+/* planes blended, the alpha plane of the output is left untouched */
+static int color_planes(FFDrawContext *dc)
 {
-    SubContext *sub = ctx->priv;
+    return (dc->nb_planes - 1) | 1;
+}
+
+static int is_chroma(FFDrawContext *dc, int plane)
+{
+    return !(dc->desc->flags & PIX_FMT_RGB) && (plane == 1 || plane == 2);
+}
+
+/**
+ * Composite one image into the cache. Colors blended straight over a
+ * layer cleared to the zero level give premultiplied values, the coverage
+ * is blended the same way as full white.
+ */
+static void blend_ass_image(AVFilterLink *link, ASS_Image *img)
+{
+    SubContext *sub = link->dst->priv;
     int opacity = 255 - A(img->color);
-    FFDrawColor color;
+    FFDrawColor color, coverage;
     uint8_t rgba_color[] = { R(img->color), G(img->color), B(img->color), opacity };
 
-    ff_draw_color(&sub->dc, &color, rgba_color);
-    ff_blend_mask(&sub->dc, &color,
-                  ref->data, ref->linesize,
-                  ref->video->w, ref->video->h,
+    ff_draw_color(&sub->layer_dc, &color, rgba_color);
+    memset(&coverage, 0xff, sizeof(coverage));
+    coverage.rgba[3] = opacity;
+    ff_blend_mask(&sub->layer_dc, &color,
+                  sub->layer, sub->layer_linesize, link->w, link->h,
+                  img->bitmap, img->stride, img->w, img->h,
+                  3, 0, img->dst_x, img->dst_y);
+    ff_blend_mask(&sub->layer_dc, &coverage,
+                  sub->layer_alpha, sub->layer_linesize, link->w, link->h,
                   img->bitmap, img->stride, img->w, img->h,
                   3, 0, img->dst_x, img->dst_y);
 }
 
-static void end_frame(AVFilterLink *link)
+/* clear the cache over the bounding rectangle of the images */
+static void clear_layer(AVFilterLink *link, ASS_Image *img)
 {
-    AVFilterContext *ctx = link->dst;
     SubContext *sub = link->dst->priv;
-    int64_t pts = av_rescale_q(link->cur_buf->pts, link->time_base,
-                               (AVRational){ 1, 1000 });
-    int detect_change;
-    ASS_Image *img = ass_render_frame(sub->ass_renderer, sub->ass_track,
-                                      pts, &detect_change);
+    FFDrawContext *dc = &sub->layer_dc;
+    int x0 = link->w, y0 = link->h, x1 = 0, y1 = 0;
+    int plane, y;
+
+    for (; img; img = img->next) {
+        x0 = FFMIN(x0, img->dst_x);
+        y0 = FFMIN(y0, img->dst_y);
+        x1 = FFMAX(x1, img->dst_x + img->w);
+        y1 = FFMAX(y1, img->dst_y + img->h);
+    }
+    x0 = FFMAX(x0, 0) & ~((1 << dc->hsub_max) - 1);
+    y0 = FFMAX(y0, 0) & ~((1 << dc->vsub_max) - 1);
+    x1 = FFMIN(x1, link->w);
+    y1 = FFMIN(y1, link->h);
+    if (x0 >= x1 || y0 >= y1)
+        x0 = y0 = x1 = y1 = 0;
+    sub->layer_x0 = x0;
+    sub->layer_y0 = y0;
+    sub->layer_x1 = x1;
+    sub->layer_y1 = y1;
+
+    for (plane = 0; plane < color_planes(dc); plane++) {
+        int hsub = dc->hsub[plane], vsub = dc->vsub[plane];
+        int x = x0 >> hsub, w = (-((-x1) >> hsub) - x) * dc->pixelstep[plane];
+        int offset = x * dc->pixelstep[plane];
+        for (y = y0 >> vsub; y < -((-y1) >> vsub); y++) {
+            memset(sub->layer[plane] + y * sub->layer_linesize[plane] + offset,
+                   is_chroma(dc, plane) ? 128 : 0, w);
+            memset(sub->layer_alpha[plane] + y * sub->layer_linesize[plane] + offset,
+                   0, w);
+        }
+    }
+}
+
+static void render_layer(AVFilterLink *link, ASS_Image *img)
+{
+    SubContext *sub = link->dst->priv;
+
+    clear_layer(link, img);
 
     if (sub->drawbox == 1 && img) {
         ASS_Image box, *i = img;
@@ -636,12 +759,20 @@ static void end_frame(AVFilterLink *link)
         box.h = max_y - min_y;
         box.dst_x = min_x;
         box.dst_y = min_y;
-        box.bitmap = av_malloc(box.w * box.h);
         box.color = sub->ass_track->styles[0].OutlineColour;
-        memset(box.bitmap, 0xff, box.w * box.h);
-        blend_ass_image(ctx, link->cur_buf, &box);
+        if (box.w > 0 && box.h > 0) {
+            if (box.w * box.h > sub->box_size) {
+                av_free(sub->box);
+                sub->box_size = 0;
+                if (!(sub->box = av_malloc(box.w * box.h)))
+                    return;
+                sub->box_size = box.w * box.h;
+            }
+            box.bitmap = sub->box;
+            memset(box.bitmap, 0xff, box.w * box.h);
+            blend_ass_image(link, &box);
+        }
         last_line_y = max_y;
-        av_free(box.bitmap);
         if (i)
             goto compute_box;
     }
@@ -651,8 +782,62 @@ static void end_frame(AVFilterLink *link)
         if (sub->drawbox == 1 &&
             img->color == sub->ass_track->styles[0].OutlineColour)
             continue;
-        blend_ass_image(ctx, link->cur_buf, img);
+        blend_ass_image(link, img);
     }
+    sub->layer_valid = 1;
+}
+
+/* blend the cache on the frame, only over the area it covers */
+static void blend_layer(AVFilterLink *link, AVFilterBufferRef *ref)
+{
+    SubContext *sub = link->dst->priv;
+    FFDrawContext *dc = &sub->dc;
+    int shift = dc->desc->comp[0].depth_minus1 + 1 - 8;
+    int plane, y;
+
+    for (plane = 0; plane < color_planes(dc); plane++) {
+        int hsub = dc->hsub[plane], vsub = dc->vsub[plane];
+        int x = sub->layer_x0 >> hsub, w = -((-sub->layer_x1) >> hsub) - x;
+        int y0 = sub->layer_y0 >> vsub, y1 = -((-sub->layer_y1) >> vsub);
+        int bias = is_chroma(dc, plane) ? 128 << shift : 0;
+        int linesize = sub->layer_linesize[plane];
+        const uint8_t *src   = sub->layer[plane]       + y0 * linesize +
+                               x * sub->layer_dc.pixelstep[plane];
+        const uint8_t *alpha = sub->layer_alpha[plane] + y0 * linesize +
+                               x * sub->layer_dc.pixelstep[plane];
+        uint8_t *dst = ref->data[plane] + y0 * ref->linesize[plane] +
+                       x * dc->pixelstep[plane];
+
+        for (y = y0; y < y1; y++) {
+            if (shift)
+                dc->blend.blend_line16_premul((uint16_t *)dst, src, alpha, w,
+                                              shift, bias);
+            else
+                dc->blend.blend_line_premul(dst, src, alpha,
+                                            w * dc->pixelstep[plane], bias);
+            src   += linesize;
+            alpha += linesize;
+            dst   += ref->linesize[plane];
+        }
+    }
+}
+
+static void end_frame(AVFilterLink *link)
+{
+    SubContext *sub = link->dst->priv;
+    int64_t pts = av_rescale_q(link->cur_buf->pts, link->time_base,
+                               (AVRational){ 1, 1000 });
+    int detect_change;
+    ASS_Image *img = ass_render_frame(sub->ass_renderer, sub->ass_track,
+                                      pts, &detect_change);
+
+    /* the images are only composited again when libass reports a change */
+    if (detect_change || !sub->layer_valid)
+        render_layer(link, img);
+    else
+        sub->cache_hits++;
+    sub->frames++;
+    blend_layer(link, link->cur_buf);
 
     avfilter_draw_slice(link->dst->outputs[0], 0, link->cur_buf->video->h, 1);
     avfilter_end_frame(link->dst->outputs[0]);
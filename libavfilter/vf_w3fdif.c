@@ -24,12 +24,21 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
+#include "w3fdif.h"
+
+#include "thread.h"
+
+#if HAVE_PTHREADS
+#include <unistd.h>
+#endif
 
 /* #define DEBUG */
 
 #undef NDEBUG
 #include <assert.h>
 
+#define MAX_THREADS 16
+
 typedef struct {
     int line_size[4];     ///< bytes of pixel data per line for each plane
     int pending;          ///< how many fields are still waiting to be sent to next filter
@@ -40,8 +49,11 @@ typedef struct {
 
     AVFilterBufferRef *prev, *crnt, *next;  ///< previous, current, next frames
     AVFilterBufferRef *work;                ///< frame we are working on
-    int32_t* work_line;   ///< line we are calculating
-
+    int depth;            ///< bits per sample, samples deeper than 8 bits are in 16-bit words
+    int nb_threads;       ///< number of bands of lines computed in parallel
+    int32_t *work_line[MAX_THREADS]; ///< line each band is calculating
+    FFFilterPool *pool;   ///< workers computing the bands
+    W3FDIFDSPContext dsp;
 } W3FDIFContext;
 
 /** Martin Weston deinterlace filter */
@@ -60,20 +72,226 @@ static const int     n_coef_hf[2]    = {3, 5};
 static const int32_t   coef_hf[2][5] = {{ -4096,  8192, -4096,     0,     0},
                                         {  2032, -7602, 11140, -7602,  2032}};
 
-static int deinterlace_component(AVFilterContext *ctx,
+/** low vertical frequencies from the current field, simple filter */
+void ff_w3fdif_simple_low_c(int32_t *work_line, uint8_t *in_lines_cur[2],
+                            const int32_t *coef, int linesize)
+{
+    int i;
+
+    for (i = 0; i < linesize; i++) {
+        *work_line    = *in_lines_cur[0]++ * coef[0];
+        *work_line++ += *in_lines_cur[1]++ * coef[1];
+    }
+}
+
+/** low vertical frequencies from the current field, more complex filter */
+void ff_w3fdif_complex_low_c(int32_t *work_line, uint8_t *in_lines_cur[4],
+                             const int32_t *coef, int linesize)
+{
+    int i;
+
+    for (i = 0; i < linesize; i++) {
+        *work_line    = *in_lines_cur[0]++ * coef[0];
+        *work_line   += *in_lines_cur[1]++ * coef[1];
+        *work_line   += *in_lines_cur[2]++ * coef[2];
+        *work_line++ += *in_lines_cur[3]++ * coef[3];
+    }
+}
+
+/** high vertical frequencies from the current and adjacent fields, simple filter */
+void ff_w3fdif_simple_high_c(int32_t *work_line, uint8_t *in_lines_cur[3],
+                             uint8_t *in_lines_adj[3], const int32_t *coef,
+                             int linesize)
+{
+    int i;
+
+    for (i = 0; i < linesize; i++) {
+        *work_line   += *in_lines_cur[0]++ * coef[0];
+        *work_line   += *in_lines_adj[0]++ * coef[0];
+        *work_line   += *in_lines_cur[1]++ * coef[1];
+        *work_line   += *in_lines_adj[1]++ * coef[1];
+        *work_line   += *in_lines_cur[2]++ * coef[2];
+        *work_line++ += *in_lines_adj[2]++ * coef[2];
+    }
+}
+
+/** high vertical frequencies from the current and adjacent fields, more complex filter */
+void ff_w3fdif_complex_high_c(int32_t *work_line, uint8_t *in_lines_cur[5],
+                              uint8_t *in_lines_adj[5], const int32_t *coef,
+                              int linesize)
+{
+    int i;
+
+    for (i = 0; i < linesize; i++) {
+        *work_line   += *in_lines_cur[0]++ * coef[0];
+        *work_line   += *in_lines_adj[0]++ * coef[0];
+        *work_line   += *in_lines_cur[1]++ * coef[1];
+        *work_line   += *in_lines_adj[1]++ * coef[1];
+        *work_line   += *in_lines_cur[2]++ * coef[2];
+        *work_line   += *in_lines_adj[2]++ * coef[2];
+        *work_line   += *in_lines_cur[3]++ * coef[3];
+        *work_line   += *in_lines_adj[3]++ * coef[3];
+        *work_line   += *in_lines_cur[4]++ * coef[4];
+        *work_line++ += *in_lines_adj[4]++ * coef[4];
+    }
+}
+
+/** save scaled result to the output line, scaling down by 256 * 256 */
+void ff_w3fdif_scale_c(uint8_t *out_pixel, const int32_t *work_pixel,
+                       int linesize, int max)
+{
+    int j;
+
+    for (j = 0; j < linesize; j++, out_pixel++, work_pixel++)
+        *out_pixel = av_clip(*work_pixel, 0, 255 << 16) >> 16;
+}
+
+/** the same on samples in 16-bit words, linesize counts samples */
+void ff_w3fdif16_simple_low_c(int32_t *work_line, uint8_t *in_lines_cur8[2],
+                              const int32_t *coef, int linesize)
+{
+    uint16_t *in_lines_cur[2] = { (uint16_t *)in_lines_cur8[0],
+                                  (uint16_t *)in_lines_cur8[1] };
+    int i;
+
+    for (i = 0; i < linesize; i++) {
+        *work_line    = *in_lines_cur[0]++ * coef[0];
+        *work_line++ += *in_lines_cur[1]++ * coef[1];
+    }
+}
+
+void ff_w3fdif16_complex_low_c(int32_t *work_line, uint8_t *in_lines_cur8[4],
+                               const int32_t *coef, int linesize)
+{
+    uint16_t *in_lines_cur[4] = { (uint16_t *)in_lines_cur8[0],
+                                  (uint16_t *)in_lines_cur8[1],
+                                  (uint16_t *)in_lines_cur8[2],
+                                  (uint16_t *)in_lines_cur8[3] };
+    int i;
+
+    for (i = 0; i < linesize; i++) {
+        *work_line    = *in_lines_cur[0]++ * coef[0];
+        *work_line   += *in_lines_cur[1]++ * coef[1];
+        *work_line   += *in_lines_cur[2]++ * coef[2];
+        *work_line++ += *in_lines_cur[3]++ * coef[3];
+    }
+}
+
+void ff_w3fdif16_simple_high_c(int32_t *work_line, uint8_t *in_lines_cur8[3],
+                               uint8_t *in_lines_adj8[3], const int32_t *coef,
+                               int linesize)
+{
+    uint16_t *in_lines_cur[3] = { (uint16_t *)in_lines_cur8[0],
+                                  (uint16_t *)in_lines_cur8[1],
+                                  (uint16_t *)in_lines_cur8[2] };
+    uint16_t *in_lines_adj[3] = { (uint16_t *)in_lines_adj8[0],
+                                  (uint16_t *)in_lines_adj8[1],
+                                  (uint16_t *)in_lines_adj8[2] };
+    int i;
+
+    for (i = 0; i < linesize; i++) {
+        *work_line   += *in_lines_cur[0]++ * coef[0];
+        *work_line   += *in_lines_adj[0]++ * coef[0];
+        *work_line   += *in_lines_cur[1]++ * coef[1];
+        *work_line   += *in_lines_adj[1]++ * coef[1];
+        *work_line   += *in_lines_cur[2]++ * coef[2];
+        *work_line++ += *in_lines_adj[2]++ * coef[2];
+    }
+}
+
+void ff_w3fdif16_complex_high_c(int32_t *work_line, uint8_t *in_lines_cur8[5],
+                                uint8_t *in_lines_adj8[5], const int32_t *coef,
+                                int linesize)
+{
+    uint16_t *in_lines_cur[5] = { (uint16_t *)in_lines_cur8[0],
+                                  (uint16_t *)in_lines_cur8[1],
+                                  (uint16_t *)in_lines_cur8[2],
+                                  (uint16_t *)in_lines_cur8[3],
+                                  (uint16_t *)in_lines_cur8[4] };
+    uint16_t *in_lines_adj[5] = { (uint16_t *)in_lines_adj8[0],
+                                  (uint16_t *)in_lines_adj8[1],
+                                  (uint16_t *)in_lines_adj8[2],
+                                  (uint16_t *)in_lines_adj8[3],
+                                  (uint16_t *)in_lines_adj8[4] };
+    int i;
+
+    for (i = 0; i < linesize; i++) {
+        *work_line   += *in_lines_cur[0]++ * coef[0];
+        *work_line   += *in_lines_adj[0]++ * coef[0];
+        *work_line   += *in_lines_cur[1]++ * coef[1];
+        *work_line   += *in_lines_adj[1]++ * coef[1];
+        *work_line   += *in_lines_cur[2]++ * coef[2];
+        *work_line   += *in_lines_adj[2]++ * coef[2];
+        *work_line   += *in_lines_cur[3]++ * coef[3];
+        *work_line   += *in_lines_adj[3]++ * coef[3];
+        *work_line   += *in_lines_cur[4]++ * coef[4];
+        *work_line++ += *in_lines_adj[4]++ * coef[4];
+    }
+}
+
+void ff_w3fdif16_scale_c(uint8_t *out_pixel8, const int32_t *work_pixel,
+                         int linesize, int max)
+{
+    uint16_t *out_pixel = (uint16_t *)out_pixel8;
+    int j;
+
+    for (j = 0; j < linesize; j++, out_pixel++, work_pixel++)
+        *out_pixel = av_clip(*work_pixel, 0, max << 16) >> 16;
+}
+
+void ff_w3fdif_init_dsp(W3FDIFDSPContext *dsp, int depth, int cpu_flags)
+{
+    if (depth > 8) {
+        dsp->filter_simple_low   = ff_w3fdif16_simple_low_c;
+        dsp->filter_complex_low  = ff_w3fdif16_complex_low_c;
+        dsp->filter_simple_high  = ff_w3fdif16_simple_high_c;
+        dsp->filter_complex_high = ff_w3fdif16_complex_high_c;
+        dsp->filter_scale        = ff_w3fdif16_scale_c;
+    } else {
+        dsp->filter_simple_low   = ff_w3fdif_simple_low_c;
+        dsp->filter_complex_low  = ff_w3fdif_complex_low_c;
+        dsp->filter_simple_high  = ff_w3fdif_simple_high_c;
+        dsp->filter_complex_high = ff_w3fdif_complex_high_c;
+        dsp->filter_scale        = ff_w3fdif_scale_c;
+    }
+
+#if HAVE_SSE
+    /* the SSE2 functions double the samples in signed 16-bit words */
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        if (depth <= 8) {
+            dsp->filter_simple_low   = ff_w3fdif_simple_low_sse2;
+            dsp->filter_complex_low  = ff_w3fdif_complex_low_sse2;
+            dsp->filter_simple_high  = ff_w3fdif_simple_high_sse2;
+            dsp->filter_complex_high = ff_w3fdif_complex_high_sse2;
+            dsp->filter_scale        = ff_w3fdif_scale_sse2;
+        } else if (depth <= 14) {
+            dsp->filter_simple_low   = ff_w3fdif16_simple_low_sse2;
+            dsp->filter_complex_low  = ff_w3fdif16_complex_low_sse2;
+            dsp->filter_simple_high  = ff_w3fdif16_simple_high_sse2;
+            dsp->filter_complex_high = ff_w3fdif16_complex_high_sse2;
+            dsp->filter_scale        = ff_w3fdif16_scale_sse2;
+        }
+    }
+#endif
+}
+
+/**
+ * Deinterlace one band of lines of a plane, the lines of the frame are
+ * split evenly in nb_jobs bands.
+ */
+static void deinterlace_component(AVFilterContext *ctx,
         const AVFilterBufferRef *cur, const AVFilterBufferRef *adj,
-        const int filter, const int plane)
+        const int filter, const int plane, int32_t *work_line,
+        int jobnr, int nb_jobs)
 {
     W3FDIFContext *w3fdif = ctx->priv;
+    W3FDIFDSPContext *dsp = &w3fdif->dsp;
 
     uint8_t *in_line, *out_line;
     uint8_t *in_lines_cur[5];
     uint8_t *in_lines_adj[5];
-    uint8_t *out_pixel;
-    int32_t* work_line;
-    int32_t *work_pixel;
-    int j, y_in, y_out;
-    int cur_line_stride, adj_line_stride, dst_line_stride, line_size;
+    int j, y_in, y_out, y_end, nb_lines;
+    int cur_line_stride, adj_line_stride, dst_line_stride, line_size, nb_samples;
     uint8_t *cur_data, *adj_data, *dst_data;
 
     cur_line_stride = cur->linesize[plane];
@@ -84,7 +302,8 @@ static int deinterlace_component(AVFilterContext *ctx,
     adj_data = adj->data[plane];
     dst_data = w3fdif->work->data[plane];
 
-    line_size = w3fdif->line_size[plane];
+    line_size  = w3fdif->line_size[plane];
+    nb_samples = w3fdif->depth > 8 ? line_size >> 1 : line_size;
 
     /** copy unchanged the lines of the field */
     if (w3fdif->field != cur->video->top_field_first) {
@@ -93,10 +312,14 @@ static int deinterlace_component(AVFilterContext *ctx,
         y_out = 1;
     }
 
+    nb_lines = (cur->video->h - y_out + 1) >> 1;
+    y_end = y_out + 2 * (nb_lines * (jobnr + 1) / nb_jobs);
+    y_out = y_out + 2 * (nb_lines *  jobnr      / nb_jobs);
+
     in_line  = cur_data + (y_out * cur_line_stride);
     out_line = dst_data + (y_out * dst_line_stride);
 
-    while (y_out < cur->video->h) {
+    while (y_out < y_end) {
         memcpy(out_line, in_line, line_size);
         y_out += 2;
         in_line  += cur_line_stride * 2;
@@ -110,11 +333,13 @@ static int deinterlace_component(AVFilterContext *ctx,
         y_out = 1;
     }
 
+    nb_lines = (w3fdif->crnt->video->h - y_out + 1) >> 1;
+    y_end = y_out + 2 * (nb_lines * (jobnr + 1) / nb_jobs);
+    y_out = y_out + 2 * (nb_lines *  jobnr      / nb_jobs);
+
     out_line = dst_data + (y_out * dst_line_stride);
 
-    while (y_out < w3fdif->crnt->video->h) {
-        /** clear workspace */
-        memset(w3fdif->work_line, 0, sizeof(uint32_t) * line_size);
+    while (y_out < y_end) {
         /** get low vertical frequencies from current field */
         for (j = 0; j < n_coef_lf[filter]; j++) {
             y_in = (y_out + 1) + (j * 2) - n_coef_lf[filter];
@@ -122,23 +347,14 @@ static int deinterlace_component(AVFilterContext *ctx,
             while (y_in >= cur->video->h) y_in -= 2;
             in_lines_cur[j] = cur_data + (y_in * cur_line_stride);
         }
-        work_line = w3fdif->work_line;
-        // TODO: set pixel stride for in
-        // these have been unrolled from an function with loops for speed
         switch (n_coef_lf[filter]) {
         case 4:
-            for (int i = 0; i < line_size; i++) {
-                *work_line   += *in_lines_cur[0]++ * coef_lf[filter][0];
-                *work_line   += *in_lines_cur[1]++ * coef_lf[filter][1];
-                *work_line   += *in_lines_cur[2]++ * coef_lf[filter][2];
-                *work_line++ += *in_lines_cur[3]++ * coef_lf[filter][3];
-            }
+            dsp->filter_complex_low(work_line, in_lines_cur,
+                                    coef_lf[filter], nb_samples);
             break;
         case 2:
-            for (int i = 0; i < line_size; i++) {
-                *work_line   += *in_lines_cur[0]++ * coef_lf[filter][0];
-                *work_line++ += *in_lines_cur[1]++ * coef_lf[filter][1];
-            }
+            dsp->filter_simple_low(work_line, in_lines_cur,
+                                   coef_lf[filter], nb_samples);
             break;
         default:
             assert(0);
@@ -151,51 +367,54 @@ static int deinterlace_component(AVFilterContext *ctx,
             in_lines_cur[j] = cur_data + (y_in * cur_line_stride);
             in_lines_adj[j] = adj_data + (y_in * adj_line_stride);
         }
-        work_line = w3fdif->work_line;
-        // TODO: set pixel stride for in
-        // these have been unrolled from an function with loops for speed
         switch (n_coef_hf[filter]) {
         case 5:
-            for (int i = 0; i < line_size; i++) {
-                *work_line   += *in_lines_cur[0]++ * coef_hf[filter][0];
-                *work_line   += *in_lines_adj[0]++ * coef_hf[filter][0];
-                *work_line   += *in_lines_cur[1]++ * coef_hf[filter][1];
-                *work_line   += *in_lines_adj[1]++ * coef_hf[filter][1];
-                *work_line   += *in_lines_cur[2]++ * coef_hf[filter][2];
-                *work_line   += *in_lines_adj[2]++ * coef_hf[filter][2];
-                *work_line   += *in_lines_cur[3]++ * coef_hf[filter][3];
-                *work_line   += *in_lines_adj[3]++ * coef_hf[filter][3];
-                *work_line   += *in_lines_cur[4]++ * coef_hf[filter][4];
-                *work_line++ += *in_lines_adj[4]++ * coef_hf[filter][4];
-            }
+            dsp->filter_complex_high(work_line, in_lines_cur, in_lines_adj,
+                                     coef_hf[filter], nb_samples);
             break;
         case 3:
-            for (int i = 0; i < line_size; i++) {
-                *work_line   += *in_lines_cur[0]++ * coef_hf[filter][0];
-                *work_line   += *in_lines_adj[0]++ * coef_hf[filter][0];
-                *work_line   += *in_lines_cur[1]++ * coef_hf[filter][1];
-                *work_line   += *in_lines_adj[1]++ * coef_hf[filter][1];
-                *work_line   += *in_lines_cur[2]++ * coef_hf[filter][2];
-                *work_line++ += *in_lines_adj[2]++ * coef_hf[filter][2];
-            }
+            dsp->filter_simple_high(work_line, in_lines_cur, in_lines_adj,
+                                    coef_hf[filter], nb_samples);
             break;
         default:
             assert(0);
         }
         /** save scaled result to the output frame, scaling down by 256 * 256 */
-        //TODO: set pixel stride for out
-        work_pixel = w3fdif->work_line;
-        out_pixel = out_line;
-        for (j = 0; j < line_size; j++) {
-            *out_pixel =  (*work_pixel>(255*256*256)?(255*256*256):(*work_pixel<0?0:*work_pixel))>>16;
-            out_pixel++;
-            work_pixel++;
-        }
+        dsp->filter_scale(out_line, work_line, nb_samples, (1 << w3fdif->depth) - 1);
         /** move on to next line */
         y_out += 2;
         out_line += dst_line_stride * 2;
     }
-    return 0;
+}
+
+typedef struct {
+    const AVFilterBufferRef *cur, *adj;
+} ThreadData;
+
+static void deinterlace_band(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    W3FDIFContext *w3fdif = ctx->priv;
+    int plane;
+
+    for (plane = 0; plane < 4 && w3fdif->crnt->data[plane]; plane++)
+        deinterlace_component(ctx, td->cur, td->adj, w3fdif->filter, plane,
+                              w3fdif->work_line[jobnr], jobnr, nb_jobs);
+}
+
+/**
+ * Deinterlace the current field, in parallel bands of lines when there
+ * is more than one thread. Every band writes its own output lines so the
+ * result does not depend on the number of threads.
+ */
+static void deinterlace_field(AVFilterContext *ctx,
+        const AVFilterBufferRef *cur, const AVFilterBufferRef *adj)
+{
+    W3FDIFContext *w3fdif = ctx->priv;
+    ThreadData td = { cur, adj };
+
+    ff_filter_pool_execute(w3fdif->pool, ctx, deinterlace_band, &td,
+                           FFMIN(w3fdif->nb_threads, (cur->video->h + 1) >> 1));
 }
 
 /** FFmpeg filter integration */
@@ -226,15 +445,9 @@ static void process_frame(AVFilterContext *ctx)
 {
     W3FDIFContext *w3fdif = ctx->priv;
 
-    int plane;
-
-    w3fdif->work_line = av_malloc(w3fdif->crnt->linesize[0] * sizeof(uint32_t));
-
     if (!w3fdif->field) {
         /** do the deinterlacing for field 0 */
-        for (plane = 0; plane < 4 && w3fdif->crnt->data[plane]; plane++) {
-            deinterlace_component(ctx, w3fdif->crnt, w3fdif->prev, w3fdif->filter, plane);
-        }
+        deinterlace_field(ctx, w3fdif->crnt, w3fdif->prev);
 
         /** prev is not neede after this point*/
         if (w3fdif->prev && w3fdif->prev != w3fdif->crnt) {
@@ -247,9 +460,7 @@ static void process_frame(AVFilterContext *ctx)
         w3fdif->next = NULL;
     } else {
         /** do the deinterlacing for field 1 */
-        for (plane = 0; plane < 4 && w3fdif->crnt->data[plane]; plane++) {
-            deinterlace_component(ctx, w3fdif->crnt, w3fdif->next, w3fdif->filter, plane);
-        }
+        deinterlace_field(ctx, w3fdif->crnt, w3fdif->next);
 
         /** at the end of the second field we _always_ copy current to previous
          *  and copy next to current */
@@ -257,8 +468,6 @@ static void process_frame(AVFilterContext *ctx)
         w3fdif->crnt = w3fdif->next;
     }
 
-    av_free(w3fdif->work_line);
-
     /** swap field */
     w3fdif->field = !w3fdif->field;
 }
@@ -270,7 +479,7 @@ static int config_input(AVFilterLink *link)
     AVFilterContext *ctx = link->dst;
     W3FDIFContext *w3fdif = ctx->priv;
 
-    int plane;
+    int plane, i;
 
     /** full an array with the number of bytes that the video
      *  data occupies per line for each plane of the input video */
@@ -280,6 +489,16 @@ static int config_input(AVFilterLink *link)
                 link->w,
                 plane);
     }
+
+    w3fdif->depth = av_pix_fmt_descriptors[link->format].comp[0].depth_minus1 + 1;
+    ff_w3fdif_init_dsp(&w3fdif->dsp, w3fdif->depth, av_get_cpu_flags());
+
+    for (i = 0; i < w3fdif->nb_threads; i++) {
+        av_freep(&w3fdif->work_line[i]);
+        w3fdif->work_line[i] = av_malloc(w3fdif->line_size[0] * sizeof(int32_t));
+        if (!w3fdif->work_line[i])
+            return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
@@ -411,28 +630,42 @@ static av_cold int init(AVFilterContext *ctx, const char *args, void *opaque)
 {
     W3FDIFContext *w3fdif = ctx->priv;
 
+    w3fdif->nb_threads = 0;
     if (!args) {
         w3fdif->filter = 1;
-    } else if (sscanf(args, "%u", &w3fdif->filter) == 1) {
+    } else if (sscanf(args, "%u:%u", &w3fdif->filter, &w3fdif->nb_threads) >= 1) {
         w3fdif->filter = !!w3fdif->filter;
     } else {
         av_log(ctx, AV_LOG_ERROR, "Invalid argument '%s'.\n", args);
         return AVERROR(EINVAL);
     }
 
-    av_log(ctx, AV_LOG_INFO, "using %s filter\n",
-            w3fdif->filter ? "more complex" : "simple");
+#if HAVE_PTHREADS && defined(_SC_NPROCESSORS_ONLN)
+    if (!w3fdif->nb_threads)
+        w3fdif->nb_threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    w3fdif->nb_threads = av_clip(w3fdif->nb_threads, 1, MAX_THREADS);
+#if !HAVE_PTHREADS
+    w3fdif->nb_threads = 1;
+#endif
 
-    return 0;
+    av_log(ctx, AV_LOG_INFO, "using %s filter, %d thread(s)\n",
+            w3fdif->filter ? "more complex" : "simple", w3fdif->nb_threads);
+
+    return ff_filter_pool_init(&w3fdif->pool, w3fdif->nb_threads);
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
 {
     W3FDIFContext *w3fdif = ctx->priv;
+    int i;
 
     if (w3fdif->prev && (w3fdif->prev != w3fdif->crnt)) avfilter_unref_buffer(w3fdif->prev);
     if (w3fdif->next && (w3fdif->next != w3fdif->crnt)) avfilter_unref_buffer(w3fdif->next);
     if (w3fdif->crnt) avfilter_unref_buffer(w3fdif->crnt);
+    for (i = 0; i < MAX_THREADS; i++)
+        av_freep(&w3fdif->work_line[i]);
+    ff_filter_pool_free(&w3fdif->pool);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -453,6 +686,7 @@ static int query_formats(AVFilterContext *ctx)
 //        AV_NE( PIX_FMT_YUV420P16BE, PIX_FMT_YUV420P16LE ),
 //        AV_NE( PIX_FMT_YUV422P16BE, PIX_FMT_YUV422P16LE ),
 //        AV_NE( PIX_FMT_YUV444P16BE, PIX_FMT_YUV444P16LE ),
+        PIX_FMT_YUV422P10,
         PIX_FMT_NONE
     };
 
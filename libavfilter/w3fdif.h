@@ -0,0 +1,104 @@
+/*
+ * Martin Weston three field deinterlace filter DSP functions
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AVFILTER_W3FDIF_H
+#define AVFILTER_W3FDIF_H
+
+#include <stdint.h>
+
+/**
+ * Vertical filters of one output line. Samples are bytes or, for depths
+ * above 8 bits, 16-bit words, linesize counts samples. The low frequency
+ * filters set work_line, the high frequency ones add to it. work_line
+ * must be 16-byte aligned.
+ */
+typedef struct W3FDIFDSPContext {
+    void (*filter_simple_low)(int32_t *work_line, uint8_t *in_lines_cur[2],
+                              const int32_t *coef, int linesize);
+    void (*filter_complex_low)(int32_t *work_line, uint8_t *in_lines_cur[4],
+                               const int32_t *coef, int linesize);
+    void (*filter_simple_high)(int32_t *work_line, uint8_t *in_lines_cur[3],
+                               uint8_t *in_lines_adj[3], const int32_t *coef,
+                               int linesize);
+    void (*filter_complex_high)(int32_t *work_line, uint8_t *in_lines_cur[5],
+                                uint8_t *in_lines_adj[5], const int32_t *coef,
+                                int linesize);
+    /** scale down by 256 * 256 and clip to [0, max] */
+    void (*filter_scale)(uint8_t *out_pixel, const int32_t *work_pixel,
+                         int linesize, int max);
+} W3FDIFDSPContext;
+
+/**
+ * Select the functions for samples of the given depth among those the
+ * given cpu flags allow.
+ */
+void ff_w3fdif_init_dsp(W3FDIFDSPContext *dsp, int depth, int cpu_flags);
+
+void ff_w3fdif_simple_low_c(int32_t *work_line, uint8_t *in_lines_cur[2],
+                            const int32_t *coef, int linesize);
+void ff_w3fdif_complex_low_c(int32_t *work_line, uint8_t *in_lines_cur[4],
+                             const int32_t *coef, int linesize);
+void ff_w3fdif_simple_high_c(int32_t *work_line, uint8_t *in_lines_cur[3],
+                             uint8_t *in_lines_adj[3], const int32_t *coef,
+                             int linesize);
+void ff_w3fdif_complex_high_c(int32_t *work_line, uint8_t *in_lines_cur[5],
+                              uint8_t *in_lines_adj[5], const int32_t *coef,
+                              int linesize);
+void ff_w3fdif_scale_c(uint8_t *out_pixel, const int32_t *work_pixel,
+                       int linesize, int max);
+
+void ff_w3fdif16_simple_low_c(int32_t *work_line, uint8_t *in_lines_cur[2],
+                              const int32_t *coef, int linesize);
+void ff_w3fdif16_complex_low_c(int32_t *work_line, uint8_t *in_lines_cur[4],
+                               const int32_t *coef, int linesize);
+void ff_w3fdif16_simple_high_c(int32_t *work_line, uint8_t *in_lines_cur[3],
+                               uint8_t *in_lines_adj[3], const int32_t *coef,
+                               int linesize);
+void ff_w3fdif16_complex_high_c(int32_t *work_line, uint8_t *in_lines_cur[5],
+                                uint8_t *in_lines_adj[5], const int32_t *coef,
+                                int linesize);
+void ff_w3fdif16_scale_c(uint8_t *out_pixel, const int32_t *work_pixel,
+                         int linesize, int max);
+
+void ff_w3fdif_simple_low_sse2(int32_t *work_line, uint8_t *in_lines_cur[2],
+                               const int32_t *coef, int linesize);
+void ff_w3fdif_complex_low_sse2(int32_t *work_line, uint8_t *in_lines_cur[4],
+                                const int32_t *coef, int linesize);
+void ff_w3fdif_simple_high_sse2(int32_t *work_line, uint8_t *in_lines_cur[3],
+                                uint8_t *in_lines_adj[3], const int32_t *coef,
+                                int linesize);
+void ff_w3fdif_complex_high_sse2(int32_t *work_line, uint8_t *in_lines_cur[5],
+                                 uint8_t *in_lines_adj[5], const int32_t *coef,
+                                 int linesize);
+void ff_w3fdif_scale_sse2(uint8_t *out_pixel, const int32_t *work_pixel,
+                          int linesize, int max);
+
+void ff_w3fdif16_simple_low_sse2(int32_t *work_line, uint8_t *in_lines_cur[2],
+                                 const int32_t *coef, int linesize);
+void ff_w3fdif16_complex_low_sse2(int32_t *work_line, uint8_t *in_lines_cur[4],
+                                  const int32_t *coef, int linesize);
+void ff_w3fdif16_simple_high_sse2(int32_t *work_line, uint8_t *in_lines_cur[3],
+                                  uint8_t *in_lines_adj[3], const int32_t *coef,
+                                  int linesize);
+void ff_w3fdif16_complex_high_sse2(int32_t *work_line, uint8_t *in_lines_cur[5],
+                                   uint8_t *in_lines_adj[5], const int32_t *coef,
+                                   int linesize);
+void ff_w3fdif16_scale_sse2(uint8_t *out_pixel, const int32_t *work_pixel,
+                            int linesize, int max);
+
+#endif /* AVFILTER_W3FDIF_H */
@@ -0,0 +1,295 @@
+/*
+ * Color matrix conversion, SSE2 functions
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavfilter/colormatrix.h"
+
+/*
+ * u and v are interleaved in words and multiplied by both halves of the
+ * coefficients with pmaddwd, c * u = lo * u + (hi * u << 16), so that
+ * the sums are exactly those of the C functions. Black and chroma zero
+ * levels cancel out in the luma, Y' = Y + ((c0 * u + c1 * v + 32768) >> 16).
+ */
+
+DECLARE_ALIGNED(16, static const uint16_t, pw_128)[8] = {128, 128, 128, 128, 128, 128, 128, 128};
+DECLARE_ALIGNED(16, static const uint16_t, pw_512)[8] = {512, 512, 512, 512, 512, 512, 512, 512};
+DECLARE_ALIGNED(16, static const uint16_t, pw_255)[8] = {255, 255, 255, 255, 255, 255, 255, 255};
+DECLARE_ALIGNED(16, static const uint16_t, pw_1023)[8] = {1023, 1023, 1023, 1023, 1023, 1023, 1023, 1023};
+DECLARE_ALIGNED(16, static const uint32_t, pd_round)[4]   = {32768, 32768, 32768, 32768};
+DECLARE_ALIGNED(16, static const uint32_t, pd_round128)[4] = {8421376, 8421376, 8421376, 8421376};
+DECLARE_ALIGNED(16, static const uint32_t, pd_round512)[4] = {33587200, 33587200, 33587200, 33587200};
+
+/* dst = (lo * uv + (hi * uv << 16) + round) >> 16, dwords, uses xmm7 */
+#define MATRIX(uv, dst, lo, hi, round)  \
+    "movdqa   "uv", "dst"           \n" \
+    "movdqa   "uv", %%xmm7          \n" \
+    "pmaddwd  "lo", "dst"           \n" \
+    "pmaddwd  "hi", %%xmm7          \n" \
+    "pslld      $16, %%xmm7         \n" \
+    "paddd   %%xmm7, "dst"          \n" \
+    "paddd "round", "dst"           \n" \
+    "psrad      $16, "dst"          \n"
+
+/* xmm0 = (u0, v0, ..., u3, v3), xmm1 = (u4, v4, ..., u7, v7) from words in xmm0 and xmm1 */
+#define INTERLEAVE_UV(bias)             \
+    "psubw  "bias", %%xmm0          \n" \
+    "psubw  "bias", %%xmm1          \n" \
+    "movdqa  %%xmm0, %%xmm2         \n" \
+    "punpcklwd %%xmm1, %%xmm0       \n" \
+    "punpckhwd %%xmm1, %%xmm2       \n" \
+    "movdqa  %%xmm2, %%xmm1         \n"
+
+/* xmm2 = luma offsets of 8 chroma samples in words */
+#define LUMA_OFFSET                                         \
+    MATRIX("%%xmm0", "%%xmm2", "%5", "%6", "%7")            \
+    MATRIX("%%xmm1", "%%xmm3", "%5", "%6", "%7")            \
+    "packssdw %%xmm3, %%xmm2        \n"                     \
+    "movdqa   %%xmm2, %%xmm3        \n"                     \
+    "punpcklwd %%xmm2, %%xmm2       \n"                     \
+    "punpckhwd %%xmm3, %%xmm3       \n"
+
+void ff_colormatrix_luma_line_sse2(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                                   const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm)
+{
+#if HAVE_SSE
+    intptr_t x = chroma_w & ~7;
+
+    if (chroma_w & 7)
+        ff_colormatrix_luma_line_c(dsty + 2 * x, srcy + 2 * x, srcu + x, srcv + x,
+                                   chroma_w & 7, cm);
+    if (!x)
+        return;
+    dsty += 2 * x;
+    srcy += 2 * x;
+    srcu += x;
+    srcv += x;
+    x = -x;
+    __asm__ volatile(
+        "pxor      %%xmm6, %%xmm6       \n"
+        "1:                             \n"
+        "movq     (%3,%0), %%xmm0       \n"
+        "movq     (%4,%0), %%xmm1       \n"
+        "punpcklbw %%xmm6, %%xmm0       \n"
+        "punpcklbw %%xmm6, %%xmm1       \n"
+        INTERLEAVE_UV("%8")
+        LUMA_OFFSET
+        "movdqu (%2,%0,2), %%xmm4       \n"
+        "movdqa    %%xmm4, %%xmm5       \n"
+        "punpcklbw %%xmm6, %%xmm4       \n"
+        "punpckhbw %%xmm6, %%xmm5       \n"
+        "paddw     %%xmm2, %%xmm4       \n"
+        "paddw     %%xmm3, %%xmm5       \n"
+        "packuswb  %%xmm5, %%xmm4       \n"
+        "movdqu    %%xmm4, (%1,%0,2)    \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(dsty), "r"(srcy), "r"(srcu), "r"(srcv),
+         "m"(cm->lo[0][0]), "m"(cm->hi[0][0]), "m"(*pd_round), "m"(*pw_128)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+#endif
+}
+
+void ff_colormatrix_luma10_line_sse2(uint8_t *dsty, const uint8_t *srcy, const uint8_t *srcu,
+                                     const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm)
+{
+#if HAVE_SSE
+    intptr_t x = chroma_w & ~7;
+
+    if (chroma_w & 7)
+        ff_colormatrix_luma10_line_c(dsty + 4 * x, srcy + 4 * x, srcu + 2 * x, srcv + 2 * x,
+                                     chroma_w & 7, cm);
+    if (!x)
+        return;
+    dsty += 4 * x;
+    srcy += 4 * x;
+    srcu += 2 * x;
+    srcv += 2 * x;
+    x = -x;
+    __asm__ volatile(
+        "pxor      %%xmm6, %%xmm6       \n"
+        "1:                             \n"
+        "movdqu (%3,%0,2), %%xmm0       \n"
+        "movdqu (%4,%0,2), %%xmm1       \n"
+        INTERLEAVE_UV("%8")
+        LUMA_OFFSET
+        "movdqu   (%2,%0,4), %%xmm4     \n"
+        "movdqu 16(%2,%0,4), %%xmm5     \n"
+        "paddw     %%xmm2, %%xmm4       \n"
+        "paddw     %%xmm3, %%xmm5       \n"
+        "pmaxsw    %%xmm6, %%xmm4       \n"
+        "pmaxsw    %%xmm6, %%xmm5       \n"
+        "pminsw        %9, %%xmm4       \n"
+        "pminsw        %9, %%xmm5       \n"
+        "movdqu    %%xmm4,   (%1,%0,4)  \n"
+        "movdqu    %%xmm5, 16(%1,%0,4)  \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(dsty), "r"(srcy), "r"(srcu), "r"(srcv),
+         "m"(cm->lo[0][0]), "m"(cm->hi[0][0]), "m"(*pd_round), "m"(*pw_512),
+         "m"(*pw_1023)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+#endif
+}
+
+/* U' in xmm2, V' in xmm4, dwords packed to words */
+#define CHROMA                                              \
+    MATRIX("%%xmm0", "%%xmm2", "%5", "%6", "%9")            \
+    MATRIX("%%xmm1", "%%xmm3", "%5", "%6", "%9")            \
+    "packssdw %%xmm3, %%xmm2        \n"                     \
+    MATRIX("%%xmm0", "%%xmm4", "%7", "%8", "%9")            \
+    MATRIX("%%xmm1", "%%xmm3", "%7", "%8", "%9")            \
+    "packssdw %%xmm3, %%xmm4        \n"
+
+void ff_colormatrix_chroma_line_sse2(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                                     const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm)
+{
+#if HAVE_SSE
+    intptr_t x = chroma_w & ~7;
+
+    if (chroma_w & 7)
+        ff_colormatrix_chroma_line_c(dstu + x, dstv + x, srcu + x, srcv + x,
+                                     chroma_w & 7, cm);
+    if (!x)
+        return;
+    dstu += x;
+    dstv += x;
+    srcu += x;
+    srcv += x;
+    x = -x;
+    __asm__ volatile(
+        "pxor      %%xmm6, %%xmm6       \n"
+        "1:                             \n"
+        "movq     (%3,%0), %%xmm0       \n"
+        "movq     (%4,%0), %%xmm1       \n"
+        "punpcklbw %%xmm6, %%xmm0       \n"
+        "punpcklbw %%xmm6, %%xmm1       \n"
+        INTERLEAVE_UV("%10")
+        CHROMA
+        "packuswb  %%xmm2, %%xmm2       \n"
+        "packuswb  %%xmm4, %%xmm4       \n"
+        "movq      %%xmm2, (%1,%0)      \n"
+        "movq      %%xmm4, (%2,%0)      \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(dstu), "r"(dstv), "r"(srcu), "r"(srcv),
+         "m"(cm->lo[1][0]), "m"(cm->hi[1][0]), "m"(cm->lo[2][0]), "m"(cm->hi[2][0]),
+         "m"(*pd_round128), "m"(*pw_128)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm6", "%xmm7",)
+         "memory"
+    );
+#endif
+}
+
+void ff_colormatrix_chroma10_line_sse2(uint8_t *dstu, uint8_t *dstv, const uint8_t *srcu,
+                                       const uint8_t *srcv, int chroma_w, const ColorMatrixCoeffs *cm)
+{
+#if HAVE_SSE
+    intptr_t x = chroma_w & ~7;
+
+    if (chroma_w & 7)
+        ff_colormatrix_chroma10_line_c(dstu + 2 * x, dstv + 2 * x, srcu + 2 * x, srcv + 2 * x,
+                                       chroma_w & 7, cm);
+    if (!x)
+        return;
+    dstu += 2 * x;
+    dstv += 2 * x;
+    srcu += 2 * x;
+    srcv += 2 * x;
+    x = -x;
+    __asm__ volatile(
+        "pxor      %%xmm6, %%xmm6       \n"
+        "1:                             \n"
+        "movdqu (%3,%0,2), %%xmm0       \n"
+        "movdqu (%4,%0,2), %%xmm1       \n"
+        INTERLEAVE_UV("%10")
+        CHROMA
+        "pmaxsw    %%xmm6, %%xmm2       \n"
+        "pmaxsw    %%xmm6, %%xmm4       \n"
+        "pminsw       %11, %%xmm2       \n"
+        "pminsw       %11, %%xmm4       \n"
+        "movdqu    %%xmm2, (%1,%0,2)    \n"
+        "movdqu    %%xmm4, (%2,%0,2)    \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(dstu), "r"(dstv), "r"(srcu), "r"(srcv),
+         "m"(cm->lo[1][0]), "m"(cm->hi[1][0]), "m"(cm->lo[2][0]), "m"(cm->hi[2][0]),
+         "m"(*pd_round512), "m"(*pw_512), "m"(*pw_1023)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm6", "%xmm7",)
+         "memory"
+    );
+#endif
+}
+
+void ff_colormatrix_uyvy_line_sse2(uint8_t *dst, const uint8_t *src, int chroma_w,
+                                   const ColorMatrixCoeffs *cm)
+{
+#if HAVE_SSE
+    intptr_t x = chroma_w & ~3;
+
+    if (chroma_w & 3)
+        ff_colormatrix_uyvy_line_c(dst + 4 * x, src + 4 * x, chroma_w & 3, cm);
+    if (!x)
+        return;
+    dst += 4 * x;
+    src += 4 * x;
+    x = -x;
+    __asm__ volatile(
+        "1:                             \n"
+        "movdqu (%2,%0,4), %%xmm0       \n" // U0 Y0 V0 Y1 U1 Y2 V1 Y3 ...
+        "movdqa    %%xmm0, %%xmm5       \n"
+        "pand          %9, %%xmm0       \n" // u0 v0 u1 v1 ... in words
+        "psrlw         $8, %%xmm5       \n" // y0 y1 y2 y3 ... in words
+        "psubw        %10, %%xmm0       \n"
+        MATRIX("%%xmm0", "%%xmm1", "%3", "%4", "%11")
+        MATRIX("%%xmm0", "%%xmm2", "%5", "%6", "%12")
+        MATRIX("%%xmm0", "%%xmm4", "%7", "%8", "%12")
+        "packssdw  %%xmm1, %%xmm1       \n"
+        "punpcklwd %%xmm1, %%xmm1       \n"
+        "paddw     %%xmm1, %%xmm5       \n"
+        "packssdw  %%xmm2, %%xmm2       \n"
+        "packssdw  %%xmm4, %%xmm4       \n"
+        "punpcklwd %%xmm4, %%xmm2       \n" // u'0 v'0 u'1 v'1 ...
+        "packuswb  %%xmm2, %%xmm2       \n"
+        "packuswb  %%xmm5, %%xmm5       \n"
+        "punpcklbw %%xmm5, %%xmm2       \n"
+        "movdqu    %%xmm2, (%1,%0,4)    \n"
+        "add           $4, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(dst), "r"(src),
+         "m"(cm->lo[0][0]), "m"(cm->hi[0][0]),
+         "m"(cm->lo[1][0]), "m"(cm->hi[1][0]), "m"(cm->lo[2][0]), "m"(cm->hi[2][0]),
+         "m"(*pw_255), "m"(*pw_128), "m"(*pd_round), "m"(*pd_round128)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm4", "%xmm5", "%xmm7",)
+         "memory"
+    );
+#endif
+}
@@ -0,0 +1,363 @@
+/*
+ * Line blending, SSE2 functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavfilter/drawutils.h"
+
+/*
+ * 8 samples per iteration. The 8-bit products fit in unsigned words and
+ * FAST_DIV255 is a pmulhuw by 257; the deeper ones are made in dwords,
+ * which requires samples of at most 14 bits, deeper ones are left to C.
+ */
+
+DECLARE_ALIGNED(16, static const uint16_t, pw_128)[8] = {128, 128, 128, 128, 128, 128, 128, 128};
+DECLARE_ALIGNED(16, static const uint16_t, pw_255)[8] = {255, 255, 255, 255, 255, 255, 255, 255};
+DECLARE_ALIGNED(16, static const uint16_t, pw_257)[8] = {257, 257, 257, 257, 257, 257, 257, 257};
+DECLARE_ALIGNED(16, static const uint32_t, pd_128)[4] = {128, 128, 128, 128};
+
+/* xmm2 = 8 alpha bytes, jump to 2 if all of them are zero;
+   xmm3 then holds 0xFF for each zero byte, xmm7 must be zero */
+#define SKIP_TRANSPARENT(alpha, tmp)    \
+    "movq  ("alpha",%0), %%xmm2     \n" \
+    "movdqa    %%xmm2, %%xmm3       \n" \
+    "pcmpeqb   %%xmm7, %%xmm3       \n" \
+    "pmovmskb  %%xmm3, "tmp"        \n" \
+    "cmp      $0xffff, "tmp"        \n" \
+    "je 2f                          \n"
+
+/* dwords dst = FAST_DIV255(dst), uses tmp */
+#define DIV255_DWORDS(dst, tmp, round, shift) \
+    "paddd  "round", "dst"          \n" \
+    "movdqa   "dst", "tmp"          \n" \
+    "pslld        $8, "tmp"         \n" \
+    "paddd    "tmp", "dst"          \n" \
+    shift"       $16, "dst"         \n"
+
+/* broadcast the low word of an int in memory */
+#define BROADCAST_WORD(src, dst)        \
+    "movd     "src", "dst"          \n" \
+    "pshuflw $0, "dst", "dst"       \n" \
+    "punpcklqdq "dst", "dst"        \n"
+
+void ff_blend_line_sse2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w)
+{
+#if HAVE_SSE
+    intptr_t x = w & ~7;
+    int tmp;
+
+    if (w & 7)
+        ff_blend_line_c(dst + x, src + x, alpha + x, w & 7);
+    if (!x)
+        return;
+    dst   += x;
+    src   += x;
+    alpha += x;
+    x = -x;
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7       \n"
+        "1:                             \n"
+        SKIP_TRANSPARENT("%4", "%1")
+        "movq     (%2,%0), %%xmm0       \n"
+        "movq     (%3,%0), %%xmm1       \n"
+        "punpcklbw %%xmm7, %%xmm0       \n"
+        "punpcklbw %%xmm7, %%xmm1       \n"
+        "punpcklbw %%xmm7, %%xmm2       \n"
+        "movdqa        %5, %%xmm3       \n"
+        "psubw     %%xmm2, %%xmm3       \n"
+        "pmullw    %%xmm3, %%xmm0       \n"
+        "pmullw    %%xmm2, %%xmm1       \n"
+        "paddw     %%xmm1, %%xmm0       \n"
+        "paddw         %6, %%xmm0       \n"
+        "pmulhuw       %7, %%xmm0       \n"
+        "packuswb  %%xmm0, %%xmm0       \n"
+        "movq      %%xmm0, (%2,%0)      \n"
+        "2:                             \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x), "=&r"(tmp)
+        :"r"(dst), "r"(src), "r"(alpha),
+         "m"(*pw_255), "m"(*pw_128), "m"(*pw_257)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm7",)
+         "memory"
+    );
+#endif
+}
+
+/* the zero level is removed from dst, so that the chroma products are
+   signed words, while the luma ones use the whole unsigned range */
+#define BLEND_PREMUL(pmulh)                                     \
+    __asm__ volatile(                                           \
+        "pxor      %%xmm7, %%xmm7       \n"                     \
+        BROADCAST_WORD("%5", "%%xmm6")                          \
+        "1:                             \n"                     \
+        SKIP_TRANSPARENT("%4", "%1")                            \
+        "movq     (%2,%0), %%xmm0       \n"                     \
+        "movq     (%3,%0), %%xmm1       \n"                     \
+        "movdqa    %%xmm0, %%xmm5       \n"                     \
+        "punpcklbw %%xmm7, %%xmm0       \n"                     \
+        "punpcklbw %%xmm7, %%xmm1       \n"                     \
+        "punpcklbw %%xmm7, %%xmm2       \n"                     \
+        "psubw     %%xmm6, %%xmm0       \n"                     \
+        "movdqa        %6, %%xmm4       \n"                     \
+        "psubw     %%xmm2, %%xmm4       \n"                     \
+        "pmullw    %%xmm4, %%xmm0       \n"                     \
+        "paddw         %7, %%xmm0       \n"                     \
+        pmulh"         %8, %%xmm0       \n"                     \
+        "paddw     %%xmm1, %%xmm0       \n"                     \
+        "packuswb  %%xmm0, %%xmm0       \n"                     \
+        "pand      %%xmm3, %%xmm5       \n"                     \
+        "pandn     %%xmm0, %%xmm3       \n"                     \
+        "por       %%xmm5, %%xmm3       \n"                     \
+        "movq      %%xmm3, (%2,%0)      \n"                     \
+        "2:                             \n"                     \
+        "add           $8, %0           \n"                     \
+        "jl 1b                          \n"                     \
+        :"+&r"(x), "=&r"(tmp)                                   \
+        :"r"(dst), "r"(src), "r"(alpha), "m"(bias),             \
+         "m"(*pw_255), "m"(*pw_128), "m"(*pw_257)               \
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",       \
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)      \
+         "memory"                                               \
+    );
+
+void ff_blend_line_premul_sse2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                               int w, int bias)
+{
+#if HAVE_SSE
+    intptr_t x = w & ~7;
+    int tmp;
+
+    if (w & 7)
+        ff_blend_line_premul_c(dst + x, src + x, alpha + x, w & 7, bias);
+    if (!x)
+        return;
+    dst   += x;
+    src   += x;
+    alpha += x;
+    x = -x;
+    if (bias)
+        BLEND_PREMUL("pmulhw")
+    else
+        BLEND_PREMUL("pmulhuw")
+#endif
+}
+
+void ff_blend_line16_sse2(uint16_t *dst, const uint8_t *src, const uint8_t *alpha,
+                          int w, int shift)
+{
+#if HAVE_SSE
+    intptr_t x = w & ~7;
+    int tmp;
+
+    if (shift > 6) {
+        ff_blend_line16_c(dst, src, alpha, w, shift);
+        return;
+    }
+    if (w & 7)
+        ff_blend_line16_c(dst + x, src + x, alpha + x, w & 7, shift);
+    if (!x)
+        return;
+    dst   += x;
+    src   += x;
+    alpha += x;
+    x = -x;
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7       \n"
+        "movd          %5, %%xmm6       \n"
+        "1:                             \n"
+        SKIP_TRANSPARENT("%4", "%1")
+        "movdqu (%2,%0,2), %%xmm0       \n"
+        "movq     (%3,%0), %%xmm1       \n"
+        "punpcklbw %%xmm7, %%xmm1       \n"
+        "punpcklbw %%xmm7, %%xmm2       \n"
+        "psllw     %%xmm6, %%xmm1       \n"
+        "movdqa        %6, %%xmm3       \n"
+        "psubw     %%xmm2, %%xmm3       \n"
+        /* (d, s) . (255 - a, a) */
+        "movdqa    %%xmm0, %%xmm4       \n"
+        "punpcklwd %%xmm1, %%xmm0       \n"
+        "punpckhwd %%xmm1, %%xmm4       \n"
+        "movdqa    %%xmm3, %%xmm5       \n"
+        "punpcklwd %%xmm2, %%xmm3       \n"
+        "punpckhwd %%xmm2, %%xmm5       \n"
+        "pmaddwd   %%xmm3, %%xmm0       \n"
+        "pmaddwd   %%xmm5, %%xmm4       \n"
+        DIV255_DWORDS("%%xmm0", "%%xmm1", "%7", "psrld")
+        DIV255_DWORDS("%%xmm4", "%%xmm1", "%7", "psrld")
+        "packssdw  %%xmm4, %%xmm0       \n"
+        "movdqu    %%xmm0, (%2,%0,2)    \n"
+        "2:                             \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x), "=&r"(tmp)
+        :"r"(dst), "r"(src), "r"(alpha), "m"(shift),
+         "m"(*pw_255), "m"(*pd_128)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+#endif
+}
+
+void ff_blend_line16_premul_sse2(uint16_t *dst, const uint8_t *src, const uint8_t *alpha,
+                                 int w, int shift, int bias)
+{
+#if HAVE_SSE
+    intptr_t x = w & ~7;
+    int tmp, max = (1 << (8 + shift)) - 1;
+
+    if (shift > 6) {
+        ff_blend_line16_premul_c(dst, src, alpha, w, shift, bias);
+        return;
+    }
+    if (w & 7)
+        ff_blend_line16_premul_c(dst + x, src + x, alpha + x, w & 7, shift, bias);
+    if (!x)
+        return;
+    dst   += x;
+    src   += x;
+    alpha += x;
+    x = -x;
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7       \n"
+        BROADCAST_WORD("%8", "%%xmm6")
+        BROADCAST_WORD("%9", "%%xmm5")
+        "1:                             \n"
+        SKIP_TRANSPARENT("%4", "%1")
+        "punpcklbw %%xmm3, %%xmm3       \n"
+        "movdqu (%2,%0,2), %%xmm0       \n"
+        "movdqa    %%xmm0, %%xmm1       \n"
+        "psubw     %%xmm6, %%xmm1       \n"
+        "punpcklbw %%xmm7, %%xmm2       \n"
+        "movdqa        %6, %%xmm4       \n"
+        "psubw     %%xmm2, %%xmm4       \n"
+        /* signed (d - bias) * (255 - a) in dwords */
+        "movdqa    %%xmm1, %%xmm2       \n"
+        "pmullw    %%xmm4, %%xmm1       \n"
+        "pmulhw    %%xmm4, %%xmm2       \n"
+        "movdqa    %%xmm1, %%xmm4       \n"
+        "punpcklwd %%xmm2, %%xmm1       \n"
+        "punpckhwd %%xmm2, %%xmm4       \n"
+        DIV255_DWORDS("%%xmm1", "%%xmm2", "%7", "psrad")
+        DIV255_DWORDS("%%xmm4", "%%xmm2", "%7", "psrad")
+        "packssdw  %%xmm4, %%xmm1       \n"
+        "movq     (%3,%0), %%xmm2       \n"
+        "movd          %5, %%xmm4       \n"
+        "punpcklbw %%xmm7, %%xmm2       \n"
+        "psllw     %%xmm4, %%xmm2       \n"
+        "paddw     %%xmm2, %%xmm1       \n"
+        "pmaxsw    %%xmm7, %%xmm1       \n"
+        "pminsw    %%xmm5, %%xmm1       \n"
+        "pand      %%xmm3, %%xmm0       \n"
+        "pandn     %%xmm1, %%xmm3       \n"
+        "por       %%xmm0, %%xmm3       \n"
+        "movdqu    %%xmm3, (%2,%0,2)    \n"
+        "2:                             \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x), "=&r"(tmp)
+        :"r"(dst), "r"(src), "r"(alpha), "m"(shift),
+         "m"(*pw_255), "m"(*pd_128), "m"(bias), "m"(max)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+#endif
+}
+
+/* with vsub = 0 the same line is read twice, the sum of the rows of a
+   block is then twice the line and is shifted by one more */
+void ff_blend_alpha_line_sse2(uint8_t *dst, const uint8_t *src, int src_linesize,
+                              int w, int hsub, int vsub, int scale)
+{
+#if HAVE_SSE
+    intptr_t x = w & ~7;
+    const uint8_t *src2 = vsub ? src + src_linesize : src;
+
+    if (hsub > 1 || vsub > 1) {
+        ff_blend_alpha_line_c(dst, src, src_linesize, w, hsub, vsub, scale);
+        return;
+    }
+    if (w & 7)
+        ff_blend_alpha_line_c(dst + x, src + (x << hsub), src_linesize,
+                              w & 7, hsub, vsub, scale);
+    if (!x)
+        return;
+    dst  += x;
+    src  += x << hsub;
+    src2 += x << hsub;
+    x = -x;
+    if (hsub) {
+        __asm__ volatile(
+            BROADCAST_WORD("%4", "%%xmm6")
+            "1:                             \n"
+            "movdqu (%2,%0,2), %%xmm0       \n"
+            "movdqu (%3,%0,2), %%xmm1       \n"
+            "movdqa    %%xmm0, %%xmm2       \n"
+            "movdqa    %%xmm1, %%xmm3       \n"
+            "pand          %5, %%xmm0       \n"
+            "pand          %5, %%xmm1       \n"
+            "psrlw         $8, %%xmm2       \n"
+            "psrlw         $8, %%xmm3       \n"
+            "paddw     %%xmm2, %%xmm0       \n"
+            "paddw     %%xmm3, %%xmm1       \n"
+            "paddw     %%xmm1, %%xmm0       \n"
+            "psrlw         $2, %%xmm0       \n"
+            "pmullw    %%xmm6, %%xmm0       \n"
+            "paddw         %6, %%xmm0       \n"
+            "pmulhuw       %7, %%xmm0       \n"
+            "packuswb  %%xmm0, %%xmm0       \n"
+            "movq      %%xmm0, (%1,%0)      \n"
+            "add           $8, %0           \n"
+            "jl 1b                          \n"
+            :"+&r"(x)
+            :"r"(dst), "r"(src), "r"(src2), "m"(scale),
+             "m"(*pw_255), "m"(*pw_128), "m"(*pw_257)
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm6",)
+             "memory"
+        );
+    } else {
+        __asm__ volatile(
+            "pxor      %%xmm7, %%xmm7       \n"
+            BROADCAST_WORD("%4", "%%xmm6")
+            "1:                             \n"
+            "movq     (%2,%0), %%xmm0       \n"
+            "movq     (%3,%0), %%xmm1       \n"
+            "punpcklbw %%xmm7, %%xmm0       \n"
+            "punpcklbw %%xmm7, %%xmm1       \n"
+            "paddw     %%xmm1, %%xmm0       \n"
+            "psrlw         $1, %%xmm0       \n"
+            "pmullw    %%xmm6, %%xmm0       \n"
+            "paddw         %5, %%xmm0       \n"
+            "pmulhuw       %6, %%xmm0       \n"
+            "packuswb  %%xmm0, %%xmm0       \n"
+            "movq      %%xmm0, (%1,%0)      \n"
+            "add           $8, %0           \n"
+            "jl 1b                          \n"
+            :"+&r"(x)
+            :"r"(dst), "r"(src), "r"(src2), "m"(scale),
+             "m"(*pw_128), "m"(*pw_257)
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm6", "%xmm7",)
+             "memory"
+        );
+    }
+#endif
+}
@@ -0,0 +1,260 @@
+/*
+ * Martin Weston three field deinterlace filter, SSE2 functions
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86_cpu.h"
+#include "libavfilter/w3fdif.h"
+
+/*
+ * The filters are computed one pair of input lines at a time:
+ * work[x] (+)= c0 * a[x] + c1 * b[x] with one pmaddwd per 4 samples of the
+ * interleaved lines. pmaddwd takes signed 16-bit coefficients, the larger
+ * ones (34472) are even and are halved while the samples are doubled, which
+ * keeps the sums identical to the C functions.
+ */
+
+#define LOAD8(a, b)                         \
+    "movq      ("a",%0), %%xmm0         \n" \
+    "movq      ("b",%0), %%xmm1         \n" \
+    "punpcklbw     %%xmm7, %%xmm0       \n" \
+    "punpcklbw     %%xmm7, %%xmm1       \n"
+
+#define LOAD16(a, b)                        \
+    "movdqu  ("a",%0,2), %%xmm0         \n" \
+    "movdqu  ("b",%0,2), %%xmm1         \n"
+
+#define MADD                                \
+    "psllw         %%xmm6, %%xmm0       \n" \
+    "psllw         %%xmm6, %%xmm1       \n" \
+    "movdqa        %%xmm0, %%xmm2       \n" \
+    "punpcklwd     %%xmm1, %%xmm0       \n" \
+    "punpckhwd     %%xmm1, %%xmm2       \n" \
+    "pmaddwd       %%xmm5, %%xmm0       \n" \
+    "pmaddwd       %%xmm5, %%xmm2       \n"
+
+#define ACCUMULATE                          \
+    "paddd     (%1,%0,4), %%xmm0        \n" \
+    "paddd   16(%1,%0,4), %%xmm2        \n"
+
+#define STORE                               \
+    "movdqa        %%xmm0, (%1,%0,4)    \n" \
+    "movdqa        %%xmm2, 16(%1,%0,4)  \n"
+
+#define MADD_PAIR(load, accumulate)                                     \
+    __asm__ volatile(                                                   \
+        "movdqa            %4, %%xmm5   \n"                             \
+        "movd              %5, %%xmm6   \n"                             \
+        "pxor          %%xmm7, %%xmm7   \n"                             \
+        "1:                             \n"                             \
+        load("%2", "%3")                                                \
+        MADD                                                            \
+        accumulate                                                      \
+        STORE                                                           \
+        "add               $8, %0       \n"                             \
+        "jl 1b                          \n"                             \
+        :"+&r"(x)                                                       \
+        :"r"(work + n), "r"(a + (n << words)), "r"(b + (n << words)),   \
+         "m"(*coef16), "rm"(shift)                                      \
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm5", "%xmm6", "%xmm7",) \
+         "memory"                                                       \
+    )
+
+static av_always_inline void madd_pair(int32_t *work, const uint8_t *a, const uint8_t *b,
+                                       int c0, int c1, int shift, int linesize,
+                                       int accumulate, int words)
+{
+#if HAVE_SSE
+    DECLARE_ALIGNED(16, int16_t, coef16)[8];
+    intptr_t x, n = linesize & ~7;
+    int i;
+
+    for (i = 0; i < 8; i += 2) {
+        coef16[i    ] = c0 >> shift;
+        coef16[i + 1] = c1 >> shift;
+    }
+    if (n) {
+        x = -n;
+        if (words) {
+            if (accumulate) MADD_PAIR(LOAD16, ACCUMULATE);
+            else            MADD_PAIR(LOAD16, );
+        } else {
+            if (accumulate) MADD_PAIR(LOAD8,  ACCUMULATE);
+            else            MADD_PAIR(LOAD8,  );
+        }
+    }
+    for (i = n; i < linesize; i++) {
+        int v = words ? c0 * ((const uint16_t *)a)[i] + c1 * ((const uint16_t *)b)[i]
+                      : c0 * a[i] + c1 * b[i];
+        work[i] = accumulate ? work[i] + v : v;
+    }
+#endif
+}
+
+/** 1 if the coefficients must be halved, -1 if they do not fit pmaddwd */
+static int coef_shift(const int32_t *coef, int nb_coef)
+{
+    int i, shift = 0;
+
+    for (i = 0; i < nb_coef; i++) {
+        if (coef[i] >= -32768 && coef[i] <= 32767)
+            continue;
+        if ((coef[i] & 1) || coef[i] < -65536 || coef[i] > 65534)
+            return -1;
+        shift = 1;
+    }
+    for (i = 0; i < nb_coef && shift; i++)
+        if (coef[i] & 1)
+            return -1;
+    return shift;
+}
+
+static av_always_inline void filter_low(int32_t *work_line, uint8_t **in_lines_cur,
+                                        const int32_t *coef, int nb_coef,
+                                        int linesize, int words)
+{
+    int j, shift = coef_shift(coef, nb_coef);
+
+    for (j = 0; j < nb_coef; j += 2)
+        madd_pair(work_line, in_lines_cur[j], in_lines_cur[j + 1], coef[j], coef[j + 1],
+                  shift, linesize, j > 0, words);
+}
+
+static av_always_inline void filter_high(int32_t *work_line, uint8_t **in_lines_cur,
+                                         uint8_t **in_lines_adj, const int32_t *coef,
+                                         int nb_coef, int linesize, int words)
+{
+    int j, shift = coef_shift(coef, nb_coef);
+
+    for (j = 0; j < nb_coef; j++)
+        madd_pair(work_line, in_lines_cur[j], in_lines_adj[j], coef[j], coef[j],
+                  shift, linesize, 1, words);
+}
+
+#define FILTER_FUNCS(name, words)                                                   \
+void ff_ ## name ## _simple_low_sse2(int32_t *work_line, uint8_t *in_lines_cur[2], \
+                                     const int32_t *coef, int linesize)             \
+{                                                                                   \
+    if (coef_shift(coef, 2) < 0)                                                    \
+        ff_ ## name ## _simple_low_c(work_line, in_lines_cur, coef, linesize);      \
+    else                                                                            \
+        filter_low(work_line, in_lines_cur, coef, 2, linesize, words);              \
+}                                                                                   \
+                                                                                    \
+void ff_ ## name ## _complex_low_sse2(int32_t *work_line, uint8_t *in_lines_cur[4],\
+                                      const int32_t *coef, int linesize)            \
+{                                                                                   \
+    if (coef_shift(coef, 4) < 0)                                                    \
+        ff_ ## name ## _complex_low_c(work_line, in_lines_cur, coef, linesize);     \
+    else                                                                            \
+        filter_low(work_line, in_lines_cur, coef, 4, linesize, words);              \
+}                                                                                   \
+                                                                                    \
+void ff_ ## name ## _simple_high_sse2(int32_t *work_line, uint8_t *in_lines_cur[3],\
+                                      uint8_t *in_lines_adj[3], const int32_t *coef,\
+                                      int linesize)                                 \
+{                                                                                   \
+    if (coef_shift(coef, 3) < 0)                                                    \
+        ff_ ## name ## _simple_high_c(work_line, in_lines_cur, in_lines_adj,        \
+                                      coef, linesize);                              \
+    else                                                                            \
+        filter_high(work_line, in_lines_cur, in_lines_adj, coef, 3, linesize, words);\
+}                                                                                   \
+                                                                                    \
+void ff_ ## name ## _complex_high_sse2(int32_t *work_line, uint8_t *in_lines_cur[5],\
+                                       uint8_t *in_lines_adj[5], const int32_t *coef,\
+                                       int linesize)                                \
+{                                                                                   \
+    if (coef_shift(coef, 5) < 0)                                                    \
+        ff_ ## name ## _complex_high_c(work_line, in_lines_cur, in_lines_adj,       \
+                                       coef, linesize);                             \
+    else                                                                            \
+        filter_high(work_line, in_lines_cur, in_lines_adj, coef, 5, linesize, words);\
+}
+
+FILTER_FUNCS(w3fdif,   0)
+FILTER_FUNCS(w3fdif16, 1)
+
+void ff_w3fdif_scale_sse2(uint8_t *out_pixel, const int32_t *work_pixel,
+                          int linesize, int max)
+{
+#if HAVE_SSE
+    intptr_t x = linesize & ~7;
+
+    if (linesize & 7)
+        ff_w3fdif_scale_c(out_pixel + x, work_pixel + x, linesize & 7, max);
+    if (!x)
+        return;
+    out_pixel  += x;
+    work_pixel += x;
+    x = -x;
+    __asm__ volatile(
+        "1:                             \n"
+        "movdqa    (%2,%0,4), %%xmm0    \n"
+        "movdqa  16(%2,%0,4), %%xmm1    \n"
+        "psrad            $16, %%xmm0   \n"
+        "psrad            $16, %%xmm1   \n"
+        "packssdw      %%xmm1, %%xmm0   \n"
+        "packuswb      %%xmm0, %%xmm0   \n" // clip to [0;255]
+        "movq          %%xmm0, (%1,%0)  \n"
+        "add               $8, %0       \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(out_pixel), "r"(work_pixel)
+        :XMM_CLOBBERS("%xmm0", "%xmm1",)
+         "memory"
+    );
+#endif
+}
+
+void ff_w3fdif16_scale_sse2(uint8_t *out_pixel, const int32_t *work_pixel,
+                            int linesize, int max)
+{
+#if HAVE_SSE
+    intptr_t x = linesize & ~7;
+
+    if (linesize & 7)
+        ff_w3fdif16_scale_c(out_pixel + 2 * x, work_pixel + x, linesize & 7, max);
+    if (!x)
+        return;
+    out_pixel  += 2 * x;
+    work_pixel += x;
+    x = -x;
+    __asm__ volatile(
+        "movd              %3, %%xmm6   \n"
+        "pxor          %%xmm7, %%xmm7   \n"
+        "pshuflw  $0,  %%xmm6, %%xmm6   \n"
+        "punpcklqdq    %%xmm6, %%xmm6   \n"
+        "1:                             \n"
+        "movdqa    (%2,%0,4), %%xmm0    \n"
+        "movdqa  16(%2,%0,4), %%xmm1    \n"
+        "psrad            $16, %%xmm0   \n"
+        "psrad            $16, %%xmm1   \n"
+        "packssdw      %%xmm1, %%xmm0   \n"
+        "pmaxsw        %%xmm7, %%xmm0   \n"
+        "pminsw        %%xmm6, %%xmm0   \n" // clip to [0;max]
+        "movdqu        %%xmm0, (%1,%0,2)\n"
+        "add               $8, %0       \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(out_pixel), "r"(work_pixel), "rm"(max)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm6", "%xmm7",)
+         "memory"
+    );
+#endif
+}
@@ -20,6 +20,10 @@
 
 #include "avfilter.h"
 
+void ff_yadif_filter_line_c(uint8_t *dst,
+                            uint8_t *prev, uint8_t *cur, uint8_t *next,
+                            int w, int prefs, int mrefs, int parity, int mode);
+
 void ff_yadif_filter_line_mmx(uint8_t *dst,
                               uint8_t *prev, uint8_t *cur, uint8_t *next,
                               int w, int prefs, int mrefs, int parity, int mode);
@@ -277,6 +277,7 @@ typedef struct AVFormatParameters {
 #define AVFMT_TS_NONSTRICT  0x8000 /**< Format does not require strictly
                                           increasing timestamps, but they must
                                           still be monotonic */
+#define AVFMT_INDEX_CACHE  0x10000 /**< Demuxer index is incomplete and can be kept in a sidecar file, see AVFMT_FLAG_IDXCACHE */
 
 typedef struct AVOutputFormat {
     const char *name;
@@ -766,6 +767,7 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_SORT_DTS    0x10000 ///< try to interleave outputted packets by dts (using this flag can slow demuxing down)
 #define AVFMT_FLAG_PRIV_OPT    0x20000 ///< Enable use of private options by delaying codec open (this could be made default once all code is converted)
 #define AVFMT_FLAG_KEEP_SIDE_DATA 0x40000 ///< Dont merge side data but keep it seperate.
+#define AVFMT_FLAG_IDXCACHE    0x80000 ///< Load the seek index from a sidecar file, or write it there after demuxing the whole file.
 
 #if FF_API_LOOP_INPUT
     /**
@@ -882,6 +884,12 @@ typedef struct AVFormatContext {
      * duration are known as FFmpeg can compute it automatically.
      */
     int64_t bit_rate;
+
+    /**
+     * Seek index cache state, see AVFMT_FLAG_IDXCACHE.
+     * NOT PART OF PUBLIC API
+     */
+    struct IndexCache *index_cache;
 } AVFormatContext;
 
 typedef struct AVPacketList {
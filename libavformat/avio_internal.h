@@ -41,6 +41,18 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size);
 
+/**
+ * Read size bytes from AVIOContext, returning a pointer.
+ * If the data is already contiguous in the internal buffer *data points
+ * into it and nothing is copied, otherwise the data is copied into buf.
+ * The pointer is only valid until the next access to the context.
+ * @param buf  buffer of at least size bytes, used if a copy is needed
+ * @param data set to the address of the data read
+ * @return number of bytes read or AVERROR
+ */
+int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size,
+                       const unsigned char **data);
+
 /**
  * Rewind the AVIOContext using the specified buffer containing the first buf_size bytes of the file.
  * Used after probing to avoid seeking.
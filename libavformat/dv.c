@@ -34,6 +34,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "dv.h"
+#include "dvaudio.h"
 
 struct DVDemuxContext {
     const DVprofile*  sys;    /* Current DV profile. E.g.: 525/60, 625/50 */
@@ -45,28 +46,9 @@ struct DVDemuxContext {
     int               ach;
     int               frames;
     uint64_t          abytes;
+    DVAudioMap        audio_map;
 };
 
-static inline uint16_t dv_audio_12to16(uint16_t sample)
-{
-    uint16_t shift, result;
-
-    sample = (sample < 0x800) ? sample : sample | 0xf000;
-    shift  = (sample & 0xf00) >> 8;
-
-    if (shift < 0x2 || shift > 0xd) {
-        result = sample;
-    } else if (shift < 0x8) {
-        shift--;
-        result = (sample - (256 * shift)) << shift;
-    } else {
-        shift = 0xe - shift;
-        result = ((sample + ((256 * shift) + 1)) << shift) - 1;
-    }
-
-    return result;
-}
-
 /*
  * This is the dumbest implementation of all -- it simply looks at
  * a fixed offset and if pack isn't there -- fails. We might want
@@ -102,12 +84,12 @@ static const uint8_t* dv_extract_pack(uint8_t* frame, enum dv_pack_type t)
  *    are converted into 16bit linear ones.
  */
 static int dv_extract_audio(uint8_t* frame, uint8_t* ppcm[4],
-                            const DVprofile *sys)
+                            DVAudioMap *map, const DVprofile *sys)
 {
-    int size, chan, i, j, d, of, smpls, freq, quant, half_ch;
-    uint16_t lc, rc;
+    int size, chan, smpls, freq, quant;
     const uint8_t* as_pack;
-    uint8_t *pcm, ipcm;
+    uint8_t *pcm[2];
+    int ipcm;
 
     as_pack = dv_extract_pack(frame, dv_audio_source);
     if (!as_pack)    /* No audio ? */
@@ -121,61 +103,27 @@ static int dv_extract_audio(uint8_t* frame, uint8_t* ppcm[4],
         return -1; /* unsupported quantization */
 
     size = (sys->audio_min_samples[freq] + smpls) * 4; /* 2ch, 2bytes */
-    half_ch = sys->difseg_size / 2;
+
+    if (map->sys != sys)
+        ff_dv_audio_map_init(map, sys);
 
     /* We work with 720p frames split in half, thus even frames have
      * channels 0,1 and odd 2,3. */
     ipcm = (sys->height == 720 && !(frame[1] & 0x0C)) ? 2 : 0;
-    pcm  = ppcm[ipcm++];
 
-    /* for each DIF channel */
+    /* for each DIF channel, one stereo channel per DIF channel at 50Mbps
+     * and 100Mbps, two in a single DIF channel in 12bit mode */
     for (chan = 0; chan < sys->n_difchan; chan++) {
-        /* for each DIF segment */
-        for (i = 0; i < sys->difseg_size; i++) {
-            frame += 6 * 80; /* skip DIF segment header */
-            if (quant == 1 && i == half_ch) {
-                /* next stereo channel (12bit mode only) */
-                pcm = ppcm[ipcm++];
-                if (!pcm)
-                    break;
-            }
-
-            /* for each AV sequence */
-            for (j = 0; j < 9; j++) {
-                for (d = 8; d < 80; d += 2) {
-                    if (quant == 0) {  /* 16bit quantization */
-                        of = sys->audio_shuffle[i][j] + (d - 8) / 2 * sys->audio_stride;
-                        if (of*2 >= size)
-                            continue;
-                        pcm[of*2]   = frame[d];
-                        pcm[of*2+1] = frame[d+1];
-                    } else {           /* 12bit quantization */
-                        lc = ((uint16_t)frame[d]   << 4) |
-                             ((uint16_t)frame[d+2] >> 4);
-                        rc = ((uint16_t)frame[d+1] << 4) |
-                             ((uint16_t)frame[d+2] & 0x0f);
-                        lc = (lc == 0x800 ? 0 : dv_audio_12to16(lc));
-                        rc = (rc == 0x800 ? 0 : dv_audio_12to16(rc));
-
-                        of = sys->audio_shuffle[i%half_ch][j] + (d - 8) / 3 * sys->audio_stride;
-                        if (of*2 >= size)
-                            continue;
-                        AV_WB16(pcm + of*2, lc);
-                        of = sys->audio_shuffle[i%half_ch+half_ch][j] +
-                            (d - 8) / 3 * sys->audio_stride;
-                        AV_WB16(pcm + of*2, rc);
-                        ++d;
-                    }
-                }
-
-                frame += 16 * 80; /* 15 Video DIFs + 1 Audio DIF */
-            }
-        }
-
-        /* next stereo channel (50Mbps and 100Mbps only) */
-        pcm = ppcm[ipcm++];
-        if (!pcm)
+        pcm[0] = ipcm < 4 ? ppcm[ipcm++] : NULL;
+        if (!pcm[0])
             break;
+        if (quant == 0) {
+            ff_dv_audio_get16(map, pcm[0], frame, size);
+        } else {
+            pcm[1] = ipcm < 4 ? ppcm[ipcm++] : NULL;
+            ff_dv_audio_get12(map, pcm, frame, size);
+        }
+        frame += sys->difseg_size * 150 * 80;
     }
 
     return size;
@@ -338,7 +286,7 @@ int dv_produce_packet(DVDemuxContext *c, AVPacket *pkt,
        c->audio_pkt[i].pts  = c->abytes * 30000*8 / c->ast[i]->codec->bit_rate;
        ppcm[i] = c->audio_buf[i];
     }
-    dv_extract_audio(buf, ppcm, c->sys);
+    dv_extract_audio(buf, ppcm, &c->audio_map, c->sys);
 
     /* We work with 720p frames split in half, thus even frames have
      * channels 0,1 and odd 2,3. */
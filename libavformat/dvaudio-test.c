@@ -0,0 +1,215 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * DV audio shuffling test, checks the table driven functions against
+ * a direct walk of the shuffling tables for every DV profile
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/lfg.h"
+#include "dvaudio.h"
+
+#undef printf
+
+#define CHAN_SIZE (12 * 150 * 80)
+
+static uint8_t frame_ref[CHAN_SIZE];
+static uint8_t frame_new[CHAN_SIZE];
+static uint8_t pcm_ref[2][8192];
+static uint8_t pcm_new[2][8192];
+static DVAudioMap map;
+
+static uint16_t ref_12to16(uint16_t sample)
+{
+    uint16_t shift, result;
+
+    sample = (sample < 0x800) ? sample : sample | 0xf000;
+    shift  = (sample & 0xf00) >> 8;
+
+    if (shift < 0x2 || shift > 0xd) {
+        result = sample;
+    } else if (shift < 0x8) {
+        shift--;
+        result = (sample - (256 * shift)) << shift;
+    } else {
+        shift = 0xe - shift;
+        result = ((sample + ((256 * shift) + 1)) << shift) - 1;
+    }
+
+    return result;
+}
+
+static void ref_get(const DVprofile *sys, int quant, uint8_t *pcm[2],
+                    const uint8_t *frame, int size)
+{
+    int i, j, d, of, half_ch = sys->difseg_size / 2;
+    uint16_t lc, rc;
+    uint8_t *dst = pcm[0];
+
+    for (i = 0; i < sys->difseg_size; i++) {
+        frame += 6 * 80;
+        if (quant == 1 && i == half_ch) {
+            dst = pcm[1];
+            if (!dst)
+                break;
+        }
+        for (j = 0; j < 9; j++) {
+            for (d = 8; d < 80; d += 2) {
+                if (quant == 0) {
+                    of = sys->audio_shuffle[i][j] + (d - 8) / 2 * sys->audio_stride;
+                    if (of*2 >= size)
+                        continue;
+                    dst[of*2]   = frame[d];
+                    dst[of*2+1] = frame[d+1];
+                } else {
+                    lc = ((uint16_t)frame[d]   << 4) |
+                         ((uint16_t)frame[d+2] >> 4);
+                    rc = ((uint16_t)frame[d+1] << 4) |
+                         ((uint16_t)frame[d+2] & 0x0f);
+                    lc = (lc == 0x800 ? 0 : ref_12to16(lc));
+                    rc = (rc == 0x800 ? 0 : ref_12to16(rc));
+
+                    of = sys->audio_shuffle[i%half_ch][j] + (d - 8) / 3 * sys->audio_stride;
+                    if (of*2 >= size)
+                        continue;
+                    AV_WB16(dst + of*2, lc);
+                    of = sys->audio_shuffle[i%half_ch+half_ch][j] +
+                        (d - 8) / 3 * sys->audio_stride;
+                    AV_WB16(dst + of*2, rc);
+                    ++d;
+                }
+            }
+            frame += 16 * 80;
+        }
+    }
+}
+
+static void ref_put(const DVprofile *sys, uint8_t *frame, const uint8_t *pcm,
+                    int size)
+{
+    int i, j, d, of;
+
+    for (i = 0; i < sys->difseg_size; i++) {
+        frame += 6 * 80;
+        for (j = 0; j < 9; j++) {
+            for (d = 8; d < 80; d += 2) {
+                of = sys->audio_shuffle[i][j] + (d - 8) / 2 * sys->audio_stride;
+                if (of*2 >= size)
+                    continue;
+                frame[d]   = pcm[of*2];
+                frame[d+1] = pcm[of*2+1];
+            }
+            frame += 16 * 80;
+        }
+    }
+}
+
+static int check(const DVprofile *sys, AVLFG *lfg)
+{
+    int i, freq, smpls, quant, size;
+
+    ff_dv_audio_map_init(&map, sys);
+
+    for (i = 0; i < CHAN_SIZE; i++)
+        frame_ref[i] = av_lfg_get(lfg);
+
+    for (freq = 0; freq < 3; freq++) {
+        for (smpls = 0; smpls < 64; smpls += 21) {
+            size = (sys->audio_min_samples[freq] + smpls) * 4;
+
+            for (quant = 0; quant < 2; quant++) {
+                uint8_t *ref[2] = { pcm_ref[0], quant ? pcm_ref[1] : NULL };
+                uint8_t *new[2] = { pcm_new[0], quant ? pcm_new[1] : NULL };
+
+                memset(pcm_ref, 0x55, sizeof(pcm_ref));
+                memset(pcm_new, 0x55, sizeof(pcm_new));
+                ref_get(sys, quant, ref, frame_ref, size);
+                if (quant)
+                    ff_dv_audio_get12(&map, new, frame_ref, size);
+                else
+                    ff_dv_audio_get16(&map, new[0], frame_ref, size);
+                if (memcmp(pcm_ref, pcm_new, sizeof(pcm_ref))) {
+                    printf("%dx%d get%d mismatch, size %d\n", sys->width,
+                           sys->height, quant ? 12 : 16, size);
+                    return 1;
+                }
+            }
+
+            for (i = 0; i < sizeof(pcm_ref[0]); i++)
+                pcm_ref[0][i] = av_lfg_get(lfg);
+            memcpy(frame_new, frame_ref, sizeof(frame_new));
+            ref_put(sys, frame_ref, pcm_ref[0], size);
+            ff_dv_audio_put16(&map, frame_new, pcm_ref[0], size);
+            if (memcmp(frame_ref, frame_new, sizeof(frame_ref))) {
+                printf("%dx%d put16 mismatch, size %d\n", sys->width,
+                       sys->height, size);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    const DVprofile *profiles[32];
+    uint8_t header[80 * 6];
+    AVLFG lfg;
+    int i, j, dsf, stype, n = 0, ret = 0;
+
+    av_lfg_init(&lfg, 1);
+
+    /* walk the header fields ff_dv_frame_profile() looks at to reach
+       every profile */
+    memset(header, 0, sizeof(header));
+    for (dsf = 0; dsf < 2; dsf++) {
+        for (stype = 0; stype < 32; stype++) {
+            for (i = 0; i < 4; i++) {
+                const DVprofile *sys;
+                header[3] = dsf << 7;
+                header[4] = i & 1;
+                header[80*5 + 48 + 3] = (i >> 1) << 5 | stype;
+                sys = ff_dv_frame_profile(NULL, header, sizeof(header));
+                if (!sys)
+                    continue;
+                for (j = 0; j < n && profiles[j] != sys; j++);
+                if (j == n && n < FF_ARRAY_ELEMS(profiles))
+                    profiles[n++] = sys;
+            }
+        }
+    }
+
+    for (i = 0; i < n; i++)
+        ret |= check(profiles[i], &lfg);
+
+    for (i = 0; i < 4096; i++) {
+        if (map.lut12[i] != (i == 0x800 ? 0 : ref_12to16(i))) {
+            printf("lut12 mismatch at 0x%03x\n", i);
+            ret = 1;
+            break;
+        }
+    }
+
+    if (!ret)
+        printf("dvaudio: OK\n");
+    return ret;
+}
@@ -0,0 +1,128 @@
+/*
+ * DV audio shuffling
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/intreadwrite.h"
+#include "dvaudio.h"
+
+static inline uint16_t dv_audio_12to16(uint16_t sample)
+{
+    uint16_t shift, result;
+
+    sample = (sample < 0x800) ? sample : sample | 0xf000;
+    shift  = (sample & 0xf00) >> 8;
+
+    if (shift < 0x2 || shift > 0xd) {
+        result = sample;
+    } else if (shift < 0x8) {
+        shift--;
+        result = (sample - (256 * shift)) << shift;
+    } else {
+        shift = 0xe - shift;
+        result = ((sample + ((256 * shift) + 1)) << shift) - 1;
+    }
+
+    return result;
+}
+
+void ff_dv_audio_map_init(DVAudioMap *m, const DVprofile *sys)
+{
+    int i, j, k, half_ch = sys->difseg_size / 2;
+    uint16_t *of16 = m->of16;
+    uint16_t (*of12)[2] = m->of12;
+
+    m->sys = sys;
+    for (i = 0; i < sys->difseg_size; i++) {
+        for (j = 0; j < 9; j++) {
+            for (k = 0; k < 36; k++)
+                *of16++ = sys->audio_shuffle[i][j] + k * sys->audio_stride;
+            for (k = 0; k < 24; k++, of12++) {
+                of12[0][0] = sys->audio_shuffle[i % half_ch][j] +
+                             k * sys->audio_stride;
+                of12[0][1] = sys->audio_shuffle[i % half_ch + half_ch][j] +
+                             k * sys->audio_stride;
+            }
+        }
+    }
+
+    /* 0x800 is an erroneous sample, silence it */
+    for (i = 0; i < 4096; i++)
+        m->lut12[i] = i == 0x800 ? 0 : dv_audio_12to16(i);
+}
+
+void ff_dv_audio_get16(const DVAudioMap *m, uint8_t *pcm,
+                       const uint8_t *frame, int size)
+{
+    const uint16_t *of = m->of16;
+    int i, j, k, words = size >> 1;
+
+    for (i = 0; i < m->sys->difseg_size; i++) {
+        frame += 6 * 80; /* skip DIF segment header */
+        for (j = 0; j < 9; j++, of += 36) {
+            for (k = 0; k < 36; k++)
+                if (of[k] < words)
+                    AV_COPY16(pcm + 2 * of[k], frame + 8 + 2 * k);
+            frame += 16 * 80; /* 15 Video DIFs + 1 Audio DIF */
+        }
+    }
+}
+
+void ff_dv_audio_get12(const DVAudioMap *m, uint8_t *pcm[2],
+                       const uint8_t *frame, int size)
+{
+    const uint16_t (*of)[2] = m->of12;
+    const uint16_t *lut = m->lut12;
+    int i, j, k, words = size >> 1, half_ch = m->sys->difseg_size / 2;
+
+    for (i = 0; i < m->sys->difseg_size; i++) {
+        uint8_t *dst = pcm[i >= half_ch];
+        if (!dst)
+            break;
+        frame += 6 * 80; /* skip DIF segment header */
+        for (j = 0; j < 9; j++, of += 24) {
+            const uint8_t *src = frame + 8;
+            for (k = 0; k < 24; k++, src += 3) {
+                /* the offsets grow with k, the rest of the block is past
+                   the end too */
+                if (of[k][0] >= words)
+                    break;
+                AV_WB16(dst + 2 * of[k][0], lut[src[0] << 4 | src[2] >> 4]);
+                AV_WB16(dst + 2 * of[k][1], lut[src[1] << 4 | (src[2] & 15)]);
+            }
+            frame += 16 * 80; /* 15 Video DIFs + 1 Audio DIF */
+        }
+    }
+}
+
+void ff_dv_audio_put16(const DVAudioMap *m, uint8_t *frame,
+                       const uint8_t *pcm, int size)
+{
+    const uint16_t *of = m->of16;
+    int i, j, k, words = size >> 1;
+
+    for (i = 0; i < m->sys->difseg_size; i++) {
+        frame += 6 * 80; /* skip DIF segment header */
+        for (j = 0; j < 9; j++, of += 36) {
+            for (k = 0; k < 36; k++)
+                if (of[k] < words)
+                    AV_COPY16(frame + 8 + 2 * k, pcm + 2 * of[k]);
+            frame += 16 * 80; /* 15 Video DIFs + 1 Audio DIF */
+        }
+    }
+}
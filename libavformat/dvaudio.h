@@ -0,0 +1,70 @@
+/*
+ * DV audio shuffling
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_DVAUDIO_H
+#define AVFORMAT_DVAUDIO_H
+
+#include <stdint.h>
+#include "libavcodec/dvdata.h"
+
+/** 16-bit samples in the audio DIF blocks of one DIF channel */
+#define DV_AUDIO_MAX_SAMPLES (12 * 9 * 36)
+/** 3-byte pairs of 12-bit samples in the audio DIF blocks of one DIF channel */
+#define DV_AUDIO_MAX_PAIRS   (12 * 9 * 24)
+
+/**
+ * Offsets of the audio samples of one DIF channel in the PCM buffer,
+ * in 16-bit words, in the order the samples appear in the stream.
+ * The PCM buffer holds interleaved stereo samples, a DIF channel carries
+ * one stereo pair in 16-bit mode and two in 12-bit mode, one per half
+ * of its DIF segments.
+ */
+typedef struct DVAudioMap {
+    const DVprofile *sys;
+    uint16_t of16[DV_AUDIO_MAX_SAMPLES];
+    uint16_t of12[DV_AUDIO_MAX_PAIRS][2];  ///< left and right sample of a pair
+    uint16_t lut12[4096];                  ///< 12-bit nonlinear to 16-bit linear
+} DVAudioMap;
+
+void ff_dv_audio_map_init(DVAudioMap *m, const DVprofile *sys);
+
+/**
+ * Gather the 16-bit samples of one DIF channel.
+ * @param frame start of the DIF channel
+ * @param size  bytes of PCM in the frame, samples past it are skipped
+ */
+void ff_dv_audio_get16(const DVAudioMap *m, uint8_t *pcm,
+                       const uint8_t *frame, int size);
+
+/**
+ * Gather the 12-bit samples of one DIF channel as 16-bit big-endian ones,
+ * pcm[1] receives the second half of the DIF segments and may be NULL.
+ */
+void ff_dv_audio_get12(const DVAudioMap *m, uint8_t *pcm[2],
+                       const uint8_t *frame, int size);
+
+/**
+ * Scatter 16-bit samples to the audio DIF blocks of one DIF channel,
+ * the AAUX packs are left alone.
+ */
+void ff_dv_audio_put16(const DVAudioMap *m, uint8_t *frame,
+                       const uint8_t *pcm, int size);
+
+#endif /* AVFORMAT_DVAUDIO_H */
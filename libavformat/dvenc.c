@@ -33,6 +33,7 @@
 #include "libavcodec/dvdata.h"
 #include "libavcodec/timecode.h"
 #include "dv.h"
+#include "dvaudio.h"
 #include "libavutil/fifo.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
@@ -43,6 +44,8 @@ struct DVMuxContext {
     int               n_ast;         /* number of stereo audio streams (up to 2) */
     AVStream         *ast[4];        /* stereo audio streams */
     AVFifoBuffer     *audio_data[4]; /* FIFO for storing excessive amounts of PCM */
+    uint8_t           audio_buf[8192]; /* PCM of one DIF channel for the frame under construction */
+    DVAudioMap        audio_map;
     int               frames;        /* current frame number */
     int64_t           start_time;    /* recording start time */
     int               has_audio;     /* frame under contruction has audio */
@@ -147,20 +150,21 @@ static int dv_write_pack(enum dv_pack_type pack_id, DVMuxContext *c, uint8_t *bu
 
 static void dv_inject_audio(DVMuxContext *c, int channel, uint8_t* frame_ptr)
 {
-    int i, j, d, of, size;
+    AVFifoBuffer *f = c->audio_data[channel];
+    int i, j, len, size;
     size = 4 * dv_audio_frame_size(c->sys, c->frames);
     frame_ptr += channel * c->sys->difseg_size * 150 * 80;
+
+    /* the PCM may wrap around the end of the FIFO */
+    len = FFMIN(size, f->end - f->rptr);
+    memcpy(c->audio_buf,       f->rptr,   len);
+    memcpy(c->audio_buf + len, f->buffer, size - len);
+    ff_dv_audio_put16(&c->audio_map, frame_ptr, c->audio_buf, size);
+
     for (i = 0; i < c->sys->difseg_size; i++) {
         frame_ptr += 6 * 80; /* skip DIF segment header */
         for (j = 0; j < 9; j++) {
             dv_write_pack(dv_aaux_packs_dist[i][j], c, &frame_ptr[3], i);
-            for (d = 8; d < 80; d+=2) {
-                of = c->sys->audio_shuffle[i][j] + (d - 8)/2 * c->sys->audio_stride;
-                if (of*2 >= size)
-                    continue;
-                frame_ptr[d]   = av_fifo_peek(c->audio_data[channel], of*2);
-                frame_ptr[d+1] = av_fifo_peek(c->audio_data[channel], of*2+1);
-            }
             frame_ptr += 16 * 80; /* 15 Video DIFs + 1 Audio DIF */
         }
     }
@@ -309,6 +313,8 @@ static DVMuxContext* dv_init_mux(AVFormatContext* s)
         }
     }
 
+    ff_dv_audio_map_init(&c->audio_map, c->sys);
+
     return c;
 
 bail_out:
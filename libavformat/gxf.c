@@ -20,15 +20,23 @@
  */
 
 #include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
 #include "avformat.h"
 #include "internal.h"
 #include "gxf.h"
 
+#define GXF_MAX_FLT_ENTRIES 1000
+
 struct gxf_stream_info {
     int64_t first_field;
     int64_t last_field;
     AVRational frames_per_second;
     int32_t fields_per_frame;
+    int64_t last_indexed_field; ///< highest field number added to the index while demuxing
+    int64_t flt_start;          ///< field number of the first FLT entry
+    uint32_t fields_per_map;    ///< number of fields between FLT entries
+    int nb_flt;                 ///< number of FLT entries
+    uint32_t flt[GXF_MAX_FLT_ENTRIES]; ///< FLT entries, in units of 1024 bytes
 };
 
 /**
@@ -228,11 +236,19 @@ static void gxf_track_tags(AVIOContext *pb, int *len, struct gxf_stream_info *si
 }
 
 /**
- * @brief read index from FLT packet into stream 0 av_index
+ * @brief read index from FLT packet
+ *
+ * Each entry gives the position, in units of 1024 bytes, of the video
+ * packet starting field i * fields_per_map. The exact packet position is
+ * found by gxf_resync_media(). The entries are kept apart from the stream 0
+ * av_index, which only gets the exact entries in field order as the packets
+ * are read, gxf_seek() uses them beyond the last exact entry.
  */
 static void gxf_read_index(AVFormatContext *s, int pkt_len) {
     AVIOContext *pb = s->pb;
     AVStream *st = s->streams[0];
+    struct gxf_stream_info *si = s->priv_data;
+    int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
     uint32_t fields_per_map = avio_rl32(pb);
     uint32_t map_cnt = avio_rl32(pb);
     int i;
@@ -241,9 +257,9 @@ static void gxf_read_index(AVFormatContext *s, int pkt_len) {
         avio_skip(pb, pkt_len);
         return;
     }
-    if (map_cnt > 1000) {
+    if (map_cnt > GXF_MAX_FLT_ENTRIES) {
         av_log(s, AV_LOG_ERROR, "too many index entries %u (%x)\n", map_cnt, map_cnt);
-        map_cnt = 1000;
+        map_cnt = GXF_MAX_FLT_ENTRIES;
     }
     if (pkt_len < 4 * map_cnt) {
         av_log(s, AV_LOG_ERROR, "invalid index length\n");
@@ -251,10 +267,11 @@ static void gxf_read_index(AVFormatContext *s, int pkt_len) {
         return;
     }
     pkt_len -= 4 * map_cnt;
-    av_add_index_entry(st, 0, 0, 0, 0, 0);
+    si->flt_start = start;
+    si->fields_per_map = fields_per_map;
+    si->nb_flt = map_cnt;
     for (i = 0; i < map_cnt; i++)
-        av_add_index_entry(st, (uint64_t)avio_rl32(pb) * 1024,
-                           i * (uint64_t)fields_per_map + 1, 0, 0, 0);
+        si->flt[i] = avio_rl32(pb);
     avio_skip(pb, pkt_len);
 }
 
@@ -266,6 +283,7 @@ static int gxf_header(AVFormatContext *s, AVFormatParameters *ap) {
     AVRational main_timebase = {0, 0};
     struct gxf_stream_info *si = s->priv_data;
     int i;
+    si->last_indexed_field = -1;
     if (!parse_packet_header(pb, &pkt_type, &map_len) || pkt_type != PKT_MAP) {
         av_log(s, AV_LOG_ERROR, "map packet not found\n");
         return 0;
@@ -366,60 +384,97 @@ static int gxf_header(AVFormatContext *s, AVFormatParameters *ap) {
     return 0;
 }
 
-#define READ_ONE() \
-    { \
-        if (!max_interval-- || url_feof(pb)) \
-            goto out; \
-        tmp = tmp << 8 | avio_r8(pb); \
-    }
+#define GXF_SCAN_SIZE (64 * 1024)
+#define GXF_MEDIA_HEADER_SIZE (16 + 6) ///< packet header up to the media field number
+
+/**
+ * @brief check for a media packet header
+ * @return packet length including header, 0 if buf does not start a media packet
+ */
+static int gxf_media_header_len(const uint8_t *buf) {
+    int len;
+    if (AV_RN32(buf) || buf[4] != 1 || buf[5] != PKT_MEDIA)
+        return 0;
+    len = AV_RB32(buf + 6);
+    if ((len >> 24) || len < 32)
+        return 0;
+    if (AV_RN32(buf + 10) || buf[14] != 0xe1 || buf[15] != 0xe2)
+        return 0;
+    return len;
+}
 
 /**
  * @brief resync the stream on the next media packet with specified properties
+ *
+ * Data is scanned in large blocks, candidates for the 0x00000000 0x01 start
+ * code are located with memchr() and once a media packet was found the
+ * following ones are reached by skipping over the packet payload.
  * @param max_interval how many bytes to search for matching packet at most
  * @param track track id the media packet must belong to, -1 for any
  * @param timestamp minimum timestamp (== field number) the packet must have, -1 for any
  * @return timestamp of packet found
  */
 static int64_t gxf_resync_media(AVFormatContext *s, uint64_t max_interval, int track, int timestamp) {
-    uint32_t tmp;
-    uint64_t last_pos;
-    uint64_t last_found_pos = 0;
-    int cur_track;
-    int64_t cur_timestamp = AV_NOPTS_VALUE;
-    int len;
     AVIOContext *pb = s->pb;
-    GXFPktType type;
-    tmp = avio_rb32(pb);
-start:
-    while (tmp)
-        READ_ONE();
-    READ_ONE();
-    if (tmp != 1)
-        goto start;
-    last_pos = avio_tell(pb);
-    if (avio_seek(pb, -5, SEEK_CUR) < 0)
-        goto out;
-    if (!parse_packet_header(pb, &type, &len) || type != PKT_MEDIA) {
-        if (avio_seek(pb, last_pos, SEEK_SET) < 0)
-            goto out;
-        goto start;
-    }
-    avio_r8(pb);
-    cur_track = avio_r8(pb);
-    cur_timestamp = avio_rb32(pb);
-    last_found_pos = avio_tell(pb) - 16 - 6;
-    if ((track >= 0 && track != cur_track) || (timestamp >= 0 && timestamp > cur_timestamp)) {
-        if (avio_seek(pb, last_pos, SEEK_SET) >= 0)
-            goto start;
+    int64_t buf_pos = avio_tell(pb);
+    int64_t limit = max_interval > INT64_MAX - buf_pos ? INT64_MAX : buf_pos + max_interval;
+    int64_t last_found_pos = -1;
+    int64_t cur_timestamp = AV_NOPTS_VALUE;
+    uint8_t *buf;
+    int len = 0, i = 0;
+
+    buf = av_malloc(GXF_SCAN_SIZE);
+    if (!buf)
+        return AV_NOPTS_VALUE;
+    for (;;) {
+        int n = avio_read(pb, buf + len, GXF_SCAN_SIZE - len);
+        if (n > 0)
+            len += n;
+        if (len < GXF_MEDIA_HEADER_SIZE)
+            break;
+        while (i <= len - GXF_MEDIA_HEADER_SIZE) {
+            const uint8_t *p;
+            int pkt_len;
+            if (buf_pos + i >= limit)
+                goto out;
+            pkt_len = gxf_media_header_len(buf + i);
+            if (!pkt_len) {
+                p = memchr(buf + i + 5, 1, len - GXF_MEDIA_HEADER_SIZE - i);
+                i = p ? p - buf - 4 : len - GXF_MEDIA_HEADER_SIZE + 1;
+                continue;
+            }
+            last_found_pos = buf_pos + i;
+            cur_timestamp = AV_RB32(buf + i + 18);
+            if ((track < 0 || track == buf[i + 17]) &&
+                (timestamp < 0 || timestamp <= cur_timestamp))
+                goto out;
+            i += pkt_len;
+        }
+        if (i > len) {
+            /* next packet starts after the buffered data */
+            buf_pos += i;
+            if (buf_pos >= limit || avio_seek(pb, buf_pos, SEEK_SET) < 0)
+                goto out;
+            len = i = 0;
+        } else {
+            memmove(buf, buf + i, len - i);
+            buf_pos += i;
+            len -= i;
+            i = 0;
+        }
+        if (n <= 0 && len < GXF_SCAN_SIZE)
+            break;
     }
 out:
-    if (last_found_pos)
+    av_free(buf);
+    if (last_found_pos >= 0)
         avio_seek(pb, last_found_pos, SEEK_SET);
     return cur_timestamp;
 }
 
 static int gxf_packet(AVFormatContext *s, AVPacket *pkt) {
     AVIOContext *pb = s->pb;
+    struct gxf_stream_info *si = s->priv_data;
     GXFPktType pkt_type;
     int pkt_len;
 
@@ -428,6 +483,7 @@ static int gxf_packet(AVFormatContext *s, AVPacket *pkt) {
         int track_type, track_id, ret;
         int field_nr, field_info, skip = 0;
         int stream_index;
+        int64_t pos = avio_tell(pb);
         if (!parse_packet_header(pb, &pkt_type, &pkt_len)) {
             if (!url_feof(pb))
                 av_log(s, AV_LOG_ERROR, "sync lost\n");
@@ -457,6 +513,12 @@ static int gxf_packet(AVFormatContext *s, AVPacket *pkt) {
         field_nr = avio_rb32(pb); // "timeline" field number
         avio_r8(pb); // flags
         avio_r8(pb); // reserved
+        /* index the first packet of each field, whatever its track,
+         * this is where gxf_resync_media() would stop for that field */
+        if (field_nr > si->last_indexed_field) {
+            av_add_index_entry(s->streams[0], pos, field_nr, 0, 0, 0);
+            si->last_indexed_field = field_nr;
+        }
         if (st->codec->codec_id == CODEC_ID_PCM_S24LE ||
             st->codec->codec_id == CODEC_ID_PCM_S16LE) {
             int first = field_info >> 16;
@@ -474,6 +536,7 @@ static int gxf_packet(AVFormatContext *s, AVPacket *pkt) {
             avio_skip(pb, skip);
         pkt->stream_index = stream_index;
         pkt->dts = field_nr;
+        pkt->pos = pos;
 
         if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
             pkt->duration = 2;
@@ -484,21 +547,36 @@ static int gxf_packet(AVFormatContext *s, AVPacket *pkt) {
 }
 
 static int gxf_seek(AVFormatContext *s, int stream_index, int64_t timestamp, int flags) {
+    struct gxf_stream_info *si = s->priv_data;
     int res = 0;
-    uint64_t pos;
+    uint64_t pos = 0;
     uint64_t maxlen = 100 * 1024 * 1024;
     AVStream *st = s->streams[0];
     int64_t start_time = s->streams[stream_index]->start_time;
-    int64_t found;
+    int64_t found, idx_ts = INT64_MIN;
     int idx;
-    if (timestamp < start_time) timestamp = start_time;
-    idx = av_index_search_timestamp(st, timestamp - start_time,
+    if (start_time != AV_NOPTS_VALUE && timestamp < start_time)
+        timestamp = start_time;
+    idx = av_index_search_timestamp(st, timestamp,
                                     AVSEEK_FLAG_ANY | AVSEEK_FLAG_BACKWARD);
+    if (idx >= 0) {
+        idx_ts = st->index_entries[idx].timestamp;
+        pos = st->index_entries[idx].pos;
+        if (idx < st->nb_index_entries - 2)
+            maxlen = st->index_entries[idx + 2].pos - pos;
+    }
+    /* the exact entries only cover what was demuxed, the FLT the whole file */
+    if (si->nb_flt && si->fields_per_map && timestamp >= si->flt_start) {
+        int i = FFMIN((timestamp - si->flt_start) / si->fields_per_map, si->nb_flt - 1);
+        if (si->flt_start + i * (int64_t)si->fields_per_map > idx_ts) {
+            /* the first entry is the start of the file */
+            pos = i ? si->flt[i] * 1024ULL : 0;
+            maxlen = i < si->nb_flt - 2 ? si->flt[i + 2] * 1024ULL - pos : 100 * 1024 * 1024;
+            idx = i;
+        }
+    }
     if (idx < 0)
         return -1;
-    pos = st->index_entries[idx].pos;
-    if (idx < st->nb_index_entries - 2)
-        maxlen = st->index_entries[idx + 2].pos - pos;
     maxlen = FFMAX(maxlen, 200 * 1024);
     res = avio_seek(s->pb, pos, SEEK_SET);
     if (res < 0)
@@ -529,4 +607,5 @@ AVInputFormat ff_gxf_demuxer = {
     .read_packet    = gxf_packet,
     .read_seek      = gxf_seek,
     .read_timestamp = gxf_read_timestamp,
+    .flags          = AVFMT_INDEX_CACHE,
 };
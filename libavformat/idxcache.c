@@ -0,0 +1,364 @@
+/*
+ * Sidecar seek index cache
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Persist the index entries built while demuxing a whole file next to it,
+ * so that later opens of the same file can seek without searching.
+ *
+ * The sidecar is named after the file with an .ffindex suffix. It starts
+ * with the size, modification and status change times, inode and a CRC of
+ * the first and last bytes of the file it describes and is ignored if any
+ * of them does not match, the times alone only have a one second
+ * resolution. Entries are stored per stream as variable length deltas
+ * against the previous entry.
+ */
+
+#include <sys/stat.h>
+#include "libavutil/avstring.h"
+#include "libavutil/crc.h"
+#include "avformat.h"
+#include "avio_internal.h"
+#include "internal.h"
+
+#define INDEX_CACHE_TAG     MKTAG('F', 'F', 'I', 'X')
+#define INDEX_CACHE_VERSION 2
+#define INDEX_CACHE_SUFFIX  ".ffindex"
+#define INDEX_CACHE_CRC_SIZE 65536  ///< bytes checked at each end of the file
+
+typedef struct IndexCache IndexCache;
+
+typedef struct IndexCacheStream {
+    int index;
+    int id;
+    AVRational time_base;
+    int nb_entries;
+    AVIndexEntry *entries;
+    int applied;
+} IndexCacheStream;
+
+struct IndexCache {
+    int64_t file_size;
+    int64_t file_mtime;
+    int64_t file_ctime;
+    int64_t file_ino;
+    uint32_t file_crc;
+    char path[MAX_URL_SIZE];
+    int loaded;         ///< entries were read from the sidecar
+    int seeked;         ///< demuxing did not run sequentially from the start
+    int complete;       ///< the whole file was demuxed before the first seek
+    int nb_streams;
+    IndexCacheStream *streams;
+};
+
+static const char *local_path(const char *filename)
+{
+    av_strstart(filename, "file:", &filename);
+    if (strstr(filename, "://") || !strcmp(filename, "-") || !strncmp(filename, "pipe:", 5))
+        return NULL;
+    return filename;
+}
+
+static void put_v(AVIOContext *pb, uint64_t val)
+{
+    int i = 1;
+
+    while (val >> (7 * i))
+        i++;
+    while (--i > 0)
+        avio_w8(pb, 128 | (uint8_t)(val >> (7 * i)));
+    avio_w8(pb, val & 127);
+}
+
+static void put_s(AVIOContext *pb, int64_t val)
+{
+    put_v(pb, val < 0 ? ~((uint64_t)val << 1) : (uint64_t)val << 1);
+}
+
+static int64_t get_s(AVIOContext *pb)
+{
+    uint64_t v = ffio_read_varlen(pb);
+    return v & 1 ? ~(v >> 1) : v >> 1;
+}
+
+static int crc_range(AVIOContext *pb, const AVCRC *table, uint32_t *crc,
+                     int64_t pos, int64_t size)
+{
+    uint8_t buf[4096];
+    int len;
+
+    if (avio_seek(pb, pos, SEEK_SET) < 0)
+        return AVERROR(EIO);
+    while (size > 0) {
+        if ((len = avio_read(pb, buf, FFMIN(size, sizeof(buf)))) <= 0)
+            return AVERROR(EIO);
+        *crc  = av_crc(table, *crc, buf, len);
+        size -= len;
+    }
+    return 0;
+}
+
+/* CRC of the first and last bytes of the file */
+static int file_crc(const char *path, int64_t file_size, uint32_t *crc)
+{
+    const AVCRC *table = av_crc_get_table(AV_CRC_32_IEEE);
+    int64_t head = FFMIN(file_size, INDEX_CACHE_CRC_SIZE);
+    int64_t tail = FFMIN(file_size - head, INDEX_CACHE_CRC_SIZE);
+    AVIOContext *pb;
+    int ret;
+
+    if (avio_open(&pb, path, AVIO_FLAG_READ) < 0)
+        return AVERROR(EIO);
+    *crc = 0;
+    if ((ret = crc_range(pb, table, crc, 0, head)) >= 0)
+        ret = crc_range(pb, table, crc, file_size - tail, tail);
+    avio_close(pb);
+    return ret;
+}
+
+static void free_streams(IndexCache *c)
+{
+    int i;
+
+    for (i = 0; i < c->nb_streams; i++)
+        av_free(c->streams[i].entries);
+    av_freep(&c->streams);
+    c->nb_streams = 0;
+}
+
+static int read_cache(AVFormatContext *s, IndexCache *c)
+{
+    AVIOContext *pb;
+    int i, j, nb_streams, ret = AVERROR_INVALIDDATA;
+
+    if (avio_open(&pb, c->path, AVIO_FLAG_READ) < 0)
+        return AVERROR(ENOENT);
+    if (avio_rl32(pb) != INDEX_CACHE_TAG || avio_rl32(pb) != INDEX_CACHE_VERSION)
+        goto fail;
+    if (avio_rl64(pb) != c->file_size || avio_rl64(pb) != c->file_mtime ||
+        avio_rl64(pb) != c->file_ctime || avio_rl64(pb) != c->file_ino ||
+        avio_rl32(pb) != c->file_crc) {
+        av_log(s, AV_LOG_VERBOSE, "index cache %s is outdated\n", c->path);
+        goto fail;
+    }
+    nb_streams = avio_rl32(pb);
+    if (nb_streams <= 0 || nb_streams >= INT_MAX / sizeof(*c->streams))
+        goto fail;
+    c->streams = av_mallocz(nb_streams * sizeof(*c->streams));
+    if (!c->streams) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    c->nb_streams = nb_streams;
+    for (i = 0; i < nb_streams; i++) {
+        IndexCacheStream *cs = &c->streams[i];
+        int64_t pos = 0, timestamp = 0;
+
+        cs->index          = avio_rl32(pb);
+        cs->id             = avio_rl32(pb);
+        cs->time_base.num  = avio_rl32(pb);
+        cs->time_base.den  = avio_rl32(pb);
+        cs->nb_entries     = avio_rl32(pb);
+        if (cs->index < 0)
+            goto fail;
+        if (cs->nb_entries < 0 || cs->nb_entries >= UINT_MAX / sizeof(AVIndexEntry))
+            goto fail;
+        cs->entries = av_malloc(cs->nb_entries * sizeof(*cs->entries));
+        if (!cs->entries) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        for (j = 0; j < cs->nb_entries; j++) {
+            AVIndexEntry *ie = &cs->entries[j];
+            int flags;
+            pos       += get_s(pb);
+            timestamp += get_s(pb);
+            ie->pos          = pos;
+            ie->timestamp    = timestamp;
+            flags            = ffio_read_varlen(pb);
+            ie->flags        = flags & 3;
+            ie->size         = flags >> 2;
+            ie->min_distance = ffio_read_varlen(pb);
+        }
+        if (url_feof(pb))
+            goto fail;
+    }
+    avio_close(pb);
+    return 0;
+fail:
+    free_streams(c);
+    avio_close(pb);
+    return ret;
+}
+
+static void write_cache(AVFormatContext *s, IndexCache *c)
+{
+    AVIOContext *pb;
+    int i, j, nb_streams = 0;
+
+    for (i = 0; i < s->nb_streams; i++)
+        nb_streams += s->streams[i]->nb_index_entries > 0;
+    if (!nb_streams)
+        return;
+
+    if (avio_open(&pb, c->path, AVIO_FLAG_WRITE) < 0) {
+        av_log(s, AV_LOG_VERBOSE, "could not write index cache %s\n", c->path);
+        return;
+    }
+    avio_wl32(pb, INDEX_CACHE_TAG);
+    avio_wl32(pb, INDEX_CACHE_VERSION);
+    avio_wl64(pb, c->file_size);
+    avio_wl64(pb, c->file_mtime);
+    avio_wl64(pb, c->file_ctime);
+    avio_wl64(pb, c->file_ino);
+    avio_wl32(pb, c->file_crc);
+    avio_wl32(pb, nb_streams);
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        int64_t pos = 0, timestamp = 0;
+
+        if (!st->nb_index_entries)
+            continue;
+        avio_wl32(pb, st->index);
+        avio_wl32(pb, st->id);
+        avio_wl32(pb, st->time_base.num);
+        avio_wl32(pb, st->time_base.den);
+        avio_wl32(pb, st->nb_index_entries);
+        for (j = 0; j < st->nb_index_entries; j++) {
+            AVIndexEntry *ie = &st->index_entries[j];
+            put_s(pb, ie->pos - pos);
+            put_s(pb, ie->timestamp - timestamp);
+            put_v(pb, (uint64_t)ie->size << 2 | (ie->flags & 3));
+            put_v(pb, ie->min_distance);
+            pos       = ie->pos;
+            timestamp = ie->timestamp;
+        }
+    }
+    avio_flush(pb);
+    avio_close(pb);
+    av_log(s, AV_LOG_VERBOSE, "wrote index cache %s\n", c->path);
+}
+
+int ff_index_cache_open(AVFormatContext *s)
+{
+    IndexCache *c;
+    const char *path;
+    struct stat st;
+
+    if (!(s->flags & AVFMT_FLAG_IDXCACHE) || !(s->iformat->flags & AVFMT_INDEX_CACHE) ||
+        (s->flags & AVFMT_FLAG_IGNIDX) || !s->pb || !s->pb->seekable)
+        return 0;
+    path = local_path(s->filename);
+    if (!path || stat(path, &st) < 0 || !S_ISREG(st.st_mode))
+        return 0;
+    if (strlen(path) + sizeof(INDEX_CACHE_SUFFIX) > MAX_URL_SIZE)
+        return 0;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+    c->file_size  = st.st_size;
+    c->file_mtime = st.st_mtime;
+    c->file_ctime = st.st_ctime;
+    c->file_ino   = st.st_ino;
+    if (file_crc(path, c->file_size, &c->file_crc) < 0) {
+        av_free(c);
+        return 0;
+    }
+    snprintf(c->path, sizeof(c->path), "%s%s", path, INDEX_CACHE_SUFFIX);
+    s->index_cache = c;
+
+    if (read_cache(s, c) >= 0) {
+        c->loaded = 1;
+        av_log(s, AV_LOG_VERBOSE, "loaded index cache %s\n", c->path);
+        ff_index_cache_apply(s);
+    }
+    return 0;
+}
+
+void ff_index_cache_apply(AVFormatContext *s)
+{
+    IndexCache *c = s->index_cache;
+    int i, j;
+
+    if (!c)
+        return;
+    for (i = 0; i < c->nb_streams; i++) {
+        IndexCacheStream *cs = &c->streams[i];
+        AVStream *st;
+
+        if (cs->applied || (unsigned)cs->index >= s->nb_streams)
+            continue;
+        st = s->streams[cs->index];
+        if (st->id != cs->id || av_cmp_q(st->time_base, cs->time_base))
+            continue;
+        for (j = 0; j < cs->nb_entries; j++) {
+            AVIndexEntry *ie = &cs->entries[j];
+            av_add_index_entry(st, ie->pos, ie->timestamp, ie->size,
+                               ie->min_distance, ie->flags);
+        }
+        cs->applied = 1;
+    }
+}
+
+/* only a sequential read up to the end gives a complete index */
+static int scanned(AVFormatContext *s, IndexCache *c)
+{
+    return c->complete || (!c->seeked && s->pb && s->pb->eof_reached);
+}
+
+int ff_index_cache_complete(AVFormatContext *s)
+{
+    IndexCache *c = s->index_cache;
+    int i;
+
+    if (!c)
+        return 0;
+    if (!c->loaded)
+        return scanned(s, c);
+    /* a stream of the cache may not exist yet or no longer match */
+    ff_index_cache_apply(s);
+    for (i = 0; i < c->nb_streams; i++)
+        if (!c->streams[i].applied)
+            return scanned(s, c);
+    return 1;
+}
+
+void ff_index_cache_seek(AVFormatContext *s)
+{
+    IndexCache *c = s->index_cache;
+
+    if (!c)
+        return;
+    c->complete = scanned(s, c);
+    c->seeked = 1;
+}
+
+void ff_index_cache_close(AVFormatContext *s)
+{
+    IndexCache *c = s->index_cache;
+
+    if (!c)
+        return;
+    if (!c->loaded && scanned(s, c))
+        write_cache(s, c);
+    free_streams(c);
+    av_freep(&s->index_cache);
+}
@@ -29,7 +29,49 @@
 #include "avformat.h"
 #include "avio_internal.h"
 #include "internal.h"
+#include "url.h"
 #include <strings.h>
+#include <unistd.h>
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#define MAX_IO_THREADS 32
+
+enum PrefetchState {
+    SLOT_EMPTY,
+    SLOT_PENDING,  ///< waiting for a worker
+    SLOT_BUSY,     ///< being read by a worker
+    SLOT_DONE,
+};
+
+/**
+ * Image read ahead of the demuxer by the I/O workers.
+ */
+typedef struct {
+    enum PrefetchState state;
+    int number;
+    int ret;
+    int size;      ///< size of the first plane
+    AVPacket pkt;
+} PrefetchSlot;
+
+/**
+ * Image written behind the muxer by the I/O workers.
+ */
+typedef struct {
+    int number;
+    int busy;
+    int created;   ///< files are open
+    int fresh;     ///< files created ahead by this muxer, removed if not written
+    int exists;    ///< files already there, not created ahead
+    int done;
+    int ret;
+    AVIOContext *pb[3];
+    uint8_t *data; ///< NULL if the file is only created ahead
+    int size;
+} WriteSlot;
 
 typedef struct {
     const AVClass *class;  /**< Class for private options. */
@@ -44,6 +86,37 @@ typedef struct {
     char *video_size;       /**< Set by a private option. */
     char *framerate;        /**< Set by a private option. */
     int loop;
+    int prefetch;           /**< number of images read ahead, set by a private option. */
+    int io_threads;         /**< number of I/O workers, set by a private option. */
+
+    PrefetchSlot *slots;
+    int slot_head;          ///< slot of the next image to return
+    int nb_queued;
+    int fetch_number;       ///< number of the next image to queue
+    int nb_workers;
+    int quit;
+    int64_t nb_reads;
+    int64_t queue_depth;    ///< sum of the images ready at each read
+    int64_t nb_stalls;
+    int64_t stall_time;
+    int write_threads;      /**< number of write-behind workers, set by a private option. */
+    int write_queue;        /**< max number of images queued, set by a private option. */
+    int precreate;          /**< number of files created ahead, set by a private option. */
+    int sync;               /**< fsync each file, set by a private option. */
+
+    WriteSlot *wslots;
+    int nb_wslots;          ///< size of the ring
+    int wslot_tail;         ///< slot of the oldest image not retired
+    int wslot_count;        ///< number of slots in use
+    int tail_number;        ///< number of the image in the tail slot
+    int nb_pending;         ///< images queued and not yet written
+    int error;
+#if HAVE_PTHREADS
+    pthread_t workers[MAX_IO_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+#endif
 } VideoData;
 
 typedef struct {
@@ -302,49 +375,43 @@ static int read_header(AVFormatContext *s1, AVFormatParameters *ap)
     return 0;
 }
 
-static int read_packet(AVFormatContext *s1, AVPacket *pkt)
+/**
+ * Read image number of the sequence, all its planes if they are split,
+ * into a new packet.
+ * @param size0 set to the size of the first plane
+ */
+static int read_image(AVFormatContext *s1, int number, AVPacket *pkt, int *size0)
 {
     VideoData *s = s1->priv_data;
     char filename[1024];
     int i;
     int size[3]={0}, ret[3]={0};
     AVIOContext *f[3];
-    AVCodecContext *codec= s1->streams[0]->codec;
-
-    if (!s->is_pipe) {
-        /* loop over input */
-        if (s->loop && s->img_number > s->img_last) {
-            s->img_number = s->img_first;
-        }
-        if (s->img_number > s->img_last)
-            return AVERROR_EOF;
-        if (av_get_frame_filename(filename, sizeof(filename),
-                                  s->path, s->img_number)<0 && s->img_number > 1)
-            return AVERROR(EIO);
-        for(i=0; i<3; i++){
-            if (avio_open(&f[i], filename, AVIO_FLAG_READ) < 0) {
-                if(i==1)
-                    break;
-                av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n",filename);
-                return AVERROR(EIO);
-            }
-            size[i]= avio_size(f[i]);
 
-            if(!s->split_planes)
+    if (av_get_frame_filename(filename, sizeof(filename),
+                              s->path, number)<0 && number > 1)
+        return AVERROR(EIO);
+    for(i=0; i<3; i++){
+        if (avio_open(&f[i], filename, AVIO_FLAG_READ) < 0) {
+            if(i==1)
                 break;
-            filename[ strlen(filename) - 1 ]= 'U' + i;
+            av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n",filename);
+            return AVERROR(EIO);
         }
+        size[i]= avio_size(f[i]);
 
-        if(codec->codec_id == CODEC_ID_RAWVIDEO && !codec->width)
-            infer_size(&codec->width, &codec->height, size[0]);
-    } else {
-        f[0] = s1->pb;
-        if (url_feof(f[0]))
-            return AVERROR(EIO);
-        size[0]= 4096;
+        if(!s->split_planes)
+            break;
+        filename[ strlen(filename) - 1 ]= 'U' + i;
     }
+    *size0 = size[0];
 
-    av_new_packet(pkt, size[0] + size[1] + size[2]);
+    if (av_new_packet(pkt, size[0] + size[1] + size[2]) < 0) {
+        for(i=0; i<3; i++)
+            if(size[i])
+                avio_close(f[i]);
+        return AVERROR(ENOMEM);
+    }
     pkt->stream_index = 0;
     pkt->flags |= AV_PKT_FLAG_KEY;
 
@@ -352,8 +419,7 @@ static int read_packet(AVFormatContext *s1, AVPacket *pkt)
     for(i=0; i<3; i++){
         if(size[i]){
             ret[i]= avio_read(f[i], pkt->data + pkt->size, size[i]);
-            if (!s->is_pipe)
-                avio_close(f[i]);
+            avio_close(f[i]);
             if(ret[i]>0)
                 pkt->size += ret[i];
         }
@@ -361,12 +427,226 @@ static int read_packet(AVFormatContext *s1, AVPacket *pkt)
 
     if (ret[0] <= 0 || ret[1]<0 || ret[2]<0) {
         av_free_packet(pkt);
-        return AVERROR(EIO); /* signal EOF */
-    } else {
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
+#if HAVE_PTHREADS
+static void *prefetch_worker(void *arg)
+{
+    AVFormatContext *s1 = arg;
+    VideoData *s = s1->priv_data;
+    PrefetchSlot *slot;
+    int i, number, size, ret;
+    AVPacket pkt;
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        slot = NULL;
+        /* take the pending image closest to the head */
+        for (i = 0; i < s->nb_queued; i++) {
+            PrefetchSlot *p = &s->slots[(s->slot_head + i) % s->prefetch];
+            if (p->state == SLOT_PENDING) {
+                slot = p;
+                break;
+            }
+        }
+        if (!slot) {
+            if (s->quit)
+                break;
+            pthread_cond_wait(&s->work_cond, &s->lock);
+            continue;
+        }
+        slot->state = SLOT_BUSY;
+        number = slot->number;
+        pthread_mutex_unlock(&s->lock);
+
+        av_init_packet(&pkt);
+        size = 0;
+        ret = read_image(s1, number, &pkt, &size);
+
+        pthread_mutex_lock(&s->lock);
+        slot->pkt   = pkt;
+        slot->ret   = ret;
+        slot->size  = size;
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&s->done_cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+static int prefetch_init(AVFormatContext *s1)
+{
+    VideoData *s = s1->priv_data;
+    int i;
+
+    s->slots = av_mallocz(s->prefetch * sizeof(*s->slots));
+    if (!s->slots)
+        return AVERROR(ENOMEM);
+    s->fetch_number = s->img_number;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->work_cond, NULL);
+    pthread_cond_init(&s->done_cond, NULL);
+    for (i = 0; i < FFMIN(s->io_threads, s->prefetch); i++) {
+        if (pthread_create(&s->workers[i], NULL, prefetch_worker, s1)) {
+            av_log(s1, AV_LOG_ERROR, "pthread_create failed\n");
+            break;
+        }
+        s->nb_workers++;
+    }
+    if (!s->nb_workers) {
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->work_cond);
+        pthread_cond_destroy(&s->done_cond);
+        av_freep(&s->slots);
+        return AVERROR(ENOMEM);
+    }
+    av_log(s1, AV_LOG_VERBOSE, "prefetching %d images with %d threads\n",
+           s->prefetch, s->nb_workers);
+    return 0;
+}
+
+/* queue images for the workers until the ring is full */
+static void prefetch_schedule(VideoData *s)
+{
+    while (s->nb_queued < s->prefetch) {
+        PrefetchSlot *slot;
+        if (s->loop && s->fetch_number > s->img_last)
+            s->fetch_number = s->img_first;
+        if (s->fetch_number > s->img_last)
+            break;
+        slot = &s->slots[(s->slot_head + s->nb_queued) % s->prefetch];
+        slot->number = s->fetch_number++;
+        slot->state  = SLOT_PENDING;
+        s->nb_queued++;
+    }
+    pthread_cond_broadcast(&s->work_cond);
+}
+
+static int prefetch_read_packet(AVFormatContext *s1, AVPacket *pkt)
+{
+    VideoData *s = s1->priv_data;
+    AVCodecContext *codec = s1->streams[0]->codec;
+    PrefetchSlot *slot;
+    int i, ret, size;
+
+    pthread_mutex_lock(&s->lock);
+    prefetch_schedule(s);
+    if (!s->nb_queued) {
+        pthread_mutex_unlock(&s->lock);
+        return AVERROR_EOF;
+    }
+    for (i = 0; i < s->nb_queued; i++)
+        if (s->slots[(s->slot_head + i) % s->prefetch].state == SLOT_DONE)
+            s->queue_depth++;
+    s->nb_reads++;
+
+    slot = &s->slots[s->slot_head];
+    if (slot->state != SLOT_DONE) {
+        int64_t t = av_gettime();
+        s->nb_stalls++;
+        while (slot->state != SLOT_DONE)
+            pthread_cond_wait(&s->done_cond, &s->lock);
+        s->stall_time += av_gettime() - t;
+    }
+    *pkt = slot->pkt;
+    ret  = slot->ret;
+    size = slot->size;
+    slot->state = SLOT_EMPTY;
+    s->slot_head = (s->slot_head + 1) % s->prefetch;
+    s->nb_queued--;
+    prefetch_schedule(s);
+    pthread_mutex_unlock(&s->lock);
+
+    if (ret < 0)
+        return ret;
+    if(codec->codec_id == CODEC_ID_RAWVIDEO && !codec->width)
+        infer_size(&codec->width, &codec->height, size);
+    s->img_count++;
+    s->img_number++;
+    return 0;
+}
+#endif
+
+static int read_packet(AVFormatContext *s1, AVPacket *pkt)
+{
+    VideoData *s = s1->priv_data;
+    int size, ret;
+    AVCodecContext *codec= s1->streams[0]->codec;
+
+    if (s->is_pipe) {
+        av_new_packet(pkt, 4096);
+        pkt->stream_index = 0;
+        pkt->flags |= AV_PKT_FLAG_KEY;
+        if (url_feof(s1->pb) || (ret = avio_read(s1->pb, pkt->data, 4096)) <= 0) {
+            av_free_packet(pkt);
+            return AVERROR(EIO); /* signal EOF */
+        }
+        pkt->size = ret;
         s->img_count++;
         s->img_number++;
         return 0;
     }
+
+#if HAVE_PTHREADS
+    if (s->prefetch > 0) {
+        if (!s->slots && (ret = prefetch_init(s1)) < 0)
+            return ret;
+        return prefetch_read_packet(s1, pkt);
+    }
+#endif
+
+    /* loop over input */
+    if (s->loop && s->img_number > s->img_last) {
+        s->img_number = s->img_first;
+    }
+    if (s->img_number > s->img_last)
+        return AVERROR_EOF;
+    if ((ret = read_image(s1, s->img_number, pkt, &size)) < 0)
+        return ret;
+
+    if(codec->codec_id == CODEC_ID_RAWVIDEO && !codec->width)
+        infer_size(&codec->width, &codec->height, size);
+    s->img_count++;
+    s->img_number++;
+    return 0;
+}
+
+static int read_close(AVFormatContext *s1)
+{
+#if HAVE_PTHREADS
+    VideoData *s = s1->priv_data;
+    int i;
+
+    if (!s->slots)
+        return 0;
+    pthread_mutex_lock(&s->lock);
+    s->quit = 1;
+    /* drop the images not yet taken by a worker */
+    for (i = 0; i < s->prefetch; i++)
+        if (s->slots[i].state == SLOT_PENDING)
+            s->slots[i].state = SLOT_EMPTY;
+    pthread_cond_broadcast(&s->work_cond);
+    pthread_mutex_unlock(&s->lock);
+    for (i = 0; i < s->nb_workers; i++)
+        pthread_join(s->workers[i], NULL);
+    for (i = 0; i < s->prefetch; i++)
+        if (s->slots[i].state == SLOT_DONE)
+            av_free_packet(&s->slots[i].pkt);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->work_cond);
+    pthread_cond_destroy(&s->done_cond);
+    av_freep(&s->slots);
+
+    if (s->nb_reads)
+        av_log(s1, AV_LOG_INFO, "prefetch: %"PRId64" images, average queue "
+               "depth %.2f/%d, %"PRId64" stalls, %.3fs stalled\n",
+               s->nb_reads, (double)s->queue_depth / s->nb_reads, s->prefetch,
+               s->nb_stalls, s->stall_time / 1000000.0);
+#endif
+    return 0;
 }
 
 #if CONFIG_IMAGE2_MUXER || CONFIG_IMAGE2PIPE_MUXER
@@ -392,51 +672,74 @@ static int write_header(AVFormatContext *s)
     return 0;
 }
 
-static int write_packet(AVFormatContext *s, AVPacket *pkt)
+static int open_image_files(AVFormatContext *s, int number, AVIOContext *pb[3])
 {
     VideoData *img = s->priv_data;
-    AVIOContext *pb[3];
     char filename[1024];
-    AVCodecContext *codec= s->streams[ pkt->stream_index ]->codec;
     int i;
 
-    if (!img->is_pipe) {
-        if (av_get_frame_filename(filename, sizeof(filename),
-                                  img->path, img->img_number) < 0 && img->img_number>1) {
-            av_log(s, AV_LOG_ERROR,
-                   "Could not get frame filename number %d from pattern '%s'\n",
-                   img->img_number, img->path);
-            return AVERROR(EINVAL);
+    if (av_get_frame_filename(filename, sizeof(filename),
+                              img->path, number) < 0 && number>1) {
+        av_log(s, AV_LOG_ERROR,
+               "Could not get frame filename number %d from pattern '%s'\n",
+               number, img->path);
+        return AVERROR(EINVAL);
+    }
+    for(i=0; i<3; i++){
+        if (avio_open(&pb[i], filename, AVIO_FLAG_WRITE) < 0) {
+            av_log(s, AV_LOG_ERROR, "Could not open file : %s\n",filename);
+            while (--i >= 0)
+                avio_close(pb[i]);
+            return AVERROR(EIO);
         }
-        for(i=0; i<3; i++){
-            if (avio_open(&pb[i], filename, AVIO_FLAG_WRITE) < 0) {
-                av_log(s, AV_LOG_ERROR, "Could not open file : %s\n",filename);
-                return AVERROR(EIO);
-            }
 
-            if(!img->split_planes)
-                break;
-            filename[ strlen(filename) - 1 ]= 'U' + i;
-        }
-    } else {
-        pb[0] = s->pb;
+        if(!img->split_planes)
+            break;
+        filename[ strlen(filename) - 1 ]= 'U' + i;
     }
+    return 0;
+}
+
+#if HAVE_PTHREADS
+/* whether any of the files of an image is already there */
+static int image_files_exist(AVFormatContext *s, int number)
+{
+    VideoData *img = s->priv_data;
+    char filename[1024];
+    int i;
+
+    if (av_get_frame_filename(filename, sizeof(filename), img->path, number) < 0)
+        return 0;
+    for (i = 0; i < 3; i++) {
+        if (avio_check(filename, 0) >= 0)
+            return 1;
+        if (!img->split_planes)
+            break;
+        filename[strlen(filename) - 1] = 'U' + i;
+    }
+    return 0;
+}
+#endif
+
+static int write_image(AVFormatContext *s, AVIOContext *pb[3],
+                       const uint8_t *data, int size)
+{
+    VideoData *img = s->priv_data;
+    AVCodecContext *codec= s->streams[0]->codec;
 
     if(img->split_planes){
         int ysize = codec->width * codec->height;
-        avio_write(pb[0], pkt->data        , ysize);
-        avio_write(pb[1], pkt->data + ysize, (pkt->size - ysize)/2);
-        avio_write(pb[2], pkt->data + ysize +(pkt->size - ysize)/2, (pkt->size - ysize)/2);
+        avio_write(pb[0], data        , ysize);
+        avio_write(pb[1], data + ysize, (size - ysize)/2);
+        avio_write(pb[2], data + ysize +(size - ysize)/2, (size - ysize)/2);
         avio_flush(pb[1]);
         avio_flush(pb[2]);
-        avio_close(pb[1]);
-        avio_close(pb[2]);
     }else{
         if(av_str2id(img_tags, s->filename) == CODEC_ID_JPEG2000){
             AVStream *st = s->streams[0];
             if(st->codec->extradata_size > 8 &&
                AV_RL32(st->codec->extradata+4) == MKTAG('j','p','2','h')){
-                if(pkt->size < 8 || AV_RL32(pkt->data+4) != MKTAG('j','p','2','c'))
+                if(size < 8 || AV_RL32(data+4) != MKTAG('j','p','2','c'))
                     goto error;
                 avio_wb32(pb[0], 12);
                 avio_wtag(pb[0], "jP  ");
@@ -447,25 +750,299 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
                 avio_wb32(pb[0], 0);
                 avio_wtag(pb[0], "jp2 ");
                 avio_write(pb[0], st->codec->extradata, st->codec->extradata_size);
-            }else if(pkt->size < 8 ||
+            }else if(size < 8 ||
                      (!st->codec->extradata_size &&
-                      AV_RL32(pkt->data+4) != MKTAG('j','P',' ',' '))){ // signature
+                      AV_RL32(data+4) != MKTAG('j','P',' ',' '))){ // signature
             error:
                 av_log(s, AV_LOG_ERROR, "malformated jpeg2000 codestream\n");
                 return -1;
             }
         }
-        avio_write(pb[0], pkt->data, pkt->size);
+        avio_write(pb[0], data, size);
     }
     avio_flush(pb[0]);
+    return 0;
+}
+
+static void close_image_files(VideoData *img, AVIOContext *pb[3])
+{
+    int i;
+
+    for (i = 0; i < (img->split_planes ? 3 : 1); i++)
+        avio_close(pb[i]);
+}
+
+#if HAVE_PTHREADS
+static int write_slot(AVFormatContext *s, WriteSlot *slot)
+{
+    VideoData *img = s->priv_data;
+    int i, ret;
+
+    ret = write_image(s, slot->pb, slot->data, slot->size);
+    for (i = 0; i < (img->split_planes ? 3 : 1); i++) {
+        if (!ret && slot->pb[i]->error)
+            ret = slot->pb[i]->error;
+#if HAVE_FSYNC
+        if (!ret && img->sync) {
+            URLContext *h = slot->pb[i]->opaque;
+            int fd = ffurl_get_file_handle(h);
+            if (fd >= 0 && fsync(fd) < 0)
+                ret = AVERROR(errno);
+        }
+#endif
+    }
+    close_image_files(img, slot->pb);
+    return ret;
+}
+
+static void *write_worker(void *arg)
+{
+    AVFormatContext *s = arg;
+    VideoData *img = s->priv_data;
+    WriteSlot *slot;
+    int i, ret, ahead, exists;
+
+    pthread_mutex_lock(&img->lock);
+    for (;;) {
+        slot = NULL;
+        /* oldest slot with some work: creating the files or writing them */
+        for (i = 0; i < img->wslot_count; i++) {
+            WriteSlot *w = &img->wslots[(img->wslot_tail + i) % img->nb_wslots];
+            if (!w->busy && !w->done &&
+                ((!w->created && !w->exists && !w->ret) || w->data)) {
+                slot = w;
+                break;
+            }
+        }
+        if (!slot) {
+            if (img->quit)
+                break;
+            pthread_cond_wait(&img->work_cond, &img->lock);
+            continue;
+        }
+        slot->busy = 1;
+        ret = slot->ret;
+        /* existing files are left alone until their image is queued */
+        ahead = !slot->data;
+        pthread_mutex_unlock(&img->lock);
+
+        exists = 0;
+        if (!slot->created && !ret) {
+            if (ahead && image_files_exist(s, slot->number))
+                exists = 1;
+            else
+                ret = open_image_files(s, slot->number, slot->pb);
+        }
+
+        pthread_mutex_lock(&img->lock);
+        if (exists) {
+            slot->exists = 1;
+        } else if (!ret && !slot->created) {
+            slot->created = 1;
+            slot->fresh   = ahead;
+        }
+        /* the image may have been queued while its files were created */
+        if (slot->data) {
+            if (!ret) {
+                pthread_mutex_unlock(&img->lock);
+                /* or found existing while it was queued */
+                if (exists)
+                    ret = open_image_files(s, slot->number, slot->pb);
+                if (!ret)
+                    ret = write_slot(s, slot);
+                pthread_mutex_lock(&img->lock);
+            }
+            slot->done = 1;
+            img->nb_pending--;
+        }
+        slot->ret  = ret;
+        slot->busy = 0;
+        pthread_cond_broadcast(&img->done_cond);
+    }
+    pthread_mutex_unlock(&img->lock);
+    return NULL;
+}
+
+static int write_behind_init(AVFormatContext *s)
+{
+    VideoData *img = s->priv_data;
+    int i;
+
+    img->nb_wslots = img->write_queue + img->precreate;
+    img->wslots = av_mallocz(img->nb_wslots * sizeof(*img->wslots));
+    if (!img->wslots)
+        return AVERROR(ENOMEM);
+    img->tail_number = img->img_number;
+    pthread_mutex_init(&img->lock, NULL);
+    pthread_cond_init(&img->work_cond, NULL);
+    pthread_cond_init(&img->done_cond, NULL);
+    for (i = 0; i < img->write_threads; i++) {
+        if (pthread_create(&img->workers[i], NULL, write_worker, s)) {
+            av_log(s, AV_LOG_ERROR, "pthread_create failed\n");
+            break;
+        }
+        img->nb_workers++;
+    }
+    if (!img->nb_workers) {
+        pthread_mutex_destroy(&img->lock);
+        pthread_cond_destroy(&img->work_cond);
+        pthread_cond_destroy(&img->done_cond);
+        av_freep(&img->wslots);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+/* retire the written images in order, keeping the first error */
+static void write_behind_retire(AVFormatContext *s)
+{
+    VideoData *img = s->priv_data;
+
+    while (img->wslot_count) {
+        WriteSlot *slot = &img->wslots[img->wslot_tail];
+        if (!slot->done)
+            break;
+        av_freep(&slot->data);
+        if (slot->ret < 0 && !img->error) {
+            av_log(s, AV_LOG_ERROR, "Error writing image number %d\n", slot->number);
+            img->error = slot->ret;
+        }
+        memset(slot, 0, sizeof(*slot));
+        img->wslot_tail = (img->wslot_tail + 1) % img->nb_wslots;
+        img->wslot_count--;
+        img->tail_number++;
+    }
+}
+
+static int write_behind_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    VideoData *img = s->priv_data;
+    WriteSlot *slot;
+    int index, last;
+    uint8_t *data;
+
+    data = av_malloc(pkt->size);
+    if (!data)
+        return AVERROR(ENOMEM);
+    memcpy(data, pkt->data, pkt->size);
+
+    pthread_mutex_lock(&img->lock);
+    for (;;) {
+        write_behind_retire(s);
+        index = img->img_number - img->tail_number;
+        if (img->error || (index < img->nb_wslots &&
+                           img->nb_pending < img->write_queue))
+            break;
+        pthread_cond_wait(&img->done_cond, &img->lock);
+    }
+    if (img->error) {
+        pthread_mutex_unlock(&img->lock);
+        av_free(data);
+        return img->error;
+    }
+
+    /* add the slots of this image and of the files to create ahead */
+    last = FFMIN(index + img->precreate, img->nb_wslots - 1);
+    while (img->wslot_count <= last) {
+        slot = &img->wslots[(img->wslot_tail + img->wslot_count) % img->nb_wslots];
+        slot->number = img->tail_number + img->wslot_count++;
+    }
+    slot = &img->wslots[(img->wslot_tail + index) % img->nb_wslots];
+    slot->data = data;
+    slot->size = pkt->size;
+    img->nb_pending++;
+    pthread_cond_broadcast(&img->work_cond);
+    pthread_mutex_unlock(&img->lock);
+
+    img->img_number++;
+    return 0;
+}
+
+static int write_behind_end(AVFormatContext *s)
+{
+    VideoData *img = s->priv_data;
+    char filename[1024];
+    int i, j;
+
+    pthread_mutex_lock(&img->lock);
+    while (img->nb_pending > 0)
+        pthread_cond_wait(&img->done_cond, &img->lock);
+    write_behind_retire(s);
+    img->quit = 1;
+    pthread_cond_broadcast(&img->work_cond);
+    pthread_mutex_unlock(&img->lock);
+    for (i = 0; i < img->nb_workers; i++)
+        pthread_join(img->workers[i], NULL);
+
+    /* remove the files created ahead past the last image, the ones that
+       were there before are not touched */
+    for (i = 0; i < img->wslot_count; i++) {
+        WriteSlot *slot = &img->wslots[(img->wslot_tail + i) % img->nb_wslots];
+        if (!slot->created)
+            continue;
+        close_image_files(img, slot->pb);
+        if (!slot->fresh)
+            continue;
+        if (av_get_frame_filename(filename, sizeof(filename),
+                                  img->path, slot->number) < 0)
+            continue;
+        for (j = 0; j < (img->split_planes ? 3 : 1); j++) {
+            const char *path = filename;
+            av_strstart(filename, "file:", &path);
+            unlink(path);
+            filename[strlen(filename) - 1] = 'U' + j;
+        }
+    }
+    pthread_mutex_destroy(&img->lock);
+    pthread_cond_destroy(&img->work_cond);
+    pthread_cond_destroy(&img->done_cond);
+    av_freep(&img->wslots);
+    return img->error;
+}
+#endif
+
+static int write_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    VideoData *img = s->priv_data;
+    AVIOContext *pb[3];
+    int ret;
+
+#if HAVE_PTHREADS
+    if (!img->is_pipe && img->write_threads > 0) {
+        if (!img->wslots && (ret = write_behind_init(s)) < 0)
+            return ret;
+        return write_behind_packet(s, pkt);
+    }
+#endif
+
     if (!img->is_pipe) {
-        avio_close(pb[0]);
+        if ((ret = open_image_files(s, img->img_number, pb)) < 0)
+            return ret;
+    } else {
+        pb[0] = s->pb;
     }
 
+    ret = write_image(s, pb, pkt->data, pkt->size);
+    if (!img->is_pipe)
+        close_image_files(img, pb);
+    if (ret < 0)
+        return ret;
+
     img->img_number++;
     return 0;
 }
 
+static int write_trailer(AVFormatContext *s)
+{
+#if HAVE_PTHREADS
+    VideoData *img = s->priv_data;
+
+    if (img->wslots)
+        return write_behind_end(s);
+#endif
+    return 0;
+}
+
 #endif /* CONFIG_IMAGE2_MUXER || CONFIG_IMAGE2PIPE_MUXER */
 
 #define OFFSET(x) offsetof(VideoData, x)
@@ -475,6 +1052,8 @@ static const AVOption options[] = {
     { "video_size",   "", OFFSET(video_size),   FF_OPT_TYPE_STRING, {.str = NULL}, 0, 0, DEC },
     { "framerate",    "", OFFSET(framerate),    FF_OPT_TYPE_STRING, {.str = "25"}, 0, 0, DEC },
     { "loop",         "", OFFSET(loop),         FF_OPT_TYPE_INT,    {.dbl = 0},    0, 1, DEC },
+    { "prefetch",     "number of images read ahead", OFFSET(prefetch), FF_OPT_TYPE_INT, {.dbl = 0}, 0, 1024, DEC },
+    { "io_threads",   "number of threads reading ahead", OFFSET(io_threads), FF_OPT_TYPE_INT, {.dbl = 4}, 1, MAX_IO_THREADS, DEC },
     { NULL },
 };
 
@@ -485,6 +1064,22 @@ static const AVClass img2_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#define ENC AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption mux_options[] = {
+    { "write_threads",   "number of threads writing the images behind", OFFSET(write_threads), FF_OPT_TYPE_INT, {.dbl = 0},  0, MAX_IO_THREADS, ENC },
+    { "write_queue",     "maximum number of images waiting to be written", OFFSET(write_queue), FF_OPT_TYPE_INT, {.dbl = 16}, 1, 1024, ENC },
+    { "write_precreate", "number of files created ahead of the images", OFFSET(precreate),     FF_OPT_TYPE_INT, {.dbl = 0},  0, 1024, ENC },
+    { "write_fsync",     "sync each file to storage when writing behind", OFFSET(sync),         FF_OPT_TYPE_INT, {.dbl = 1},  0, 1, ENC },
+    { NULL },
+};
+
+static const AVClass img2mux_class = {
+    .class_name = "image2 muxer",
+    .item_name  = av_default_item_name,
+    .option     = mux_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 /* input */
 #if CONFIG_IMAGE2_DEMUXER
 AVInputFormat ff_image2_demuxer = {
@@ -494,6 +1089,7 @@ AVInputFormat ff_image2_demuxer = {
     .read_probe     = read_probe,
     .read_header    = read_header,
     .read_packet    = read_packet,
+    .read_close     = read_close,
     .flags          = AVFMT_NOFILE,
     .priv_class     = &img2_class,
 };
@@ -520,7 +1116,9 @@ AVOutputFormat ff_image2_muxer = {
     .video_codec    = CODEC_ID_MJPEG,
     .write_header   = write_header,
     .write_packet   = write_packet,
-    .flags          = AVFMT_NOTIMESTAMPS | AVFMT_NODIMENSIONS | AVFMT_NOFILE
+    .write_trailer  = write_trailer,
+    .flags          = AVFMT_NOTIMESTAMPS | AVFMT_NODIMENSIONS | AVFMT_NOFILE,
+    .priv_class     = &img2mux_class,
 };
 #endif
 #if CONFIG_IMAGE2PIPE_MUXER
@@ -235,6 +235,33 @@ AVChapter *ff_new_chapter(AVFormatContext *s, int id, AVRational time_base,
  */
 void ff_reduce_index(AVFormatContext *s, int stream_index);
 
+/**
+ * Set up the seek index cache if AVFMT_FLAG_IDXCACHE is set and load the
+ * index entries stored for the file, if any.
+ */
+int ff_index_cache_open(AVFormatContext *s);
+
+/**
+ * Add the cached index entries to the streams created since the last call.
+ */
+void ff_index_cache_apply(AVFormatContext *s);
+
+/**
+ * @return 1 if the index of all streams is complete, either loaded from
+ *         the cache or built by demuxing the whole file, 0 otherwise
+ */
+int ff_index_cache_complete(AVFormatContext *s);
+
+/**
+ * Signal a seek: the index built from then on may have holes.
+ */
+void ff_index_cache_seek(AVFormatContext *s);
+
+/**
+ * Write the index to the cache if it was completed and free the cache.
+ */
+void ff_index_cache_close(AVFormatContext *s);
+
 /*
  * Convert a relative url into an absolute url, given a base url.
  *
@@ -616,5 +616,5 @@ AVInputFormat ff_mpegps_demuxer = {
     .read_packet    = mpegps_read_packet,
     .read_seek      = NULL, //mpegps_read_seek,
     .read_timestamp = mpegps_read_dts,
-    .flags = AVFMT_SHOW_IDS|AVFMT_TS_DISCONT,
+    .flags = AVFMT_SHOW_IDS|AVFMT_TS_DISCONT|AVFMT_INDEX_CACHE,
 };
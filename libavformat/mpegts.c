@@ -123,6 +123,15 @@ struct MpegTSContext {
 
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
+
+    /** discard_pid() results, valid for pids with their discard_checked bit set */
+    uint8_t discard_checked[NB_PID_MAX / 8];
+    uint8_t discard_pids[NB_PID_MAX / 8];
+    /** AVProgram.discard values the discard_pid() results were computed with */
+    enum AVDiscard *prg_discard;
+    int nb_prg_discard;
+    /** set if at least one program is discarded */
+    int discard_active;
 };
 
 static const AVOption options[] = {
@@ -175,10 +184,16 @@ typedef struct PESContext {
 
 extern AVInputFormat ff_mpegts_demuxer;
 
+static void invalidate_discard_cache(MpegTSContext *ts)
+{
+    memset(ts->discard_checked, 0, sizeof(ts->discard_checked));
+}
+
 static void clear_program(MpegTSContext *ts, unsigned int programid)
 {
     int i;
 
+    invalidate_discard_cache(ts);
     for(i=0; i<ts->nb_prg; i++)
         if(ts->prg[i].id == programid)
             ts->prg[i].nb_pids = 0;
@@ -188,6 +203,7 @@ static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg=0;
+    invalidate_discard_cache(ts);
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -201,6 +217,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->id = programid;
     p->nb_pids = 0;
     ts->nb_prg++;
+    invalidate_discard_cache(ts);
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned int pid)
@@ -219,6 +236,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned i
     if(p->nb_pids >= MAX_PIDS_PER_PROGRAM)
         return;
     p->pids[p->nb_pids++] = pid;
+    invalidate_discard_cache(ts);
 }
 
 static void set_pcr_pid(AVFormatContext *s, unsigned int programid, unsigned int pid)
@@ -233,14 +251,14 @@ static void set_pcr_pid(AVFormatContext *s, unsigned int programid, unsigned int
 }
 
 /**
- * @brief discard_pid() decides if the pid is to be discarded according
- *                      to caller's programs selection
+ * @brief check_discard_pid() decides if the pid is to be discarded according
+ *                            to caller's programs selection
  * @param ts    : - TS context
  * @param pid   : - pid
  * @return 1 if the pid is only comprised in programs that have .discard=AVDISCARD_ALL
  *         0 otherwise
  */
-static int discard_pid(MpegTSContext *ts, unsigned int pid)
+static int check_discard_pid(MpegTSContext *ts, unsigned int pid)
 {
     int i, j, k;
     int used = 0, discarded = 0;
@@ -265,6 +283,59 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Compare the programs discard flags with the ones the cached
+ * check_discard_pid() results were computed with, and drop the cache
+ * if they changed. This is called once per batch of packets instead of
+ * walking the programs for every packet.
+ */
+static void update_discard_cache(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i, changed = 0;
+
+    if (ts->nb_prg_discard != s->nb_programs) {
+        void *tmp = av_realloc(ts->prg_discard, s->nb_programs * sizeof(*ts->prg_discard));
+        if (!tmp && s->nb_programs) {
+            /* no cache, check every packet */
+            ts->nb_prg_discard = 0;
+            ts->discard_active = 1;
+            invalidate_discard_cache(ts);
+            return;
+        }
+        ts->prg_discard = tmp;
+        ts->nb_prg_discard = s->nb_programs;
+        changed = 1;
+    }
+    ts->discard_active = 0;
+    for (i = 0; i < s->nb_programs; i++) {
+        if (changed || ts->prg_discard[i] != s->programs[i]->discard) {
+            ts->prg_discard[i] = s->programs[i]->discard;
+            changed = 1;
+        }
+        if (ts->prg_discard[i] == AVDISCARD_ALL)
+            ts->discard_active = 1;
+    }
+    if (changed)
+        invalidate_discard_cache(ts);
+}
+
+static int discard_pid(MpegTSContext *ts, unsigned int pid)
+{
+    int mask = 1 << (pid & 7);
+
+    if (!ts->discard_active)
+        return 0;
+    if (!(ts->discard_checked[pid >> 3] & mask)) {
+        if (check_discard_pid(ts, pid))
+            ts->discard_pids[pid >> 3] |= mask;
+        else
+            ts->discard_pids[pid >> 3] &= ~mask;
+        ts->discard_checked[pid >> 3] |= mask;
+    }
+    return !!(ts->discard_pids[pid >> 3] & mask);
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -1274,10 +1345,11 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if(pid && discard_pid(ts, pid))
+    tss = ts->pids[pid];
+    /* sections are always parsed so the program pid lists stay current */
+    if (pid && (!tss || tss->type == MPEGTS_PES) && discard_pid(ts, pid))
         return 0;
     is_start = packet[1] & 0x40;
-    tss = ts->pids[pid];
     if (ts->auto_guess && tss == NULL && is_start) {
         add_pes_stream(ts, pid, -1);
         tss = ts->pids[pid];
@@ -1367,28 +1439,33 @@ static int mpegts_resync(AVFormatContext *s)
     return -1;
 }
 
-/* return -1 if error or EOF. Return 0 if OK. */
-static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size)
+/**
+ * Read one TS packet, including FEC or timestamp bytes if any.
+ * The packet is returned in place in the AVIOContext buffer when it is
+ * contiguous there, and only copied to buf otherwise.
+ * @param buf  buffer of at least TS_MAX_PACKET_SIZE bytes
+ * @param data set to the start of the packet, valid until the next read
+ * @return -1 if error or EOF. Return 0 if OK.
+ */
+static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size,
+                       const uint8_t **data)
 {
     AVIOContext *pb = s->pb;
-    int skip, len;
+    int len;
 
     for(;;) {
-        len = avio_read(pb, buf, TS_PACKET_SIZE);
-        if (len != TS_PACKET_SIZE)
+        len = ffio_read_indirect(pb, buf, raw_packet_size, data);
+        if (len != raw_packet_size)
             return len < 0 ? len : AVERROR_EOF;
         /* check paquet sync byte */
-        if (buf[0] != 0x47) {
+        if ((*data)[0] != 0x47) {
             /* find a new packet start */
-            avio_seek(pb, -TS_PACKET_SIZE, SEEK_CUR);
+            avio_seek(pb, -raw_packet_size, SEEK_CUR);
             if (mpegts_resync(s) < 0)
                 return AVERROR(EAGAIN);
             else
                 continue;
         } else {
-            skip = raw_packet_size - TS_PACKET_SIZE;
-            if (skip > 0)
-                avio_skip(pb, skip);
             break;
         }
     }
@@ -1398,9 +1475,11 @@ static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size)
 static int handle_packets(MpegTSContext *ts, int nb_packets)
 {
     AVFormatContext *s = ts->stream;
-    uint8_t packet[TS_PACKET_SIZE];
+    uint8_t packet[TS_MAX_PACKET_SIZE];
+    const uint8_t *data;
     int packet_num, ret;
 
+    update_discard_cache(ts);
     ts->stop_parse = 0;
     packet_num = 0;
     for(;;) {
@@ -1409,10 +1488,10 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         packet_num++;
         if (nb_packets != 0 && packet_num >= nb_packets)
             break;
-        ret = read_packet(s, packet, ts->raw_packet_size);
+        ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             return ret;
-        ret = handle_packet(ts, packet);
+        ret = handle_packet(ts, data);
         if (ret != 0)
             return ret;
     }
@@ -1535,7 +1614,8 @@ static int mpegts_read_header(AVFormatContext *s,
         int pcr_pid, pid, nb_packets, nb_pcrs, ret, pcr_l;
         int64_t pcrs[2], pcr_h;
         int packet_count[2];
-        uint8_t packet[TS_PACKET_SIZE];
+        uint8_t packet[TS_MAX_PACKET_SIZE];
+        const uint8_t *data;
 
         /* only read packets */
 
@@ -1551,12 +1631,12 @@ static int mpegts_read_header(AVFormatContext *s,
         nb_pcrs = 0;
         nb_packets = 0;
         for(;;) {
-            ret = read_packet(s, packet, ts->raw_packet_size);
+            ret = read_packet(s, packet, ts->raw_packet_size, &data);
             if (ret < 0)
                 return -1;
-            pid = AV_RB16(packet + 1) & 0x1fff;
+            pid = AV_RB16(data + 1) & 0x1fff;
             if ((pcr_pid == -1 || pcr_pid == pid) &&
-                parse_pcr(&pcr_h, &pcr_l, packet) == 0) {
+                parse_pcr(&pcr_h, &pcr_l, data) == 0) {
                 pcr_pid = pid;
                 packet_count[nb_pcrs] = nb_packets;
                 pcrs[nb_pcrs] = pcr_h * 300 + pcr_l;
@@ -1594,15 +1674,18 @@ static int mpegts_raw_read_packet(AVFormatContext *s,
     int64_t pcr_h, next_pcr_h, pos;
     int pcr_l, next_pcr_l;
     uint8_t pcr_buf[12];
+    uint8_t packet[TS_MAX_PACKET_SIZE];
+    const uint8_t *data;
 
     if (av_new_packet(pkt, TS_PACKET_SIZE) < 0)
         return AVERROR(ENOMEM);
     pkt->pos= avio_tell(s->pb);
-    ret = read_packet(s, pkt->data, ts->raw_packet_size);
+    ret = read_packet(s, packet, ts->raw_packet_size, &data);
     if (ret < 0) {
         av_free_packet(pkt);
         return ret;
     }
+    memcpy(pkt->data, data, TS_PACKET_SIZE);
     if (ts->mpeg2ts_compute_pcr) {
         /* compute exact PCR for each packet */
         if (parse_pcr(&pcr_h, &pcr_l, pkt->data) == 0) {
@@ -1679,6 +1762,7 @@ static int mpegts_read_close(AVFormatContext *s)
 
     for(i=0;i<NB_PID_MAX;i++)
         if (ts->pids[i]) mpegts_close_filter(ts, ts->pids[i]);
+    av_freep(&ts->prg_discard);
 
     return 0;
 }
@@ -1860,6 +1944,7 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
     len1 = len;
     ts->pkt = pkt;
     ts->stop_parse = 0;
+    update_discard_cache(ts);
     for(;;) {
         if (ts->stop_parse>0)
             break;
@@ -1883,6 +1968,7 @@ void ff_mpegts_parse_close(MpegTSContext *ts)
 
     for(i=0;i<NB_PID_MAX;i++)
         av_free(ts->pids[i]);
+    av_free(ts->prg_discard);
     av_free(ts);
 }
 
@@ -1896,7 +1982,7 @@ AVInputFormat ff_mpegts_demuxer = {
     .read_close     = mpegts_read_close,
     .read_seek      = read_seek,
     .read_timestamp = mpegts_get_pcr,
-    .flags = AVFMT_SHOW_IDS|AVFMT_TS_DISCONT,
+    .flags = AVFMT_SHOW_IDS|AVFMT_TS_DISCONT|AVFMT_INDEX_CACHE,
 #ifdef USE_SYNCPOINT_SEARCH
     .read_seek2 = read_seek2,
 #endif
@@ -52,8 +52,13 @@ typedef struct MpegTSService {
     int pcr_pid;
     int pcr_packet_count;
     int pcr_packet_period;
+    AVStream *pcr_st;
+    int64_t pcr_next; ///< CBR: time of the next PCR, in 27MHz units
 } MpegTSService;
 
+/* number of TS packets gathered before they are written out */
+#define TS_OUT_PACKETS 64
+
 typedef struct MpegTSWrite {
     const AVClass *av_class;
     MpegTSSection pat; /* MPEG2 pat table */
@@ -75,6 +80,20 @@ typedef struct MpegTSWrite {
 
     int pmt_start_pid;
     int start_pid;
+
+    int pcr_period;  ///< in ms, CBR only
+    int pat_period;  ///< in ms, CBR only
+    int sdt_period;  ///< in ms, CBR only
+    int64_t pcr_interval; ///< CBR: pcr_period in 27MHz units
+    int64_t pat_interval; ///< CBR: pat_period in 27MHz units
+    int64_t sdt_interval; ///< CBR: sdt_period in 27MHz units
+    int64_t pat_next; ///< CBR: time of the next PAT/PMT, in 27MHz units
+    int64_t sdt_next; ///< CBR: time of the next SDT, in 27MHz units
+    int64_t nb_packets; ///< number of TS packets written, the CBR clock
+    int nb_queued;    ///< CBR: number of PES packets waiting to be sent
+
+    int out_count;
+    uint8_t out[TS_OUT_PACKETS * TS_PACKET_SIZE];
 } MpegTSWrite;
 
 static const AVOption options[] = {
@@ -88,6 +107,12 @@ static const AVOption options[] = {
       offsetof(MpegTSWrite, pmt_start_pid), FF_OPT_TYPE_INT, {.dbl = 0x1000 }, 0x1000, 0x1f00, AV_OPT_FLAG_ENCODING_PARAM},
     { "mpegts_start_pid", "Set the first pid.",
       offsetof(MpegTSWrite, start_pid), FF_OPT_TYPE_INT, {.dbl = 0x0100 }, 0x0100, 0x0f00, AV_OPT_FLAG_ENCODING_PARAM},
+    { "mpegts_pcr_period", "Set the PCR period in ms when muxing at a constant rate.",
+      offsetof(MpegTSWrite, pcr_period), FF_OPT_TYPE_INT, {.dbl = 20 }, 1, 100, AV_OPT_FLAG_ENCODING_PARAM},
+    { "mpegts_pat_period", "Set the PAT and PMT period in ms when muxing at a constant rate.",
+      offsetof(MpegTSWrite, pat_period), FF_OPT_TYPE_INT, {.dbl = 100 }, 10, 1000, AV_OPT_FLAG_ENCODING_PARAM},
+    { "mpegts_sdt_period", "Set the SDT period in ms when muxing at a constant rate.",
+      offsetof(MpegTSWrite, sdt_period), FF_OPT_TYPE_INT, {.dbl = 500 }, 25, 2000, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -191,10 +216,21 @@ static int mpegts_write_section1(MpegTSSection *s, int tid, int id,
 #define DEFAULT_PES_HEADER_FREQ 16
 #define DEFAULT_PES_PAYLOAD_SIZE ((DEFAULT_PES_HEADER_FREQ - 1) * 184 + 170)
 
-/* we retransmit the SI info at this rate */
-#define SDT_RETRANS_TIME 500
-#define PAT_RETRANS_TIME 100
-#define PCR_RETRANS_TIME 20
+/* size of the transport buffer of the T-STD model */
+#define TB_SIZE 512
+
+/**
+ * PES packet cut into TS packets, waiting for its turn in the CBR
+ * multiplex.
+ */
+typedef struct MpegTSPes {
+    struct MpegTSPes *next;
+    int64_t dts;     ///< in 90kHz units, AV_NOPTS_VALUE if the PES can be sent anytime
+    int pcr;         ///< the first packet has a PCR field to fill when it is sent
+    int nb_packets;
+    int sent;
+    uint8_t *data;
+} MpegTSPes;
 
 typedef struct MpegTSWriteStream {
     struct MpegTSService *service;
@@ -207,8 +243,39 @@ typedef struct MpegTSWriteStream {
     int payload_flags;
     uint8_t payload[DEFAULT_PES_PAYLOAD_SIZE];
     ADTSContext *adts;
+
+    /* CBR */
+    MpegTSPes *pes_first, *pes_last;
+    int sent_cc;     ///< continuity counter of the last packet sent
+    int tb_rate;     ///< transport buffer leak rate in bit/s, 0 if unconstrained
+    double tb_level; ///< transport buffer fullness in bytes
+    int64_t tb_time; ///< time of tb_level, in 27MHz units
 } MpegTSWriteStream;
 
+/**
+ * Return room for the next TS packet of the output, the packets are
+ * written out TS_OUT_PACKETS at a time.
+ */
+static uint8_t *get_out_packet(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    if (ts->out_count == TS_OUT_PACKETS) {
+        avio_write(s->pb, ts->out, TS_OUT_PACKETS * TS_PACKET_SIZE);
+        ts->out_count = 0;
+    }
+    ts->nb_packets++;
+    return ts->out + TS_PACKET_SIZE * ts->out_count++;
+}
+
+static void flush_out_packets(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    avio_write(s->pb, ts->out, ts->out_count * TS_PACKET_SIZE);
+    ts->out_count = 0;
+}
+
 static void mpegts_write_pat(AVFormatContext *s)
 {
     MpegTSWrite *ts = s->priv_data;
@@ -228,7 +295,6 @@ static void mpegts_write_pat(AVFormatContext *s)
 
 static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service)
 {
-    //    MpegTSWrite *ts = s->priv_data;
     uint8_t data[1012], *q, *desc_length_ptr, *program_info_length_ptr;
     int val, stream_type, i;
 
@@ -248,6 +314,8 @@ static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service)
         AVStream *st = s->streams[i];
         MpegTSWriteStream *ts_st = st->priv_data;
         AVDictionaryEntry *lang = av_dict_get(st->metadata, "language", NULL,0);
+        if (ts_st->service != service)
+            continue;
         switch(st->codec->codec_id) {
         case CODEC_ID_MPEG1VIDEO:
         case CODEC_ID_MPEG2VIDEO:
@@ -320,6 +388,14 @@ static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service)
                 if (*len_ptr == 0)
                     q -= 2; /* no language codes were written */
             }
+            if (st->codec->codec_id == CODEC_ID_S302M) {
+                *q++ = 0x05; /* registration descriptor */
+                *q++ = 4;
+                *q++ = 'B';
+                *q++ = 'S';
+                *q++ = 'S';
+                *q++ = 'D';
+            }
             break;
         case AVMEDIA_TYPE_SUBTITLE:
             {
@@ -437,34 +513,65 @@ static MpegTSService *mpegts_add_service(MpegTSWrite *ts,
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
 {
     AVFormatContext *ctx = s->opaque;
-    avio_write(ctx->pb, packet, TS_PACKET_SIZE);
+    memcpy(get_out_packet(ctx), packet, TS_PACKET_SIZE);
 }
 
-static int mpegts_write_header(AVFormatContext *s)
+static MpegTSService *mpegts_add_service_metadata(AVFormatContext *s, int sid,
+                                                  AVDictionary *metadata)
 {
     MpegTSWrite *ts = s->priv_data;
-    MpegTSWriteStream *ts_st;
     MpegTSService *service;
-    AVStream *st, *pcr_st = NULL;
     AVDictionaryEntry *title, *provider;
-    int i, j;
     const char *service_name;
     const char *provider_name;
-    int *pids;
 
-    ts->tsid = ts->transport_stream_id;
-    ts->onid = ts->original_network_id;
-    /* allocate a single DVB service */
-    title = av_dict_get(s->metadata, "service_name", NULL, 0);
+    title = av_dict_get(metadata, "service_name", NULL, 0);
     if (!title)
-        title = av_dict_get(s->metadata, "title", NULL, 0);
+        title = av_dict_get(metadata, "title", NULL, 0);
     service_name = title ? title->value : DEFAULT_SERVICE_NAME;
-    provider = av_dict_get(s->metadata, "service_provider", NULL, 0);
+    provider = av_dict_get(metadata, "service_provider", NULL, 0);
     provider_name = provider ? provider->value : DEFAULT_PROVIDER_NAME;
-    service = mpegts_add_service(ts, ts->service_id, provider_name, service_name);
+    service = mpegts_add_service(ts, sid, provider_name, service_name);
+    if (!service)
+        return NULL;
     service->pmt.write_packet = section_write_packet;
     service->pmt.opaque = s;
     service->pmt.cc = 15;
+    return service;
+}
+
+/* streams of a program go to its service, the others to the first service */
+static MpegTSService *mpegts_stream_service(AVFormatContext *s, int index)
+{
+    MpegTSWrite *ts = s->priv_data;
+    int i, j;
+
+    for (i = 0; i < s->nb_programs; i++)
+        for (j = 0; j < s->programs[i]->nb_stream_indexes; j++)
+            if (s->programs[i]->stream_index[j] == index)
+                return ts->services[i];
+    return ts->services[0];
+}
+
+static int mpegts_write_header(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    MpegTSWriteStream *ts_st;
+    MpegTSService *service;
+    AVStream *st, *pcr_st;
+    int i, j;
+    int *pids;
+
+    ts->tsid = ts->transport_stream_id;
+    ts->onid = ts->original_network_id;
+    /* allocate a DVB service per program, or a single one */
+    if (s->nb_programs) {
+        for (i = 0; i < s->nb_programs; i++)
+            if (!mpegts_add_service_metadata(s, s->programs[i]->id,
+                                             s->programs[i]->metadata))
+                return AVERROR(ENOMEM);
+    } else if (!mpegts_add_service_metadata(s, ts->service_id, s->metadata))
+        return AVERROR(ENOMEM);
 
     ts->pat.pid = PAT_PID;
     ts->pat.cc = 15; // Initialize at 15 so that it wraps and be equal to 0 for the first packet we write
@@ -488,7 +595,7 @@ static int mpegts_write_header(AVFormatContext *s)
         if (!ts_st)
             goto fail;
         st->priv_data = ts_st;
-        ts_st->service = service;
+        ts_st->service = service = mpegts_stream_service(s, i);
         /* MPEG pid values < 16 are reserved. Applications which set st->id in
          * this range are assigned a calculated pid. */
         if (st->id < 16) {
@@ -499,10 +606,11 @@ static int mpegts_write_header(AVFormatContext *s)
             av_log(s, AV_LOG_ERROR, "Invalid stream id %d, must be less than 8191\n", st->id);
             goto fail;
         }
-        if (ts_st->pid == service->pmt.pid) {
-            av_log(s, AV_LOG_ERROR, "Duplicate stream id %d\n", ts_st->pid);
-            goto fail;
-        }
+        for (j = 0; j < ts->nb_services; j++)
+            if (ts_st->pid == ts->services[j]->pmt.pid) {
+                av_log(s, AV_LOG_ERROR, "Duplicate stream id %d\n", ts_st->pid);
+                goto fail;
+            }
         for (j = 0; j < i; j++)
             if (pids[j] == ts_st->pid) {
                 av_log(s, AV_LOG_ERROR, "Duplicate stream id %d\n", ts_st->pid);
@@ -513,12 +621,20 @@ static int mpegts_write_header(AVFormatContext *s)
         ts_st->payload_dts = AV_NOPTS_VALUE;
         ts_st->first_pts_check = 1;
         ts_st->cc = 15;
+        ts_st->sent_cc = 15;
         /* update PCR pid by using the first video stream */
         if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO &&
             service->pcr_pid == 0x1fff) {
             service->pcr_pid = ts_st->pid;
-            pcr_st = st;
+            service->pcr_st = st;
         }
+        /* transport buffer leak rates of the T-STD, 1.2 Rmax for video
+           with at least the main level rate, 2 Mbit/s for audio */
+        if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            ts_st->tb_rate = FFMIN(FFMAX(st->codec->rc_max_rate, 15000000) * 6LL / 5,
+                                   INT_MAX);
+        else if (st->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+            ts_st->tb_rate = 2000000;
         if (st->codec->codec_id == CODEC_ID_AAC &&
             st->codec->extradata_size > 0) {
             ts_st->adts = av_mallocz(sizeof(*ts_st->adts));
@@ -532,58 +648,67 @@ static int mpegts_write_header(AVFormatContext *s)
 
     av_free(pids);
 
-    /* if no video stream, use the first stream as PCR */
-    if (service->pcr_pid == 0x1fff && s->nb_streams > 0) {
-        pcr_st = s->streams[0];
-        ts_st = pcr_st->priv_data;
-        service->pcr_pid = ts_st->pid;
+    /* if no video stream, use the first stream of the service as PCR */
+    for (i = 0; i < s->nb_streams; i++) {
+        ts_st = s->streams[i]->priv_data;
+        if (ts_st->service->pcr_pid == 0x1fff) {
+            ts_st->service->pcr_pid = ts_st->pid;
+            ts_st->service->pcr_st = s->streams[i];
+        }
     }
 
     ts->mux_rate = s->mux_rate ? s->mux_rate : 1;
 
     if (ts->mux_rate > 1) {
-        service->pcr_packet_period = (ts->mux_rate * PCR_RETRANS_TIME) /
-            (TS_PACKET_SIZE * 8 * 1000);
-        ts->sdt_packet_period      = (ts->mux_rate * SDT_RETRANS_TIME) /
-            (TS_PACKET_SIZE * 8 * 1000);
-        ts->pat_packet_period      = (ts->mux_rate * PAT_RETRANS_TIME) /
-            (TS_PACKET_SIZE * 8 * 1000);
-
         ts->first_pcr = av_rescale(s->max_delay, PCR_TIME_BASE, AV_TIME_BASE);
+        ts->pcr_interval = ts->pcr_period * (PCR_TIME_BASE / 1000);
+        ts->pat_interval = ts->pat_period * (PCR_TIME_BASE / 1000);
+        ts->sdt_interval = ts->sdt_period * (PCR_TIME_BASE / 1000);
+        // output the tables and a PCR as soon as possible
+        ts->pat_next = ts->sdt_next = 0;
+        for (i = 0; i < ts->nb_services; i++)
+            ts->services[i]->pcr_next = 0;
+
+        av_log(s, AV_LOG_INFO, "muxrate %d, %d services, pcr every %d ms, "
+               "sdt every %d ms, pat/pmt every %d ms\n", ts->mux_rate,
+               ts->nb_services, ts->pcr_period, ts->sdt_period, ts->pat_period);
     } else {
         /* Arbitrary values, PAT/PMT could be written on key frames */
         ts->sdt_packet_period = 200;
         ts->pat_packet_period = 40;
-        if (pcr_st->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
-            if (!pcr_st->codec->frame_size) {
-                av_log(s, AV_LOG_WARNING, "frame size not set\n");
-                service->pcr_packet_period =
-                    pcr_st->codec->sample_rate/(10*512);
+        for (i = 0; i < ts->nb_services; i++) {
+            service = ts->services[i];
+            pcr_st = service->pcr_st;
+            if (!pcr_st)
+                continue;
+            if (pcr_st->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
+                if (!pcr_st->codec->frame_size) {
+                    av_log(s, AV_LOG_WARNING, "frame size not set\n");
+                    service->pcr_packet_period =
+                        pcr_st->codec->sample_rate/(10*512);
+                } else {
+                    service->pcr_packet_period =
+                        pcr_st->codec->sample_rate/(10*pcr_st->codec->frame_size);
+                }
             } else {
+                // max delta PCR 0.1s
                 service->pcr_packet_period =
-                    pcr_st->codec->sample_rate/(10*pcr_st->codec->frame_size);
+                    pcr_st->codec->time_base.den/(10*pcr_st->codec->time_base.num);
             }
-        } else {
-            // max delta PCR 0.1s
-            service->pcr_packet_period =
-                pcr_st->codec->time_base.den/(10*pcr_st->codec->time_base.num);
+            // output a PCR as soon as possible
+            service->pcr_packet_count = service->pcr_packet_period;
         }
-    }
+        ts->pat_packet_count = ts->pat_packet_period-1;
+        ts->sdt_packet_count = ts->sdt_packet_period-1;
 
-    // output a PCR as soon as possible
-    service->pcr_packet_count = service->pcr_packet_period;
-    ts->pat_packet_count = ts->pat_packet_period-1;
-    ts->sdt_packet_count = ts->sdt_packet_period-1;
-
-    if (ts->mux_rate == 1)
         av_log(s, AV_LOG_INFO, "muxrate VBR, ");
-    else
-        av_log(s, AV_LOG_INFO, "muxrate %d, ", ts->mux_rate);
-    av_log(s, AV_LOG_INFO, "pcr every %d pkts, "
-           "sdt every %d, pat/pmt every %d pkts\n",
-           service->pcr_packet_period,
-           ts->sdt_packet_period, ts->pat_packet_period);
+        av_log(s, AV_LOG_INFO, "pcr every %d pkts, "
+               "sdt every %d, pat/pmt every %d pkts\n",
+               ts->services[0]->pcr_packet_period,
+               ts->sdt_packet_period, ts->pat_packet_period);
+    }
 
+    flush_out_packets(s);
     avio_flush(s->pb);
 
     return 0;
@@ -616,10 +741,11 @@ static void retransmit_si_info(AVFormatContext *s)
     }
 }
 
-static int64_t get_pcr(const MpegTSWrite *ts, AVIOContext *pb)
+/* PCR of the next packet, it references the last byte of the PCR base */
+static int64_t get_pcr(const MpegTSWrite *ts)
 {
-    return av_rescale(avio_tell(pb) + 11, 8 * PCR_TIME_BASE, ts->mux_rate) +
-           ts->first_pcr;
+    return av_rescale(ts->nb_packets * TS_PACKET_SIZE + 11, 8 * PCR_TIME_BASE,
+                      ts->mux_rate) + ts->first_pcr;
 }
 
 static int write_pcr_bits(uint8_t *buf, int64_t pcr)
@@ -639,41 +765,145 @@ static int write_pcr_bits(uint8_t *buf, int64_t pcr)
 /* Write a single null transport stream packet */
 static void mpegts_insert_null_packet(AVFormatContext *s)
 {
-    uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *q = get_out_packet(s);
 
-    q = buf;
     *q++ = 0x47;
     *q++ = 0x00 | 0x1f;
     *q++ = 0xff;
     *q++ = 0x10;
-    memset(q, 0x0FF, TS_PACKET_SIZE - (q - buf));
-    avio_write(s->pb, buf, TS_PACKET_SIZE);
+    memset(q, 0x0FF, TS_PACKET_SIZE - 4);
 }
 
 /* Write a single transport stream packet with a PCR and no payload */
-static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
+static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st, int64_t pcr)
 {
-    MpegTSWrite *ts = s->priv_data;
     MpegTSWriteStream *ts_st = st->priv_data;
-    uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *buf = get_out_packet(s);
+    uint8_t *q = buf;
 
-    q = buf;
     *q++ = 0x47;
     *q++ = ts_st->pid >> 8;
     *q++ = ts_st->pid;
-    *q++ = 0x20 | ts_st->cc;   /* Adaptation only */
+    *q++ = 0x20 | ts_st->sent_cc; /* Adaptation only */
     /* Continuity Count field does not increment (see 13818-1 section 2.4.3.3) */
     *q++ = TS_PACKET_SIZE - 5; /* Adaptation Field Length */
     *q++ = 0x10;               /* Adaptation flags: PCR present */
 
     /* PCR coded into 6 bytes */
-    q += write_pcr_bits(q, get_pcr(ts, s->pb));
+    q += write_pcr_bits(q, pcr);
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
-    avio_write(s->pb, buf, TS_PACKET_SIZE);
+}
+
+/* Drain the transport buffer of the stream up to time pcr */
+static void update_tb(MpegTSWriteStream *ts_st, int64_t pcr)
+{
+    ts_st->tb_level -= (pcr - ts_st->tb_time) * (double)ts_st->tb_rate / (8 * PCR_TIME_BASE);
+    if (ts_st->tb_level < 0)
+        ts_st->tb_level = 0;
+    ts_st->tb_time = pcr;
+}
+
+/**
+ * Fill the next packet slot of a constant rate multiplex, in order of
+ * priority with the tables and PCRs that are due, the next packet of
+ * the PES with the earliest dts among those that may enter the T-STD,
+ * or a null packet.
+ */
+static void mpegts_write_cbr_slot(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    MpegTSWriteStream *ts_st, *best = NULL;
+    MpegTSPes *pes;
+    int64_t pcr = get_pcr(ts);
+    int64_t delay = av_rescale(s->max_delay, PCR_TIME_BASE, AV_TIME_BASE);
+    int64_t best_dts = INT64_MAX;
+    uint8_t *q;
+    int i;
+
+    if (pcr >= ts->sdt_next) {
+        ts->sdt_next = pcr + ts->sdt_interval;
+        mpegts_write_sdt(s);
+        return;
+    }
+    if (pcr >= ts->pat_next) {
+        ts->pat_next = pcr + ts->pat_interval;
+        mpegts_write_pat(s);
+        for (i = 0; i < ts->nb_services; i++)
+            mpegts_write_pmt(s, ts->services[i]);
+        return;
+    }
+    for (i = 0; i < ts->nb_services; i++) {
+        MpegTSService *service = ts->services[i];
+        if (service->pcr_st && pcr >= service->pcr_next) {
+            ts_st = service->pcr_st->priv_data;
+            service->pcr_next = pcr + ts->pcr_interval;
+            mpegts_insert_pcr_only(s, service->pcr_st, pcr);
+            update_tb(ts_st, pcr);
+            ts_st->tb_level += TS_PACKET_SIZE;
+            return;
+        }
+    }
+
+    for (i = 0; i < s->nb_streams; i++) {
+        int64_t dts;
+        ts_st = s->streams[i]->priv_data;
+        pes = ts_st->pes_first;
+        if (!pes)
+            continue;
+        dts = pes->dts == AV_NOPTS_VALUE ? INT64_MIN : pes->dts * 300;
+        /* not before the data may enter the decoder buffer */
+        if (dts != INT64_MIN && dts - delay > pcr)
+            continue;
+        if (ts_st->tb_rate) {
+            update_tb(ts_st, pcr);
+            if (ts_st->tb_level + TS_PACKET_SIZE > TB_SIZE)
+                continue;
+        }
+        if (dts < best_dts || !best) {
+            best_dts = dts;
+            best = ts_st;
+        }
+    }
+    if (!best) {
+        mpegts_insert_null_packet(s);
+        return;
+    }
+
+    pes = best->pes_first;
+    q = get_out_packet(s);
+    memcpy(q, pes->data + pes->sent * TS_PACKET_SIZE, TS_PACKET_SIZE);
+    if (!pes->sent) {
+        if (pes->pcr) {
+            write_pcr_bits(q + 6, pcr);
+            best->service->pcr_next = pcr + ts->pcr_interval;
+        }
+        if (pes->dts != AV_NOPTS_VALUE && pes->dts < pcr / 300)
+            av_log(s, AV_LOG_WARNING, "dts < pcr, TS is invalid\n");
+    }
+    best->sent_cc = q[3] & 0xf;
+    best->tb_level += TS_PACKET_SIZE;
+    if (++pes->sent == pes->nb_packets) {
+        best->pes_first = pes->next;
+        if (!best->pes_first)
+            best->pes_last = NULL;
+        ts->nb_queued--;
+        av_free(pes->data);
+        av_free(pes);
+    }
+}
+
+/**
+ * Fill the packet slots of a constant rate multiplex until the PCR
+ * reaches end, or until all queued PES packets are sent if flush is set.
+ */
+static void mpegts_write_cbr(AVFormatContext *s, int64_t end, int flush)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    while (flush ? ts->nb_queued > 0 : get_pcr(ts) < end)
+        mpegts_write_cbr_slot(s);
 }
 
 static void write_pts(uint8_t *q, int fourbits, int64_t pts)
@@ -734,36 +964,45 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
 {
     MpegTSWriteStream *ts_st = st->priv_data;
     MpegTSWrite *ts = s->priv_data;
-    uint8_t buf[TS_PACKET_SIZE];
+    MpegTSPes *pes = NULL;
+    uint8_t *buf;
     uint8_t *q;
     int val, is_start, len, header_len, write_pcr, private_code, flags;
     int afc_len, stuffing_len;
     int64_t pcr = -1; /* avoid warning */
     int64_t delay = av_rescale(s->max_delay, 90000, AV_TIME_BASE);
 
+    if (ts->mux_rate > 1) {
+        /* the packets are queued and sent by the CBR scheduler */
+        pes = av_mallocz(sizeof(*pes));
+        if (!pes)
+            return;
+        pes->data = av_malloc((2 + payload_size / 184) * TS_PACKET_SIZE);
+        if (!pes->data) {
+            av_free(pes);
+            return;
+        }
+        pes->dts = dts != AV_NOPTS_VALUE ? dts : pts;
+    }
+
     is_start = 1;
     while (payload_size > 0) {
-        retransmit_si_info(s);
-
         write_pcr = 0;
-        if (ts_st->pid == ts_st->service->pcr_pid) {
-            if (ts->mux_rate > 1 || is_start) // VBR pcr period is based on frames
-                ts_st->service->pcr_packet_count++;
-            if (ts_st->service->pcr_packet_count >=
-                ts_st->service->pcr_packet_period) {
-                ts_st->service->pcr_packet_count = 0;
-                write_pcr = 1;
+        if (pes) {
+            buf = pes->data + pes->nb_packets * TS_PACKET_SIZE;
+        } else {
+            retransmit_si_info(s);
+
+            if (ts_st->pid == ts_st->service->pcr_pid) {
+                if (is_start) // VBR pcr period is based on frames
+                    ts_st->service->pcr_packet_count++;
+                if (ts_st->service->pcr_packet_count >=
+                    ts_st->service->pcr_packet_period) {
+                    ts_st->service->pcr_packet_count = 0;
+                    write_pcr = 1;
+                }
             }
-        }
-
-        if (ts->mux_rate > 1 && dts != AV_NOPTS_VALUE &&
-            (dts - get_pcr(ts, s->pb)/300) > delay) {
-            /* pcr insert gets priority over null packet insert */
-            if (write_pcr)
-                mpegts_insert_pcr_only(s, st);
-            else
-                mpegts_insert_null_packet(s);
-            continue; /* recalculate write_pcr and possibly retransmit si_info */
+            buf = get_out_packet(s);
         }
 
         /* prepare packet header */
@@ -786,13 +1025,15 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         if (write_pcr) {
             set_af_flag(buf, 0x10);
             q = get_ts_payload_start(buf);
-            // add 11, pcr references the last byte of program clock reference base
-            if (ts->mux_rate > 1)
-                pcr = get_pcr(ts, s->pb);
-            else
+            if (pes) {
+                // filled in when the packet is sent
+                pes->pcr = 1;
+                pcr = 0;
+            } else {
                 pcr = (dts - delay)*300;
-            if (dts != AV_NOPTS_VALUE && dts < pcr / 300)
-                av_log(s, AV_LOG_WARNING, "dts < pcr, TS is invalid\n");
+                if (dts != AV_NOPTS_VALUE && dts < pcr / 300)
+                    av_log(s, AV_LOG_WARNING, "dts < pcr, TS is invalid\n");
+            }
             extend_af(buf, write_pcr_bits(q, pcr));
             q = get_ts_payload_start(buf);
         }
@@ -850,8 +1091,10 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             *q++ = len >> 8;
             *q++ = len;
             val = 0x80;
-            /* data alignment indicator is required for subtitle data */
-            if (st->codec->codec_type == AVMEDIA_TYPE_SUBTITLE)
+            /* data alignment indicator is required for subtitle data
+               and AES3 frames */
+            if (st->codec->codec_type == AVMEDIA_TYPE_SUBTITLE ||
+                st->codec->codec_id == CODEC_ID_S302M)
                 val |= 0x04;
             *q++ = val;
             *q++ = flags;
@@ -909,9 +1152,24 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         memcpy(buf + TS_PACKET_SIZE - len, payload, len);
         payload += len;
         payload_size -= len;
-        avio_write(s->pb, buf, TS_PACKET_SIZE);
+        if (pes)
+            pes->nb_packets++;
+    }
+
+    if (pes) {
+        if (ts_st->pes_last)
+            ts_st->pes_last->next = pes;
+        else
+            ts_st->pes_first = pes;
+        ts_st->pes_last = pes;
+        ts->nb_queued++;
+        /* fill the multiplex until the new packet may enter the T-STD */
+        if (pes->dts != AV_NOPTS_VALUE)
+            mpegts_write_cbr(s, (pes->dts - delay) * 300, 0);
+    } else {
+        flush_out_packets(s);
+        avio_flush(s->pb);
     }
-    avio_flush(s->pb);
 }
 
 static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
@@ -991,6 +1249,13 @@ static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
         }
     }
 
+    if (st->codec->codec_id == CODEC_ID_S302M) {
+        // each AES3 frame starts its own pes packet, which must have a pts
+        mpegts_write_pes(s, st, buf, size, pts, dts, 1);
+        av_free(data);
+        return 0;
+    }
+
     if (st->codec->codec_type != AVMEDIA_TYPE_AUDIO) {
         // flush buffered audio
         for (i = 0; i < s->nb_streams; i++) {
@@ -1056,6 +1321,9 @@ static int mpegts_write_end(AVFormatContext *s)
         }
         av_freep(&ts_st->adts);
     }
+    if (ts->mux_rate > 1)
+        mpegts_write_cbr(s, 0, 1);
+    flush_out_packets(s);
     avio_flush(s->pb);
 
     for(i = 0; i < ts->nb_services; i++) {
@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "libavutil/common.h"
+#include "libavutil/log.h"
 #include "libavutil/mathematics.h"
 #include "libavformat/avformat.h"
 
@@ -58,11 +59,49 @@ static void ts_str(char buffer[60], int64_t ts, AVRational base)
     snprintf(buffer, 60, "%9f", tsval);
 }
 
+static int cache_loaded, cached_seeks;
+
+/* count the index cache messages of lavf, which prints them at verbose
+   and debug level */
+static void log_callback(void *avcl, int level, const char *fmt, va_list vl)
+{
+    if (!strncmp(fmt, "loaded index cache", 18))
+        cache_loaded++;
+    else if (strstr(fmt, "with the cached index"))
+        cached_seeks++;
+    av_log_default_callback(avcl, level, fmt, vl);
+}
+
+/* demux the whole file once so that the index cache gets written */
+static int write_index_cache(const char *filename, AVFormatParameters *ap)
+{
+    AVFormatContext *ic = avformat_alloc_context();
+    char cache[1024];
+    AVPacket pkt;
+    FILE *f;
+
+    snprintf(cache, sizeof(cache), "%s.ffindex", filename);
+    remove(cache);
+    if (!ic)
+        return -1;
+    ic->flags |= AVFMT_FLAG_IDXCACHE;
+    ap->prealloced_context = 1;
+    if (av_open_input_file(&ic, filename, NULL, 0, ap) < 0)
+        return -1;
+    while (av_read_frame(ic, &pkt) >= 0)
+        av_free_packet(&pkt);
+    av_close_input_file(ic);
+    if (!(f = fopen(cache, "rb")))
+        return -1;
+    fclose(f);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     const char *filename;
     AVFormatContext *ic = NULL;
-    int i, ret, stream_id;
+    int i, ret, stream_id, idxcache = 0;
     int64_t timestamp;
     AVFormatParameters params, *ap= &params;
     memset(ap, 0, sizeof(params));
@@ -72,8 +111,13 @@ int main(int argc, char **argv)
     /* initialize libavcodec, and register all codecs and formats */
     av_register_all();
 
+    if (argc > 1 && !strcmp(argv[1], "-idxcache")) {
+        idxcache = 1;
+        argc--;
+        argv++;
+    }
     if (argc < 2 || argc > 3) {
-        printf("usage: %s input_file [<frame rate>]\n", argv[0]);
+        printf("usage: %s [-idxcache] input_file [<frame rate>]\n", argv[0]);
         exit(1);
     }
 
@@ -82,6 +126,17 @@ int main(int argc, char **argv)
         ap->time_base.den = atoi(argv[2]);
         ap->time_base.num = 1;
     }
+    if (idxcache) {
+        if (write_index_cache(filename, ap) < 0) {
+            fprintf(stderr, "%s: could not write index cache\n", filename);
+            exit(1);
+        }
+        /* reopen and seek with the cached index */
+        if (!(ic = avformat_alloc_context()))
+            exit(1);
+        ic->flags |= AVFMT_FLAG_IDXCACHE;
+        av_log_set_callback(log_callback);
+    }
     ret = av_open_input_file(&ic, filename, NULL, 0, ap);
     if (ret < 0) {
         fprintf(stderr, "cannot open %s\n", filename);
@@ -131,5 +186,11 @@ int main(int argc, char **argv)
 
     av_close_input_file(ic);
 
+    if (idxcache) {
+        printf("index cache: %s, %d seeks with the cached index\n",
+               cache_loaded ? "loaded" : "not loaded", cached_seeks);
+        if (!cache_loaded || !cached_seeks)
+            return 1;
+    }
     return 0;
 }
@@ -672,6 +672,9 @@ int avformat_open_input(AVFormatContext **ps, const char *filename, AVInputForma
     if (!(s->flags&AVFMT_FLAG_PRIV_OPT) && s->pb && !s->data_offset)
         s->data_offset = avio_tell(s->pb);
 
+    if ((ret = ff_index_cache_open(s)) < 0)
+        goto fail;
+
     s->raw_packet_buffer_remaining_size = RAW_PACKET_BUFFER_SIZE;
 
     if (options) {
@@ -1063,7 +1066,7 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
                 *pkt = st->cur_pkt; st->cur_pkt.data= NULL;
                 compute_pkt_fields(s, st, NULL, pkt);
                 s->cur_st = NULL;
-                if ((s->iformat->flags & AVFMT_GENERIC_INDEX) &&
+                if ((s->iformat->flags & AVFMT_GENERIC_INDEX || s->index_cache) &&
                     (pkt->flags & AV_PKT_FLAG_KEY) && pkt->dts != AV_NOPTS_VALUE) {
                     ff_reduce_index(s, st->index);
                     av_add_index_entry(st, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
@@ -1108,6 +1111,12 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
                         ff_reduce_index(s, st->index);
                         av_add_index_entry(st, pos, pkt->dts,
                                            0, 0, AVINDEX_KEYFRAME);
+                    } else if (s->index_cache && pkt->flags & AV_PKT_FLAG_KEY &&
+                               pkt->pos >= 0 && pkt->dts != AV_NOPTS_VALUE) {
+                        /* pos of the demuxer packet the frame starts in */
+                        ff_reduce_index(s, st->index);
+                        av_add_index_entry(st, pkt->pos, pkt->dts,
+                                           0, 0, AVINDEX_KEYFRAME);
                     }
 
                     break;
@@ -1722,6 +1731,30 @@ static int seek_frame_generic(AVFormatContext *s,
     return 0;
 }
 
+/**
+ * Seek using the index if it is known to be complete, see AVFMT_FLAG_IDXCACHE.
+ */
+static int seek_frame_cached_index(AVFormatContext *s,
+                                   int stream_index, int64_t timestamp, int flags)
+{
+    AVStream *st = s->streams[stream_index];
+    AVIndexEntry *ie;
+    int index, complete = ff_index_cache_complete(s);
+
+    ff_index_cache_seek(s);
+    if (!complete)
+        return -1;
+    index = av_index_search_timestamp(st, timestamp, flags);
+    if (index < 0)
+        return -1;
+    ie = &st->index_entries[index];
+    if (avio_seek(s->pb, ie->pos, SEEK_SET) < 0)
+        return -1;
+    av_log(s, AV_LOG_DEBUG, "seek to %"PRId64" with the cached index\n", ie->timestamp);
+    av_update_cur_dts(s, st, ie->timestamp);
+    return 0;
+}
+
 int av_seek_frame(AVFormatContext *s, int stream_index, int64_t timestamp, int flags)
 {
     int ret;
@@ -1729,8 +1762,10 @@ int av_seek_frame(AVFormatContext *s, int stream_index, int64_t timestamp, int f
 
     ff_read_frame_flush(s);
 
-    if(flags & AVSEEK_FLAG_BYTE)
+    if(flags & AVSEEK_FLAG_BYTE) {
+        ff_index_cache_seek(s);
         return seek_frame_byte(s, stream_index, timestamp, flags);
+    }
 
     if(stream_index < 0){
         stream_index= av_find_default_stream_index(s);
@@ -1742,6 +1777,9 @@ int av_seek_frame(AVFormatContext *s, int stream_index, int64_t timestamp, int f
         timestamp = av_rescale(timestamp, st->time_base.den, AV_TIME_BASE * (int64_t)st->time_base.num);
     }
 
+    if (s->index_cache && seek_frame_cached_index(s, stream_index, timestamp, flags) >= 0)
+        return 0;
+
     /* first, we try the format specific seek */
     if (s->iformat->read_seek)
         ret = s->iformat->read_seek(s, stream_index, timestamp, flags);
@@ -1766,8 +1804,10 @@ int avformat_seek_file(AVFormatContext *s, int stream_index, int64_t min_ts, int
 
     ff_read_frame_flush(s);
 
-    if (s->iformat->read_seek2)
+    if (s->iformat->read_seek2) {
+        ff_index_cache_seek(s);
         return s->iformat->read_seek2(s, stream_index, min_ts, ts, max_ts, flags);
+    }
 
     if(s->iformat->read_timestamp){
         //try to seek via read_timestamp()
@@ -2600,6 +2640,7 @@ int av_read_pause(AVFormatContext *s)
 
 void av_close_input_stream(AVFormatContext *s)
 {
+    ff_index_cache_close(s);
     flush_packet_queue(s);
     if (s->iformat->read_close)
         s->iformat->read_close(s);
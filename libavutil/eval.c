@@ -136,8 +136,46 @@ struct AVExpr {
         double (*func2)(void *, double, double);
     } a;
     struct AVExpr *param[2];
+    struct ExprCode *code; ///< compiled form of the expression, set on the root only
 };
 
+/**
+ * Expressions are compiled after parsing into a flat list of instructions
+ * working on a small register file, which is what av_expr_eval() runs.
+ * Constant subexpressions are folded into a pool of preloaded registers
+ * and the left side of ';' is dropped when it has no side effects.
+ */
+enum {
+    i_var, i_mov, i_scale, i_neg, i_func0, i_func1, i_func2,
+    i_squish, i_gauss, i_ld, i_isnan, i_floor, i_ceil, i_trunc,
+    i_sqrt, i_not, i_mod, i_max, i_min, i_eq, i_gt, i_gte,
+    i_pow, i_mul, i_div, i_add, i_st, i_jz, i_jmp,
+};
+
+typedef struct ExprOp {
+    int op;
+    int dst, a, b;  ///< registers, a is the constant index for i_var and b the target of jumps
+    double k;       ///< factor for i_var and i_scale
+    union {
+        double (*func0)(double);
+        double (*func1)(void *, double);
+        double (*func2)(void *, double, double);
+    } f;
+} ExprOp;
+
+#define MAX_REGS 64
+
+typedef struct ExprCode {
+    ExprOp *ops;
+    int nb_ops;
+    int nb_temps;           ///< temporaries come first in the register file
+    int nb_pool;            ///< followed by the folded constants
+    double pool[MAX_REGS];
+    int result;             ///< register holding the value of the expression
+    int has_jumps;
+    int uses_vars;
+} ExprCode;
+
 static double eval_expr(Parser *p, AVExpr *e)
 {
     switch (e->type) {
@@ -190,6 +228,9 @@ void av_expr_free(AVExpr *e)
     if (!e) return;
     av_expr_free(e->param[0]);
     av_expr_free(e->param[1]);
+    if (e->code)
+        av_free(e->code->ops);
+    av_freep(&e->code);
     av_freep(&e);
 }
 
@@ -466,6 +507,321 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+
+static int has_side_effects(AVExpr *e)
+{
+    if (!e) return 0;
+    switch (e->type) {
+        case e_st:
+        case e_while:
+        case e_func1:
+        case e_func2: return 1;
+        default: return has_side_effects(e->param[0]) || has_side_effects(e->param[1]);
+    }
+}
+
+static int is_constant(AVExpr *e)
+{
+    if (!e) return 1;
+    switch (e->type) {
+        case e_value: return 1;
+        case e_const:
+        case e_ld:
+        case e_st:
+        case e_while:
+        case e_func1:
+        case e_func2: return 0;
+        default: return is_constant(e->param[0]) && is_constant(e->param[1]);
+    }
+}
+
+static int count_nodes(AVExpr *e)
+{
+    return e ? 1 + count_nodes(e->param[0]) + count_nodes(e->param[1]) : 0;
+}
+
+typedef struct Compiler {
+    ExprCode *c;
+    int error;
+} Compiler;
+
+/* constants are numbered from -1 downwards until the temporaries are known */
+static int pool_reg(Compiler *cp, double v)
+{
+    ExprCode *c = cp->c;
+    int i;
+    for (i = 0; i < c->nb_pool; i++)
+        if (!memcmp(&c->pool[i], &v, sizeof(v)))
+            return -1 - i;
+    if (c->nb_pool == MAX_REGS) {
+        cp->error = 1;
+        return -1;
+    }
+    c->pool[c->nb_pool] = v;
+    return -1 - c->nb_pool++;
+}
+
+static ExprOp *emit(Compiler *cp, int op, int dst, int a, int b)
+{
+    ExprOp *o = &cp->c->ops[cp->c->nb_ops++];
+    o->op  = op;
+    o->dst = dst;
+    o->a   = a;
+    o->b   = b;
+    return o;
+}
+
+static int compile_expr(Compiler *cp, AVExpr *e, int tmp);
+
+/* apply the sign of the node to the value in tmp */
+static int compile_scale(Compiler *cp, double value, int r, int tmp)
+{
+    if (value == 1)
+        return r;
+    emit(cp, value == -1 ? i_neg : i_scale, tmp, r, 0)->k = value;
+    return tmp;
+}
+
+/**
+ * Emit the code for e, using the registers from tmp upwards as
+ * temporaries. Return the register holding the result, which is either
+ * tmp or a constant.
+ */
+static int compile_expr(Compiler *cp, AVExpr *e, int tmp)
+{
+    ExprCode *c = cp->c;
+    ExprOp *o;
+    int a, b, loop, jz;
+
+    if (tmp >= MAX_REGS - 2) {
+        cp->error = 1;
+        return tmp;
+    }
+    c->nb_temps = FFMAX(c->nb_temps, tmp + 1);
+
+    if (is_constant(e)) {
+        Parser p = { 0 };
+        return pool_reg(cp, eval_expr(&p, e));
+    }
+
+    switch (e->type) {
+    case e_const:
+        o = emit(cp, i_var, tmp, e->a.const_index, 0);
+        o->k = e->value;
+        return tmp;
+    case e_while:
+        if (is_constant(e->param[0])) {
+            Parser p = { 0 };
+            if (!eval_expr(&p, e->param[0]))
+                return pool_reg(cp, NAN);
+        }
+        c->has_jumps = 1;
+        emit(cp, i_mov, tmp, pool_reg(cp, NAN), 0);
+        loop = c->nb_ops;
+        a  = compile_expr(cp, e->param[0], tmp + 1);
+        jz = c->nb_ops;
+        emit(cp, i_jz, 0, a, 0);
+        b  = compile_expr(cp, e->param[1], tmp + 1);
+        emit(cp, i_mov, tmp, b, 0);
+        emit(cp, i_jmp, 0, 0, loop);
+        c->ops[jz].b = c->nb_ops;
+        return tmp;
+    case e_last:
+        if (has_side_effects(e->param[0]))
+            compile_expr(cp, e->param[0], tmp);
+        return compile_scale(cp, e->value, compile_expr(cp, e->param[1], tmp), tmp);
+    case e_not:
+        a = compile_scale(cp, e->value, compile_expr(cp, e->param[0], tmp), tmp);
+        emit(cp, i_not, tmp, a, 0);
+        return tmp;
+    case e_squish:
+    case e_gauss:
+        a = compile_expr(cp, e->param[0], tmp);
+        emit(cp, e->type == e_squish ? i_squish : i_gauss, tmp, a, 0);
+        return tmp;
+    case e_func0:
+    case e_func1:
+    case e_ld:
+    case e_isnan:
+    case e_floor:
+    case e_ceil:
+    case e_trunc:
+    case e_sqrt:
+        a = compile_expr(cp, e->param[0], tmp);
+        o = emit(cp, e->type == e_func0 ? i_func0 :
+                     e->type == e_func1 ? i_func1 :
+                     e->type == e_ld    ? i_ld    :
+                     e->type == e_isnan ? i_isnan :
+                     e->type == e_floor ? i_floor :
+                     e->type == e_ceil  ? i_ceil  :
+                     e->type == e_trunc ? i_trunc : i_sqrt, tmp, a, 0);
+        if (e->type == e_func0) o->f.func0 = e->a.func0;
+        if (e->type == e_func1) o->f.func1 = e->a.func1;
+        if (e->type == e_ld)    c->uses_vars = 1;
+        return compile_scale(cp, e->value, tmp, tmp);
+    default:
+        a = compile_expr(cp, e->param[0], tmp);
+        b = compile_expr(cp, e->param[1], tmp + 1);
+        switch (e->type) {
+        case e_func2: emit(cp, i_func2, tmp, a, b)->f.func2 = e->a.func2; break;
+        case e_mod:   emit(cp, i_mod,   tmp, a, b); break;
+        case e_max:   emit(cp, i_max,   tmp, a, b); break;
+        case e_min:   emit(cp, i_min,   tmp, a, b); break;
+        case e_eq:    emit(cp, i_eq,    tmp, a, b); break;
+        case e_gt:    emit(cp, i_gt,    tmp, a, b); break;
+        case e_gte:   emit(cp, i_gte,   tmp, a, b); break;
+        case e_pow:   emit(cp, i_pow,   tmp, a, b); break;
+        case e_mul:   emit(cp, i_mul,   tmp, a, b); break;
+        case e_div:   emit(cp, i_div,   tmp, a, b); break;
+        case e_add:   emit(cp, i_add,   tmp, a, b); break;
+        case e_st:    emit(cp, i_st,    tmp, a, b); c->uses_vars = 1; break;
+        default:      cp->error = 1; return tmp;
+        }
+        return compile_scale(cp, e->value, tmp, tmp);
+    }
+}
+
+static int compile(AVExpr *e)
+{
+    ExprCode *c = av_mallocz(sizeof(*c));
+    Compiler cp = { c };
+    int i;
+
+    if (!c)
+        return AVERROR(ENOMEM);
+    /* at most a main and a sign instruction per node, plus 4 per loop */
+    c->ops = av_malloc(sizeof(*c->ops) * (4 * count_nodes(e) + 1));
+    if (!c->ops) {
+        av_free(c);
+        return AVERROR(ENOMEM);
+    }
+    c->result = compile_expr(&cp, e, 0);
+    if (cp.error || c->nb_temps + c->nb_pool > MAX_REGS) {
+        av_free(c->ops);
+        av_free(c);
+        return AVERROR(ENOSYS);
+    }
+
+#define REG(r) ((r) < 0 ? c->nb_temps - 1 - (r) : (r))
+    for (i = 0; i < c->nb_ops; i++) {
+        ExprOp *o = &c->ops[i];
+        if (o->op != i_var && o->op != i_jmp)
+            o->a = REG(o->a);
+        if (o->op != i_jz && o->op != i_jmp)
+            o->b = REG(o->b);
+    }
+    c->result = REG(c->result);
+#undef REG
+    e->code = c;
+    return 0;
+}
+
+static double run_code(const ExprCode *c, const double *const_values, void *opaque)
+{
+    double r[MAX_REGS], var[VARS];
+    const ExprOp *o;
+    int pc;
+
+    for (pc = 0; pc < c->nb_pool; pc++)
+        r[c->nb_temps + pc] = c->pool[pc];
+    if (c->uses_vars)
+        memset(var, 0, sizeof(var));
+
+    for (pc = 0; pc < c->nb_ops; pc++) {
+        o = &c->ops[pc];
+        switch (o->op) {
+        case i_var:    r[o->dst] = o->k * const_values[o->a];             break;
+        case i_mov:    r[o->dst] = r[o->a];                                break;
+        case i_scale:  r[o->dst] = o->k * r[o->a];                         break;
+        case i_neg:    r[o->dst] = -r[o->a];                               break;
+        case i_func0:  r[o->dst] = o->f.func0(r[o->a]);                    break;
+        case i_func1:  r[o->dst] = o->f.func1(opaque, r[o->a]);            break;
+        case i_func2:  r[o->dst] = o->f.func2(opaque, r[o->a], r[o->b]);   break;
+        case i_squish: r[o->dst] = 1/(1+exp(4*r[o->a]));                   break;
+        case i_gauss:  r[o->dst] = exp(-r[o->a]*r[o->a]/2)/sqrt(2*M_PI);   break;
+        case i_ld:     r[o->dst] = var[av_clip(r[o->a], 0, VARS-1)];       break;
+        case i_isnan:  r[o->dst] = !!isnan(r[o->a]);                       break;
+        case i_floor:  r[o->dst] = floor(r[o->a]);                         break;
+        case i_ceil:   r[o->dst] = ceil (r[o->a]);                         break;
+        case i_trunc:  r[o->dst] = trunc(r[o->a]);                         break;
+        case i_sqrt:   r[o->dst] = sqrt (r[o->a]);                         break;
+        case i_not:    r[o->dst] = r[o->a] == 0;                           break;
+        case i_mod:    r[o->dst] = r[o->a] - floor(r[o->a]/r[o->b])*r[o->b]; break;
+        case i_max:    r[o->dst] = r[o->a] >  r[o->b] ? r[o->a] : r[o->b]; break;
+        case i_min:    r[o->dst] = r[o->a] <  r[o->b] ? r[o->a] : r[o->b]; break;
+        case i_eq:     r[o->dst] = r[o->a] == r[o->b] ? 1.0 : 0.0;         break;
+        case i_gt:     r[o->dst] = r[o->a] >  r[o->b] ? 1.0 : 0.0;         break;
+        case i_gte:    r[o->dst] = r[o->a] >= r[o->b] ? 1.0 : 0.0;         break;
+        case i_pow:    r[o->dst] = pow(r[o->a], r[o->b]);                  break;
+        case i_mul:    r[o->dst] = r[o->a] * r[o->b];                      break;
+        case i_div:    r[o->dst] = r[o->a] / r[o->b];                      break;
+        case i_add:    r[o->dst] = r[o->a] + r[o->b];                      break;
+        case i_st:     r[o->dst] = var[av_clip(r[o->a], 0, VARS-1)] = r[o->b]; break;
+        case i_jz:     if (!r[o->a]) pc = o->b - 1;                        break;
+        case i_jmp:    pc = o->b - 1;                                      break;
+        }
+    }
+    return r[c->result];
+}
+
+#define BATCH 16
+
+/**
+ * Run straight line code on up to BATCH sets of constants at once, one
+ * instruction at a time over the whole set.
+ */
+static void run_code_batch(const ExprCode *c, double *res, const double *const_values,
+                           int stride, int n, void *opaque)
+{
+    double r[MAX_REGS][BATCH], var[VARS][BATCH];
+    int pc, i;
+
+    for (pc = 0; pc < c->nb_pool; pc++)
+        for (i = 0; i < n; i++)
+            r[c->nb_temps + pc][i] = c->pool[pc];
+    if (c->uses_vars)
+        memset(var, 0, sizeof(var));
+
+    for (pc = 0; pc < c->nb_ops; pc++) {
+        const ExprOp *o = &c->ops[pc];
+        double *d = r[o->dst];
+        const double *a = r[o->a], *b = r[o->b];
+#define LOOP(expr) for (i = 0; i < n; i++) d[i] = expr; break
+        switch (o->op) {
+        case i_var:    LOOP(o->k * const_values[i * stride + o->a]);
+        case i_mov:    LOOP(a[i]);
+        case i_scale:  LOOP(o->k * a[i]);
+        case i_neg:    LOOP(-a[i]);
+        case i_func0:  LOOP(o->f.func0(a[i]));
+        case i_func1:  LOOP(o->f.func1(opaque, a[i]));
+        case i_func2:  LOOP(o->f.func2(opaque, a[i], b[i]));
+        case i_squish: LOOP(1/(1+exp(4*a[i])));
+        case i_gauss:  LOOP(exp(-a[i]*a[i]/2)/sqrt(2*M_PI));
+        case i_ld:     LOOP(var[av_clip(a[i], 0, VARS-1)][i]);
+        case i_isnan:  LOOP(!!isnan(a[i]));
+        case i_floor:  LOOP(floor(a[i]));
+        case i_ceil:   LOOP(ceil (a[i]));
+        case i_trunc:  LOOP(trunc(a[i]));
+        case i_sqrt:   LOOP(sqrt (a[i]));
+        case i_not:    LOOP(a[i] == 0);
+        case i_mod:    LOOP(a[i] - floor(a[i]/b[i])*b[i]);
+        case i_max:    LOOP(a[i] >  b[i] ? a[i] : b[i]);
+        case i_min:    LOOP(a[i] <  b[i] ? a[i] : b[i]);
+        case i_eq:     LOOP(a[i] == b[i] ? 1.0 : 0.0);
+        case i_gt:     LOOP(a[i] >  b[i] ? 1.0 : 0.0);
+        case i_gte:    LOOP(a[i] >= b[i] ? 1.0 : 0.0);
+        case i_pow:    LOOP(pow(a[i], b[i]));
+        case i_mul:    LOOP(a[i] * b[i]);
+        case i_div:    LOOP(a[i] / b[i]);
+        case i_add:    LOOP(a[i] + b[i]);
+        case i_st:     LOOP(var[av_clip(a[i], 0, VARS-1)][i] = b[i]);
+        }
+#undef LOOP
+    }
+    for (i = 0; i < n; i++)
+        res[i] = r[c->result][i];
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -510,6 +866,12 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(EINVAL);
         goto end;
     }
+    /* fall back to walking the tree if the expression does not fit */
+    if (compile(e) == AVERROR(ENOMEM)) {
+        av_expr_free(e);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
     *expr = e;
 end:
     av_free(w);
@@ -518,13 +880,31 @@ end:
 
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 {
-    Parser p = { 0 };
+    Parser p;
 
+    if (e->code)
+        return run_code(e->code, const_values, opaque);
+    memset(&p, 0, sizeof(p));
     p.const_values = const_values;
     p.opaque     = opaque;
     return eval_expr(&p, e);
 }
 
+void av_expr_eval_batch(AVExpr *e, double *res, const double *const_values,
+                        int stride, int count, void *opaque)
+{
+    int i;
+
+    if (e->code && !e->code->has_jumps) {
+        for (i = 0; i < count; i += BATCH)
+            run_code_batch(e->code, res + i, const_values + i * stride, stride,
+                           FFMIN(count - i, BATCH), opaque);
+        return;
+    }
+    for (i = 0; i < count; i++)
+        res[i] = av_expr_eval(e, const_values + i * stride, opaque);
+}
+
 int av_expr_parse_and_eval(double *d, const char *s,
                            const char * const *const_names, const double *const_values,
                            const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -578,6 +958,7 @@ void av_free_expr(AVExpr *e)
 #ifdef TEST
 #undef printf
 #include <string.h>
+#include <time.h>
 
 static double const_values[] = {
     M_PI,
@@ -591,6 +972,78 @@ static const char *const_names[] = {
     0
 };
 
+static double walk_tree(AVExpr *e, const double *values)
+{
+    Parser p = { 0 };
+    p.const_values = values;
+    return eval_expr(&p, e);
+}
+
+/* the compiled code must give the same result as walking the tree */
+static void check_compiled(const char *s)
+{
+    AVExpr *e;
+    double d, d2, d3;
+    int level = av_log_get_level(), ret;
+
+    av_log_set_level(AV_LOG_QUIET);
+    ret = av_expr_parse(&e, s, const_names, NULL, NULL, NULL, NULL, 0, NULL);
+    av_log_set_level(level);
+    if (ret < 0)
+        return;
+    d  = walk_tree(e, const_values);
+    d2 = av_expr_eval(e, const_values, NULL);
+    av_expr_eval_batch(e, &d3, const_values, 0, 1, NULL);
+    if (memcmp(&d, &d2, sizeof(d)) || memcmp(&d, &d3, sizeof(d)))
+        printf("'%s' -> %f tree, %f compiled, %f batch\n", s, d, d2, d3);
+    av_expr_free(e);
+}
+
+static const char *bench_names[] = { "N", "T", "W", "H", "VAL", 0 };
+
+#define BENCH_SETS 1024
+
+static void bench(const char *s, int runs)
+{
+    static double values[BENCH_SETS][5], res[BENCH_SETS];
+    double sum = 0;
+    clock_t t0, t1, t2, t3;
+    AVExpr *e;
+    int i, j;
+
+    if (av_expr_parse(&e, s, bench_names, NULL, NULL, NULL, NULL, 0, NULL) < 0)
+        return;
+    for (i = 0; i < BENCH_SETS; i++) {
+        values[i][0] = i;
+        values[i][1] = i / 25.0;
+        values[i][2] = 1920;
+        values[i][3] = 1080;
+        values[i][4] = i & 255;
+    }
+
+    t0 = clock();
+    for (j = 0; j < runs; j++)
+        for (i = 0; i < BENCH_SETS; i++)
+            sum += walk_tree(e, values[i]);
+    t1 = clock();
+    for (j = 0; j < runs; j++)
+        for (i = 0; i < BENCH_SETS; i++)
+            sum += av_expr_eval(e, values[i], NULL);
+    t2 = clock();
+    for (j = 0; j < runs; j++) {
+        av_expr_eval_batch(e, res, values[0], 5, BENCH_SETS, NULL);
+        sum += res[j & (BENCH_SETS - 1)];
+    }
+    t3 = clock();
+
+#define NS(t) ((t) * 1e9 / CLOCKS_PER_SEC / ((double)runs * BENCH_SETS))
+    printf("%-48s %7.1f %7.1f %7.1f ns %5.2fx %5.2fx (%g)\n", s,
+           NS(t1 - t0), NS(t2 - t1), NS(t3 - t2),
+           (double)(t1 - t0) / FFMAX(t2 - t1, 1),
+           (double)(t1 - t0) / FFMAX(t3 - t2, 1), sum);
+    av_expr_free(e);
+}
+
 int main(int argc, char **argv)
 {
     int i;
@@ -652,9 +1105,33 @@ int main(int argc, char **argv)
         "pow(PI,1.23)",
         "PI^1.23",
         "pow(-1,1.23)",
+        "1+2*3-4/2+max(sqrt(16),-1)",
+        "-(2^-2)*PI",
+        "st(0, 5); 1+2; ld(0)",
+        "while(0, st(0, 1)); ld(0)+1",
+        "not(-E)",
+        "squish(-PI)+gauss(E-2)",
         NULL
     };
 
+    if (argc > 1 && !strcmp(argv[1], "-b")) {
+        const char *bench_exprs[] = {
+            "N/25+T",
+            "(W-1280)/2",
+            "gte(T-st(0,T),0.5)*not(eq(mod(N,12),0))",
+            "min(max(VAL*219/255+16,16),235)",
+            "st(1,VAL/255);ld(1)*ld(1)*255",
+            "2*T/3+sin(1)*W",
+            NULL
+        };
+        int runs = argc > 2 ? atoi(argv[2]) : 1000;
+        printf("%-48s %7s %7s %7s    %6s %6s\n", "expression", "tree", "code", "batch",
+               "code", "batch");
+        for (expr = bench_exprs; *expr; expr++)
+            bench(*expr, runs);
+        return 0;
+    }
+
     for (expr = exprs; *expr; expr++) {
         printf("Evaluating '%s'\n", *expr);
         av_expr_parse_and_eval(&d, *expr,
@@ -665,6 +1142,7 @@ int main(int argc, char **argv)
         }else{
             printf("'%s' -> %f\n\n", *expr, d);
         }
+        check_compiled(*expr);
     }
 
     av_expr_parse_and_eval(&d, "1+(5-2)^(3-1)+1/2+sin(PI)-max(-2.2,-3.1)",
@@ -86,6 +86,22 @@ int av_expr_parse(AVExpr **expr, const char *s,
  */
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque);
 
+/**
+ * Evaluate a previously parsed expression for several sets of constant
+ * values, which is faster than calling av_expr_eval() for each of them.
+ * The functions from funcs1 and funcs2 may be called for the sets in any
+ * order, so their results must only depend on their arguments.
+ *
+ * @param res array of count values where the results are put
+ * @param const_values count consecutive arrays of values for the
+ * identifiers from av_expr_parse() const_names
+ * @param stride distance in doubles between two sets of const_values
+ * @param count number of sets to evaluate
+ * @param opaque a pointer which will be passed to all functions from funcs1 and funcs2
+ */
+void av_expr_eval_batch(AVExpr *e, double *res, const double *const_values,
+                        int stride, int count, void *opaque);
+
 /**
  * Free a parsed expression previously created with av_expr_parse().
  */
@@ -16,6 +16,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "intreadwrite.h"
 #include "samplefmt.h"
 
 #include <stdio.h>
@@ -25,15 +26,20 @@
 typedef struct SampleFmtInfo {
     const char *name;
     int bits;
+    int planar;
+    enum AVSampleFormat altform; ///< planar<->packed alternative form
 } SampleFmtInfo;
 
 /** this table gives more information about formats */
 static const SampleFmtInfo sample_fmt_info[AV_SAMPLE_FMT_NB] = {
-    [AV_SAMPLE_FMT_U8]  = { .name = "u8",  .bits = 8 },
-    [AV_SAMPLE_FMT_S16] = { .name = "s16", .bits = 16 },
-    [AV_SAMPLE_FMT_S32] = { .name = "s32", .bits = 32 },
-    [AV_SAMPLE_FMT_FLT] = { .name = "flt", .bits = 32 },
-    [AV_SAMPLE_FMT_DBL] = { .name = "dbl", .bits = 64 },
+    [AV_SAMPLE_FMT_U8]   = { .name = "u8",   .bits = 8,  .planar = 0, .altform = AV_SAMPLE_FMT_NONE },
+    [AV_SAMPLE_FMT_S16]  = { .name = "s16",  .bits = 16, .planar = 0, .altform = AV_SAMPLE_FMT_S16P },
+    [AV_SAMPLE_FMT_S32]  = { .name = "s32",  .bits = 32, .planar = 0, .altform = AV_SAMPLE_FMT_S32P },
+    [AV_SAMPLE_FMT_FLT]  = { .name = "flt",  .bits = 32, .planar = 0, .altform = AV_SAMPLE_FMT_FLTP },
+    [AV_SAMPLE_FMT_DBL]  = { .name = "dbl",  .bits = 64, .planar = 0, .altform = AV_SAMPLE_FMT_NONE },
+    [AV_SAMPLE_FMT_S16P] = { .name = "s16p", .bits = 16, .planar = 1, .altform = AV_SAMPLE_FMT_S16 },
+    [AV_SAMPLE_FMT_S32P] = { .name = "s32p", .bits = 32, .planar = 1, .altform = AV_SAMPLE_FMT_S32 },
+    [AV_SAMPLE_FMT_FLTP] = { .name = "fltp", .bits = 32, .planar = 1, .altform = AV_SAMPLE_FMT_FLT },
 };
 
 const char *av_get_sample_fmt_name(enum AVSampleFormat sample_fmt)
@@ -72,6 +78,31 @@ int av_get_bytes_per_sample(enum AVSampleFormat sample_fmt)
         0 : sample_fmt_info[sample_fmt].bits >> 3;
 }
 
+int av_sample_fmt_is_planar(enum AVSampleFormat sample_fmt)
+{
+    if (sample_fmt < 0 || sample_fmt >= AV_SAMPLE_FMT_NB)
+        return 0;
+    return sample_fmt_info[sample_fmt].planar;
+}
+
+enum AVSampleFormat av_get_packed_sample_fmt(enum AVSampleFormat sample_fmt)
+{
+    if (sample_fmt < 0 || sample_fmt >= AV_SAMPLE_FMT_NB)
+        return AV_SAMPLE_FMT_NONE;
+    if (sample_fmt_info[sample_fmt].planar)
+        return sample_fmt_info[sample_fmt].altform;
+    return sample_fmt;
+}
+
+enum AVSampleFormat av_get_planar_sample_fmt(enum AVSampleFormat sample_fmt)
+{
+    if (sample_fmt < 0 || sample_fmt >= AV_SAMPLE_FMT_NB)
+        return AV_SAMPLE_FMT_NONE;
+    if (sample_fmt_info[sample_fmt].planar)
+        return sample_fmt;
+    return sample_fmt_info[sample_fmt].altform;
+}
+
 #if FF_API_GET_BITS_PER_SAMPLE_FMT
 int av_get_bits_per_sample_fmt(enum AVSampleFormat sample_fmt)
 {
@@ -128,3 +159,26 @@ int av_samples_alloc(uint8_t *pointers[8], int linesizes[8],
                                   buf, nb_channels, nb_samples,
                                   sample_fmt, planar, align);
 }
+
+void av_samples_copy_layout(uint8_t *dst, const uint8_t *src,
+                            int nb_channels, int nb_samples,
+                            int sample_size, int planar_dst)
+{
+    int c, i;
+    int is = planar_dst ? nb_channels * sample_size : sample_size;
+    int os = planar_dst ? sample_size : nb_channels * sample_size;
+    int plane_size = nb_samples * sample_size;
+
+    for (c = 0; c < nb_channels; c++) {
+        const uint8_t *s = src + c * (planar_dst ? sample_size : plane_size);
+        uint8_t *d       = dst + c * (planar_dst ? plane_size : sample_size);
+        switch (sample_size) {
+        case 2: for (i = 0; i < nb_samples; i++, s += is, d += os) AV_WN16(d, AV_RN16(s)); break;
+        case 4: for (i = 0; i < nb_samples; i++, s += is, d += os) AV_WN32(d, AV_RN32(s)); break;
+        case 8: for (i = 0; i < nb_samples; i++, s += is, d += os) AV_WN64(d, AV_RN64(s)); break;
+        default:
+            for (i = 0; i < nb_samples; i++, s += is, d += os)
+                memcpy(d, s, sample_size);
+        }
+    }
+}
@@ -31,6 +31,9 @@ enum AVSampleFormat {
     AV_SAMPLE_FMT_S32,         ///< signed 32 bits
     AV_SAMPLE_FMT_FLT,         ///< float
     AV_SAMPLE_FMT_DBL,         ///< double
+    AV_SAMPLE_FMT_S16P,        ///< signed 16 bits, planar
+    AV_SAMPLE_FMT_S32P,        ///< signed 32 bits, planar
+    AV_SAMPLE_FMT_FLTP,        ///< float, planar
     AV_SAMPLE_FMT_NB           ///< Number of sample formats. DO NOT USE if linking dynamically
 };
 
@@ -60,6 +63,26 @@ enum AVSampleFormat av_get_sample_fmt(const char *name);
  */
 char *av_get_sample_fmt_string(char *buf, int buf_size, enum AVSampleFormat sample_fmt);
 
+/**
+ * Check if the sample format is planar, that is if each channel is
+ * stored in its own plane.
+ *
+ * @return 1 if the sample format is planar, 0 if it is packed or unknown
+ */
+int av_sample_fmt_is_planar(enum AVSampleFormat sample_fmt);
+
+/**
+ * Return the packed alternative form of the given sample format, or
+ * the sample format itself if it is already packed.
+ */
+enum AVSampleFormat av_get_packed_sample_fmt(enum AVSampleFormat sample_fmt);
+
+/**
+ * Return the planar alternative form of the given sample format, or
+ * AV_SAMPLE_FMT_NONE if there is no planar form of it.
+ */
+enum AVSampleFormat av_get_planar_sample_fmt(enum AVSampleFormat sample_fmt);
+
 #if FF_API_GET_BITS_PER_SAMPLE_FMT
 /**
  * @deprecated Use av_get_bytes_per_sample() instead.
@@ -122,4 +145,16 @@ int av_samples_alloc(uint8_t *pointers[8], int linesizes[8],
                      enum AVSampleFormat sample_fmt, int planar,
                      int align);
 
+/**
+ * Copy nb_samples samples per channel between packed and planar layout.
+ * The planes of the planar side follow each other without padding.
+ *
+ * @param sample_size the size of a sample in bytes
+ * @param planar_dst 1 to split packed src into planes, 0 to interleave
+ * planar src
+ */
+void av_samples_copy_layout(uint8_t *dst, const uint8_t *src,
+                            int nb_channels, int nb_samples,
+                            int sample_size, int planar_dst);
+
 #endif /* AVCORE_SAMPLEFMT_H */
@@ -2484,6 +2484,68 @@ find_c_packed_planar_out_funcs(SwsContext *c,
 #define DEBUG_SWSCALE_BUFFERS 0
 #define DEBUG_BUFFERS(...) if (DEBUG_SWSCALE_BUFFERS) av_log(c, AV_LOG_DEBUG, __VA_ARGS__)
 
+#define YUV2YUV_MATRIX_PLANAR(type, depth, x0, cx0)                                 \
+    {                                                                               \
+        type *py = (type *)(dst[0] + y  * dstStride[0]);                            \
+        type *pu = (type *)(dst[1] + cy * dstStride[1]);                            \
+        type *pv = (type *)(dst[2] + cy * dstStride[2]);                            \
+        const int black = 16 << (depth - 8), zero = 128 << (depth - 8);            \
+        for (x = x0; x < c->dstW; x++) {                                            \
+            const int u = pu[x >> 1] - zero;                                        \
+            const int v = pv[x >> 1] - zero;                                        \
+            py[x] = av_clip_uintp2((65536 * (py[x] - black) + m[0] * u + m[1] * v + \
+                                    (black << 16) + 32768) >> 16, depth);           \
+        }                                                                           \
+        if ((y & chrSkipMask) != chrSkipMask && y != c->dstH - 1)                   \
+            break;                                                                  \
+        if (cx0)                                                                    \
+            c->yuv2yuv_chroma(c, (uint8_t *)pu, (uint8_t *)pv, cx0);                \
+        for (x = cx0; x < c->chrDstW; x++) {                                        \
+            const int u = pu[x] - zero;                                             \
+            const int v = pv[x] - zero;                                             \
+            pu[x] = av_clip_uintp2((m[2] * u + m[3] * v + (zero << 16) + 32768) >> 16, depth); \
+            pv[x] = av_clip_uintp2((m[4] * u + m[5] * v + (zero << 16) + 32768) >> 16, depth); \
+        }                                                                           \
+    }
+
+void ff_sws_yuv2yuv_matrix(SwsContext *c, uint8_t *dst[4], const int dstStride[4], int y)
+{
+    const int *m = c->yuv2yuv_coeffs;
+    const int chrSkipMask = (1 << c->chrDstVSubSample) - 1;
+    const int cy = y >> c->chrDstVSubSample;
+    int x, n;
+
+    switch (c->dstFormat) {
+    case PIX_FMT_UYVY422: {
+        uint8_t *p = dst[0] + y * dstStride[0];
+        n = c->yuv2yuv_uyvy ? c->chrDstW & ~7 : 0;
+        if (n)
+            c->yuv2yuv_uyvy(c, p, n);
+        for (x = 4 * n; x < 2 * c->dstW; x += 4) {
+            const int u = p[x + 0] - 128;
+            const int v = p[x + 2] - 128;
+            const int uvval = m[0] * u + m[1] * v + 1081344;
+            p[x + 0] = av_clip_uint8((m[2] * u + m[3] * v + 8421376) >> 16);
+            p[x + 1] = av_clip_uint8((65536 * (p[x + 1] - 16) + uvval) >> 16);
+            p[x + 2] = av_clip_uint8((m[4] * u + m[5] * v + 8421376) >> 16);
+            p[x + 3] = av_clip_uint8((65536 * (p[x + 3] - 16) + uvval) >> 16);
+        }
+        break;
+    }
+    case PIX_FMT_YUV420P:
+    case PIX_FMT_YUV422P:
+        n = c->yuv2yuv_luma ? (c->dstW >> 1) & ~7 : 0;
+        if (n)
+            c->yuv2yuv_luma(c, dst[0] + y * dstStride[0],
+                            dst[1] + cy * dstStride[1], dst[2] + cy * dstStride[2], n);
+        YUV2YUV_MATRIX_PLANAR(uint8_t,  8, 2 * n, n)
+        break;
+    case PIX_FMT_YUV422P10:
+        YUV2YUV_MATRIX_PLANAR(uint16_t, 10, 0, 0)
+        break;
+    }
+}
+
 static int swScale(SwsContext *c, const uint8_t* src[],
                    int srcStride[], int srcSliceY,
                    int srcSliceH, uint8_t* dst[], int dstStride[])
@@ -2731,6 +2793,8 @@ static int swScale(SwsContext *c, const uint8_t* src[],
                 }
             }
         }
+        if (c->yuv2yuv_matrix)
+            ff_sws_yuv2yuv_matrix(c, dst, dstStride, dstY);
     }
 
     if ((dstFormat == PIX_FMT_YUVA420P) && !alpPixBuf)
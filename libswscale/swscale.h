@@ -32,7 +32,7 @@
 #include "libavutil/pixfmt.h"
 
 #define LIBSWSCALE_VERSION_MAJOR 2
-#define LIBSWSCALE_VERSION_MINOR 0
+#define LIBSWSCALE_VERSION_MINOR 1
 #define LIBSWSCALE_VERSION_MICRO 0
 
 #define LIBSWSCALE_VERSION_INT  AV_VERSION_INT(LIBSWSCALE_VERSION_MAJOR, \
@@ -250,6 +250,12 @@ int sws_scale_ordered(struct SwsContext *context, const uint8_t* const src[],
 
 /**
  * @param inv_table the yuv2rgb coefficients, normally ff_yuv2rgb_coeffs[x]
+ * @param table     the rgb2yuv coefficients, normally ff_yuv2rgb_coeffs[x].
+ *                  For a YUV output, the output is converted from the
+ *                  inv_table to the table colorspace, this is supported
+ *                  for the SWS_CS_ITU709, SWS_CS_FCC, SWS_CS_ITU601 and
+ *                  SWS_CS_SMPTE240M coefficients, in MPEG range, with a
+ *                  yuv420p, yuv422p, yuv422p10 or uyvy422 output.
  * @return -1 if not supported
  */
 int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
@@ -294,6 +294,20 @@ typedef struct SwsContext {
     int dstColorspaceTable[4];
     int srcRange;                 ///< 0 = MPG YUV range, 1 = JPG YUV range (source      image).
     int dstRange;                 ///< 0 = MPG YUV range, 1 = JPG YUV range (destination image).
+    int yuv2yuv_matrix;           ///< 1 if the YUV output is converted with yuv2yuv_coeffs
+    int yuv2yuv_coeffs[6];        ///< source to destination YUV colorspace, scaled by 65536
+    /** yuv2yuv_coeffs split in hi * 65536 + lo, as (u, v) pairs of words */
+    DECLARE_ALIGNED(16, int16_t, yuv2yuv_lo)[3][8];
+    DECLARE_ALIGNED(16, int16_t, yuv2yuv_hi)[3][8];
+    /**
+     * Optional SIMD versions of the colorspace conversion of 8-bit output
+     * lines, for n chroma samples, n being a multiple of 8. The luma is
+     * converted before the chroma it uses.
+     */
+    void (*yuv2yuv_luma)(struct SwsContext *c, uint8_t *dst, const uint8_t *u,
+                         const uint8_t *v, int n);
+    void (*yuv2yuv_chroma)(struct SwsContext *c, uint8_t *u, uint8_t *v, int n);
+    void (*yuv2yuv_uyvy)(struct SwsContext *c, uint8_t *dst, int n);
     int yuv2rgb_y_offset;
     int yuv2rgb_y_coeff;
     int yuv2rgb_v2r_coeff;
@@ -678,7 +692,14 @@ void ff_swscale_get_unscaled_altivec(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+/**
+ * Converts the YUV output line y from the source to the destination
+ * colorspace. The chroma line is converted with the last luma line it covers.
+ */
+void ff_sws_yuv2yuv_matrix(SwsContext *c, uint8_t *dst[4], const int dstStride[4], int y);
+
 void ff_sws_init_swScale_altivec(SwsContext *c);
 void ff_sws_init_swScale_mmx(SwsContext *c);
+void ff_sws_init_yuv2yuv_mmx(SwsContext *c);
 
 #endif /* SWSCALE_SWSCALE_INTERNAL_H */
@@ -682,6 +682,19 @@ static int check_image_pointers(uint8_t *data[4], enum PixelFormat pix_fmt,
     return 1;
 }
 
+static int scale_slice(SwsContext *c, const uint8_t* src[], int srcStride[],
+                       int srcSliceY, int srcSliceH, uint8_t* dst[], int dstStride[])
+{
+    int y, ret = c->swScale(c, src, srcStride, srcSliceY, srcSliceH, dst, dstStride);
+
+    /* the generic scaler converts the colorspace of each line it outputs,
+       the unscaled converters output the lines of the slice */
+    if (c->yuv2yuv_matrix && !c->lumPixBuf)
+        for (y = srcSliceY; y < srcSliceY + ret; y++)
+            ff_sws_yuv2yuv_matrix(c, dst, dstStride, y);
+    return ret;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -791,7 +804,7 @@ int sws_scale(struct SwsContext *c, const uint8_t* const srcSlice[],
         if (srcSliceY + srcSliceH == c->srcH)
             c->sliceDir = 0;
 
-        return c->swScale(c, src2, srcStride2, srcSliceY, srcSliceH, dst2, dstStride2);
+        return scale_slice(c, src2, srcStride2, srcSliceY, srcSliceH, dst2, dstStride2);
     } else {
         // slices go from bottom to top => we flip the image internally
         int srcStride2[4]= {-srcStride[0], -srcStride[1], -srcStride[2], -srcStride[3]};
@@ -814,7 +827,7 @@ int sws_scale(struct SwsContext *c, const uint8_t* const srcSlice[],
         if (!srcSliceY)
             c->sliceDir = 0;
 
-        return c->swScale(c, src2, srcStride2, c->srcH-srcSliceY-srcSliceH, srcSliceH, dst2, dstStride2);
+        return scale_slice(c, src2, srcStride2, c->srcH-srcSliceY-srcSliceH, srcSliceH, dst2, dstStride2);
     }
 }
 
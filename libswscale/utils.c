@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include "config.h"
 #include <assert.h>
+#include <float.h>
 #if HAVE_SYS_MMAN_H
 #include <sys/mman.h>
 #if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
@@ -674,6 +675,106 @@ static void getSubSampleFactors(int *h, int *v, enum PixelFormat format)
     *v = av_pix_fmt_descriptors[format].log2_chroma_h;
 }
 
+#define NS(n) n < 0 ? (int)(n*65536.0-0.5+DBL_EPSILON) : (int)(n*65536.0+0.5)
+
+/* Y, U, V rows of (G, B, R) weights, same values and order as the
+ * colormatrix filter so that both give the same output */
+static const double yuv_coeff[4][3][3] = {
+    { { +0.7152, +0.0722, +0.2126 }, // Rec.709
+      { -0.3850, +0.5000, -0.1150 },
+      { -0.4540, -0.0460, +0.5000 } },
+    { { +0.5900, +0.1100, +0.3000 }, // FCC
+      { -0.3310, +0.5000, -0.1690 },
+      { -0.4210, -0.0790, +0.5000 } },
+    { { +0.5870, +0.1140, +0.2990 }, // Rec.601
+      { -0.3313, +0.5000, -0.1687 },
+      { -0.4187, -0.0813, +0.5000 } },
+    { { +0.7010, +0.0870, +0.2120 }, // SMPTE 240M
+      { -0.3840, +0.5000, -0.1160 },
+      { -0.4450, -0.0550, +0.5000 } },
+};
+
+static const int yuv_coeff_cs[4] = {
+    SWS_CS_ITU709, SWS_CS_FCC, SWS_CS_ITU601, SWS_CS_SMPTE240M
+};
+
+static int get_yuv_coeff_index(const int table[4])
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        if (!memcmp(table, ff_yuv2rgb_coeffs[yuv_coeff_cs[i]], sizeof(int)*4))
+            return i;
+    return -1;
+}
+
+static void init_yuv2yuv_coeffs(int coeffs[6], int src, int dst)
+{
+    const double (*m)[3] = yuv_coeff[src];
+    double im[3][3], det;
+    int i, j;
+
+    det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+          m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+          m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    det = 1.0 / det;
+    im[0][0] = det * (m[1][1] * m[2][2] - m[1][2] * m[2][1]);
+    im[0][1] = det * (m[0][2] * m[2][1] - m[0][1] * m[2][2]);
+    im[0][2] = det * (m[0][1] * m[1][2] - m[0][2] * m[1][1]);
+    im[1][0] = det * (m[1][2] * m[2][0] - m[1][0] * m[2][2]);
+    im[1][1] = det * (m[0][0] * m[2][2] - m[0][2] * m[2][0]);
+    im[1][2] = det * (m[0][2] * m[1][0] - m[0][0] * m[1][2]);
+    im[2][0] = det * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    im[2][1] = det * (m[0][1] * m[2][0] - m[0][0] * m[2][1]);
+    im[2][2] = det * (m[0][0] * m[1][1] - m[0][1] * m[1][0]);
+
+    for (i = 0; i < 3; i++) {
+        for (j = 1; j < 3; j++) {
+            const double *yuv = yuv_coeff[dst][i];
+            double v = yuv[0] * im[0][j] + yuv[1] * im[1][j] + yuv[2] * im[2][j];
+            coeffs[2*i + j - 1] = NS(v);
+        }
+    }
+}
+
+static int init_yuv2yuv_matrix(SwsContext *c, const int inv_table[4], int srcRange,
+                               const int table[4], int dstRange)
+{
+    int src = get_yuv_coeff_index(inv_table);
+    int dst = get_yuv_coeff_index(table);
+    int i, j;
+
+    c->yuv2yuv_matrix = 0;
+    if (src < 0 || dst < 0 || src == dst || srcRange || dstRange ||
+        !isYUV(c->srcFormat) || isGray(c->srcFormat))
+        return -1;
+    switch (c->dstFormat) {
+    case PIX_FMT_YUV420P:
+    case PIX_FMT_YUV422P:
+    case PIX_FMT_YUV422P10:
+    case PIX_FMT_UYVY422:
+        break;
+    default:
+        return -1;
+    }
+
+    init_yuv2yuv_coeffs(c->yuv2yuv_coeffs, src, dst);
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 8; j++) {
+            int coeff = c->yuv2yuv_coeffs[2*i + (j & 1)];
+            c->yuv2yuv_hi[i][j] = (coeff + 32768) >> 16;
+            c->yuv2yuv_lo[i][j] = coeff - c->yuv2yuv_hi[i][j] * 65536;
+        }
+    }
+    c->yuv2yuv_luma   = NULL;
+    c->yuv2yuv_chroma = NULL;
+    c->yuv2yuv_uyvy   = NULL;
+    if (HAVE_MMX)
+        ff_sws_init_yuv2yuv_mmx(c);
+    c->yuv2yuv_matrix = 1;
+    return 0;
+}
+
 int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
                              int srcRange, const int table[4], int dstRange,
                              int brightness, int contrast, int saturation)
@@ -686,7 +787,15 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     c->saturation= saturation;
     c->srcRange  = srcRange;
     c->dstRange  = dstRange;
-    if (isYUV(c->dstFormat) || isGray(c->dstFormat)) return -1;
+    if (isYUV(c->dstFormat) || isGray(c->dstFormat)) {
+        int matrix = c->yuv2yuv_matrix;
+        int ret = init_yuv2yuv_matrix(c, inv_table, srcRange, table, dstRange);
+
+        /* the output functions depend on the lines being read back */
+        if (c->lumPixBuf && c->yuv2yuv_matrix != matrix)
+            c->swScale = ff_getSwsFunc(c);
+        return ret;
+    }
 
     c->dstFormatBpp = av_get_bits_per_pixel(&av_pix_fmt_descriptors[c->dstFormat]);
     c->srcFormatBpp = av_get_bits_per_pixel(&av_pix_fmt_descriptors[c->srcFormat]);
@@ -703,7 +812,7 @@ int sws_getColorspaceDetails(struct SwsContext *c, int **inv_table,
                              int *srcRange, int **table, int *dstRange,
                              int *brightness, int *contrast, int *saturation)
 {
-    if (!c || isYUV(c->dstFormat) || isGray(c->dstFormat)) return -1;
+    if (!c || ((isYUV(c->dstFormat) || isGray(c->dstFormat)) && !c->yuv2yuv_matrix)) return -1;
 
     *inv_table = c->srcColorspaceTable;
     *table     = c->dstColorspaceTable;
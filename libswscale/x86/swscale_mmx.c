@@ -183,7 +183,9 @@ void ff_sws_init_swScale_mmx(SwsContext *c)
     if (cpu_flags & AV_CPU_FLAG_MMX)
         sws_init_swScale_MMX(c);
 #if HAVE_MMX2
-    if (cpu_flags & AV_CPU_FLAG_MMX2)
+    /* the MMX2 functions write the output lines with non-temporal stores,
+       which makes reading them back for the colorspace conversion slow */
+    if (cpu_flags & AV_CPU_FLAG_MMX2 && !c->yuv2yuv_matrix)
         sws_init_swScale_MMX2(c);
 #endif
 }
@@ -0,0 +1,173 @@
+/*
+ * YUV to YUV colorspace conversion of the output lines, SSE2 functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+
+#if HAVE_SSE
+/*
+ * u and v are interleaved in words and multiplied by both halves of the
+ * coefficients with pmaddwd, c * u = lo * u + (hi * u << 16), which gives
+ * exactly the sums of the C code.
+ */
+
+DECLARE_ASM_CONST(16, uint16_t, pw_128)[8] = {128, 128, 128, 128, 128, 128, 128, 128};
+DECLARE_ASM_CONST(16, uint16_t, pw_255)[8] = {255, 255, 255, 255, 255, 255, 255, 255};
+DECLARE_ASM_CONST(16, uint32_t, pd_round)[4]    = {32768, 32768, 32768, 32768};
+DECLARE_ASM_CONST(16, uint32_t, pd_round128)[4] = {8421376, 8421376, 8421376, 8421376};
+
+/* dst = (lo * uv + (hi * uv << 16) + round) >> 16, dwords, uses xmm7 */
+#define MATRIX(uv, dst, lo, hi, round)  \
+    "movdqa   "uv", "dst"           \n" \
+    "movdqa   "uv", %%xmm7          \n" \
+    "pmaddwd  "lo", "dst"           \n" \
+    "pmaddwd  "hi", %%xmm7          \n" \
+    "pslld      $16, %%xmm7         \n" \
+    "paddd   %%xmm7, "dst"          \n" \
+    "paddd "round", "dst"           \n" \
+    "psrad      $16, "dst"          \n"
+
+/* xmm0 = (u0, v0, ..., u3, v3), xmm1 = (u4, v4, ..., u7, v7) from 8 u and v bytes */
+#define LOAD_UV(u, v)                   \
+    "movq      ("u",%0), %%xmm0     \n" \
+    "movq      ("v",%0), %%xmm1     \n" \
+    "punpcklbw %%xmm6, %%xmm0       \n" \
+    "punpcklbw %%xmm6, %%xmm1       \n" \
+    "psubw   "MANGLE(pw_128)", %%xmm0 \n" \
+    "psubw   "MANGLE(pw_128)", %%xmm1 \n" \
+    "movdqa  %%xmm0, %%xmm2         \n" \
+    "punpcklwd %%xmm1, %%xmm0       \n" \
+    "punpckhwd %%xmm1, %%xmm2       \n" \
+    "movdqa  %%xmm2, %%xmm1         \n"
+
+static void yuv2yuv_luma_sse2(SwsContext *c, uint8_t *dst, const uint8_t *u,
+                              const uint8_t *v, int n)
+{
+    x86_reg x = -n;
+
+    __asm__ volatile(
+        "pxor      %%xmm6, %%xmm6       \n"
+        "1:                             \n"
+        LOAD_UV("%2", "%3")
+        MATRIX("%%xmm0", "%%xmm2", "%4", "%5", MANGLE(pd_round))
+        MATRIX("%%xmm1", "%%xmm3", "%4", "%5", MANGLE(pd_round))
+        "packssdw  %%xmm3, %%xmm2       \n"
+        "movdqa    %%xmm2, %%xmm3       \n"
+        "punpcklwd %%xmm2, %%xmm2       \n"
+        "punpckhwd %%xmm3, %%xmm3       \n"
+        "movdqu (%1,%0,2), %%xmm4       \n"
+        "movdqa    %%xmm4, %%xmm5       \n"
+        "punpcklbw %%xmm6, %%xmm4       \n"
+        "punpckhbw %%xmm6, %%xmm5       \n"
+        "paddw     %%xmm2, %%xmm4       \n"
+        "paddw     %%xmm3, %%xmm5       \n"
+        "packuswb  %%xmm5, %%xmm4       \n"
+        "movdqu    %%xmm4, (%1,%0,2)    \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(dst + 2 * n), "r"(u + n), "r"(v + n),
+         "m"(c->yuv2yuv_lo[0][0]), "m"(c->yuv2yuv_hi[0][0])
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+static void yuv2yuv_chroma_sse2(SwsContext *c, uint8_t *u, uint8_t *v, int n)
+{
+    x86_reg x = -n;
+
+    __asm__ volatile(
+        "pxor      %%xmm6, %%xmm6       \n"
+        "1:                             \n"
+        LOAD_UV("%1", "%2")
+        MATRIX("%%xmm0", "%%xmm2", "%3", "%4", MANGLE(pd_round128))
+        MATRIX("%%xmm1", "%%xmm3", "%3", "%4", MANGLE(pd_round128))
+        "packssdw  %%xmm3, %%xmm2       \n"
+        MATRIX("%%xmm0", "%%xmm4", "%5", "%6", MANGLE(pd_round128))
+        MATRIX("%%xmm1", "%%xmm3", "%5", "%6", MANGLE(pd_round128))
+        "packssdw  %%xmm3, %%xmm4       \n"
+        "packuswb  %%xmm2, %%xmm2       \n"
+        "packuswb  %%xmm4, %%xmm4       \n"
+        "movq      %%xmm2, (%1,%0)      \n"
+        "movq      %%xmm4, (%2,%0)      \n"
+        "add           $8, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(u + n), "r"(v + n),
+         "m"(c->yuv2yuv_lo[1][0]), "m"(c->yuv2yuv_hi[1][0]),
+         "m"(c->yuv2yuv_lo[2][0]), "m"(c->yuv2yuv_hi[2][0])
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+static void yuv2yuv_uyvy_sse2(SwsContext *c, uint8_t *dst, int n)
+{
+    x86_reg x = -n;
+
+    __asm__ volatile(
+        "1:                             \n"
+        "movdqu (%1,%0,4), %%xmm0       \n" // U0 Y0 V0 Y1 U1 Y2 V1 Y3 ...
+        "movdqa    %%xmm0, %%xmm5       \n"
+        "pand    "MANGLE(pw_255)", %%xmm0 \n" // u0 v0 u1 v1 ... in words
+        "psrlw         $8, %%xmm5       \n" // y0 y1 y2 y3 ... in words
+        "psubw   "MANGLE(pw_128)", %%xmm0 \n"
+        MATRIX("%%xmm0", "%%xmm1", "%2", "%3", MANGLE(pd_round))
+        MATRIX("%%xmm0", "%%xmm2", "%4", "%5", MANGLE(pd_round128))
+        MATRIX("%%xmm0", "%%xmm4", "%6", "%7", MANGLE(pd_round128))
+        "packssdw  %%xmm1, %%xmm1       \n"
+        "punpcklwd %%xmm1, %%xmm1       \n"
+        "paddw     %%xmm1, %%xmm5       \n"
+        "packssdw  %%xmm2, %%xmm2       \n"
+        "packssdw  %%xmm4, %%xmm4       \n"
+        "punpcklwd %%xmm4, %%xmm2       \n" // u'0 v'0 u'1 v'1 ...
+        "packuswb  %%xmm2, %%xmm2       \n"
+        "packuswb  %%xmm5, %%xmm5       \n"
+        "punpcklbw %%xmm5, %%xmm2       \n"
+        "movdqu    %%xmm2, (%1,%0,4)    \n"
+        "add           $4, %0           \n"
+        "jl 1b                          \n"
+        :"+&r"(x)
+        :"r"(dst + 4 * n),
+         "m"(c->yuv2yuv_lo[0][0]), "m"(c->yuv2yuv_hi[0][0]),
+         "m"(c->yuv2yuv_lo[1][0]), "m"(c->yuv2yuv_hi[1][0]),
+         "m"(c->yuv2yuv_lo[2][0]), "m"(c->yuv2yuv_hi[2][0])
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm4", "%xmm5", "%xmm7",)
+         "memory"
+    );
+}
+#endif /* HAVE_SSE */
+
+void ff_sws_init_yuv2yuv_mmx(SwsContext *c)
+{
+#if HAVE_SSE
+    if (av_get_cpu_flags() & AV_CPU_FLAG_SSE2) {
+        c->yuv2yuv_luma   = yuv2yuv_luma_sse2;
+        c->yuv2yuv_chroma = yuv2yuv_chroma_sse2;
+        c->yuv2yuv_uyvy   = yuv2yuv_uyvy_sse2;
+    }
+#endif
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavutil/cpu.h"
+#include "libavfilter/drawutils.h"
+#include "checkasm.h"
+
+#define MAX_WIDTH 1000
+
+static const int widths[] = { 1, 7, 8, 9, 16, 17, 100, 361, MAX_WIDTH };
+
+static uint8_t  src[2 * MAX_WIDTH], alpha[MAX_WIDTH], dst8[MAX_WIDTH];
+static uint16_t dst16[MAX_WIDTH];
+
+/* alpha with transparent and opaque runs, which the functions skip or copy */
+static void fill(void)
+{
+    int j;
+
+    for (j = 0; j < 2 * MAX_WIDTH; j++)
+        src[j] = rnd();
+    for (j = 0; j < MAX_WIDTH; j++) {
+        unsigned r = rnd();
+        alpha[j] = (j / 11) % 3 == 0 ? 0 : (j / 11) % 3 == 1 ? r : 255;
+        dst8[j]  = r >> 8;
+        dst16[j] = r >> 16;
+    }
+}
+
+static void check_blend_line(FFBlendDSPContext *c)
+{
+    uint8_t dst0[MAX_WIDTH], dst1[MAX_WIDTH];
+    int i, bias;
+
+    {
+        declare_func(void, uint8_t *, const uint8_t *, const uint8_t *, int);
+
+        if (check_func(c->blend_line, "blend_line")) {
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                fill();
+                memcpy(dst0, dst8, sizeof(dst0));
+                memcpy(dst1, dst8, sizeof(dst1));
+                call_ref(dst0, src, alpha, widths[i]);
+                call_new(dst1, src, alpha, widths[i]);
+                if (memcmp(dst0, dst1, sizeof(dst0)))
+                    fail();
+            }
+            bench_new(dst1, src, alpha, MAX_WIDTH);
+        }
+    }
+    {
+        declare_func(void, uint8_t *, const uint8_t *, const uint8_t *, int, int);
+
+        if (check_func(c->blend_line_premul, "blend_line_premul")) {
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                for (bias = 0; bias <= 128; bias += 128) {
+                    fill();
+                    memcpy(dst0, dst8, sizeof(dst0));
+                    memcpy(dst1, dst8, sizeof(dst1));
+                    call_ref(dst0, src, alpha, widths[i], bias);
+                    call_new(dst1, src, alpha, widths[i], bias);
+                    if (memcmp(dst0, dst1, sizeof(dst0)))
+                        fail();
+                }
+            }
+            bench_new(dst1, src, alpha, MAX_WIDTH, 128);
+        }
+    }
+}
+
+static void check_blend_line16(FFBlendDSPContext *c)
+{
+    uint16_t dst0[MAX_WIDTH], dst1[MAX_WIDTH];
+    int i, j, shift, bias;
+
+    {
+        declare_func(void, uint16_t *, const uint8_t *, const uint8_t *, int, int);
+
+        if (check_func(c->blend_line16, "blend_line16")) {
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                for (shift = 2; shift <= 8; shift += 6) {
+                    fill();
+                    for (j = 0; j < MAX_WIDTH; j++)
+                        dst0[j] = dst1[j] = dst16[j] >> (8 - shift);
+                    call_ref(dst0, src, alpha, widths[i], shift);
+                    call_new(dst1, src, alpha, widths[i], shift);
+                    if (memcmp(dst0, dst1, sizeof(dst0)))
+                        fail();
+                }
+            }
+            bench_new(dst1, src, alpha, MAX_WIDTH, 2);
+        }
+    }
+    {
+        declare_func(void, uint16_t *, const uint8_t *, const uint8_t *, int, int, int);
+
+        if (check_func(c->blend_line16_premul, "blend_line16_premul")) {
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                for (shift = 2; shift <= 8; shift += 6) {
+                    for (bias = 0; bias <= 128 << shift; bias += 128 << shift) {
+                        fill();
+                        for (j = 0; j < MAX_WIDTH; j++)
+                            dst0[j] = dst1[j] = dst16[j] >> (8 - shift);
+                        call_ref(dst0, src, alpha, widths[i], shift, bias);
+                        call_new(dst1, src, alpha, widths[i], shift, bias);
+                        if (memcmp(dst0, dst1, sizeof(dst0)))
+                            fail();
+                    }
+                }
+            }
+            bench_new(dst1, src, alpha, MAX_WIDTH, 2, 128 << 2);
+        }
+    }
+}
+
+static void check_alpha_line(FFBlendDSPContext *c)
+{
+    uint8_t dst0[MAX_WIDTH], dst1[MAX_WIDTH];
+    int i, hsub, vsub, scale;
+    declare_func(void, uint8_t *, const uint8_t *, int, int, int, int, int);
+
+    for (hsub = 0; hsub <= 2; hsub++) {
+        for (vsub = 0; vsub <= 1; vsub++) {
+            if (check_func(c->alpha_line, "alpha_line_%dx%d", 1 << hsub, 1 << vsub)) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    int w = widths[i];
+                    if (w << hsub > MAX_WIDTH)
+                        continue;
+                    for (scale = 0; scale < 2; scale++) {
+                        fill();
+                        memset(dst0, 0, sizeof(dst0));
+                        memset(dst1, 0, sizeof(dst1));
+                        call_ref(dst0, src, MAX_WIDTH, w, hsub, vsub, scale ? i * 28 : 255);
+                        call_new(dst1, src, MAX_WIDTH, w, hsub, vsub, scale ? i * 28 : 255);
+                        if (memcmp(dst0, dst1, sizeof(dst0)))
+                            fail();
+                    }
+                }
+                bench_new(dst1, src, MAX_WIDTH, MAX_WIDTH >> hsub, hsub, vsub, 255);
+            }
+        }
+    }
+}
+
+void checkasm_check_blend(void)
+{
+    FFBlendDSPContext c;
+
+    ff_blend_init_dsp(&c, av_get_cpu_flags());
+    check_blend_line(&c);
+    check_blend_line16(&c);
+    check_alpha_line(&c);
+}
@@ -0,0 +1,276 @@
+/*
+ * Assembly testing and benchmarking tool
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Compare every optimized DSP function with its C version on random
+ * input, once per CPU flag level, and optionally time both.
+ *
+ * usage: checkasm [--bench] [--seed=<n>] [test]
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
+#include "libavutil/random_seed.h"
+#include "checkasm.h"
+
+#undef printf
+#undef fprintf
+
+static const struct {
+    const char *name;
+    void (*func)(void);
+} tests[] = {
+#if CONFIG_AVFILTER
+    { "blend", checkasm_check_blend },
+#endif
+#if CONFIG_COLORMATRIX_FILTER
+    { "colormatrix", checkasm_check_colormatrix },
+#endif
+#if CONFIG_DPXDSP
+    { "dpxdsp", checkasm_check_dpxdsp },
+#endif
+    { "dsputil", checkasm_check_dsputil },
+#if CONFIG_DVVIDEO_ENCODER
+    { "dvencdsp", checkasm_check_dvencdsp },
+#endif
+#if CONFIG_GRADFUN_FILTER
+    { "gradfun", checkasm_check_gradfun },
+#endif
+#if CONFIG_H264DSP
+    { "h264dsp", checkasm_check_h264dsp },
+#endif
+#if CONFIG_JPEG2000_DECODER
+    { "j2k_dwt", checkasm_check_j2k_dwt },
+#endif
+#if CONFIG_V210_DECODER
+    { "v210dec", checkasm_check_v210dec },
+#endif
+#if CONFIG_VP8_DECODER
+    { "vp8dsp",  checkasm_check_vp8dsp  },
+#endif
+#if CONFIG_W3FDIF_FILTER
+    { "w3fdif", checkasm_check_w3fdif },
+#endif
+#if CONFIG_YADIF_FILTER
+    { "yadif",   checkasm_check_yadif   },
+#endif
+};
+
+/* levels are cumulative, the flags of a level the CPU lacks are skipped */
+static const struct {
+    const char *suffix;
+    int flags;
+} cpus[] = {
+    { "c",        0 },
+#if ARCH_X86
+    { "mmx",      AV_CPU_FLAG_MMX },
+    { "mmx2",     AV_CPU_FLAG_MMX2 },
+    { "3dnow",    AV_CPU_FLAG_3DNOW },
+    { "3dnowext", AV_CPU_FLAG_3DNOWEXT },
+    { "sse",      AV_CPU_FLAG_SSE },
+    { "sse2",     AV_CPU_FLAG_SSE2 | AV_CPU_FLAG_SSE2SLOW },
+    { "sse3",     AV_CPU_FLAG_SSE3 | AV_CPU_FLAG_SSE3SLOW },
+    { "ssse3",    AV_CPU_FLAG_SSSE3 | AV_CPU_FLAG_ATOM },
+    { "sse4",     AV_CPU_FLAG_SSE4 },
+    { "sse42",    AV_CPU_FLAG_SSE42 },
+    { "avx",      AV_CPU_FLAG_AVX },
+#endif
+};
+
+typedef struct CheckasmFunc {
+    char *name;
+    void *ref;              ///< C version
+    void *last;             ///< last version compared with the C one
+    struct CheckasmFunc *next;
+} CheckasmFunc;
+
+AVLFG checkasm_lfg;
+
+static struct {
+    CheckasmFunc *funcs;
+    CheckasmFunc *current;
+    const char *test_name;
+    const char *cpu_suffix;
+    int cpu_index;
+    int bench;
+    int num_checked;
+    int num_failed;
+    int current_failed;
+} state;
+
+static void report_current(void)
+{
+    if (!state.current || state.current_failed)
+        return;
+    fprintf(stderr, " %-28s %-8s OK\n", state.current->name, state.cpu_suffix);
+}
+
+void *checkasm_check_func(void *func, const char *name, ...)
+{
+    char buf[256];
+    CheckasmFunc *f;
+    va_list arg;
+
+    va_start(arg, name);
+    vsnprintf(buf, sizeof(buf), name, arg);
+    va_end(arg);
+
+    report_current();
+    state.current        = NULL;
+    state.current_failed = 0;
+
+    for (f = state.funcs; f; f = f->next)
+        if (!strcmp(f->name, buf))
+            break;
+
+    if (!f) {
+        /* the first version seen is the reference one, with no flags */
+        if (state.cpu_index || !func)
+            return NULL;
+        f = av_mallocz(sizeof(*f));
+        if (!f || !(f->name = av_strdup(buf))) {
+            fprintf(stderr, "checkasm: out of memory\n");
+            exit(1);
+        }
+        f->ref  = func;
+        f->last = func;
+        f->next = state.funcs;
+        state.funcs = f;
+        return NULL;
+    }
+
+    if (!func || func == f->last)
+        return NULL;
+    f->last = func;
+    state.current = f;
+    state.num_checked++;
+    return f->ref;
+}
+
+void checkasm_fail_func(const char *msg, ...)
+{
+    va_list arg;
+
+    if (!state.current || state.current_failed)
+        return;
+    state.current_failed = 1;
+    state.num_failed++;
+
+    fprintf(stderr, " %-28s %-8s FAILED (", state.current->name, state.cpu_suffix);
+    va_start(arg, msg);
+    vfprintf(stderr, msg, arg);
+    va_end(arg);
+    fprintf(stderr, ")\n");
+}
+
+int checkasm_bench_enabled(void)
+{
+#ifdef AV_READ_TIME
+    return state.bench && state.current && !state.current_failed;
+#else
+    return 0;
+#endif
+}
+
+void checkasm_update_bench(uint64_t cycles_ref, uint64_t cycles_new)
+{
+    fprintf(stderr, " %-28s %-8s %8"PRIu64" cycles, c %8"PRIu64", %5.2fx\n",
+            state.current->name, state.cpu_suffix, cycles_new, cycles_ref,
+            cycles_new ? (double)cycles_ref / cycles_new : 0.0);
+    /* printed along with the timing */
+    state.current_failed = -1;
+}
+
+int checkasm_float_near(const float *a, const float *b, int len, float eps)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        float d = fabsf(a[i] - b[i]);
+        if (!(d <= eps * FFMAX(1.0f, fabsf(a[i]))))
+            return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *only = NULL;
+    unsigned seed = av_get_random_seed();
+    int cpu_flags = av_get_cpu_flags();
+    int flags = 0, i, j;
+    CheckasmFunc *f;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench")) {
+            state.bench = 1;
+        } else if (!strncmp(argv[i], "--seed=", 7)) {
+            seed = strtoul(argv[i] + 7, NULL, 10);
+        } else if (argv[i][0] != '-') {
+            only = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [--bench] [--seed=<n>] [test]\n", argv[0]);
+            return 1;
+        }
+    }
+    fprintf(stderr, "checkasm: seed %u\n", seed);
+
+    /* the C versions clip through the tables set up there */
+    avcodec_init();
+
+    for (i = 0; i < FF_ARRAY_ELEMS(cpus); i++) {
+        if (cpus[i].flags && !(cpu_flags & cpus[i].flags))
+            continue;
+        flags |= cpus[i].flags & cpu_flags;
+        av_force_cpu_flags(flags);
+        state.cpu_index  = i;
+        state.cpu_suffix = cpus[i].suffix;
+
+        for (j = 0; j < FF_ARRAY_ELEMS(tests); j++) {
+            if (only && strcmp(only, tests[j].name))
+                continue;
+            /* the same input for each level */
+            av_lfg_init(&checkasm_lfg, seed);
+            state.test_name = tests[j].name;
+            tests[j].func();
+            report_current();
+            state.current = NULL;
+        }
+    }
+    av_force_cpu_flags(cpu_flags);
+
+    while ((f = state.funcs)) {
+        state.funcs = f->next;
+        av_free(f->name);
+        av_free(f);
+    }
+
+    fprintf(stderr, "checkasm: %d of %d functions failed\n",
+            state.num_failed, state.num_checked);
+    printf("checkasm: %s\n", state.num_failed ? "FAILED" : "OK");
+    return !!state.num_failed;
+}
@@ -0,0 +1,111 @@
+/*
+ * Assembly testing and benchmarking tool
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef TESTS_CHECKASM_CHECKASM_H
+#define TESTS_CHECKASM_CHECKASM_H
+
+#include <stdint.h>
+#include "config.h"
+#include "libavutil/common.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/timer.h"
+
+/**
+ * Every test is run once per CPU flag level, starting with no flags. The
+ * checks of a test call check_func() for each function pointer of the
+ * context they initialized: the first level records the C version, and
+ * at the next levels check_func() returns nonzero when the pointer changed,
+ * so that every optimized version is compared against C exactly once.
+ */
+void checkasm_check_blend(void);
+void checkasm_check_colormatrix(void);
+void checkasm_check_dpxdsp(void);
+void checkasm_check_dsputil(void);
+void checkasm_check_dvencdsp(void);
+void checkasm_check_gradfun(void);
+void checkasm_check_h264dsp(void);
+void checkasm_check_j2k_dwt(void);
+void checkasm_check_v210dec(void);
+void checkasm_check_vp8dsp(void);
+void checkasm_check_w3fdif(void);
+void checkasm_check_yadif(void);
+
+extern AVLFG checkasm_lfg;
+#define rnd() av_lfg_get(&checkasm_lfg)
+
+void *checkasm_check_func(void *func, const char *name, ...) av_printf_format(2, 3);
+void checkasm_fail_func(const char *msg, ...) av_printf_format(1, 2);
+int checkasm_bench_enabled(void);
+void checkasm_update_bench(uint64_t cycles_ref, uint64_t cycles_new);
+
+/** compare float arrays, allowing for a different order of operations */
+int checkasm_float_near(const float *a, const float *b, int len, float eps);
+
+/**
+ * Declare the prototype of the checked functions. The arguments are
+ * the return type and the parameter types.
+ */
+#define declare_func(ret, ...)                                          \
+    void *func_ref, *func_new;                                          \
+    typedef ret func_type(__VA_ARGS__)
+
+/** nonzero if func has to be checked, the name is a printf format */
+#define check_func(func, ...)                                           \
+    (func_ref = checkasm_check_func((void *)(func_new = (void *)(func)), __VA_ARGS__))
+
+#define call_ref(...) ((func_type *)func_ref)(__VA_ARGS__)
+#define call_new(...) ((func_type *)func_new)(__VA_ARGS__)
+
+#define fail() checkasm_fail_func("%s:%d", __FILE__, __LINE__)
+
+#ifdef AV_READ_TIME
+#define checkasm_gettime() AV_READ_TIME()
+#else
+#define checkasm_gettime() 0
+#endif
+
+#define BENCH_RUNS 256
+
+#define BENCH_LOOP(best, call)                                          \
+    do {                                                                \
+        int ti;                                                         \
+        best = UINT64_MAX;                                              \
+        for (ti = 0; ti < BENCH_RUNS; ti++) {                           \
+            uint64_t t = checkasm_gettime();                            \
+            call; call; call; call;                                     \
+            t = checkasm_gettime() - t;                                 \
+            best = FFMIN(best, t);                                      \
+        }                                                               \
+        best /= 4;                                                      \
+    } while (0)
+
+/** time the C and the optimized function with the same arguments */
+#define bench_new(...)                                                  \
+    do {                                                                \
+        if (checkasm_bench_enabled()) {                                 \
+            uint64_t tref, tnew;                                        \
+            BENCH_LOOP(tref, call_ref(__VA_ARGS__));                    \
+            BENCH_LOOP(tnew, call_new(__VA_ARGS__));                    \
+            checkasm_update_bench(tref, tnew);                          \
+        }                                                               \
+    } while (0)
+
+#endif /* TESTS_CHECKASM_CHECKASM_H */
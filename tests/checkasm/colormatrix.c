@@ -0,0 +1,156 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavutil/cpu.h"
+#include "libavfilter/colormatrix.h"
+#include "checkasm.h"
+
+#define MAX_WIDTH 1930
+
+/* bt709 -> bt601 and bt601 -> bt709 as computed by vf_colormatrix.c,
+   the other sets are random coefficients between -2 and 2 */
+#define NB_COEFFS 8
+static const int coeffs[2][6] = {
+    {  6662,  12857, 64874, -7191, -4727, 64449 },
+    { -7745, -13938, 66747,  7447,  4895, 67188 },
+};
+
+static const int widths[] = { 1, 3, 7, 8, 9, 16, 17, 360, 961, MAX_WIDTH / 2 };
+
+static uint16_t src[3][MAX_WIDTH];
+
+static void fill(int depth)
+{
+    int i, j;
+
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < MAX_WIDTH; j++)
+            src[i][j] = depth > 8 ? rnd() & 1023 : rnd();
+}
+
+static void init_coeffs(ColorMatrixCoeffs *cm, int n)
+{
+    int c[6], i;
+
+    if (n < 2) {
+        ff_colormatrix_init_coeffs(cm, coeffs[n]);
+        return;
+    }
+    for (i = 0; i < 6; i++)
+        c[i] = (int)(rnd() % (4 << 16)) - (2 << 16);
+    ff_colormatrix_init_coeffs(cm, c);
+}
+
+static void check_luma(void (*func)(uint8_t *, const uint8_t *, const uint8_t *,
+                                    const uint8_t *, int, const ColorMatrixCoeffs *),
+                       const char *name, int depth)
+{
+    uint16_t dst0[MAX_WIDTH + 8], dst1[MAX_WIDTH + 8];
+    ColorMatrixCoeffs cm;
+    int i, n;
+    declare_func(void, uint8_t *, const uint8_t *, const uint8_t *, const uint8_t *,
+                 int, const ColorMatrixCoeffs *);
+
+    if (check_func(func, "colormatrix_%s", name)) {
+        for (n = 0; n < NB_COEFFS; n++) {
+            init_coeffs(&cm, n);
+            fill(depth);
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                memset(dst0, 0x55, sizeof(dst0));
+                memset(dst1, 0x55, sizeof(dst1));
+                call_ref((uint8_t *)dst0, (uint8_t *)src[0], (uint8_t *)src[1],
+                         (uint8_t *)src[2], widths[i], &cm);
+                call_new((uint8_t *)dst1, (uint8_t *)src[0], (uint8_t *)src[1],
+                         (uint8_t *)src[2], widths[i], &cm);
+                if (memcmp(dst0, dst1, sizeof(dst0)))
+                    fail();
+            }
+        }
+        bench_new((uint8_t *)dst1, (uint8_t *)src[0], (uint8_t *)src[1],
+                  (uint8_t *)src[2], 960, &cm);
+    }
+}
+
+static void check_chroma(void (*func)(uint8_t *, uint8_t *, const uint8_t *,
+                                      const uint8_t *, int, const ColorMatrixCoeffs *),
+                         const char *name, int depth)
+{
+    uint16_t dst0[2][MAX_WIDTH + 8], dst1[2][MAX_WIDTH + 8];
+    ColorMatrixCoeffs cm;
+    int i, n;
+    declare_func(void, uint8_t *, uint8_t *, const uint8_t *, const uint8_t *,
+                 int, const ColorMatrixCoeffs *);
+
+    if (check_func(func, "colormatrix_%s", name)) {
+        for (n = 0; n < NB_COEFFS; n++) {
+            init_coeffs(&cm, n);
+            fill(depth);
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                memset(dst0, 0x55, sizeof(dst0));
+                memset(dst1, 0x55, sizeof(dst1));
+                call_ref((uint8_t *)dst0[0], (uint8_t *)dst0[1], (uint8_t *)src[1],
+                         (uint8_t *)src[2], widths[i], &cm);
+                call_new((uint8_t *)dst1[0], (uint8_t *)dst1[1], (uint8_t *)src[1],
+                         (uint8_t *)src[2], widths[i], &cm);
+                if (memcmp(dst0, dst1, sizeof(dst0)))
+                    fail();
+            }
+        }
+        bench_new((uint8_t *)dst1[0], (uint8_t *)dst1[1], (uint8_t *)src[1],
+                  (uint8_t *)src[2], 960, &cm);
+    }
+}
+
+static void check_uyvy(void (*func)(uint8_t *, const uint8_t *, int,
+                                    const ColorMatrixCoeffs *))
+{
+    uint16_t dst0[MAX_WIDTH + 8], dst1[MAX_WIDTH + 8];
+    ColorMatrixCoeffs cm;
+    int i, n;
+    declare_func(void, uint8_t *, const uint8_t *, int, const ColorMatrixCoeffs *);
+
+    if (check_func(func, "colormatrix_uyvy_line")) {
+        for (n = 0; n < NB_COEFFS; n++) {
+            init_coeffs(&cm, n);
+            fill(8);
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                memset(dst0, 0x55, sizeof(dst0));
+                memset(dst1, 0x55, sizeof(dst1));
+                call_ref((uint8_t *)dst0, (uint8_t *)src[0], widths[i], &cm);
+                call_new((uint8_t *)dst1, (uint8_t *)src[0], widths[i], &cm);
+                if (memcmp(dst0, dst1, sizeof(dst0)))
+                    fail();
+            }
+        }
+        bench_new((uint8_t *)dst1, (uint8_t *)src[0], 960, &cm);
+    }
+}
+
+void checkasm_check_colormatrix(void)
+{
+    ColorMatrixDSPContext c;
+
+    ff_colormatrix_init_dsp(&c, av_get_cpu_flags());
+    check_luma  (c.luma_line,     "luma_line",     8);
+    check_chroma(c.chroma_line,   "chroma_line",   8);
+    check_uyvy  (c.uyvy_line);
+    check_luma  (c.luma10_line,   "luma10_line",   10);
+    check_chroma(c.chroma10_line, "chroma10_line", 10);
+}
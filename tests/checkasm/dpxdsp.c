@@ -0,0 +1,186 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavutil/cpu.h"
+#include "libavcodec/dpxdsp.h"
+#include "checkasm.h"
+
+#define MAX_WIDTH 4099
+
+static const int widths[] = { 1, 3, 4, 7, 8, 9, 16, 17, 720, 2048, MAX_WIDTH };
+
+static uint8_t  src[MAX_WIDTH * 8 + 16];
+static uint16_t src_planes[3][MAX_WIDTH];
+static uint16_t dst0[3][MAX_WIDTH * 3 + 8];
+static uint16_t dst1[3][MAX_WIDTH * 3 + 8];
+
+static void fill(void)
+{
+    int i, j;
+
+    for (i = 0; i < sizeof(src); i++)
+        src[i] = rnd();
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < MAX_WIDTH; j++)
+            src_planes[i][j] = rnd();
+    memset(dst0, 0x55, sizeof(dst0));
+    memset(dst1, 0x55, sizeof(dst1));
+}
+
+static void check_unpack(DPXDSPContext *c)
+{
+    int i, j, k;
+
+    for (j = 0; j < 2; j++) {
+        for (k = 0; k < 2; k++) {
+            declare_func(void, uint16_t *, const uint8_t *, int);
+
+            if (check_func(c->unpack10[j][k], "dpx_unpack10_%s%s", j ? "b" : "a", k ? "_be" : "_le")) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    fill();
+                    call_ref(dst0[0], src, widths[i]);
+                    call_new(dst1[0], src, widths[i]);
+                    if (memcmp(dst0, dst1, sizeof(dst0)))
+                        fail();
+                }
+                bench_new(dst1[0], src, 2048);
+            }
+        }
+        {
+            declare_func(void, uint16_t *, const uint8_t *, int);
+
+            if (check_func(c->unpack12b[j], "dpx_unpack12b%s", j ? "_be" : "_le")) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    fill();
+                    call_ref(dst0[0], src, 3 * widths[i]);
+                    call_new(dst1[0], src, 3 * widths[i]);
+                    if (memcmp(dst0, dst1, sizeof(dst0)))
+                        fail();
+                }
+                bench_new(dst1[0], src, 3 * 2048);
+            }
+        }
+    }
+}
+
+static void check_unpack_planar(DPXDSPContext *c)
+{
+    int i, j, k;
+    declare_func(void, uint16_t *, uint16_t *, uint16_t *, const uint8_t *, int);
+
+    for (j = 0; j < 2; j++) {
+        for (k = 0; k < 2; k++) {
+            if (check_func(c->unpack10_planar[j][k], "dpx_unpack10_planar_%s%s",
+                           j ? "b" : "a", k ? "_be" : "_le")) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    fill();
+                    call_ref(dst0[0], dst0[1], dst0[2], src, widths[i]);
+                    call_new(dst1[0], dst1[1], dst1[2], src, widths[i]);
+                    if (memcmp(dst0, dst1, sizeof(dst0)))
+                        fail();
+                }
+                bench_new(dst1[0], dst1[1], dst1[2], src, 2048);
+            }
+            if (check_func(c->unpack10_422[j][k], "dpx_unpack10_422_%s%s",
+                           j ? "b" : "a", k ? "_be" : "_le")) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    fill();
+                    call_ref(dst0[0], dst0[1], dst0[2], src, widths[i]);
+                    call_new(dst1[0], dst1[1], dst1[2], src, widths[i]);
+                    if (memcmp(dst0, dst1, sizeof(dst0)))
+                        fail();
+                }
+                bench_new(dst1[0], dst1[1], dst1[2], src, 2048);
+            }
+        }
+    }
+}
+
+/* unpacking the 4:2:2 planes just packed must give the 10-bit samples back */
+static int round_trip_422(DPXDSPContext *c, int be, uint8_t *packed, int w)
+{
+    static uint16_t planes[3][MAX_WIDTH];
+    int j, p;
+
+    c->unpack10_422[0][be](planes[0], planes[1], planes[2], packed, w);
+    for (p = 0; p < 3; p++)
+        for (j = 0; j < (p ? w / 2 : w); j++)
+            if (planes[p][j] != (src_planes[p][j] & 0x3ff))
+                return 0;
+    return 1;
+}
+
+static void check_pack(DPXDSPContext *c)
+{
+    int i, j, k;
+
+    for (j = 0; j < 2; j++) {
+        for (k = 0; k < 2; k++) {
+            declare_func(void, uint8_t *, const uint8_t *, int);
+
+            if (check_func(c->pack10[j][k], "dpx_pack10%s%s", j ? "_be" : "_le", k ? "_be" : "_le")) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    fill();
+                    call_ref((uint8_t *)dst0[0], src, widths[i]);
+                    call_new((uint8_t *)dst1[0], src, widths[i]);
+                    if (memcmp(dst0, dst1, sizeof(dst0)))
+                        fail();
+                }
+                bench_new((uint8_t *)dst1[0], src, 2048);
+            }
+        }
+        {
+            declare_func(void, uint8_t *, const uint16_t *, const uint16_t *,
+                         const uint16_t *, int);
+
+            if (check_func(c->pack10_planar[j], "dpx_pack10_planar%s", j ? "_be" : "_le")) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    fill();
+                    call_ref((uint8_t *)dst0[0], src_planes[0], src_planes[1], src_planes[2], widths[i]);
+                    call_new((uint8_t *)dst1[0], src_planes[0], src_planes[1], src_planes[2], widths[i]);
+                    if (memcmp(dst0, dst1, sizeof(dst0)))
+                        fail();
+                }
+                bench_new((uint8_t *)dst1[0], src_planes[0], src_planes[1], src_planes[2], 2048);
+            }
+            if (check_func(c->pack10_422[j], "dpx_pack10_422%s", j ? "_be" : "_le")) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    fill();
+                    call_ref((uint8_t *)dst0[0], src_planes[0], src_planes[1], src_planes[2], widths[i]);
+                    call_new((uint8_t *)dst1[0], src_planes[0], src_planes[1], src_planes[2], widths[i]);
+                    if (memcmp(dst0, dst1, sizeof(dst0)) ||
+                        !round_trip_422(c, j, (uint8_t *)dst1[0], widths[i] & ~1))
+                        fail();
+                }
+                bench_new((uint8_t *)dst1[0], src_planes[0], src_planes[1], src_planes[2], 2048);
+            }
+        }
+    }
+}
+
+void checkasm_check_dpxdsp(void)
+{
+    DPXDSPContext c;
+
+    ff_dpxdsp_init(&c, av_get_cpu_flags());
+    check_unpack(&c);
+    check_unpack_planar(&c);
+    check_pack(&c);
+}
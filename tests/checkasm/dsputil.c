@@ -0,0 +1,524 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavcodec/avcodec.h"
+#include "libavcodec/dsputil.h"
+#include "checkasm.h"
+
+#define STRIDE   64
+#define BUF_SIZE (STRIDE * 40)
+/* room for the taps above and left of a block, aligned like a block */
+#define OFFSET   (STRIDE * 8 + 16)
+
+static const int sizes[4] = { 16, 8, 4, 2 };
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+static void randomize_block(DCTELEM *block, int size, int range)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        block[i] = (int)(rnd() % (2 * range)) - range;
+}
+
+static void randomize_float(float *buf, int size)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        buf[i] = (int)(rnd() & 0xffff) / 256.0f - 128.0f;
+}
+
+static void check_pixels(op_pixels_func (*ref)[4], const char *name)
+{
+    DECLARE_ALIGNED(16, uint8_t, src)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst1)[BUF_SIZE];
+    int i, j;
+    declare_func(void, uint8_t *, const uint8_t *, int, int);
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            if (check_func(ref[i][j], "%s_%dx%d_%d", name, sizes[i], sizes[i], j)) {
+                randomize_buffer(src,  BUF_SIZE);
+                randomize_buffer(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                /* sources are unaligned, like for motion vectors */
+                call_ref(dst0 + OFFSET, src + OFFSET + 1, STRIDE, sizes[i]);
+                call_new(dst1 + OFFSET, src + OFFSET + 1, STRIDE, sizes[i]);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + OFFSET, src + OFFSET + 1, STRIDE, sizes[i]);
+            }
+        }
+    }
+}
+
+static void check_qpel(qpel_mc_func (*ref)[16], int nb_sizes, const char *name)
+{
+    DECLARE_ALIGNED(16, uint8_t, src)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst1)[BUF_SIZE];
+    int i, j;
+    declare_func(void, uint8_t *, uint8_t *, int);
+
+    for (i = 0; i < nb_sizes; i++) {
+        for (j = 0; j < 16; j++) {
+            if (check_func(ref[i][j], "%s%d_mc%d%d", name, sizes[i], j & 3, j >> 2)) {
+                randomize_buffer(src,  BUF_SIZE);
+                randomize_buffer(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(dst0 + OFFSET, src + OFFSET + 1, STRIDE);
+                call_new(dst1 + OFFSET, src + OFFSET + 1, STRIDE);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + OFFSET, src + OFFSET + 1, STRIDE);
+            }
+        }
+    }
+}
+
+static void check_h264_chroma(h264_chroma_mc_func *ref, const char *name)
+{
+    DECLARE_ALIGNED(16, uint8_t, src)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst1)[BUF_SIZE];
+    int i, x, y;
+    declare_func(void, uint8_t *, uint8_t *, int, int, int, int);
+
+    for (i = 0; i < 3; i++) {
+        int w = 8 >> i;
+        if (check_func(ref[i], "%s%d", name, w)) {
+            for (y = 0; y < 8; y++) {
+                for (x = 0; x < 8; x++) {
+                    randomize_buffer(src,  BUF_SIZE);
+                    randomize_buffer(dst0, BUF_SIZE);
+                    memcpy(dst1, dst0, BUF_SIZE);
+                    call_ref(dst0 + OFFSET, src + OFFSET + 1, STRIDE, w, x, y);
+                    call_new(dst1 + OFFSET, src + OFFSET + 1, STRIDE, w, x, y);
+                    if (memcmp(dst0, dst1, BUF_SIZE))
+                        fail();
+                }
+            }
+            bench_new(dst1 + OFFSET, src + OFFSET + 1, STRIDE, w, 3, 5);
+        }
+    }
+}
+
+static void check_block_pixels(DSPContext *c)
+{
+    DECLARE_ALIGNED(16, uint8_t, src0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, src1)[BUF_SIZE];
+    DECLARE_ALIGNED(16, DCTELEM, block0)[64 * 6];
+    DECLARE_ALIGNED(16, DCTELEM, block1)[64 * 6];
+
+    randomize_buffer(src0, BUF_SIZE);
+    randomize_buffer(src1, BUF_SIZE);
+
+    {
+        declare_func(void, DCTELEM *, const uint8_t *, int);
+        if (check_func(c->get_pixels, "get_pixels")) {
+            call_ref(block0, src0 + OFFSET, STRIDE);
+            call_new(block1, src0 + OFFSET, STRIDE);
+            if (memcmp(block0, block1, 64 * sizeof(DCTELEM)))
+                fail();
+            bench_new(block1, src0 + OFFSET, STRIDE);
+        }
+    }
+    {
+        declare_func(void, DCTELEM *, const uint8_t *, const uint8_t *, int);
+        if (check_func(c->diff_pixels, "diff_pixels")) {
+            call_ref(block0, src0 + OFFSET, src1 + OFFSET, STRIDE);
+            call_new(block1, src0 + OFFSET, src1 + OFFSET, STRIDE);
+            if (memcmp(block0, block1, 64 * sizeof(DCTELEM)))
+                fail();
+            bench_new(block1, src0 + OFFSET, src1 + OFFSET, STRIDE);
+        }
+    }
+    {
+        static const char *const names[3] = {
+            "put_pixels_clamped", "put_signed_pixels_clamped", "add_pixels_clamped"
+        };
+        void (*funcs[3])(const DCTELEM *, uint8_t *, int) = {
+            c->put_pixels_clamped, c->put_signed_pixels_clamped, c->add_pixels_clamped
+        };
+        int i;
+        declare_func(void, const DCTELEM *, uint8_t *, int);
+        for (i = 0; i < 3; i++) {
+            if (check_func(funcs[i], "%s", names[i])) {
+                randomize_block(block0, 64, 512);
+                memcpy(src1, src0, BUF_SIZE);
+                call_ref(block0, src0 + OFFSET, STRIDE);
+                call_new(block0, src1 + OFFSET, STRIDE);
+                if (memcmp(src0, src1, BUF_SIZE))
+                    fail();
+                bench_new(block0, src1 + OFFSET, STRIDE);
+            }
+        }
+    }
+    {
+        declare_func(void, DCTELEM *);
+        if (check_func(c->clear_block, "clear_block")) {
+            randomize_block(block0, 64, 512);
+            memcpy(block1, block0, sizeof(block0));
+            call_ref(block0);
+            call_new(block1);
+            if (memcmp(block0, block1, sizeof(block0)))
+                fail();
+            bench_new(block1);
+        }
+        if (check_func(c->clear_blocks, "clear_blocks")) {
+            randomize_block(block0, 64 * 6, 512);
+            memcpy(block1, block0, sizeof(block0));
+            call_ref(block0);
+            call_new(block1);
+            if (memcmp(block0, block1, sizeof(block0)))
+                fail();
+            bench_new(block1);
+        }
+    }
+    {
+        declare_func(int, uint8_t *, int);
+        if (check_func(c->pix_sum, "pix_sum")) {
+            if (call_ref(src0 + OFFSET, STRIDE) != call_new(src0 + OFFSET, STRIDE))
+                fail();
+            bench_new(src0 + OFFSET, STRIDE);
+        }
+        if (check_func(c->pix_norm1, "pix_norm1")) {
+            if (call_ref(src0 + OFFSET, STRIDE) != call_new(src0 + OFFSET, STRIDE))
+                fail();
+            bench_new(src0 + OFFSET, STRIDE);
+        }
+    }
+}
+
+static void check_me_cmp(me_cmp_func *funcs, int nb_sizes, const char *name)
+{
+    DECLARE_ALIGNED(16, uint8_t, src0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, src1)[BUF_SIZE];
+    int i, h;
+    declare_func(int, void *, uint8_t *, uint8_t *, int, int);
+
+    for (i = 0; i < nb_sizes; i++) {
+        if (check_func(funcs[i], "%s%d", name, sizes[i])) {
+            randomize_buffer(src0, BUF_SIZE);
+            randomize_buffer(src1, BUF_SIZE);
+            /* the 8 pixel wide versions only handle square blocks */
+            for (h = i ? sizes[i] : 4; h <= sizes[i]; h += 4) {
+                if (call_ref(NULL, src0 + OFFSET, src1 + OFFSET + 1, STRIDE, h) !=
+                    call_new(NULL, src0 + OFFSET, src1 + OFFSET + 1, STRIDE, h))
+                    fail();
+            }
+            bench_new(NULL, src0 + OFFSET, src1 + OFFSET + 1, STRIDE, 16 >> i);
+        }
+    }
+}
+
+static void check_vsad_intra(DSPContext *c)
+{
+    DECLARE_ALIGNED(16, uint8_t, src)[BUF_SIZE];
+    int i, h, field;
+    declare_func(int, void *, uint8_t *, uint8_t *, int, int);
+
+    for (i = 0; i < 2; i++) {
+        if (check_func(c->vsad[4 + i], "vsad_intra%d", sizes[i])) {
+            randomize_buffer(src, BUF_SIZE);
+            /* frame and field lines, like the interlaced DCT decision */
+            for (field = 0; field < 2; field++) {
+                h = sizes[i] >> field;
+                if (call_ref(NULL, src + OFFSET, NULL, STRIDE << field, h) !=
+                    call_new(NULL, src + OFFSET, NULL, STRIDE << field, h))
+                    fail();
+            }
+            bench_new(NULL, src + OFFSET, NULL, STRIDE, sizes[i]);
+        }
+    }
+}
+
+static void check_pix_abs(DSPContext *c)
+{
+    DECLARE_ALIGNED(16, uint8_t, src0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, src1)[BUF_SIZE];
+    int i, j;
+    declare_func(int, void *, uint8_t *, uint8_t *, int, int);
+
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 4; j++) {
+            if (check_func(c->pix_abs[i][j], "pix_abs%d_%d", sizes[i], j)) {
+                randomize_buffer(src0, BUF_SIZE);
+                randomize_buffer(src1, BUF_SIZE);
+                if (call_ref(NULL, src0 + OFFSET, src1 + OFFSET + 1, STRIDE, sizes[i]) !=
+                    call_new(NULL, src0 + OFFSET, src1 + OFFSET + 1, STRIDE, sizes[i]))
+                    fail();
+                bench_new(NULL, src0 + OFFSET, src1 + OFFSET + 1, STRIDE, sizes[i]);
+            }
+        }
+    }
+}
+
+static void check_huffyuv(DSPContext *c)
+{
+    DECLARE_ALIGNED(16, uint8_t, src0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, src1)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst1)[BUF_SIZE];
+    /* odd width to exercise the tails */
+    int w = 1024 + (rnd() & 15);
+
+    randomize_buffer(src0, BUF_SIZE);
+    randomize_buffer(src1, BUF_SIZE);
+    randomize_buffer(dst0, BUF_SIZE);
+    memcpy(dst1, dst0, BUF_SIZE);
+
+    {
+        declare_func(void, uint8_t *, uint8_t *, int);
+        if (check_func(c->add_bytes, "add_bytes")) {
+            call_ref(dst0, src0, w);
+            call_new(dst1, src0, w);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new(dst1, src0, w);
+        }
+    }
+    {
+        declare_func(void, uint8_t *, uint8_t *, uint8_t *, int);
+        if (check_func(c->diff_bytes, "diff_bytes")) {
+            call_ref(dst0, src0, src1 + 1, w);
+            call_new(dst1, src0, src1 + 1, w);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new(dst1, src0, src1 + 1, w);
+        }
+    }
+    {
+        declare_func(void, uint8_t *, const uint8_t *, const uint8_t *, int, int *, int *);
+        int left0 = rnd() & 0xff, left_top0 = rnd() & 0xff;
+        int left1 = left0, left_top1 = left_top0;
+
+        if (check_func(c->add_hfyu_median_prediction, "add_hfyu_median_prediction")) {
+            call_ref(dst0, src0, src1, w, &left0, &left_top0);
+            call_new(dst1, src0, src1, w, &left1, &left_top1);
+            if (memcmp(dst0, dst1, BUF_SIZE) || left0 != left1 || left_top0 != left_top1)
+                fail();
+            bench_new(dst1, src0, src1, w, &left1, &left_top1);
+        }
+        /* the SIMD version writes whole registers past the end */
+        if (check_func(c->sub_hfyu_median_prediction, "sub_hfyu_median_prediction")) {
+            call_ref(dst0, src0 + 16, src1 + 16, w, &left0, &left_top0);
+            call_new(dst1, src0 + 16, src1 + 16, w, &left1, &left_top1);
+            if (memcmp(dst0, dst1, w) || left0 != left1 || left_top0 != left_top1)
+                fail();
+            bench_new(dst1, src0 + 16, src1 + 16, w, &left1, &left_top1);
+        }
+    }
+    {
+        declare_func(int, uint8_t *, const uint8_t *, int, int);
+        int left = rnd() & 0xff;
+        if (check_func(c->add_hfyu_left_prediction, "add_hfyu_left_prediction")) {
+            if (call_ref(dst0, src0, w, left) != call_new(dst1, src0, w, left) ||
+                memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new(dst1, src0, w, left);
+        }
+    }
+    {
+        declare_func(void, uint32_t *, const uint32_t *, int);
+        if (check_func(c->bswap_buf, "bswap_buf")) {
+            call_ref((uint32_t *)dst0, (const uint32_t *)src0, w / 4);
+            call_new((uint32_t *)dst1, (const uint32_t *)src0, w / 4);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new((uint32_t *)dst1, (const uint32_t *)src0, w / 4);
+        }
+    }
+}
+
+static void check_h263_loop_filter(DSPContext *c)
+{
+    DECLARE_ALIGNED(16, uint8_t, buf0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, buf1)[BUF_SIZE];
+    void (*funcs[2])(uint8_t *, int, int) = { c->h263_v_loop_filter, c->h263_h_loop_filter };
+    int i, q;
+    declare_func(void, uint8_t *, int, int);
+
+    for (i = 0; i < 2; i++) {
+        if (check_func(funcs[i], "h263_%c_loop_filter", i ? 'h' : 'v')) {
+            for (q = 1; q < 32; q++) {
+                int j;
+                /* smooth enough to have most edges filtered */
+                for (j = 0; j < BUF_SIZE; j++)
+                    buf0[j] = 128 + (int)(rnd() % (2 * q + 1)) - q;
+                memcpy(buf1, buf0, BUF_SIZE);
+                call_ref(buf0 + OFFSET, STRIDE, q);
+                call_new(buf1 + OFFSET, STRIDE, q);
+                if (memcmp(buf0, buf1, BUF_SIZE))
+                    fail();
+            }
+            bench_new(buf1 + OFFSET, STRIDE, 16);
+        }
+    }
+}
+
+#define FLOAT_LEN 256
+
+static void check_float(DSPContext *c)
+{
+    DECLARE_ALIGNED(32, float, src0)[FLOAT_LEN * 2];
+    DECLARE_ALIGNED(32, float, src1)[FLOAT_LEN * 2];
+    DECLARE_ALIGNED(32, float, src2)[FLOAT_LEN * 2];
+    DECLARE_ALIGNED(32, float, dst0)[FLOAT_LEN * 2];
+    DECLARE_ALIGNED(32, float, dst1)[FLOAT_LEN * 2];
+    const float eps = 1e-6;
+
+    randomize_float(src0, FLOAT_LEN * 2);
+    randomize_float(src1, FLOAT_LEN * 2);
+    randomize_float(src2, FLOAT_LEN * 2);
+
+    {
+        declare_func(void, float *, const float *, const float *, int);
+        if (check_func(c->vector_fmul, "vector_fmul")) {
+            call_ref(dst0, src0, src1, FLOAT_LEN);
+            call_new(dst1, src0, src1, FLOAT_LEN);
+            if (!checkasm_float_near(dst0, dst1, FLOAT_LEN, eps))
+                fail();
+            bench_new(dst1, src0, src1, FLOAT_LEN);
+        }
+        if (check_func(c->vector_fmul_reverse, "vector_fmul_reverse")) {
+            call_ref(dst0, src0, src1, FLOAT_LEN);
+            call_new(dst1, src0, src1, FLOAT_LEN);
+            if (!checkasm_float_near(dst0, dst1, FLOAT_LEN, eps))
+                fail();
+            bench_new(dst1, src0, src1, FLOAT_LEN);
+        }
+    }
+    {
+        declare_func(void, float *, const float *, const float *, const float *, int);
+        if (check_func(c->vector_fmul_add, "vector_fmul_add")) {
+            call_ref(dst0, src0, src1, src2, FLOAT_LEN);
+            call_new(dst1, src0, src1, src2, FLOAT_LEN);
+            if (!checkasm_float_near(dst0, dst1, FLOAT_LEN, eps))
+                fail();
+            bench_new(dst1, src0, src1, src2, FLOAT_LEN);
+        }
+        if (check_func(c->vector_fmul_window, "vector_fmul_window")) {
+            call_ref(dst0, src0, src1, src2, FLOAT_LEN);
+            call_new(dst1, src0, src1, src2, FLOAT_LEN);
+            if (!checkasm_float_near(dst0, dst1, FLOAT_LEN * 2, eps))
+                fail();
+            bench_new(dst1, src0, src1, src2, FLOAT_LEN);
+        }
+    }
+    {
+        declare_func(void, float *, const float *, float, float, int);
+        if (check_func(c->vector_clipf, "vector_clipf")) {
+            call_ref(dst0, src0, -50.0f, 70.0f, FLOAT_LEN);
+            call_new(dst1, src0, -50.0f, 70.0f, FLOAT_LEN);
+            if (memcmp(dst0, dst1, FLOAT_LEN * sizeof(float)))
+                fail();
+            call_ref(dst0, src0, 10.0f, 70.0f, FLOAT_LEN);
+            call_new(dst1, src0, 10.0f, 70.0f, FLOAT_LEN);
+            if (memcmp(dst0, dst1, FLOAT_LEN * sizeof(float)))
+                fail();
+            bench_new(dst1, src0, -50.0f, 70.0f, FLOAT_LEN);
+        }
+    }
+    {
+        declare_func(void, float *, float *, int);
+        if (check_func(c->butterflies_float, "butterflies_float")) {
+            memcpy(dst0, src0, sizeof(src0));
+            memcpy(dst1, src0, sizeof(src0));
+            memcpy(src2, src1, sizeof(src1));
+            call_ref(dst0, src1, FLOAT_LEN);
+            call_new(dst1, src2, FLOAT_LEN);
+            if (!checkasm_float_near(dst0, dst1, FLOAT_LEN, eps) ||
+                !checkasm_float_near(src1, src2, FLOAT_LEN, eps))
+                fail();
+            bench_new(dst1, src2, FLOAT_LEN);
+        }
+    }
+    {
+        declare_func(float, const float *, const float *, int);
+        if (check_func(c->scalarproduct_float, "scalarproduct_float")) {
+            float r0 = call_ref(src0, src1, FLOAT_LEN);
+            float r1 = call_new(src0, src1, FLOAT_LEN);
+            /* the sum of products is much larger than each term */
+            if (!checkasm_float_near(&r0, &r1, 1, 1e-4))
+                fail();
+            bench_new(src0, src1, FLOAT_LEN);
+        }
+    }
+}
+
+static void check_scalarproduct_int16(DSPContext *c)
+{
+    DECLARE_ALIGNED(16, int16_t, v1)[FLOAT_LEN];
+    DECLARE_ALIGNED(16, int16_t, v2)[FLOAT_LEN];
+    declare_func(int32_t, const int16_t *, const int16_t *, int, int);
+
+    if (check_func(c->scalarproduct_int16, "scalarproduct_int16")) {
+        randomize_block(v1, FLOAT_LEN, 1 << 10);
+        randomize_block(v2, FLOAT_LEN, 1 << 10);
+        /* the SIMD versions shift the sum, not each product */
+        if (call_ref(v1, v2, FLOAT_LEN, 0) != call_new(v1, v2, FLOAT_LEN, 0))
+            fail();
+        bench_new(v1, v2, FLOAT_LEN, 0);
+    }
+}
+
+void checkasm_check_dsputil(void)
+{
+    AVCodecContext *avctx = avcodec_alloc_context3(NULL);
+    DSPContext c;
+
+    if (!avctx)
+        return;
+    /* the approximate versions are only used without this flag */
+    avctx->flags |= CODEC_FLAG_BITEXACT;
+    avctx->bits_per_raw_sample = 8;
+    /* not every size is set, like in the zeroed codec contexts */
+    memset(&c, 0, sizeof(c));
+    dsputil_init(&c, avctx);
+
+    check_pixels(c.put_pixels_tab,        "put_pixels");
+    check_pixels(c.avg_pixels_tab,        "avg_pixels");
+    check_pixels(c.put_no_rnd_pixels_tab, "put_no_rnd_pixels");
+    check_qpel(c.put_qpel_pixels_tab,        2, "put_qpel");
+    check_qpel(c.avg_qpel_pixels_tab,        2, "avg_qpel");
+    check_qpel(c.put_no_rnd_qpel_pixels_tab, 2, "put_no_rnd_qpel");
+    check_qpel(c.put_h264_qpel_pixels_tab,   3, "put_h264_qpel");
+    check_qpel(c.avg_h264_qpel_pixels_tab,   3, "avg_h264_qpel");
+    check_h264_chroma(c.put_h264_chroma_pixels_tab, "put_h264_chroma_mc");
+    check_h264_chroma(c.avg_h264_chroma_pixels_tab, "avg_h264_chroma_mc");
+    check_block_pixels(&c);
+    check_me_cmp(c.sad, 2, "sad");
+    check_me_cmp(c.sse, 3, "sse");
+    check_vsad_intra(&c);
+    check_pix_abs(&c);
+    check_huffyuv(&c);
+    check_h263_loop_filter(&c);
+    check_float(&c);
+    check_scalarproduct_int16(&c);
+
+    av_free(avctx);
+}
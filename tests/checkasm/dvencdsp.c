@@ -0,0 +1,96 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavutil/cpu.h"
+#include "libavcodec/dvdata.h"
+#include "libavcodec/dvencdsp.h"
+#include "checkasm.h"
+
+static void check_weigh(DVEncDSPContext *c)
+{
+    /* DV25/50 and DV100 weights, rounding and shift */
+    static const struct {
+        const char *name;
+        const int *weight;
+        int bias, shift;
+    } tests[] = {
+        { "sd_88",  dv_weight_88,      1 << 21,            22 },
+        { "sd_248", dv_weight_248,     1 << 21,            22 },
+        { "hd",     dv_weight_1080[0], 4096 + (1 << 17),   18 },
+        { "hd_c",   dv_weight_720[1],  4096 + (1 << 17),   18 },
+    };
+    DECLARE_ALIGNED(16, DCTELEM, src)[64];
+    DCTELEM dst0[65], dst1[65];
+    uint8_t sign0[65], sign1[65];
+    int i, j;
+    declare_func(uint64_t, DCTELEM *, uint8_t *, const DCTELEM *, const int *, int, int);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        if (check_func(c->weigh, "dv_weigh_%s", tests[i].name)) {
+            /* fdct output range, with many small levels */
+            for (j = 0; j < 64; j++)
+                src[j] = (int)(rnd() % (j & 1 ? 64 : 8192)) - (j & 1 ? 32 : 4096);
+            memset(dst0, 0, sizeof(dst0));
+            memset(dst1, 0, sizeof(dst1));
+            memset(sign0, 0, sizeof(sign0));
+            memset(sign1, 0, sizeof(sign1));
+            /* the outputs of the encoder are not aligned */
+            if (call_ref(dst0 + 1, sign0 + 1, src, tests[i].weight, tests[i].bias, tests[i].shift) !=
+                call_new(dst1 + 1, sign1 + 1, src, tests[i].weight, tests[i].bias, tests[i].shift) ||
+                memcmp(dst0, dst1, sizeof(dst0)) || memcmp(sign0, sign1, sizeof(sign0)))
+                fail();
+            bench_new(dst1 + 1, sign1 + 1, src, tests[i].weight, tests[i].bias, tests[i].shift);
+        }
+    }
+}
+
+static void check_quantize_hd(DVEncDSPContext *c)
+{
+    DECLARE_ALIGNED(16, DCTELEM, src)[65];
+    DECLARE_ALIGNED(16, DCTELEM, dst0)[64];
+    DECLARE_ALIGNED(16, DCTELEM, dst1)[64];
+    int i, qno, cno;
+    declare_func(uint64_t, DCTELEM *, const DCTELEM *, int, int);
+
+    if (check_func(c->quantize_hd, "dv100_quantize")) {
+        for (qno = 0; qno < 16; qno++) {
+            for (cno = 0; cno < 4; cno++) {
+                /* weighted levels, mostly small, one of them as large as possible */
+                for (i = 0; i < 65; i++)
+                    src[i] = rnd() % (i & 3 ? 32 : 4096);
+                src[1 + rnd() % 64] = 32767;
+                if (call_ref(dst0, src + 1, dv100_qstep_inv[qno], cno) !=
+                    call_new(dst1, src + 1, dv100_qstep_inv[qno], cno) ||
+                    memcmp(dst0, dst1, sizeof(dst0)))
+                    fail();
+            }
+        }
+        bench_new(dst1, src + 1, dv100_qstep_inv[4], 1);
+    }
+}
+
+void checkasm_check_dvencdsp(void)
+{
+    DVEncDSPContext c;
+
+    ff_dvencdsp_init(&c, av_get_cpu_flags());
+    check_weigh(&c);
+    check_quantize_hd(&c);
+}
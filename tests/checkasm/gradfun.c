@@ -0,0 +1,123 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "libavutil/cpu.h"
+#include "libavfilter/gradfun.h"
+#include "checkasm.h"
+
+#define WIDTH  1024
+#define STRIDE (WIDTH + 32)
+
+/* same selection as the filter */
+static void init_gradfun(GradFunContext *gf)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    gf->blur_line   = ff_gradfun_blur_line_c;
+    gf->filter_line = ff_gradfun_filter_line_c;
+
+    if (HAVE_MMX && cpu_flags & AV_CPU_FLAG_MMX2)
+        gf->filter_line = ff_gradfun_filter_line_mmx2;
+    if (HAVE_SSSE3 && cpu_flags & AV_CPU_FLAG_SSSE3)
+        gf->filter_line = ff_gradfun_filter_line_ssse3;
+    if (HAVE_SSE && cpu_flags & AV_CPU_FLAG_SSE2)
+        gf->blur_line = ff_gradfun_blur_line_sse2;
+}
+
+static void check_filter_line(GradFunContext *gf)
+{
+    DECLARE_ALIGNED(16, uint8_t,  src)[STRIDE];
+    DECLARE_ALIGNED(16, uint8_t,  dst0)[STRIDE];
+    DECLARE_ALIGNED(16, uint8_t,  dst1)[STRIDE];
+    DECLARE_ALIGNED(16, uint16_t, dc)[STRIDE / 2];
+    DECLARE_ALIGNED(16, uint16_t, dithers)[8];
+    int i;
+    declare_func(void, uint8_t *, const uint8_t *, const uint16_t *, int, int, const uint16_t *);
+
+    if (check_func(gf->filter_line, "gradfun_filter_line")) {
+        /* odd width for the C tail of the SIMD versions */
+        int width  = WIDTH - (rnd() & 7);
+        int thresh = (1 << 15) / (1 + rnd() % 64);
+
+        for (i = 0; i < STRIDE; i++)
+            src[i] = rnd();
+        /* the local average is close to the pixels, or the filter is a
+         * no-op, and never above 255 << 7 like an actual average */
+        for (i = 0; i < STRIDE / 2; i++)
+            dc[i] = av_clip(src[2 * i] * 128 + (int)(rnd() % 2048) - 1024, 0, 255 << 7);
+        for (i = 0; i < 8; i++)
+            dithers[i] = rnd() & 0x7f;
+        memset(dst0, 0, STRIDE);
+        memset(dst1, 0, STRIDE);
+        call_ref(dst0, src, dc, width, thresh, dithers);
+        call_new(dst1, src, dc, width, thresh, dithers);
+        /* the SIMD versions round m * m * delta >> 14 differently, the
+         * result may be off by 1 */
+        for (i = 0; i < STRIDE; i++) {
+            if (FFABS(dst0[i] - dst1[i]) > 1) {
+                fail();
+                break;
+            }
+        }
+        bench_new(dst1, src, dc, width, thresh, dithers);
+    }
+}
+
+static void check_blur_line(GradFunContext *gf)
+{
+    DECLARE_ALIGNED(16, uint8_t,  src)[STRIDE * 2];
+    DECLARE_ALIGNED(16, uint16_t, dc0)[STRIDE / 2];
+    DECLARE_ALIGNED(16, uint16_t, dc1)[STRIDE / 2];
+    DECLARE_ALIGNED(16, uint16_t, buf0)[STRIDE / 2];
+    DECLARE_ALIGNED(16, uint16_t, buf1)[STRIDE / 2];
+    DECLARE_ALIGNED(16, uint16_t, prev)[STRIDE / 2];
+    int i;
+    declare_func(void, uint16_t *, uint16_t *, const uint16_t *, const uint8_t *, int, int);
+
+    if (check_func(gf->blur_line, "gradfun_blur_line")) {
+        int linesize;
+        for (i = 0; i < STRIDE * 2; i++)
+            src[i] = rnd();
+        for (i = 0; i < STRIDE / 2; i++)
+            prev[i] = rnd() & 0x3fff;
+        /* both the aligned and the unaligned loads, the filter works on
+         * rows padded to 16 pixels */
+        for (linesize = STRIDE - 1; linesize <= STRIDE; linesize++) {
+            for (i = 0; i < STRIDE / 2; i++)
+                buf0[i] = rnd() & 0x3fff;
+            memcpy(buf1, buf0, sizeof(buf0));
+            memset(dc0, 0, sizeof(dc0));
+            memset(dc1, 0, sizeof(dc1));
+            call_ref(dc0, buf0, prev, src, linesize, WIDTH / 2);
+            call_new(dc1, buf1, prev, src, linesize, WIDTH / 2);
+            if (memcmp(dc0, dc1, sizeof(dc0)) || memcmp(buf0, buf1, sizeof(buf0)))
+                fail();
+        }
+        bench_new(dc1, buf1, prev, src, STRIDE, WIDTH / 2);
+    }
+}
+
+void checkasm_check_gradfun(void)
+{
+    GradFunContext gf;
+
+    init_gradfun(&gf);
+    check_filter_line(&gf);
+    check_blur_line(&gf);
+}
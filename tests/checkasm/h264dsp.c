@@ -0,0 +1,193 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavcodec/h264dsp.h"
+#include "checkasm.h"
+
+#define STRIDE   64
+#define BUF_SIZE (STRIDE * 32)
+#define OFFSET   (STRIDE * 8 + 16)
+
+static const uint8_t weight_sizes[10][2] = {
+    { 16, 16 }, { 16, 8 }, { 8, 16 }, { 8, 8 }, { 8, 4 },
+    {  4,  8 }, {  4, 4 }, { 4,  2 }, { 2, 4 }, { 2, 2 },
+};
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+/* values close enough to each other for most edges to be filtered */
+static void randomize_smooth(uint8_t *buf, int size, int noise)
+{
+    int i, base = 32 + rnd() % 192;
+    for (i = 0; i < size; i++)
+        buf[i] = base + (int)(rnd() % (2 * noise + 1)) - noise;
+}
+
+static void check_idct(H264DSPContext *h)
+{
+    DECLARE_ALIGNED(16, uint8_t, dst0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst1)[BUF_SIZE];
+    DECLARE_ALIGNED(16, DCTELEM, block0)[64];
+    DECLARE_ALIGNED(16, DCTELEM, block1)[64];
+    static const char *const names[4] = {
+        "h264_idct_add", "h264_idct8_add", "h264_idct_dc_add", "h264_idct8_dc_add"
+    };
+    void (*funcs[4])(uint8_t *, DCTELEM *, int) = {
+        h->h264_idct_add, h->h264_idct8_add, h->h264_idct_dc_add, h->h264_idct8_dc_add
+    };
+    int i, j;
+    declare_func(void, uint8_t *, DCTELEM *, int);
+
+    for (i = 0; i < 4; i++) {
+        int size = i & 1 ? 64 : 16;
+        if (check_func(funcs[i], "%s", names[i])) {
+            randomize_buffer(dst0, BUF_SIZE);
+            memcpy(dst1, dst0, BUF_SIZE);
+            memset(block0, 0, sizeof(block0));
+            if (i < 2) {
+                /* the coefficients of a dequantized block fit in 16 bits
+                 * through the whole transform */
+                for (j = 0; j < size; j++)
+                    block0[j] = (int)(rnd() % 512) - 256;
+            } else {
+                block0[0] = (int)(rnd() % 8192) - 4096;
+            }
+            memcpy(block1, block0, sizeof(block0));
+            call_ref(dst0 + OFFSET, block0, STRIDE);
+            call_new(dst1 + OFFSET, block1, STRIDE);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new(dst1 + OFFSET, block1, STRIDE);
+        }
+    }
+}
+
+static void check_weight(H264DSPContext *h)
+{
+    DECLARE_ALIGNED(16, uint8_t, src)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst1)[BUF_SIZE];
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        int w = weight_sizes[i][0], hgt = weight_sizes[i][1];
+        int denom  = rnd() & 7;
+        int weight = (int)(rnd() & 0xff) - 128;
+        int offset = (int)(rnd() & 0xff) - 128;
+        {
+            declare_func(void, uint8_t *, int, int, int, int);
+            if (check_func(h->weight_h264_pixels_tab[i], "weight_h264_pixels%dx%d", w, hgt)) {
+                randomize_buffer(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(dst0 + OFFSET, STRIDE, denom, weight, offset);
+                call_new(dst1 + OFFSET, STRIDE, denom, weight, offset);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + OFFSET, STRIDE, denom, weight, offset);
+            }
+        }
+        {
+            int weights = (int)(rnd() & 0x7f) - 64;
+            int weightd = (int)(rnd() & 0x7f) - 64;
+            declare_func(void, uint8_t *, uint8_t *, int, int, int, int, int);
+            if (check_func(h->biweight_h264_pixels_tab[i], "biweight_h264_pixels%dx%d", w, hgt)) {
+                randomize_buffer(src,  BUF_SIZE);
+                randomize_buffer(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(dst0 + OFFSET, src + OFFSET, STRIDE, denom, weightd, weights, offset);
+                call_new(dst1 + OFFSET, src + OFFSET, STRIDE, denom, weightd, weights, offset);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + OFFSET, src + OFFSET, STRIDE, denom, weightd, weights, offset);
+            }
+        }
+    }
+}
+
+static void check_loop_filter(H264DSPContext *h)
+{
+    DECLARE_ALIGNED(16, uint8_t, buf0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, buf1)[BUF_SIZE];
+    static const char *const names[4] = {
+        "h264_v_loop_filter_luma",   "h264_h_loop_filter_luma",
+        "h264_v_loop_filter_chroma", "h264_h_loop_filter_chroma",
+    };
+    void (*funcs[4])(uint8_t *, int, int, int, int8_t *) = {
+        h->h264_v_loop_filter_luma,   h->h264_h_loop_filter_luma,
+        h->h264_v_loop_filter_chroma, h->h264_h_loop_filter_chroma,
+    };
+    void (*intra[4])(uint8_t *, int, int, int) = {
+        h->h264_v_loop_filter_luma_intra,   h->h264_h_loop_filter_luma_intra,
+        h->h264_v_loop_filter_chroma_intra, h->h264_h_loop_filter_chroma_intra,
+    };
+    int i, j, k;
+
+    for (i = 0; i < 4; i++) {
+        {
+            declare_func(void, uint8_t *, int, int, int, int8_t *);
+            if (check_func(funcs[i], "%s", names[i])) {
+                int8_t tc0[4];
+                for (j = 0; j < 32; j++) {
+                    int alpha = 16 + rnd() % 240, beta = 2 + rnd() % 17;
+                    for (k = 0; k < 4; k++)
+                        tc0[k] = (int)(rnd() % 27) - 1;
+                    randomize_smooth(buf0, BUF_SIZE, beta / 2 + 1);
+                    memcpy(buf1, buf0, BUF_SIZE);
+                    call_ref(buf0 + OFFSET, STRIDE, alpha, beta, tc0);
+                    call_new(buf1 + OFFSET, STRIDE, alpha, beta, tc0);
+                    if (memcmp(buf0, buf1, BUF_SIZE))
+                        fail();
+                }
+                bench_new(buf1 + OFFSET, STRIDE, 128, 8, tc0);
+            }
+        }
+        {
+            declare_func(void, uint8_t *, int, int, int);
+            if (check_func(intra[i], "%s_intra", names[i])) {
+                for (j = 0; j < 32; j++) {
+                    int alpha = 16 + rnd() % 240, beta = 2 + rnd() % 17;
+                    randomize_smooth(buf0, BUF_SIZE, beta / 2 + 1);
+                    memcpy(buf1, buf0, BUF_SIZE);
+                    call_ref(buf0 + OFFSET, STRIDE, alpha, beta);
+                    call_new(buf1 + OFFSET, STRIDE, alpha, beta);
+                    if (memcmp(buf0, buf1, BUF_SIZE))
+                        fail();
+                }
+                bench_new(buf1 + OFFSET, STRIDE, 128, 8);
+            }
+        }
+    }
+}
+
+void checkasm_check_h264dsp(void)
+{
+    H264DSPContext h;
+
+    ff_h264dsp_init(&h, 8, 1);
+
+    check_idct(&h);
+    check_weight(&h);
+    check_loop_filter(&h);
+}
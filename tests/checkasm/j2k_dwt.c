@@ -0,0 +1,86 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavutil/cpu.h"
+#include "libavcodec/j2k_dwt.h"
+#include "checkasm.h"
+
+/* groups of FF_DWT_STRIP samples, n groups 2 apart and their neighbours */
+#define MAX_GROUPS 301
+#define BUF_SIZE   ((2 * MAX_GROUPS + 2) * FF_DWT_STRIP)
+
+static const int counts[] = { 0, 1, 2, 3, 7, 32, 150, MAX_GROUPS };
+
+/* the lifting coefficients of the 9/7 transform */
+static const float coefs97[] = { -0.443506852, -0.882911075, 0.052980118, 1.586134342 };
+
+static void check_sr53(void (*func)(int *, int), const char *name)
+{
+    DECLARE_ALIGNED(16, int, buf0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, int, buf1)[BUF_SIZE];
+    int i, j;
+    declare_func(void, int *, int);
+
+    if (check_func(func, "j2k_dwt_sr53_%s", name)) {
+        for (i = 0; i < FF_ARRAY_ELEMS(counts); i++) {
+            /* wavelet coefficients of 16-bit samples */
+            for (j = 0; j < BUF_SIZE; j++)
+                buf0[j] = buf1[j] = (int)rnd() >> 16;
+            call_ref(buf0 + FF_DWT_STRIP, counts[i]);
+            call_new(buf1 + FF_DWT_STRIP, counts[i]);
+            if (memcmp(buf0, buf1, sizeof(buf0)))
+                fail();
+        }
+        bench_new(buf1 + FF_DWT_STRIP, 150);
+    }
+}
+
+static void check_lift97(void (*func)(float *, int, float))
+{
+    DECLARE_ALIGNED(16, float, buf0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, float, buf1)[BUF_SIZE];
+    int i, j, k;
+    declare_func(void, float *, int, float);
+
+    if (check_func(func, "j2k_dwt_lift97")) {
+        for (i = 0; i < FF_ARRAY_ELEMS(counts); i++) {
+            for (k = 0; k < FF_ARRAY_ELEMS(coefs97); k++) {
+                for (j = 0; j < BUF_SIZE; j++)
+                    buf0[j] = buf1[j] = ((int)rnd() >> 16) / 32.0f;
+                call_ref(buf0 + FF_DWT_STRIP, counts[i], coefs97[k]);
+                call_new(buf1 + FF_DWT_STRIP, counts[i], coefs97[k]);
+                /* the same operations in the same order, bit-exact */
+                if (memcmp(buf0, buf1, sizeof(buf0)))
+                    fail();
+            }
+        }
+        bench_new(buf1 + FF_DWT_STRIP, 150, coefs97[0]);
+    }
+}
+
+void checkasm_check_j2k_dwt(void)
+{
+    DWTContext c;
+
+    ff_j2k_dwt_init_lifting(&c, av_get_cpu_flags());
+    check_sr53(c.sr53_even, "even");
+    check_sr53(c.sr53_odd,  "odd");
+    check_lift97(c.lift97);
+}
@@ -0,0 +1,58 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "libavcodec/v210dec.h"
+#include "checkasm.h"
+
+#define WIDTH 1920
+
+void checkasm_check_v210dec(void)
+{
+    /* one spare word for the unaligned source */
+    DECLARE_ALIGNED(32, uint32_t, src)[WIDTH * 2 / 3 + 8];
+    DECLARE_ALIGNED(32, uint16_t, y0)[WIDTH + 32];
+    DECLARE_ALIGNED(32, uint16_t, u0)[WIDTH / 2 + 32];
+    DECLARE_ALIGNED(32, uint16_t, v0)[WIDTH / 2 + 32];
+    DECLARE_ALIGNED(32, uint16_t, y1)[WIDTH + 32];
+    DECLARE_ALIGNED(32, uint16_t, u1)[WIDTH / 2 + 32];
+    DECLARE_ALIGNED(32, uint16_t, v1)[WIDTH / 2 + 32];
+    V210DecContext s = { 0 };
+    int i, aligned;
+    declare_func(void, const uint32_t *, uint16_t *, uint16_t *, uint16_t *, int);
+
+    for (aligned = 0; aligned < 2; aligned++) {
+        s.aligned_input = aligned;
+        ff_v210dec_init(&s);
+        if (check_func(s.unpack_frame, "v210_unpack_%s", aligned ? "aligned" : "unaligned")) {
+            const uint32_t *in = src + !aligned;
+            /* the SIMD versions work on 12 pixels at a time */
+            int width = 12 * (1 + rnd() % (WIDTH / 12 - 1));
+
+            for (i = 0; i < FF_ARRAY_ELEMS(src); i++)
+                src[i] = rnd() & 0x3fffffff;
+            call_ref(in, y0, u0, v0, width);
+            call_new(in, y1, u1, v1, width);
+            if (memcmp(y0, y1, width     * sizeof(uint16_t)) ||
+                memcmp(u0, u1, width / 2 * sizeof(uint16_t)) ||
+                memcmp(v0, v1, width / 2 * sizeof(uint16_t)))
+                fail();
+            bench_new(in, y1, u1, v1, WIDTH);
+        }
+    }
+}
@@ -0,0 +1,237 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavcodec/vp8dsp.h"
+#include "checkasm.h"
+
+#define STRIDE   64
+#define BUF_SIZE (STRIDE * 40)
+#define OFFSET   (STRIDE * 8 + 16)
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+static void randomize_smooth(uint8_t *buf, int size, int noise)
+{
+    int i, base = 32 + rnd() % 192;
+    for (i = 0; i < size; i++)
+        buf[i] = base + (int)(rnd() % (2 * noise + 1)) - noise;
+}
+
+static void randomize_coeffs(DCTELEM *block, int size, int range)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        block[i] = (int)(rnd() % (2 * range)) - range;
+}
+
+static void check_idct(VP8DSPContext *d)
+{
+    DECLARE_ALIGNED(16, uint8_t, dst0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst1)[BUF_SIZE];
+    DECLARE_ALIGNED(16, DCTELEM, block0)[4 * 4 * 16];
+    DECLARE_ALIGNED(16, DCTELEM, block1)[4 * 4 * 16];
+    DECLARE_ALIGNED(16, DCTELEM, dc0)[16];
+    DECLARE_ALIGNED(16, DCTELEM, dc1)[16];
+
+    {
+        declare_func(void, DCTELEM (*)[4][16], DCTELEM *);
+        if (check_func(d->vp8_luma_dc_wht, "vp8_luma_dc_wht")) {
+            randomize_coeffs(block0, 4 * 4 * 16, 1 << 10);
+            randomize_coeffs(dc0, 16, 1 << 10);
+            memcpy(block1, block0, sizeof(block0));
+            memcpy(dc1, dc0, sizeof(dc0));
+            call_ref((DCTELEM (*)[4][16])block0, dc0);
+            call_new((DCTELEM (*)[4][16])block1, dc1);
+            if (memcmp(block0, block1, sizeof(block0)) || memcmp(dc0, dc1, sizeof(dc0)))
+                fail();
+            bench_new((DCTELEM (*)[4][16])block1, dc1);
+        }
+    }
+    {
+        static const char *const names[2] = { "vp8_idct_add", "vp8_idct_dc_add" };
+        void (*funcs[2])(uint8_t *, DCTELEM *, int) = { d->vp8_idct_add, d->vp8_idct_dc_add };
+        int i;
+        declare_func(void, uint8_t *, DCTELEM *, int);
+        for (i = 0; i < 2; i++) {
+            if (check_func(funcs[i], "%s", names[i])) {
+                randomize_buffer(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                memset(block0, 0, 16 * sizeof(DCTELEM));
+                randomize_coeffs(block0, i ? 1 : 16, i ? 1 << 11 : 1 << 8);
+                memcpy(block1, block0, 16 * sizeof(DCTELEM));
+                call_ref(dst0 + OFFSET, block0, STRIDE);
+                call_new(dst1 + OFFSET, block1, STRIDE);
+                if (memcmp(dst0, dst1, BUF_SIZE) ||
+                    memcmp(block0, block1, 16 * sizeof(DCTELEM)))
+                    fail();
+                bench_new(dst1 + OFFSET, block1, STRIDE);
+            }
+        }
+    }
+    {
+        static const char *const names[2] = { "vp8_idct_dc_add4y", "vp8_idct_dc_add4uv" };
+        void (*funcs[2])(uint8_t *, DCTELEM (*)[16], int) = {
+            d->vp8_idct_dc_add4y, d->vp8_idct_dc_add4uv
+        };
+        int i, j;
+        declare_func(void, uint8_t *, DCTELEM (*)[16], int);
+        for (i = 0; i < 2; i++) {
+            if (check_func(funcs[i], "%s", names[i])) {
+                randomize_buffer(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                memset(block0, 0, 4 * 16 * sizeof(DCTELEM));
+                for (j = 0; j < 4; j++)
+                    randomize_coeffs(block0 + 16 * j, 1, 1 << 11);
+                memcpy(block1, block0, 4 * 16 * sizeof(DCTELEM));
+                call_ref(dst0 + OFFSET, (DCTELEM (*)[16])block0, STRIDE);
+                call_new(dst1 + OFFSET, (DCTELEM (*)[16])block1, STRIDE);
+                if (memcmp(dst0, dst1, BUF_SIZE) ||
+                    memcmp(block0, block1, 4 * 16 * sizeof(DCTELEM)))
+                    fail();
+                bench_new(dst1 + OFFSET, (DCTELEM (*)[16])block1, STRIDE);
+            }
+        }
+    }
+}
+
+static void check_loop_filter(VP8DSPContext *d)
+{
+    DECLARE_ALIGNED(16, uint8_t, buf0)[BUF_SIZE * 2];
+    DECLARE_ALIGNED(16, uint8_t, buf1)[BUF_SIZE * 2];
+    static const char *const names[4] = {
+        "vp8_v_loop_filter16y", "vp8_h_loop_filter16y",
+        "vp8_v_loop_filter16y_inner", "vp8_h_loop_filter16y_inner",
+    };
+    void (*luma[4])(uint8_t *, int, int, int, int) = {
+        d->vp8_v_loop_filter16y, d->vp8_h_loop_filter16y,
+        d->vp8_v_loop_filter16y_inner, d->vp8_h_loop_filter16y_inner,
+    };
+    void (*chroma[4])(uint8_t *, uint8_t *, int, int, int, int) = {
+        d->vp8_v_loop_filter8uv, d->vp8_h_loop_filter8uv,
+        d->vp8_v_loop_filter8uv_inner, d->vp8_h_loop_filter8uv_inner,
+    };
+    void (*simple[2])(uint8_t *, int, int) = {
+        d->vp8_v_loop_filter_simple, d->vp8_h_loop_filter_simple
+    };
+    int i, j;
+
+    for (i = 0; i < 4; i++) {
+        {
+            declare_func(void, uint8_t *, int, int, int, int);
+            if (check_func(luma[i], "%s", names[i])) {
+                for (j = 0; j < 32; j++) {
+                    int flim_I = 1 + rnd() % 63, flim_E = 2 * (rnd() % 64) + flim_I;
+                    int hev = rnd() & 3;
+                    randomize_smooth(buf0, BUF_SIZE, flim_I / 2 + 1);
+                    memcpy(buf1, buf0, BUF_SIZE);
+                    call_ref(buf0 + OFFSET, STRIDE, flim_E, flim_I, hev);
+                    call_new(buf1 + OFFSET, STRIDE, flim_E, flim_I, hev);
+                    if (memcmp(buf0, buf1, BUF_SIZE))
+                        fail();
+                }
+                bench_new(buf1 + OFFSET, STRIDE, 80, 20, 2);
+            }
+        }
+        {
+            /* U and V planes interleaved by rows to share one stride */
+            declare_func(void, uint8_t *, uint8_t *, int, int, int, int);
+            if (check_func(chroma[i], "vp8_%c_loop_filter8uv%s",
+                           i & 1 ? 'h' : 'v', i & 2 ? "_inner" : "")) {
+                for (j = 0; j < 32; j++) {
+                    int flim_I = 1 + rnd() % 63, flim_E = 2 * (rnd() % 64) + flim_I;
+                    int hev = rnd() & 3;
+                    randomize_smooth(buf0, BUF_SIZE * 2, flim_I / 2 + 1);
+                    memcpy(buf1, buf0, BUF_SIZE * 2);
+                    call_ref(buf0 + OFFSET, buf0 + BUF_SIZE + OFFSET, STRIDE, flim_E, flim_I, hev);
+                    call_new(buf1 + OFFSET, buf1 + BUF_SIZE + OFFSET, STRIDE, flim_E, flim_I, hev);
+                    if (memcmp(buf0, buf1, BUF_SIZE * 2))
+                        fail();
+                }
+                bench_new(buf1 + OFFSET, buf1 + BUF_SIZE + OFFSET, STRIDE, 80, 20, 2);
+            }
+        }
+    }
+
+    for (i = 0; i < 2; i++) {
+        declare_func(void, uint8_t *, int, int);
+        if (check_func(simple[i], "vp8_%c_loop_filter_simple", i ? 'h' : 'v')) {
+            for (j = 0; j < 32; j++) {
+                int flim = rnd() % 190;
+                randomize_smooth(buf0, BUF_SIZE, flim / 4 + 1);
+                memcpy(buf1, buf0, BUF_SIZE);
+                call_ref(buf0 + OFFSET, STRIDE, flim);
+                call_new(buf1 + OFFSET, STRIDE, flim);
+                if (memcmp(buf0, buf1, BUF_SIZE))
+                    fail();
+            }
+            bench_new(buf1 + OFFSET, STRIDE, 80);
+        }
+    }
+}
+
+static void check_mc(vp8_mc_func (*tab)[3][3], int epel, const char *name)
+{
+    DECLARE_ALIGNED(16, uint8_t, src)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst0)[BUF_SIZE];
+    DECLARE_ALIGNED(16, uint8_t, dst1)[BUF_SIZE];
+    int i, dx, dy;
+    declare_func(void, uint8_t *, int, uint8_t *, int, int, int, int);
+
+    for (i = 0; i < 3; i++) {
+        int size = 16 >> i;
+        for (dy = 0; dy < 3; dy++) {
+            for (dx = 0; dx < 3; dx++) {
+                if (check_func(tab[i][dy][dx], "%s%d_%d%d", name, size, dx, dy)) {
+                    /* a 4-tap filter is for odd fractions, a 6-tap one
+                     * for even ones, the bilinear filter takes any */
+                    int mx = dx ? (epel ? (dx == 1 ? 1 + 2 * (rnd() & 3) : 2 + 2 * (rnd() % 3))
+                                        : 1 + rnd() % 7) : 0;
+                    int my = dy ? (epel ? (dy == 1 ? 1 + 2 * (rnd() & 3) : 2 + 2 * (rnd() % 3))
+                                        : 1 + rnd() % 7) : 0;
+                    randomize_buffer(src,  BUF_SIZE);
+                    randomize_buffer(dst0, BUF_SIZE);
+                    memcpy(dst1, dst0, BUF_SIZE);
+                    call_ref(dst0 + OFFSET, STRIDE, src + OFFSET + 1, STRIDE, size, mx, my);
+                    call_new(dst1 + OFFSET, STRIDE, src + OFFSET + 1, STRIDE, size, mx, my);
+                    if (memcmp(dst0, dst1, BUF_SIZE))
+                        fail();
+                    bench_new(dst1 + OFFSET, STRIDE, src + OFFSET + 1, STRIDE, size, mx, my);
+                }
+            }
+        }
+    }
+}
+
+void checkasm_check_vp8dsp(void)
+{
+    VP8DSPContext d;
+
+    ff_vp8dsp_init(&d);
+
+    check_idct(&d);
+    check_loop_filter(&d);
+    check_mc(d.put_vp8_epel_pixels_tab,     1, "put_vp8_epel");
+    check_mc(d.put_vp8_bilinear_pixels_tab, 0, "put_vp8_bilinear");
+}
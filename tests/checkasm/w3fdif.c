@@ -0,0 +1,160 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "config.h"
+#include "libavutil/cpu.h"
+#include "libavfilter/w3fdif.h"
+#include "checkasm.h"
+
+#define MAX_WIDTH 1930
+
+/* the coefficient sets of vf_w3fdif.c */
+static const int32_t coef_lf[2][4] = {{ 32768, 32768,     0,      0},
+                                      { -1704, 34472, 34472,  -1704}};
+static const int32_t coef_hf[2][5] = {{ -4096,  8192, -4096,     0,     0},
+                                      {  2032, -7602, 11140, -7602,  2032}};
+
+static const int widths[] = { 1, 7, 8, 9, 16, 61, 720, 1920, MAX_WIDTH };
+
+static uint16_t lines[10][MAX_WIDTH];
+
+/* pattern 0 is random, 1 and 2 the extreme values the scaling clips */
+static void fill_lines(int depth, int pattern)
+{
+    int i, j, max = (1 << depth) - 1;
+
+    for (i = 0; i < 10; i++) {
+        for (j = 0; j < MAX_WIDTH; j++) {
+            int v = rnd() & max;
+            if (pattern)
+                v = (i & 1) == pattern - 1 ? max : 0;
+            if (depth > 8)
+                lines[i][j] = v;
+            else
+                ((uint8_t *)lines[i])[j] = v;
+        }
+    }
+}
+
+/* the functions advance the line pointers they are given */
+static void set_lines(uint8_t *cur[5], uint8_t *adj[5])
+{
+    int i;
+
+    for (i = 0; i < 5; i++) {
+        cur[i] = (uint8_t *)lines[i];
+        adj[i] = (uint8_t *)lines[i + 5];
+    }
+}
+
+static void check_low(void (*func)(int32_t *, uint8_t **, const int32_t *, int),
+                      const char *name, int depth, const int32_t *coef)
+{
+    DECLARE_ALIGNED(16, int32_t, work0)[MAX_WIDTH];
+    DECLARE_ALIGNED(16, int32_t, work1)[MAX_WIDTH];
+    uint8_t *cur[5], *adj[5];
+    int i, pattern;
+    declare_func(void, int32_t *, uint8_t **, const int32_t *, int);
+
+    if (check_func(func, "w3fdif_%s_%d", name, depth)) {
+        for (pattern = 0; pattern < 3; pattern++) {
+            fill_lines(depth, pattern);
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                memset(work0, 0x55, sizeof(work0));
+                memset(work1, 0x55, sizeof(work1));
+                set_lines(cur, adj);
+                call_ref(work0, cur, coef, widths[i]);
+                set_lines(cur, adj);
+                call_new(work1, cur, coef, widths[i]);
+                if (memcmp(work0, work1, sizeof(work0)))
+                    fail();
+            }
+        }
+        set_lines(cur, adj);
+        bench_new(work1, cur, coef, 1920);
+    }
+}
+
+static void check_high(void (*func)(int32_t *, uint8_t **, uint8_t **, const int32_t *, int),
+                       const char *name, int depth, const int32_t *coef)
+{
+    DECLARE_ALIGNED(16, int32_t, work0)[MAX_WIDTH];
+    DECLARE_ALIGNED(16, int32_t, work1)[MAX_WIDTH];
+    uint8_t *cur[5], *adj[5];
+    int i, pattern;
+    declare_func(void, int32_t *, uint8_t **, uint8_t **, const int32_t *, int);
+
+    if (check_func(func, "w3fdif_%s_%d", name, depth)) {
+        for (pattern = 0; pattern < 3; pattern++) {
+            fill_lines(depth, pattern);
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                /* the high frequency filters add to the low frequency result */
+                memset(work0, 0x05, sizeof(work0));
+                memset(work1, 0x05, sizeof(work1));
+                set_lines(cur, adj);
+                call_ref(work0, cur, adj, coef, widths[i]);
+                set_lines(cur, adj);
+                call_new(work1, cur, adj, coef, widths[i]);
+                if (memcmp(work0, work1, sizeof(work0)))
+                    fail();
+            }
+        }
+        set_lines(cur, adj);
+        bench_new(work1, cur, adj, coef, 1920);
+    }
+}
+
+static void check_scale(void (*func)(uint8_t *, const int32_t *, int, int), int depth)
+{
+    DECLARE_ALIGNED(16, int32_t, work)[MAX_WIDTH];
+    uint16_t out0[MAX_WIDTH + 1], out1[MAX_WIDTH + 1];
+    int i, j, max = (1 << depth) - 1;
+    declare_func(void, uint8_t *, const int32_t *, int, int);
+
+    if (check_func(func, "w3fdif_scale_%d", depth)) {
+        /* filter sums, beyond the range of the samples on both sides */
+        for (j = 0; j < MAX_WIDTH; j++)
+            work[j] = (int)(rnd() % (3u << (depth + 16))) - (1 << (depth + 16));
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            memset(out0, 0x55, sizeof(out0));
+            memset(out1, 0x55, sizeof(out1));
+            call_ref((uint8_t *)out0, work, widths[i], max);
+            call_new((uint8_t *)out1, work, widths[i], max);
+            if (memcmp(out0, out1, sizeof(out0)))
+                fail();
+        }
+        bench_new((uint8_t *)out1, work, 1920, max);
+    }
+}
+
+void checkasm_check_w3fdif(void)
+{
+    static const int depths[] = { 8, 10 };
+    W3FDIFDSPContext c;
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(depths); i++) {
+        ff_w3fdif_init_dsp(&c, depths[i], av_get_cpu_flags());
+        check_low (c.filter_simple_low,   "simple_low",   depths[i], coef_lf[0]);
+        check_low (c.filter_complex_low,  "complex_low",  depths[i], coef_lf[1]);
+        check_high(c.filter_simple_high,  "simple_high",  depths[i], coef_hf[0]);
+        check_high(c.filter_complex_high, "complex_high", depths[i], coef_hf[1]);
+        check_scale(c.filter_scale, depths[i]);
+    }
+}
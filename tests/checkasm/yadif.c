@@ -0,0 +1,95 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "libavutil/cpu.h"
+#include "libavfilter/yadif.h"
+#include "checkasm.h"
+
+#define WIDTH    512
+#define STRIDE   (WIDTH + 64)
+/* 2 lines above and below the current one, with 32 bytes on each side */
+#define BUF_SIZE (STRIDE * 5)
+#define OFFSET   (STRIDE * 2 + 32)
+
+typedef void (*filter_line_func)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                                 int w, int prefs, int mrefs, int parity, int mode);
+
+/* same selection as the filter */
+static filter_line_func get_filter_line(void)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (HAVE_SSSE3 && cpu_flags & AV_CPU_FLAG_SSSE3)
+        return ff_yadif_filter_line_ssse3;
+    if (HAVE_SSE && cpu_flags & AV_CPU_FLAG_SSE2)
+        return ff_yadif_filter_line_sse2;
+    if (HAVE_MMX && cpu_flags & AV_CPU_FLAG_MMX)
+        return ff_yadif_filter_line_mmx;
+    return ff_yadif_filter_line_c;
+}
+
+static void randomize_field(uint8_t *buf, int base)
+{
+    int i;
+    for (i = 0; i < BUF_SIZE; i++)
+        buf[i] = av_clip_uint8(base + (int)(rnd() % 64) - 32);
+}
+
+void checkasm_check_yadif(void)
+{
+    uint8_t *prev = av_malloc(BUF_SIZE);
+    uint8_t *cur  = av_malloc(BUF_SIZE);
+    uint8_t *next = av_malloc(BUF_SIZE);
+    uint8_t *dst0 = av_malloc(STRIDE);
+    uint8_t *dst1 = av_malloc(STRIDE);
+    int mode, parity;
+    declare_func(void, uint8_t *, uint8_t *, uint8_t *, uint8_t *, int, int, int, int, int);
+
+    if (!prev || !cur || !next || !dst0 || !dst1)
+        goto end;
+
+    /* mode 2 and up skips the spatial interlacing check */
+    for (mode = 0; mode < 4; mode += 2) {
+        if (check_func(get_filter_line(), "yadif_filter_line_mode%d", mode)) {
+            int base = 64 + rnd() % 128;
+            randomize_field(prev, base);
+            randomize_field(cur,  base);
+            randomize_field(next, base);
+            for (parity = 0; parity < 2; parity++) {
+                memset(dst0, 0, STRIDE);
+                memset(dst1, 0, STRIDE);
+                call_ref(dst0, prev + OFFSET, cur + OFFSET, next + OFFSET,
+                         WIDTH, STRIDE, -STRIDE, parity, mode);
+                call_new(dst1, prev + OFFSET, cur + OFFSET, next + OFFSET,
+                         WIDTH, STRIDE, -STRIDE, parity, mode);
+                if (memcmp(dst0, dst1, WIDTH))
+                    fail();
+            }
+            bench_new(dst1, prev + OFFSET, cur + OFFSET, next + OFFSET,
+                      WIDTH, STRIDE, -STRIDE, 0, mode);
+        }
+    }
+
+end:
+    av_free(prev);
+    av_free(cur);
+    av_free(next);
+    av_free(dst0);
+    av_free(dst1);
+}
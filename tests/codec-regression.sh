@@ -45,6 +45,10 @@ do_video_decoding "-idct int"
 # mpeg2 encoding interlaced
 do_video_encoding mpeg2i.mpg "-qscale 10 -vcodec mpeg2video -f mpeg1video -bff"
 do_video_decoding
+
+# mpeg2 b-frame decision by lookahead encodes, with scene cuts in closed gops
+do_video_encoding mpeg2bstrategy.mpg "-qscale 10 -vcodec mpeg2video -f mpeg1video -bf 3 -b_strategy 2 -brd_scale 1 -flags +cgop -sc_threshold 0"
+do_video_decoding
 fi
 if [ -n "$do_mpeg2thread" ] ; then
 # mpeg2 encoding interlaced
@@ -54,6 +58,10 @@ do_video_decoding
 # mpeg2 encoding interlaced using intra vlc
 do_video_encoding mpeg2threadivlc.mpg "-qscale 10 -vcodec mpeg2video -f mpeg1video -bf 2 -bff -flags2 +ivlc -threads 2"
 do_video_decoding
+
+# mpeg2 b-frame decision candidates encoded in parallel
+do_video_encoding mpeg2threadbstrategy.mpg "-qscale 10 -vcodec mpeg2video -f mpeg1video -bf 3 -b_strategy 2 -brd_scale 1 -threads 2"
+do_video_decoding
 fi
 
 if [ -n "$do_msmpeg4v2" ] ; then
@@ -357,6 +365,14 @@ do_ffmpeg_nomd5 $pcm_dst $DEC_OPTS -i $target_path/$file -f wav
 $tiny_psnr $pcm_dst $pcm_ref 2 8192
 fi
 
+if [ -n "$do_s302m" ] ; then
+# 302M only carries 48 kHz, read the samples at that rate so that the
+# round trip is lossless
+file=${outfile}s302m.ts
+do_ffmpeg $file $DEC_OPTS -ac 2 -ar 48000 -f s16le -i $pcm_src $ENC_OPTS -acodec s302m
+do_audio_decoding
+fi
+
 #if [ -n "$do_vorbis" ] ; then
 # vorbis
 #disabled because it is broken
@@ -392,4 +408,9 @@ do_audio_enc_dec au  dbl pcm_f64be
 do_audio_enc_dec wav dbl pcm_f64le
 do_audio_enc_dec wav s16 pcm_zork
 do_audio_enc_dec 302 s16 pcm_s24daud "-ac 6 -ar 96000"
+# channels merged by -map_audio_channel
+do_audio_encoding pcm_s16le_map.wav "-acodec pcm_s16le -map_audio_channel 0.0:0:0.0:0 -map_audio_channel 0.0:1:0.0:1"
+do_audio_decoding
+do_audio_encoding pcm_f32le_map.wav "-acodec pcm_f32le -map_audio_channel 0.0:0:0.0:0 -map_audio_channel 0.0:1:0.0:1"
+do_audio_decoding
 fi
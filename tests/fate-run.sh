@@ -73,6 +73,31 @@ pcm(){
     ffmpeg "$@" -vn -f s16le -
 }
 
+segments(){
+    src=$1
+    out=${outdir}/${test}.avi
+    shift
+    cleanfiles=$out
+    ffmpeg -i $target_path/$src "$@" -segments 3 -y $target_path/$out || return
+    framemd5 -i $target_path/$out -vcodec copy
+}
+
+dtsorder(){
+    fmt=$1
+    out=${outdir}/${test}.${fmt}
+    shift
+    cleanfiles=$out
+    ffmpeg -f image2 -vcodec pgmyuv -i $target_path/tests/vsynth1/%02d.pgm "$@" -f $fmt -y $target_path/$out || return
+    run ffprobe -show_packets $target_path/$out 2>/dev/null | awk -F= '
+        /^\[PACKET\]/   { pts = dts = "" }
+        /^pts=/         { pts = $2 }
+        /^dts=/         { dts = $2 }
+        /^\[\/PACKET\]/  { if (pts == "N/A" || dts == "N/A" || pts + 0 < dts + 0 ||
+                              (n && dts + 0 <= last)) bad++
+                          last = dts + 0; n++ }
+        END             { printf "%d packets, %d out of order\n", n, bad }'
+}
+
 regtest(){
     t="${test#$2-}"
     ref=${base}/ref/$2/$t
@@ -95,6 +120,9 @@ lavfitest(){
 seektest(){
     t="${test#seek-}"
     ref=${base}/ref/seek/$t
+    case $t in
+        idxcache_*) opts=-idxcache; t="${t#idxcache_}" ;;
+    esac
     case $t in
         image_*) file="tests/data/images/${t#image_}/%02d.${t#image_}" ;;
         *)       file=$(echo $t | tr _ '?')
@@ -108,7 +136,7 @@ seektest(){
         roq*) fps=30 ;;
         *)    fps=25 ;;
     esac
-    $target_exec $target_path/libavformat/seek-test $target_path/$file $fps
+    $target_exec $target_path/libavformat/seek-test $opts $target_path/$file $fps
 }
 
 mkdir -p "$outdir"
@@ -0,0 +1,3 @@
+FATE_TESTS += fate-checkasm
+fate-checkasm: tests/checkasm/checkasm$(EXESUF)
+fate-checkasm: CMD = run tests/checkasm/checkasm
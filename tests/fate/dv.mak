@@ -0,0 +1,3 @@
+FATE_TESTS += fate-dvaudio
+fate-dvaudio: libavformat/dvaudio-test$(EXESUF)
+fate-dvaudio: CMD = run libavformat/dvaudio-test
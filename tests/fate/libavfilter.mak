@@ -0,0 +1,3 @@
+FATE_TESTS += fate-drawutils
+fate-drawutils: libavfilter/drawutils-test$(EXESUF)
+fate-drawutils: CMD = run libavfilter/drawutils-test
@@ -0,0 +1,11 @@
+# the decoding times x264 returns with a B-pyramid start below 0, they
+# must stay increasing and not exceed the presentation times once muxed
+FATE_LIBX264-$(CONFIG_LIBX264_ENCODER) += fate-libx264-bpyramid-mov
+fate-libx264-bpyramid-mov: CMD = dtsorder mov -vcodec libx264 -bf 3 -b_pyramid normal
+
+FATE_LIBX264-$(CONFIG_LIBX264_ENCODER) += fate-libx264-bpyramid-ts
+fate-libx264-bpyramid-ts: CMD = dtsorder mpegts -vcodec libx264 -bf 3 -b_pyramid normal
+
+FATE_LIBX264 = $(FATE_LIBX264-yes)
+$(FATE_LIBX264): ffprobe$(EXESUF) tests/vsynth1/00.pgm
+fate-libx264: $(FATE_LIBX264)
@@ -0,0 +1,10 @@
+# the reference is the framemd5 of the same transcode without -segments
+FATE_TESTS += fate-segments-mjpeg
+fate-segments-mjpeg: fate-vsynth1-mjpeg
+fate-segments-mjpeg: CMD = segments tests/data/vsynth1/mjpeg.avi -an -vcodec mjpeg -qscale 9
+
+# with audio, transcoded by a job of its own, and a drop frame timecode
+# crossing a minute, shifted to the start of each segment
+FATE_TESTS += fate-segments-mpeg2-dftc
+fate-segments-mpeg2-dftc: fate-lavf-avi
+fate-segments-mpeg2-dftc: CMD = segments tests/data/lavf/lavf_ntsc.avi -vcodec mpeg2video -intra -flags +cgop -sc_threshold 1000000000 -qscale 10 -acodec pcm_s16le -timecode 00:00:59;26
@@ -58,6 +58,7 @@ do_audio_only()
 
 if [ -n "$do_avi" ] ; then
 do_lavf avi
+do_lavf avi "-ar 48000 -r 30000/1001 -vcodec mjpeg" '' 'lavf_ntsc.avi'
 fi
 
 if [ -n "$do_asf" ] ; then
@@ -93,6 +94,7 @@ fi
 
 if [ -n "$do_ts" ] ; then
 do_lavf ts
+do_lavf ts "-muxrate 4000000" '' 'lavf_cbr.ts'
 fi
 
 if [ -n "$do_swf" ] ; then
@@ -165,6 +167,14 @@ fi
 
 if [ -n "$do_pgm" ] ; then
 do_image_formats pgm
+file=${outfile}%02d.pgm
+do_ffmpeg_crc $file $DEC_OPTS -prefetch 4 -io_threads 2 -i $target_path/$file
+outfile="$datadir/images/pgm_wb/"
+mkdir -p "$outfile"
+file=${outfile}%02d.pgm
+run_ffmpeg $DEC_OPTS -f image2 -vcodec pgmyuv -i $raw_src $ENC_OPTS -t 0.5 -y -qscale 10 -write_threads 2 -write_queue 2 -write_precreate 2 $target_path/$file
+do_md5sum ${outfile}02.pgm
+do_ffmpeg_crc $file $DEC_OPTS -i $target_path/$file
 fi
 
 if [ -n "$do_ppm" ] ; then
@@ -199,6 +209,12 @@ if [ -n "$do_pcx" ] ; then
 do_image_formats pcx
 fi
 
+if [ -n "$do_dpx" ] ; then
+do_image_formats dpx "-pix_fmt yuv422p10le"
+# 4:2:2 10-bit is stored losslessly, the source has the same crc
+do_ffmpeg_crc ${outfile}source $DEC_OPTS -f image2 -vcodec pgmyuv -i $raw_src -pix_fmt yuv422p10le $ENC_OPTS -t 0.5
+fi
+
 # audio only
 
 if [ -n "$do_wav" ] ; then
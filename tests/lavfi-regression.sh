@@ -24,20 +24,27 @@ do_lavfi() {
     vfilters="slicify=random,$2"
 
     if [ $test = $1 ] ; then
-        do_video_filter $test "$vfilters"
+        shift 2
+        do_video_filter $test "$vfilters" "$@"
     fi
 }
 
+do_lavfi "colormatrix"        "colormatrix=bt709:bt601"
 do_lavfi "crop"               "crop=iw-100:ih-100:100:100"
 do_lavfi "crop_scale"         "crop=iw-100:ih-100:100:100,scale=400:-1"
 do_lavfi "crop_scale_vflip"   "null,null,crop=iw-200:ih-200:200:200,crop=iw-20:ih-20:20:20,scale=200:200,scale=250:250,vflip,vflip,null,scale=200:200,crop=iw-100:ih-100:100:100,vflip,scale=200:200,null,vflip,crop=iw-100:ih-100:100:100,null"
 do_lavfi "crop_vflip"         "crop=iw-100:ih-100:100:100,vflip"
+do_lavfi "framerate_mc"       "framerate=fps=30000/1001:flags=scd+mc:threads=3" -r 30000/1001
 do_lavfi "null"               "null"
+do_lavfi "overlay"            "null[m];color=red@0.5:90x66,format=yuva420p,pad=100:76:4:4:blue@0.25,fade=in:0:25:alpha=1,slicify=random[o];[m][o]overlay=49:31"
+do_lavfi "overlay_premultiplied" "null[m];color=red@0.5:90x66,format=yuva420p,pad=100:76:4:4:blue@0.25,fade=in:0:25:alpha=1,slicify=random[o];[m][o]overlay=49:31:premultiplied=1"
 do_lavfi "scale200"           "scale=200:200"
 do_lavfi "scale500"           "scale=500:500"
+do_lavfi "scale_colormatrix"  "scale=200:100:in_color_matrix=bt709:out_color_matrix=bt601"
 do_lavfi "vflip"              "vflip"
 do_lavfi "vflip_crop"         "vflip,crop=iw-100:ih-100:100:100"
 do_lavfi "vflip_vflip"        "vflip,vflip"
+do_lavfi "w3fdif"             "w3fdif=0:1"
 
 do_lavfi_pixfmts(){
     test ${test%_[bl]e} = pixfmts_$1 || return 0
@@ -61,6 +68,7 @@ do_lavfi_pixfmts(){
 }
 
 # all these filters have exactly one input and exactly one output
+do_lavfi_pixfmts "colormatrix" "bt709:bt601"
 do_lavfi_pixfmts "copy"    ""
 do_lavfi_pixfmts "crop"    "100:100:100:100"
 do_lavfi_pixfmts "hflip"   ""
@@ -68,6 +76,7 @@ do_lavfi_pixfmts "null"    ""
 do_lavfi_pixfmts "pad"     "500:400:20:20"
 do_lavfi_pixfmts "scale"   "200:100"
 do_lavfi_pixfmts "vflip"   ""
+do_lavfi_pixfmts "w3fdif"  "1:3"
 
 if [ -n "$do_pixdesc" ]; then
     pix_fmts="$($ffmpeg -pix_fmts list 2>/dev/null | sed -ne '9,$p' | grep '^IO' | cut -d' ' -f2 | sort)"
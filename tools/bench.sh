@@ -0,0 +1,41 @@
+#
+# Helpers shared by the tools/*-bench scripts, sourced after setting NAME.
+#
+# Timings are read from the -benchmark_file CSV of each run, so that a
+# benchmark reports the stage it measures, e.g. the encoder, and not the
+# probing, decoding and scaling around it. Only POSIX sh and awk are used.
+
+FFMBC=${FFMBC:-./ffmbc}
+
+TMP=${TMPDIR:-/tmp}/$NAME.$$
+mkdir -p $TMP || exit 1
+trap 'rm -rf $TMP' EXIT
+
+# keep the logs of the failed run and exit
+bench_fail(){
+    echo "$1 failed, see $TMP"
+    trap - EXIT
+    exit 1
+}
+
+# run ffmbc, the stage timings go to $TMP/name.csv and the log to $TMP/name.log
+# usage: bench_run name ffmbc options
+bench_run(){
+    bench_out=$TMP/$1
+    shift
+    $FFMBC -y -benchmark_file $bench_out.csv "$@" < /dev/null 2> $bench_out.log
+}
+
+# frames and seconds spent in a stage by the video streams of a run
+# usage: stage_of name stage
+stage_of(){
+    awk -F, -v stage=$2 '$1 == stage && $4 == "video" { n += $5; t += $6 }
+        END { print n + 0, t + 0 }' $TMP/$1.csv
+}
+
+# print the frames, seconds and frames per second of a stage of a run
+# usage: bench_report name stage
+bench_report(){
+    echo "$1 $(stage_of $1 $2)" | awk '{
+        printf "%-12s %6d frames %8.2fs %8.2f fps\n", $1, $2, $3, ($3 > 0 ? $2 / $3 : 0) }'
+}
@@ -0,0 +1,95 @@
+/*
+ * Demuxer throughput benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libavformat/avformat.h"
+
+static int usage(int ret)
+{
+    fprintf(stderr, "measure how fast libavformat demuxes a file, without decoding.\n");
+    fprintf(stderr, "demux-bench [-f format] [-p program] file [runs]\n");
+    fprintf(stderr, "-f\tforce input format\n");
+    fprintf(stderr, "-p\tonly keep program with this id, discard the others\n");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVInputFormat *fmt = NULL;
+    int program = -1;
+    int runs = 3;
+    int run;
+
+    while (argc > 2 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-f")) {
+            fmt = av_find_input_format(argv[2]);
+            if (!fmt) {
+                fprintf(stderr, "unknown format %s\n", argv[2]);
+                return 1;
+            }
+        } else if (!strcmp(argv[1], "-p")) {
+            program = atoi(argv[2]);
+        } else
+            return usage(1);
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc < 2)
+        return usage(1);
+    if (argc > 2)
+        runs = atoi(argv[2]);
+
+    av_register_all();
+
+    for (run = 0; run < runs; run++) {
+        AVFormatContext *fctx = NULL;
+        AVPacket pkt;
+        int64_t bytes = 0, pkts = 0, t;
+        int i, err;
+
+        err = avformat_open_input(&fctx, argv[1], fmt, NULL);
+        if (err < 0) {
+            fprintf(stderr, "avformat_open_input: error %d\n", err);
+            return 1;
+        }
+        if (program >= 0) {
+            for (i = 0; i < fctx->nb_programs; i++)
+                if (fctx->programs[i]->id != program)
+                    fctx->programs[i]->discard = AVDISCARD_ALL;
+        }
+
+        t = av_gettime();
+        while ((err = av_read_frame(fctx, &pkt)) >= 0) {
+            bytes += pkt.size;
+            pkts++;
+            av_free_packet(&pkt);
+        }
+        t = av_gettime() - t;
+
+        printf("run %d: %"PRId64" packets, %"PRId64" payload bytes in %.3fs, "
+               "%.1f MB/s of input, %.0f packets/s\n", run, pkts, bytes, t / 1e6,
+               avio_size(fctx->pb) / (double)FFMAX(t, 1), pkts * 1e6 / FFMAX(t, 1));
+        av_close_input_file(fctx);
+    }
+
+    return 0;
+}